@@ -0,0 +1,21 @@
+// swift-tools-version:4.2
+//
+// Command line build of the software renderer (`deepmap-render`). The sources are shared with
+// the app, which compiles all of Sources/DeepMapRender except main.swift.
+
+import PackageDescription
+
+let package = Package(
+    name: "DeepMapRender",
+    products: [
+        .executable(name: "deepmap-render", targets: ["DeepMapRender"]),
+    ],
+    targets: [
+        .systemLibrary(name: "CSQLite", pkgConfig: "sqlite3",
+                       providers: [.apt(["libsqlite3-dev"]), .brew(["sqlite3"])]),
+        .systemLibrary(name: "CZlib", pkgConfig: "zlib",
+                       providers: [.apt(["zlib1g-dev"]), .brew(["zlib"])]),
+        .target(name: "DeepMapRender", dependencies: ["CSQLite", "CZlib"]),
+    ],
+    swiftLanguageVersions: [.v4]
+)
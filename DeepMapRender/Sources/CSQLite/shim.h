@@ -0,0 +1 @@
+#include <sqlite3.h>
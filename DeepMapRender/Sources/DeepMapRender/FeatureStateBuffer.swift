@@ -0,0 +1,156 @@
+//
+//  FeatureStateBuffer.swift
+//  DeepMapRender
+//
+//  Created by agent on 18.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+import Foundation
+
+/// Interaction state of a feature.
+struct FeatureState: OptionSet {
+    let rawValue: UInt8
+
+    static let selected = FeatureState(rawValue: 1 << 0)
+    static let highlighted = FeatureState(rawValue: 1 << 1)
+}
+
+/// Selection and highlight state of every feature, one byte per `FeatureTagStore` row.
+///
+/// Changing a state is a single byte write plus a dirty mark, independent of the number of
+/// features. Renderers read the buffer directly (`withStates`), and `apply(to:)` sends only
+/// the net change of each dirty feature to the map, so a feature highlighted and
+/// unhighlighted again before the next frame costs no map call at all.
+/// Features missing from the store are kept in a dictionary. Use from one thread.
+final class FeatureStateBuffer {
+
+    let store: FeatureTagStore?
+
+    /// Incremented on every change, for renderers caching derived data.
+    private(set) var version: UInt64 = 0
+
+    private var states: [UInt8]
+    private var applied: [UInt8]
+    private var dirty: FeatureBitset
+    private var dirtyRows: [Int32] = []
+
+    private var overflow: [UInt64: UInt8] = [:]
+    private var appliedOverflow: [UInt64: UInt8] = [:]
+    private var dirtyOverflow = Set<UInt64>()
+
+    init(store: FeatureTagStore?) {
+        self.store = store
+        let count = store?.count ?? 0
+        states = [UInt8](repeating: 0, count: count)
+        applied = [UInt8](repeating: 0, count: count)
+        dirty = FeatureBitset(count: count)
+    }
+
+    func state(of featureId: UInt64) -> FeatureState {
+        if let row = store?.row(ofFeature: featureId) {
+            return FeatureState(rawValue: states[row])
+        }
+        return FeatureState(rawValue: overflow[featureId] ?? 0)
+    }
+
+    /// Adds `state` to a feature; false if it already had it.
+    @discardableResult
+    func insert(_ state: FeatureState, featureId: UInt64) -> Bool {
+        let current = self.state(of: featureId)
+        guard !current.contains(state) else { return false }
+        set(current.union(state), featureId: featureId)
+        return true
+    }
+
+    /// Removes `state` from a feature; false if it did not have it.
+    @discardableResult
+    func remove(_ state: FeatureState, featureId: UInt64) -> Bool {
+        let current = self.state(of: featureId)
+        guard !current.isDisjoint(with: state) else { return false }
+        set(current.subtracting(state), featureId: featureId)
+        return true
+    }
+
+    /// Features that currently have all of `state`.
+    func featureIds(with state: FeatureState) -> [UInt64] {
+        var featureIds: [UInt64] = []
+        if let store = store {
+            for (row, value) in states.enumerated() where FeatureState(rawValue: value).isSuperset(of: state) {
+                featureIds.append(store.featureIds[row])
+            }
+        }
+        for (featureId, value) in overflow where FeatureState(rawValue: value).isSuperset(of: state) {
+            featureIds.append(featureId)
+        }
+        return featureIds
+    }
+
+    var hasPendingChanges: Bool {
+        return !dirtyRows.isEmpty || !dirtyOverflow.isEmpty
+    }
+
+    /// Calls `body` with the state of every store row, as `FeatureState` raw values.
+    func withStates<Result>(_ body: (UnsafeBufferPointer<UInt8>) throws -> Result) rethrows -> Result {
+        return try states.withUnsafeBufferPointer(body)
+    }
+
+    /// Sends the changes since the last call to the map.
+    ///
+    /// - returns: The number of map calls made.
+    @discardableResult
+    func apply(to mapView: StyleTarget) -> Int {
+        var calls = 0
+        for row in dirtyRows {
+            let row = Int(row)
+            calls += FeatureStateBuffer.apply(from: applied[row], to: states[row], featureId: store!.featureIds[row], mapView: mapView)
+            applied[row] = states[row]
+            dirty[row] = false
+        }
+        dirtyRows.removeAll(keepingCapacity: true)
+
+        for featureId in dirtyOverflow {
+            let state = overflow[featureId] ?? 0
+            calls += FeatureStateBuffer.apply(from: appliedOverflow[featureId] ?? 0, to: state, featureId: featureId, mapView: mapView)
+            appliedOverflow[featureId] = state == 0 ? nil : state
+        }
+        dirtyOverflow.removeAll()
+        return calls
+    }
+
+    private func set(_ state: FeatureState, featureId: UInt64) {
+        version += 1
+        if let row = store?.row(ofFeature: featureId) {
+            states[row] = state.rawValue
+            if !dirty[row] {
+                dirty[row] = true
+                dirtyRows.append(Int32(row))
+            }
+        } else {
+            overflow[featureId] = state.rawValue == 0 ? nil : state.rawValue
+            dirtyOverflow.insert(featureId)
+        }
+    }
+
+    private static func apply(from old: UInt8, to new: UInt8, featureId: UInt64, mapView: StyleTarget) -> Int {
+        let old = FeatureState(rawValue: old), new = FeatureState(rawValue: new)
+        var calls = 0
+        if old.contains(.selected) != new.contains(.selected) {
+            if new.contains(.selected) {
+                mapView.selectFeature(withId: featureId)
+            } else {
+                mapView.deselectFeature(withId: featureId)
+            }
+            calls += 1
+        }
+        if old.contains(.highlighted) != new.contains(.highlighted) {
+            if new.contains(.highlighted) {
+                mapView.highlightFeature(withId: featureId)
+            } else {
+                mapView.unhighlightFeature(withId: featureId)
+            }
+            calls += 1
+        }
+        return calls
+    }
+}
@@ -0,0 +1,279 @@
+//
+//  FeatureTagStore.swift
+//  DeepMapRender
+//
+//  Created by agent on 18.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+import Foundation
+
+/// Column handle of an attribute key of a `FeatureTagStore`.
+struct AttributeKey: Hashable {
+    let rawValue: UInt32
+
+    var hashValue: Int {
+        return Int(rawValue)
+    }
+
+    static func == (lhs: AttributeKey, rhs: AttributeKey) -> Bool {
+        return lhs.rawValue == rhs.rawValue
+    }
+}
+
+/// Pre-resolved key pair for localized lookups such as "name:de" with fallback to "name".
+struct LocalizedAttributeKey {
+    let localized: AttributeKey?
+    let fallback: AttributeKey?
+}
+
+/// Columnar, read-only copy of the `tags` table of a Deep Map database.
+///
+/// Every attribute key owns one column. Keys present on most features are stored densely
+/// (one value slot per feature), rare keys as a sorted (row, value) list. Keys are interned in
+/// the shared `SymbolTable`; values are interned per store, so reading an attribute through a
+/// `FeatureView` returns a shared string without copying.
+final class FeatureTagStore {
+
+    fileprivate enum Column {
+        case dense([UInt32])
+        case sparse(rows: [Int32], values: [UInt32])
+    }
+
+    /// Marks an empty slot of a dense column.
+    fileprivate static let absent = UInt32.max
+
+    /// Keys covering at least 1/denseThreshold of all features get a dense column.
+    private static let denseThreshold = 16
+
+    /// Feature IDs in ascending order; the index of an ID is the feature's row.
+    let featureIds: [UInt64]
+
+    fileprivate let columns: [Column]
+    fileprivate let values: [String]
+    /// Key of every column.
+    let keySymbols: [Symbol]
+    private let columnOfKey: [Symbol: AttributeKey]
+
+    /// Reads the complete `tags` table of the database at `path`.
+    convenience init(databasePath path: String) throws {
+        let reader = try SQLiteReader(path: path)
+        var rows: [(UInt64, String, String)] = []
+        try reader.query("SELECT object_id, key, value FROM tags WHERE key IS NOT NULL AND value IS NOT NULL") { row, _ in
+            rows.append((UInt64(bitPattern: row.int64(at: 0)), row.string(at: 1) ?? "", row.string(at: 2) ?? ""))
+            return true
+        }
+        self.init(tags: rows)
+    }
+
+    /// Builds a store from (featureId, key, value) triples in any order.
+    init(tags: [(UInt64, String, String)]) {
+        var keySymbols: [Symbol] = []
+        var keyIndex: [String: AttributeKey] = [:]
+        var values: [String] = []
+        var valueIndex: [String: UInt32] = [:]
+
+        let featureIds = Array(Set(tags.map { $0.0 })).sorted()
+        var rowOfFeature: [UInt64: Int32] = [:]
+        rowOfFeature.reserveCapacity(featureIds.count)
+        for (row, id) in featureIds.enumerated() {
+            rowOfFeature[id] = Int32(row)
+        }
+
+        // (row, value) pairs per key, rows ascending once sorted
+        var entries: [[(Int32, UInt32)]] = []
+        for (featureId, key, value) in tags {
+            let keyHandle: AttributeKey
+            if let existing = keyIndex[key] {
+                keyHandle = existing
+            } else {
+                keyHandle = AttributeKey(rawValue: UInt32(keySymbols.count))
+                keyIndex[key] = keyHandle
+                keySymbols.append(Symbol(key))
+                entries.append([])
+            }
+
+            let valueHandle: UInt32
+            if let existing = valueIndex[value] {
+                valueHandle = existing
+            } else {
+                valueHandle = UInt32(values.count)
+                valueIndex[value] = valueHandle
+                values.append(value)
+            }
+            entries[Int(keyHandle.rawValue)].append((rowOfFeature[featureId]!, valueHandle))
+        }
+
+        self.featureIds = featureIds
+        self.keySymbols = keySymbols
+        var columnOfKey: [Symbol: AttributeKey] = [:]
+        for (index, symbol) in keySymbols.enumerated() {
+            columnOfKey[symbol] = AttributeKey(rawValue: UInt32(index))
+        }
+        self.columnOfKey = columnOfKey
+        self.values = values
+        self.columns = entries.map { pairs -> Column in
+            if pairs.count * FeatureTagStore.denseThreshold >= featureIds.count {
+                var slots = [UInt32](repeating: FeatureTagStore.absent, count: featureIds.count)
+                for (row, value) in pairs {
+                    slots[Int(row)] = value
+                }
+                return .dense(slots)
+            }
+            // the last occurrence of a duplicate (row, key) wins, as in the dense case
+            let sorted = pairs.enumerated().sorted { a, b in
+                a.element.0 != b.element.0 ? a.element.0 < b.element.0 : a.offset < b.offset
+            }
+            var rows: [Int32] = []
+            var rowValues: [UInt32] = []
+            for (_, pair) in sorted {
+                if rows.last == pair.0 {
+                    rowValues[rowValues.count - 1] = pair.1
+                } else {
+                    rows.append(pair.0)
+                    rowValues.append(pair.1)
+                }
+            }
+            return .sparse(rows: rows, values: rowValues)
+        }
+    }
+
+    var count: Int {
+        return featureIds.count
+    }
+
+    /// All attribute keys in the store.
+    var keys: [String] {
+        return keySymbols.map { $0.string }
+    }
+
+    // MARK: - Keys
+
+    func key(_ symbol: Symbol) -> AttributeKey? {
+        return columnOfKey[symbol]
+    }
+
+    func key(_ name: String) -> AttributeKey? {
+        return SymbolTable.shared.lookup(name).flatMap { columnOfKey[$0] }
+    }
+
+    func symbol(of key: AttributeKey) -> Symbol {
+        return keySymbols[Int(key.rawValue)]
+    }
+
+    func name(of key: AttributeKey) -> String {
+        return symbol(of: key).string
+    }
+
+    /// Resolves "<base>:<locale>" and "<base>" once, for repeated lookups with `FeatureView.value(for:)`.
+    func localizedKey(_ base: String, locale: String) -> LocalizedAttributeKey {
+        return LocalizedAttributeKey(localized: key(base + ":" + locale), fallback: key(base))
+    }
+
+    // MARK: - Features
+
+    func row(ofFeature featureId: UInt64) -> Int? {
+        var low = 0
+        var high = featureIds.count
+        while low < high {
+            let mid = (low + high) / 2
+            if featureIds[mid] < featureId {
+                low = mid + 1
+            } else {
+                high = mid
+            }
+        }
+        return low < featureIds.count && featureIds[low] == featureId ? low : nil
+    }
+
+    func view(forFeature featureId: UInt64) -> FeatureView? {
+        return row(ofFeature: featureId).map { FeatureView(store: self, row: $0) }
+    }
+
+    func views(forFeatures featureIds: [UInt64]) -> [FeatureView] {
+        var views: [FeatureView] = []
+        views.reserveCapacity(featureIds.count)
+        for featureId in featureIds {
+            if let row = row(ofFeature: featureId) {
+                views.append(FeatureView(store: self, row: row))
+            }
+        }
+        return views
+    }
+
+    fileprivate func valueHandle(_ key: AttributeKey, row: Int) -> UInt32? {
+        switch columns[Int(key.rawValue)] {
+        case .dense(let slots):
+            let value = slots[row]
+            return value == FeatureTagStore.absent ? nil : value
+        case .sparse(let rows, let rowValues):
+            var low = 0
+            var high = rows.count
+            let target = Int32(row)
+            while low < high {
+                let mid = (low + high) / 2
+                if rows[mid] < target {
+                    low = mid + 1
+                } else {
+                    high = mid
+                }
+            }
+            return low < rows.count && rows[low] == target ? rowValues[low] : nil
+        }
+    }
+}
+
+/// A feature of a `FeatureTagStore`, referencing the store's columns instead of copying them.
+///
+/// Creating a view does not allocate; attributes are only looked up when accessed and
+/// `attributes`/`makeFeature()` materialize the full dictionary on demand.
+struct FeatureView {
+
+    let store: FeatureTagStore
+    let row: Int
+
+    var featureId: UInt64 {
+        return store.featureIds[row]
+    }
+
+    func value(for key: AttributeKey) -> String? {
+        return store.valueHandle(key, row: row).map { store.values[Int($0)] }
+    }
+
+    func value(forKey name: String) -> String? {
+        return store.key(name).flatMap { value(for: $0) }
+    }
+
+    func value(for key: LocalizedAttributeKey) -> String? {
+        if let localized = key.localized, let value = value(for: localized) {
+            return value
+        }
+        return key.fallback.flatMap { value(for: $0) }
+    }
+
+    /// Same semantics as `HDMFeature.valueForKey:withLocale:`.
+    func value(forKey name: String, locale: String) -> String {
+        return value(for: store.localizedKey(name, locale: locale)) ?? ""
+    }
+
+    /// Same semantics as `HDMFeature.defaultDisplayNameWithLocale:`. Prefer `value(for:)` with a
+    /// `LocalizedAttributeKey` resolved once when looking up many features.
+    func defaultDisplayName(locale: String) -> String {
+        return value(forKey: "name", locale: locale)
+    }
+
+    var originalSerial: String {
+        return value(forKey: "original_serial") ?? ""
+    }
+
+    /// All attributes of the feature, materialized on every call.
+    var attributes: [String: String] {
+        var attributes: [String: String] = [:]
+        for (index, symbol) in store.keySymbols.enumerated() {
+            if let value = value(for: AttributeKey(rawValue: UInt32(index))) {
+                attributes[symbol.string] = value
+            }
+        }
+        return attributes
+    }
+}
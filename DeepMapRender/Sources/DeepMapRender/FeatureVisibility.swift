@@ -0,0 +1,281 @@
+//
+//  FeatureVisibility.swift
+//  DeepMapRender
+//
+//  Created by agent on 18.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+import Foundation
+
+/// Fixed-size set of feature rows of a `FeatureTagStore`, one bit per row.
+struct FeatureBitset: Equatable {
+
+    private(set) var words: [UInt64]
+    /// Number of rows covered.
+    let count: Int
+
+    init(count: Int, filled: Bool = false) {
+        self.count = count
+        words = [UInt64](repeating: filled ? UInt64.max : 0, count: (count + 63) / 64)
+        if filled {
+            clearPadding()
+        }
+    }
+
+    subscript(row: Int) -> Bool {
+        get {
+            return words[row >> 6] & 1 << UInt64(row & 63) != 0
+        }
+        set {
+            if newValue {
+                words[row >> 6] |= 1 << UInt64(row & 63)
+            } else {
+                words[row >> 6] &= ~(1 << UInt64(row & 63))
+            }
+        }
+    }
+
+    /// Number of rows in the set.
+    var cardinality: Int {
+        return words.reduce(0) { $0 + $1.nonzeroBitCount }
+    }
+
+    var isEmpty: Bool {
+        return !words.contains { $0 != 0 }
+    }
+
+    mutating func formUnion(_ other: FeatureBitset) {
+        for index in words.indices {
+            words[index] |= other.words[index]
+        }
+    }
+
+    mutating func formIntersection(_ other: FeatureBitset) {
+        for index in words.indices {
+            words[index] &= other.words[index]
+        }
+    }
+
+    mutating func subtract(_ other: FeatureBitset) {
+        for index in words.indices {
+            words[index] &= ~other.words[index]
+        }
+    }
+
+    mutating func formSymmetricDifference(_ other: FeatureBitset) {
+        for index in words.indices {
+            words[index] ^= other.words[index]
+        }
+    }
+
+    func union(_ other: FeatureBitset) -> FeatureBitset {
+        var result = self
+        result.formUnion(other)
+        return result
+    }
+
+    func intersection(_ other: FeatureBitset) -> FeatureBitset {
+        var result = self
+        result.formIntersection(other)
+        return result
+    }
+
+    /// Rows not in the set.
+    func complement() -> FeatureBitset {
+        var result = self
+        for index in result.words.indices {
+            result.words[index] = ~result.words[index]
+        }
+        result.clearPadding()
+        return result
+    }
+
+    /// Calls `body` with every row in the set, ascending.
+    func forEachRow(_ body: (Int) -> Void) {
+        for (index, word) in words.enumerated() {
+            var remaining = word
+            while remaining != 0 {
+                body(index << 6 + remaining.trailingZeroBitCount)
+                remaining &= remaining - 1
+            }
+        }
+    }
+
+    private mutating func clearPadding() {
+        let used = count & 63
+        if used != 0 {
+            words[words.count - 1] &= (1 << UInt64(used)) - 1
+        }
+    }
+
+    static func == (lhs: FeatureBitset, rhs: FeatureBitset) -> Bool {
+        return lhs.count == rhs.count && lhs.words == rhs.words
+    }
+}
+
+/// Per-feature visibility of a map, combined from feature type, `visibility_profile`,
+/// floor and per-feature toggles.
+///
+/// Each source keeps a bitset of the rows it hides; membership of every type, profile and
+/// level is precomputed once, so toggling one of them unions the member sets of what is
+/// hidden and never touches styles or geometry. A row of several types stays hidden while
+/// any of them is. `visible` is the complement of the union of all hidden sets and is
+/// recomputed only after a change. Renderers and culling can test or iterate it before
+/// resolving any style, from any thread.
+final class FeatureVisibility {
+
+    let store: FeatureTagStore
+
+    private let lock = NSLock()
+    private var typeMembers: [Symbol: FeatureBitset] = [:]
+    private var profileMembers: [Symbol: FeatureBitset] = [:]
+    private var levelMembers: [Float: FeatureBitset] = [:]
+
+    private var hiddenTypes = Set<Symbol>()
+    private var hiddenProfiles = Set<Symbol>()
+    private var visibleLevels: Set<Float>?
+
+    private var hiddenByType: FeatureBitset
+    private var hiddenByProfile: FeatureBitset
+    private var hiddenByLevel: FeatureBitset
+    private var hiddenByUser: FeatureBitset
+    private var combined: FeatureBitset?
+
+    /// Types of the features are taken from `types`, e.g. the primitives of a
+    /// `FeatureLocationSource`; see also `setFeatureType(_:forFeature:)`.
+    init(store: FeatureTagStore, types: [RenderPrimitive] = []) {
+        self.store = store
+        hiddenByType = FeatureBitset(count: store.count)
+        hiddenByProfile = FeatureBitset(count: store.count)
+        hiddenByLevel = FeatureBitset(count: store.count)
+        hiddenByUser = FeatureBitset(count: store.count)
+
+        let profileKey = store.key("visibility_profile")
+        let levelKey = store.key("level")
+        for row in 0..<store.count {
+            let view = FeatureView(store: store, row: row)
+            if let profileKey = profileKey, let profile = view.value(for: profileKey) {
+                profileMembers[Symbol(profile), default: FeatureBitset(count: store.count)][row] = true
+            }
+            if let levelKey = levelKey, let level = view.value(for: levelKey).flatMap({ Float($0) }) {
+                levelMembers[level, default: FeatureBitset(count: store.count)][row] = true
+            }
+        }
+        for primitive in types {
+            if let row = store.row(ofFeature: primitive.featureId) {
+                typeMembers[primitive.type, default: FeatureBitset(count: store.count)][row] = true
+            }
+        }
+    }
+
+    // MARK: - Types
+
+    /// Records the type of a feature, e.g. from `HDMFeature.featureType`, replacing the ones
+    /// it was built with. Types of features never recorded do not affect their visibility.
+    func setFeatureType(_ type: Symbol, forFeature featureId: UInt64) {
+        guard let row = store.row(ofFeature: featureId) else { return }
+        lock.lock()
+        defer { lock.unlock() }
+        for (other, members) in typeMembers where other != type && members[row] {
+            typeMembers[other]![row] = false
+        }
+        typeMembers[type, default: FeatureBitset(count: store.count)][row] = true
+        hiddenByType = FeatureVisibility.union(of: hiddenTypes, in: typeMembers, count: store.count)
+        combined = nil
+    }
+
+    func setTypeVisible(_ visible: Bool, _ type: Symbol) {
+        lock.lock()
+        defer { lock.unlock() }
+        guard hiddenTypes.contains(type) == visible else { return }
+        if visible {
+            hiddenTypes.remove(type)
+        } else {
+            hiddenTypes.insert(type)
+        }
+        if typeMembers[type] != nil {
+            hiddenByType = FeatureVisibility.union(of: hiddenTypes, in: typeMembers, count: store.count)
+            combined = nil
+        }
+    }
+
+    // MARK: - Profiles and floors
+
+    /// Shows or hides the features tagged `visibility_profile=<profile>`, e.g. "in_building".
+    func setProfileVisible(_ visible: Bool, _ profile: Symbol) {
+        lock.lock()
+        defer { lock.unlock() }
+        guard hiddenProfiles.contains(profile) == visible else { return }
+        if visible {
+            hiddenProfiles.remove(profile)
+        } else {
+            hiddenProfiles.insert(profile)
+        }
+        if profileMembers[profile] != nil {
+            hiddenByProfile = FeatureVisibility.union(of: hiddenProfiles, in: profileMembers, count: store.count)
+            combined = nil
+        }
+    }
+
+    /// Limits features with a level to `levels`; nil shows all levels. Features without a
+    /// level stay visible.
+    func setVisibleLevels(_ levels: Set<Float>?) {
+        lock.lock()
+        defer { lock.unlock() }
+        guard levels != visibleLevels else { return }
+        visibleLevels = levels
+        hiddenByLevel = FeatureBitset(count: store.count)
+        if let levels = levels {
+            for (level, members) in levelMembers where !levels.contains(level) {
+                hiddenByLevel.formUnion(members)
+            }
+        }
+        combined = nil
+    }
+
+    // MARK: - Features
+
+    func setFeaturesVisible(_ visible: Bool, _ featureIds: [UInt64]) {
+        lock.lock()
+        defer { lock.unlock() }
+        for featureId in featureIds {
+            if let row = store.row(ofFeature: featureId) {
+                hiddenByUser[row] = !visible
+            }
+        }
+        combined = nil
+    }
+
+    /// Rows of all visible features.
+    var visible: FeatureBitset {
+        lock.lock()
+        defer { lock.unlock() }
+        if let combined = combined {
+            return combined
+        }
+        var hidden = hiddenByType
+        hidden.formUnion(hiddenByProfile)
+        hidden.formUnion(hiddenByLevel)
+        hidden.formUnion(hiddenByUser)
+        let visible = hidden.complement()
+        combined = visible
+        return visible
+    }
+
+    func isVisible(_ featureId: UInt64) -> Bool {
+        guard let row = store.row(ofFeature: featureId) else { return true }
+        return visible[row]
+    }
+
+    /// Rows that are members of any of `keys`.
+    private static func union<Key>(of keys: Set<Key>, in members: [Key: FeatureBitset], count: Int) -> FeatureBitset {
+        var result = FeatureBitset(count: count)
+        for key in keys {
+            if let rows = members[key] {
+                result.formUnion(rows)
+            }
+        }
+        return result
+    }
+}
@@ -0,0 +1,123 @@
+//
+//  FlatBuffer.swift
+//  DeepMapRender
+//
+//  Created by agent on 18.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+import Foundation
+
+enum FlatBufferError: Error {
+    case format
+}
+
+/// Minimal bounds-checked FlatBuffer table access, for the package files read in place.
+///
+/// Tables are addressed by their byte position; fields by their index in the schema. Absent
+/// fields read as nil, anything pointing outside the buffer throws.
+struct FlatBuffer {
+    let bytes: UnsafePointer<UInt8>
+    let count: Int
+
+    func root() throws -> Int {
+        return try offset(at: 0)
+    }
+
+    func table(_ table: Int, field: Int) throws -> Int? {
+        return try reference(table, field: field)
+    }
+
+    func tables(_ table: Int, field: Int) throws -> [Int] {
+        guard let vector = try reference(table, field: field) else { return [] }
+        let length = Int(try uint32(at: vector))
+        guard length <= (count - vector) / 4 else { throw FlatBufferError.format }
+        return try (0..<length).map { try offset(at: vector + 4 + $0 * 4) }
+    }
+
+    func string(_ table: Int, field: Int) throws -> String? {
+        guard let range = try vector(table, field: field) else { return nil }
+        return String(bytes: UnsafeBufferPointer(start: bytes + range.lowerBound, count: range.count), encoding: .utf8)
+    }
+
+    /// Byte range of the elements of a vector of scalars or structs of `elementSize` bytes.
+    func vector(_ table: Int, field: Int, elementSize: Int = 1) throws -> CountableRange<Int>? {
+        guard let vector = try reference(table, field: field) else { return nil }
+        let length = Int(try uint32(at: vector))
+        guard length <= (count - vector - 4) / elementSize else { throw FlatBufferError.format }
+        return vector + 4..<vector + 4 + length * elementSize
+    }
+
+    func uint8(_ table: Int, field: Int) throws -> UInt8? {
+        return try position(table, field: field).map { try uint8(at: $0) }
+    }
+
+    func uint16(_ table: Int, field: Int) throws -> UInt16? {
+        return try position(table, field: field).map { try uint16(at: $0) }
+    }
+
+    func uint32(_ table: Int, field: Int) throws -> UInt32? {
+        return try position(table, field: field).map { try uint32(at: $0) }
+    }
+
+    func uint64(_ table: Int, field: Int) throws -> UInt64? {
+        return try position(table, field: field).map { try uint64(at: $0) }
+    }
+
+    func float(_ table: Int, field: Int) throws -> Float? {
+        return try uint32(table, field: field).map { Float(bitPattern: $0) }
+    }
+
+    func double(_ table: Int, field: Int) throws -> Double? {
+        return try uint64(table, field: field).map { Double(bitPattern: $0) }
+    }
+
+    /// Position of a field's value, nil if the field is absent. Struct fields are stored
+    /// inline at this position.
+    func position(_ table: Int, field: Int) throws -> Int? {
+        let vtable = table - Int(Int32(bitPattern: try uint32(at: table)))
+        let vtableLength = Int(try uint16(at: vtable))
+        guard 4 + field * 2 + 2 <= vtableLength else { return nil }
+        let fieldOffset = Int(try uint16(at: vtable + 4 + field * 2))
+        return fieldOffset == 0 ? nil : table + fieldOffset
+    }
+
+    func double(at position: Int) throws -> Double {
+        return Double(bitPattern: try uint64(at: position))
+    }
+
+    private func reference(_ table: Int, field: Int) throws -> Int? {
+        return try position(table, field: field).map { try offset(at: $0) }
+    }
+
+    private func offset(at position: Int) throws -> Int {
+        let target = position + Int(try uint32(at: position))
+        guard target < count else { throw FlatBufferError.format }
+        return target
+    }
+
+    private func uint8(at position: Int) throws -> UInt8 {
+        guard position >= 0 && position < count else { throw FlatBufferError.format }
+        return bytes[position]
+    }
+
+    private func uint16(at position: Int) throws -> UInt16 {
+        guard position >= 0 && position + 2 <= count else { throw FlatBufferError.format }
+        return UInt16(bytes[position]) | UInt16(bytes[position + 1]) << 8
+    }
+
+    private func uint32(at position: Int) throws -> UInt32 {
+        guard position >= 0 && position + 4 <= count else { throw FlatBufferError.format }
+        return UInt32(bytes[position]) | UInt32(bytes[position + 1]) << 8
+            | UInt32(bytes[position + 2]) << 16 | UInt32(bytes[position + 3]) << 24
+    }
+
+    private func uint64(at position: Int) throws -> UInt64 {
+        guard position >= 0 && position + 8 <= count else { throw FlatBufferError.format }
+        var value: UInt64 = 0
+        for index in (0..<8).reversed() {
+            value = value << 8 | UInt64(bytes[position + index])
+        }
+        return value
+    }
+}
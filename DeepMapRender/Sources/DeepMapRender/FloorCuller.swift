@@ -0,0 +1,588 @@
+//
+//  FloorCuller.swift
+//  DeepMapRender
+//
+//  Created by agent on 18.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+import Foundation
+
+/// Axis-aligned bounding box in the renderer's planar CRS.
+struct RenderBounds {
+    var minX, minY, minZ, maxX, maxY, maxZ: Double
+
+    static let empty = RenderBounds(minX: .infinity, minY: .infinity, minZ: .infinity,
+                                    maxX: -.infinity, maxY: -.infinity, maxZ: -.infinity)
+
+    var isEmpty: Bool {
+        return minX > maxX
+    }
+
+    var center: RenderPoint {
+        return RenderPoint(x: (minX + maxX) / 2, y: (minY + maxY) / 2, z: (minZ + maxZ) / 2)
+    }
+
+    mutating func formUnion(_ other: RenderBounds) {
+        minX = min(minX, other.minX)
+        minY = min(minY, other.minY)
+        minZ = min(minZ, other.minZ)
+        maxX = max(maxX, other.maxX)
+        maxY = max(maxY, other.maxY)
+        maxZ = max(maxZ, other.maxZ)
+    }
+
+    mutating func extend(_ point: RenderPoint) {
+        formUnion(RenderBounds(minX: point.x, minY: point.y, minZ: point.z, maxX: point.x, maxY: point.y, maxZ: point.z))
+    }
+}
+
+/// The near and side planes of a `RenderCamera`'s view volume; there is no far plane.
+struct RenderFrustum {
+
+    enum Containment {
+        case outside
+        case intersecting
+        case inside
+    }
+
+    /// Inward normals and offsets: a point `p` is inside a plane if `normal · p + offset >= 0`.
+    private let planes: [(RenderPoint, Double)]
+    let eye: RenderPoint
+
+    init(camera: RenderCamera, nearPlane: Double = 0.1) {
+        let basis = camera.basis
+        let f = basis.forward, r = basis.right, u = basis.up
+        let vertical = camera.fieldOfView * .pi / 360
+        let horizontal = atan(tan(vertical) * Double(camera.width) / Double(max(camera.height, 1)))
+        func combine(_ a: RenderPoint, _ s: Double, _ b: RenderPoint, _ t: Double) -> RenderPoint {
+            return RenderPoint(x: a.x * s + b.x * t, y: a.y * s + b.y * t, z: a.z * s + b.z * t)
+        }
+        func plane(_ normal: RenderPoint, through point: RenderPoint) -> (RenderPoint, Double) {
+            return (normal, -(normal.x * point.x + normal.y * point.y + normal.z * point.z))
+        }
+        eye = basis.eye
+        let near = combine(basis.eye, 1, f, nearPlane)
+        planes = [plane(f, through: near),
+                  plane(combine(f, sin(vertical), u, -cos(vertical)), through: eye),
+                  plane(combine(f, sin(vertical), u, cos(vertical)), through: eye),
+                  plane(combine(f, sin(horizontal), r, -cos(horizontal)), through: eye),
+                  plane(combine(f, sin(horizontal), r, cos(horizontal)), through: eye)]
+    }
+
+    func classify(_ bounds: RenderBounds) -> Containment {
+        var result = Containment.inside
+        for (normal, offset) in planes {
+            // the corner furthest along the normal decides outside, the nearest one inside
+            let far = normal.x * (normal.x >= 0 ? bounds.maxX : bounds.minX)
+                + normal.y * (normal.y >= 0 ? bounds.maxY : bounds.minY)
+                + normal.z * (normal.z >= 0 ? bounds.maxZ : bounds.minZ) + offset
+            if far < 0 {
+                return .outside
+            }
+            let near = normal.x * (normal.x >= 0 ? bounds.minX : bounds.maxX)
+                + normal.y * (normal.y >= 0 ? bounds.minY : bounds.maxY)
+                + normal.z * (normal.z >= 0 ? bounds.minZ : bounds.maxZ) + offset
+            if near < 0 {
+                result = .intersecting
+            }
+        }
+        return result
+    }
+}
+
+/// Bounding volume hierarchy over the features of one floor.
+///
+/// Built top down by splitting at the median of the longest axis. Inserting, moving and
+/// removing features only updates leaves and marks the tree for a refit, which recomputes
+/// node bounds bottom up before the next query; after as many changes as the tree had
+/// features at its last build, it is rebuilt instead.
+final class BoundingVolumeHierarchy {
+
+    private struct Node {
+        var bounds: RenderBounds
+        /// Children for inner nodes, -1 for leaves.
+        var left: Int32
+        var right: Int32
+        var items: [Int32]
+        /// Live items below this node, for statistics.
+        var count: Int32
+    }
+
+    private struct Item {
+        var featureId: UInt64
+        var bounds: RenderBounds
+        var leaf: Int32
+    }
+
+    static let leafSize = 4
+
+    private var nodes: [Node] = []
+    private var items: [Item] = []
+    private var itemOfFeature: [UInt64: Int32] = [:]
+    private var freeItems: [Int32] = []
+    private var changesSinceBuild = 0
+    private var needsRefit = false
+
+    init(_ features: [(UInt64, RenderBounds)] = []) {
+        for (featureId, bounds) in features {
+            itemOfFeature[featureId] = Int32(items.count)
+            items.append(Item(featureId: featureId, bounds: bounds, leaf: -1))
+        }
+        rebuild()
+    }
+
+    var count: Int {
+        return itemOfFeature.count
+    }
+
+    var bounds: RenderBounds {
+        refitIfNeeded()
+        return nodes.first?.bounds ?? .empty
+    }
+
+    /// Bounds of a feature, nil if it is not in the tree.
+    func bounds(ofFeature featureId: UInt64) -> RenderBounds? {
+        return itemOfFeature[featureId].map { items[Int($0)].bounds }
+    }
+
+    /// Adds a feature or moves it to new bounds.
+    func insert(_ featureId: UInt64, bounds: RenderBounds) {
+        if let item = itemOfFeature[featureId] {
+            items[Int(item)].bounds = bounds
+        } else {
+            let item: Int32
+            if let free = freeItems.popLast() {
+                item = free
+                items[Int(item)] = Item(featureId: featureId, bounds: bounds, leaf: -1)
+            } else {
+                item = Int32(items.count)
+                items.append(Item(featureId: featureId, bounds: bounds, leaf: -1))
+            }
+            itemOfFeature[featureId] = item
+            let leaf = bestLeaf(for: bounds)
+            nodes[Int(leaf)].items.append(item)
+            items[Int(item)].leaf = leaf
+        }
+        noteChange()
+    }
+
+    func remove(_ featureId: UInt64) {
+        guard let item = itemOfFeature.removeValue(forKey: featureId) else { return }
+        let leaf = Int(items[Int(item)].leaf)
+        if let index = nodes[leaf].items.index(of: item) {
+            nodes[leaf].items.remove(at: index)
+        }
+        freeItems.append(item)
+        noteChange()
+    }
+
+    /// Calls `body` with every feature whose bounds may intersect `frustum` and are not
+    /// reported hidden by `occluded`, which is asked for whole subtrees.
+    func forEachVisible(in frustum: RenderFrustum, occluded: ((RenderBounds) -> Bool)? = nil,
+                        statistics: inout CullStatistics, _ body: (UInt64) -> Void) {
+        refitIfNeeded()
+        guard !nodes.isEmpty else { return }
+        var stack: [(Int32, Bool)] = [(0, false)]
+        while let entry = stack.popLast() {
+            let (index, contained) = entry
+            let node = nodes[Int(index)]
+            statistics.nodesVisited += 1
+            guard node.count > 0 else { continue }
+            var inside = contained
+            if !inside {
+                switch frustum.classify(node.bounds) {
+                case .outside:
+                    statistics.frustumCulled += Int(node.count)
+                    continue
+                case .inside:
+                    inside = true
+                case .intersecting:
+                    break
+                }
+            }
+            if let occluded = occluded, occluded(node.bounds) {
+                statistics.occlusionCulled += Int(node.count)
+                continue
+            }
+            if node.left < 0 {
+                for item in node.items {
+                    let item = items[Int(item)]
+                    if !inside && frustum.classify(item.bounds) == .outside {
+                        statistics.frustumCulled += 1
+                    } else if let occluded = occluded, occluded(item.bounds) {
+                        statistics.occlusionCulled += 1
+                    } else {
+                        body(item.featureId)
+                    }
+                }
+            } else {
+                stack.append((node.right, inside))
+                stack.append((node.left, inside))
+            }
+        }
+    }
+
+    /// Calls `body` with every feature whose bounds intersect `bounds`.
+    func forEach(intersecting bounds: RenderBounds, _ body: (UInt64) -> Void) {
+        refitIfNeeded()
+        guard !nodes.isEmpty else { return }
+        func intersects(_ other: RenderBounds) -> Bool {
+            return other.minX <= bounds.maxX && other.maxX >= bounds.minX && other.minY <= bounds.maxY
+                && other.maxY >= bounds.minY && other.minZ <= bounds.maxZ && other.maxZ >= bounds.minZ
+        }
+        var stack: [Int32] = [0]
+        while let index = stack.popLast() {
+            let node = nodes[Int(index)]
+            guard node.count > 0 && intersects(node.bounds) else { continue }
+            if node.left < 0 {
+                for item in node.items where intersects(items[Int(item)].bounds) {
+                    body(items[Int(item)].featureId)
+                }
+            } else {
+                stack.append(node.right)
+                stack.append(node.left)
+            }
+        }
+    }
+
+    // MARK: - Maintenance
+
+    private func noteChange() {
+        changesSinceBuild += 1
+        if changesSinceBuild > max(count, 16) {
+            rebuild()
+        } else {
+            needsRefit = true
+        }
+    }
+
+    private func rebuild() {
+        nodes.removeAll(keepingCapacity: true)
+        var live = itemOfFeature.values.sorted()
+        if !live.isEmpty {
+            build(&live, 0, live.count)
+        }
+        changesSinceBuild = 0
+        needsRefit = false
+    }
+
+    @discardableResult
+    private func build(_ list: inout [Int32], _ start: Int, _ end: Int) -> Int32 {
+        var bounds = RenderBounds.empty
+        var centers = RenderBounds.empty
+        for index in start..<end {
+            let itemBounds = items[Int(list[index])].bounds
+            bounds.formUnion(itemBounds)
+            centers.extend(itemBounds.center)
+        }
+        let nodeIndex = Int32(nodes.count)
+        nodes.append(Node(bounds: bounds, left: -1, right: -1, items: [], count: Int32(end - start)))
+        if end - start <= BoundingVolumeHierarchy.leafSize {
+            nodes[Int(nodeIndex)].items = Array(list[start..<end])
+            for item in list[start..<end] {
+                items[Int(item)].leaf = nodeIndex
+            }
+            return nodeIndex
+        }
+
+        let extentX = centers.maxX - centers.minX, extentY = centers.maxY - centers.minY, extentZ = centers.maxZ - centers.minZ
+        let axis: (RenderPoint) -> Double
+        if extentX >= extentY && extentX >= extentZ {
+            axis = { $0.x }
+        } else if extentY >= extentZ {
+            axis = { $0.y }
+        } else {
+            axis = { $0.z }
+        }
+        let snapshot = items
+        list[start..<end].sort { axis(snapshot[Int($0)].bounds.center) < axis(snapshot[Int($1)].bounds.center) }
+        let middle = (start + end) / 2
+        let left = build(&list, start, middle)
+        let right = build(&list, middle, end)
+        nodes[Int(nodeIndex)].left = left
+        nodes[Int(nodeIndex)].right = right
+        return nodeIndex
+    }
+
+    /// The leaf whose bounds grow least by adding `bounds`.
+    private func bestLeaf(for bounds: RenderBounds) -> Int32 {
+        if nodes.isEmpty {
+            nodes.append(Node(bounds: bounds, left: -1, right: -1, items: [], count: 0))
+            return 0
+        }
+        refitIfNeeded()
+        var index: Int32 = 0
+        while nodes[Int(index)].left >= 0 {
+            let node = nodes[Int(index)]
+            index = growth(nodes[Int(node.left)].bounds, bounds) <= growth(nodes[Int(node.right)].bounds, bounds) ? node.left : node.right
+        }
+        return index
+    }
+
+    private func growth(_ bounds: RenderBounds, _ added: RenderBounds) -> Double {
+        func area(_ b: RenderBounds) -> Double {
+            return b.isEmpty ? 0 : (b.maxX - b.minX) * (b.maxY - b.minY)
+        }
+        var union = bounds
+        union.formUnion(added)
+        return area(union) - area(bounds)
+    }
+
+    /// Recomputes node bounds and counts bottom up; children always follow their parent.
+    private func refitIfNeeded() {
+        guard needsRefit else { return }
+        for index in stride(from: nodes.count - 1, through: 0, by: -1) {
+            var node = nodes[index]
+            var bounds = RenderBounds.empty
+            if node.left < 0 {
+                for item in node.items {
+                    bounds.formUnion(items[Int(item)].bounds)
+                }
+                node.count = Int32(node.items.count)
+            } else {
+                let left = nodes[Int(node.left)], right = nodes[Int(node.right)]
+                bounds = left.bounds
+                bounds.formUnion(right.bounds)
+                node.count = left.count + right.count
+            }
+            node.bounds = bounds
+            nodes[index] = node
+        }
+        needsRefit = false
+    }
+}
+
+/// Coarse map of where a floor's slab is solid, for testing what it hides below.
+///
+/// Cells are solid when their corners and center lie inside one of the slab's polygons;
+/// a summed area table answers "is this rectangle fully solid" in constant time.
+struct FloorSlab {
+
+    let bounds: RenderBounds
+    let cellSize: Double
+    private let columns: Int
+    private let rows: Int
+    /// Solid cells in the rectangle from the origin to each cell, (columns + 1) × (rows + 1).
+    private let summedArea: [Int32]
+
+    init?(polygons: [[[RenderPoint]]], cellSize: Double = 1, maximumCells: Int = 256) {
+        var bounds = RenderBounds.empty
+        polygons.forEach { $0.forEach { $0.forEach { bounds.extend($0) } } }
+        guard !bounds.isEmpty else { return nil }
+        let cellSize = max(cellSize, (bounds.maxX - bounds.minX) / Double(maximumCells), (bounds.maxY - bounds.minY) / Double(maximumCells))
+        let columns = max(1, Int(((bounds.maxX - bounds.minX) / cellSize).rounded(.up)))
+        let rows = max(1, Int(((bounds.maxY - bounds.minY) / cellSize).rounded(.up)))
+
+        // samples at cell corners (even indices) and centers (odd indices) of a doubled grid
+        let sampleColumns = columns * 2 + 1, sampleRows = rows * 2 + 1
+        var inside = [Bool](repeating: false, count: sampleColumns * sampleRows)
+        for rings in polygons {
+            var box = RenderBounds.empty
+            rings.forEach { $0.forEach { box.extend($0) } }
+            let firstColumn = max(0, Int(((box.minX - bounds.minX) / cellSize * 2).rounded(.up)))
+            let lastColumn = min(sampleColumns - 1, Int(((box.maxX - bounds.minX) / cellSize * 2).rounded(.down)))
+            let firstRow = max(0, Int(((box.minY - bounds.minY) / cellSize * 2).rounded(.up)))
+            let lastRow = min(sampleRows - 1, Int(((box.maxY - bounds.minY) / cellSize * 2).rounded(.down)))
+            guard firstColumn <= lastColumn && firstRow <= lastRow else { continue }
+            for row in firstRow...lastRow {
+                let y = bounds.minY + Double(row) * cellSize / 2
+                for column in firstColumn...lastColumn where !inside[row * sampleColumns + column] {
+                    let x = bounds.minX + Double(column) * cellSize / 2
+                    inside[row * sampleColumns + column] = FloorSlab.contains(rings, x: x, y: y)
+                }
+            }
+        }
+
+        var summedArea = [Int32](repeating: 0, count: (columns + 1) * (rows + 1))
+        for row in 0..<rows {
+            var rowSum: Int32 = 0
+            for column in 0..<columns {
+                let sampleRow = row * 2, sampleColumn = column * 2
+                var solid = inside[(sampleRow + 1) * sampleColumns + sampleColumn + 1]
+                for (dy, dx) in [(0, 0), (0, 2), (2, 0), (2, 2)] where solid {
+                    solid = inside[(sampleRow + dy) * sampleColumns + sampleColumn + dx]
+                }
+                rowSum += solid ? 1 : 0
+                summedArea[(row + 1) * (columns + 1) + column + 1] = summedArea[row * (columns + 1) + column + 1] + rowSum
+            }
+        }
+        self.bounds = bounds
+        self.cellSize = cellSize
+        self.columns = columns
+        self.rows = rows
+        self.summedArea = summedArea
+    }
+
+    /// Whether every cell touched by the rectangle is solid.
+    func covers(minX: Double, minY: Double, maxX: Double, maxY: Double) -> Bool {
+        guard minX >= bounds.minX && minY >= bounds.minY && maxX <= bounds.maxX && maxY <= bounds.maxY else { return false }
+        let x0 = max(0, Int((minX - bounds.minX) / cellSize)), x1 = min(columns, Int(((maxX - bounds.minX) / cellSize).rounded(.down)) + 1)
+        let y0 = max(0, Int((minY - bounds.minY) / cellSize)), y1 = min(rows, Int(((maxY - bounds.minY) / cellSize).rounded(.down)) + 1)
+        let width = columns + 1
+        let solid = summedArea[y1 * width + x1] - summedArea[y0 * width + x1] - summedArea[y1 * width + x0] + summedArea[y0 * width + x0]
+        return Int(solid) == (x1 - x0) * (y1 - y0)
+    }
+
+    /// Whether (x, y) lies inside `rings` by the even-odd rule.
+    static func contains(_ rings: [[RenderPoint]], x: Double, y: Double) -> Bool {
+        var inside = false
+        for ring in rings where ring.count >= 3 {
+            var previous = ring[ring.count - 1]
+            for point in ring {
+                if (point.y > y) != (previous.y > y)
+                    && x < (previous.x - point.x) * (y - point.y) / (previous.y - point.y) + point.x {
+                    inside = !inside
+                }
+                previous = point
+            }
+        }
+        return inside
+    }
+}
+
+/// Counters of one culling pass.
+struct CullStatistics: CustomStringConvertible {
+    var nodesVisited = 0
+    var visible = 0
+    var frustumCulled = 0
+    var occlusionCulled = 0
+    /// Floors skipped entirely, as above the active floor or fully hidden under it.
+    var floorsSkipped = 0
+    var time: TimeInterval = 0
+
+    var description: String {
+        return String(format: "%d visible, %d outside the view, %d occluded, %d floors skipped, %d nodes in %.3f ms",
+                      visible, frustumCulled, occlusionCulled, floorsSkipped, nodesVisited, time * 1000)
+    }
+}
+
+/// Decides per frame which features of a stacked multi-floor map can be seen.
+///
+/// Every floor has its own `BoundingVolumeHierarchy`, placed `floorHeight` meters above the
+/// floor below it. Floors above the active one are not drawn. Floors below it are tested
+/// against the view frustum and against the active floor's slab: subtrees whose bounds,
+/// projected from the eye onto the slab, land entirely on solid slab cells are skipped.
+/// Slabs are built from the active floor's polygons of `slabTypes`.
+final class FloorCuller {
+
+    /// Vertical distance between floors, in meters; the app passes `HDMMapView.minFloorDistance`.
+    let floorHeight: Double
+    var activeLevel: Float = 0
+    /// Area types forming a floor's solid slab.
+    var slabTypes: Set<Symbol> = ["fg_polygons", "building"]
+
+    private var trees: [Float: BoundingVolumeHierarchy] = [:]
+    private var slabPolygons: [Float: [UInt64: [[RenderPoint]]]] = [:]
+    private var slabs: [Float: FloorSlab?] = [:]
+
+    init(primitives: [RenderPrimitive] = [], floorHeight: Double) {
+        self.floorHeight = floorHeight
+        var features: [Float: [UInt64: RenderBounds]] = [:]
+        for primitive in primitives {
+            features[primitive.level, default: [:]][primitive.featureId, default: .empty].formUnion(bounds(of: primitive))
+            notePolygon(primitive)
+        }
+        for (level, boxes) in features {
+            trees[level] = BoundingVolumeHierarchy(boxes.map { ($0.key, $0.value) })
+        }
+    }
+
+    var levels: [Float] {
+        return trees.keys.sorted()
+    }
+
+    func tree(forLevel level: Float) -> BoundingVolumeHierarchy? {
+        return trees[level]
+    }
+
+    /// Adds a primitive, growing its feature's bounds if the feature is already known.
+    func insert(_ primitive: RenderPrimitive) {
+        let tree = trees[primitive.level] ?? BoundingVolumeHierarchy()
+        trees[primitive.level] = tree
+        var bounds = self.bounds(of: primitive)
+        if let known = tree.bounds(ofFeature: primitive.featureId) {
+            bounds.formUnion(known)
+        }
+        tree.insert(primitive.featureId, bounds: bounds)
+        notePolygon(primitive)
+    }
+
+    func remove(_ featureId: UInt64, level: Float) {
+        trees[level]?.remove(featureId)
+        if slabPolygons[level]?.removeValue(forKey: featureId) != nil {
+            slabs[level] = nil
+        }
+    }
+
+    /// Features visible from `camera`, per level.
+    func visibleFeatures(camera: RenderCamera, statistics: inout CullStatistics) -> [Float: [UInt64]] {
+        let start = Date()
+        let frustum = RenderFrustum(camera: camera)
+        let slabElevation = elevation(of: activeLevel)
+        let slab = self.slab(forLevel: activeLevel)
+        var visible: [Float: [UInt64]] = [:]
+
+        for (level, tree) in trees {
+            if level > activeLevel {
+                statistics.floorsSkipped += 1
+                continue
+            }
+            var occluded: ((RenderBounds) -> Bool)?
+            if level < activeLevel, let slab = slab, frustum.eye.z > slabElevation {
+                occluded = { FloorCuller.isHidden($0, under: slab, at: slabElevation, eye: frustum.eye) }
+                if occluded!(tree.bounds) {
+                    statistics.occlusionCulled += tree.count
+                    statistics.floorsSkipped += 1
+                    continue
+                }
+            }
+            var ids: [UInt64] = []
+            tree.forEachVisible(in: frustum, occluded: occluded, statistics: &statistics) { ids.append($0) }
+            statistics.visible += ids.count
+            visible[level] = ids
+        }
+        statistics.time += Date().timeIntervalSince(start)
+        return visible
+    }
+
+    private func elevation(of level: Float) -> Double {
+        return Double(level) * floorHeight
+    }
+
+    private func bounds(of primitive: RenderPrimitive) -> RenderBounds {
+        let box = primitive.bounds
+        let z = elevation(of: primitive.level)
+        return RenderBounds(minX: box.0, minY: box.1, minZ: z, maxX: box.2, maxY: box.3, maxZ: z)
+    }
+
+    private func notePolygon(_ primitive: RenderPrimitive) {
+        guard case .polygon(let rings) = primitive.geometry, slabTypes.contains(primitive.type) else { return }
+        slabPolygons[primitive.level, default: [:]][primitive.featureId] = rings
+        slabs[primitive.level] = nil
+    }
+
+    private func slab(forLevel level: Float) -> FloorSlab? {
+        if let slab = slabs[level] {
+            return slab
+        }
+        let slab = FloorSlab(polygons: Array((slabPolygons[level] ?? [:]).values))
+        slabs[level] = slab
+        return slab
+    }
+
+    /// Whether `bounds`, seen from `eye`, lies entirely behind solid cells of `slab`.
+    private static func isHidden(_ bounds: RenderBounds, under slab: FloorSlab, at elevation: Double, eye: RenderPoint) -> Bool {
+        guard bounds.maxZ < elevation else { return false }
+        var projected = RenderBounds.empty
+        for x in [bounds.minX, bounds.maxX] {
+            for y in [bounds.minY, bounds.maxY] {
+                for z in [bounds.minZ, bounds.maxZ] {
+                    let t = (elevation - eye.z) / (z - eye.z)
+                    projected.extend(RenderPoint(x: eye.x + (x - eye.x) * t, y: eye.y + (y - eye.y) * t, z: elevation))
+                }
+            }
+        }
+        return slab.covers(minX: projected.minX, minY: projected.minY, maxX: projected.maxX, maxY: projected.maxY)
+    }
+}
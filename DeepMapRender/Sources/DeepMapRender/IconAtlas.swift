@@ -0,0 +1,320 @@
+//
+//  IconAtlas.swift
+//  DeepMapRender
+//
+//  Created by agent on 18.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+import Foundation
+#if os(iOS)
+import UIKit
+#endif
+
+/// The icon texture of a map package (`mapdata/textures/icons.bin`), read in place.
+///
+/// The file is a FlatBuffer: the root holds a vector of icons (name, page and u, v, width,
+/// height in texture coordinates) and a vector of atlases, each with textures whose mip
+/// levels are PNG images. The file is mapped, not read; parsing only walks the tables and
+/// records where each PNG lies, so opening costs nothing however large the images are.
+struct IconAtlasFile {
+
+    struct Entry {
+        /// Image name without extension, e.g. "toilet_m".
+        let name: String
+        let page: Int
+        let u, v, width, height: Float
+    }
+
+    let entries: [Entry]
+    /// Byte ranges of the PNG of every mip level of every page, largest level first.
+    let pages: [[CountableRange<Int>]]
+    private let data: Data
+
+    init(contentsOfFile path: String) throws {
+        try self.init(data: try Data(contentsOf: URL(fileURLWithPath: path), options: .alwaysMapped))
+    }
+
+    init(data: Data) throws {
+        self.data = data
+        let parsed = try data.withUnsafeBytes { (bytes: UnsafePointer<UInt8>) throws -> ([Entry], [[CountableRange<Int>]]) in
+            let buffer = FlatBuffer(bytes: bytes, count: data.count)
+            let root = try buffer.root()
+
+            var entries: [Entry] = []
+            for icon in try buffer.tables(root, field: 0) {
+                var name = try buffer.string(icon, field: 0) ?? ""
+                if let dot = name.range(of: ".", options: .backwards) {
+                    name = String(name[..<dot.lowerBound])
+                }
+                entries.append(Entry(name: name, page: Int(try buffer.uint32(icon, field: 1) ?? 0),
+                                     u: try buffer.float(icon, field: 2) ?? 0, v: try buffer.float(icon, field: 3) ?? 0,
+                                     width: try buffer.float(icon, field: 4) ?? 0, height: try buffer.float(icon, field: 5) ?? 0))
+            }
+
+            var pages: [[CountableRange<Int>]] = []
+            for atlas in try buffer.tables(root, field: 1) {
+                for texture in try buffer.tables(atlas, field: 2) {
+                    pages.append(try buffer.tables(texture, field: 0).flatMap { try buffer.vector($0, field: 0) })
+                }
+            }
+            return (entries, pages)
+        }
+        entries = parsed.0
+        pages = parsed.1
+    }
+
+    /// The PNG of mip `level` of `page`; the bytes are copied out of the mapping.
+    func png(page: Int, level: Int) -> Data {
+        return data.subdata(in: Range(pages[page][level]))
+    }
+
+    /// Width and height of mip `level` of `page`, read from the PNG header without decoding.
+    func size(page: Int, level: Int) -> (width: Int, height: Int)? {
+        let range = pages[page][level]
+        // signature, IHDR length and type, then width and height, big-endian
+        guard range.count >= 24 else { return nil }
+        let header = [UInt8](data[range.lowerBound + 16..<range.lowerBound + 24])
+        let width = header[0..<4].reduce(0) { $0 << 8 | Int($1) }
+        let height = header[4..<8].reduce(0) { $0 << 8 | Int($1) }
+        return (width, height)
+    }
+}
+
+/// A page of decoded icons, filled shelf by shelf.
+///
+/// The pixels are allocated once and written in place: icons already handed out keep
+/// pointing into the page while later icons are copied into its free space, and neither
+/// side copies the page. Every rectangle is written once, before its `IconImage` exists.
+final class IconPage {
+    let width: Int
+    let height: Int
+    /// RGBA pixels, straight alpha, rows top to bottom.
+    let pixels: UnsafeMutablePointer<UInt8>
+    private var x = 0, y = 0, shelfHeight = 0
+
+    init(width: Int, height: Int) {
+        self.width = width
+        self.height = height
+        pixels = UnsafeMutablePointer<UInt8>.allocate(capacity: width * height * 4)
+        pixels.initialize(to: 0, count: width * height * 4)
+    }
+
+    deinit {
+        pixels.deallocate(capacity: width * height * 4)
+    }
+
+    /// Top left corner for a `width` x `height` image, nil if the page is full.
+    fileprivate func allocate(width: Int, height: Int) -> (x: Int, y: Int)? {
+        var x = self.x, y = self.y, shelfHeight = self.shelfHeight
+        if x + width > self.width {
+            x = 0
+            y += shelfHeight
+            shelfHeight = 0
+        }
+        guard x + width <= self.width && y + height <= self.height else { return nil }
+        self.x = x + width
+        self.y = y
+        self.shelfHeight = max(shelfHeight, height)
+        return (x, y)
+    }
+}
+
+/// A decoded icon: a rectangle of an `IconPage`, which it keeps alive.
+struct IconImage {
+    let page: IconPage
+    let x, y, width, height: Int
+
+    /// Color at texture coordinates `u`, `v` in 0...1, nearest texel.
+    func color(u: Float, v: Float) -> UInt32 {
+        let column = x + max(0, min(width - 1, Int(u * Float(width))))
+        let row = y + max(0, min(height - 1, Int(v * Float(height))))
+        let pixel = page.pixels + (row * page.width + column) * 4
+        return UInt32(pixel[0]) << 24 | UInt32(pixel[1]) << 16 | UInt32(pixel[2]) << 8 | UInt32(pixel[3])
+    }
+}
+
+/// Icons of a map package, decoded on first use into pages the renderer draws from.
+///
+/// Feature types are mapped to icons once and get an interned icon ID: the type name itself,
+/// without an `icon_` prefix or `_outdoor` suffix, or an entry of `aliases` names the image.
+/// An icon is only decoded when first drawn, from the smallest mip level at least as large as
+/// requested, and copied into a `pageSize` page shared with other icons; the decoded source
+/// level is kept until memory gets low. Icons no type of the style sheet maps to are never
+/// decoded. On a memory warning all pages and decoded levels are dropped and icons are
+/// decoded again when next used. Thread-safe.
+final class IconAtlas {
+
+    static let aliases: [String: String] = ["phone": "phonebox"]
+
+    let file: IconAtlasFile
+    var pageSize = 256
+
+    /// Counters for instrumentation.
+    private(set) var decodedIcons = 0
+    private(set) var decodedLevels = 0
+    private(set) var evictions = 0
+
+    private struct ImageKey: Hashable {
+        let icon: Int32
+        let level: Int
+
+        var hashValue: Int {
+            return Int(icon) << 8 ^ level
+        }
+
+        static func == (lhs: ImageKey, rhs: ImageKey) -> Bool {
+            return lhs.icon == rhs.icon && lhs.level == rhs.level
+        }
+    }
+
+    private let lock = NSLock()
+    private var iconOfType: [Symbol: Int32] = [:]
+    /// Entries some type of the style sheet maps to; nil if there is no sheet.
+    private var referenced: Set<Int32>?
+    private var images: [ImageKey: IconImage] = [:]
+    private(set) var pages: [IconPage] = []
+    /// Decoded mip levels by page and level.
+    private var levels: [Int: (width: Int, height: Int, pixels: [UInt8])] = [:]
+    private var observer: NSObjectProtocol?
+
+    init(file: IconAtlasFile, sheet: StyleSheet? = nil) {
+        self.file = file
+        if let sheet = sheet {
+            referenced = Set(sheet.featureTypes.flatMap { icon(forType: $0) })
+        }
+        #if os(iOS)
+        observer = NotificationCenter.default.addObserver(forName: .UIApplicationDidReceiveMemoryWarning, object: nil,
+                                                          queue: nil) { [weak self] _ in
+            self?.evict()
+        }
+        #endif
+    }
+
+    deinit {
+        if let observer = observer {
+            NotificationCenter.default.removeObserver(observer)
+        }
+    }
+
+    /// Opens the icon file at `path`; nil if it is missing or empty, as `textures.bin` is in
+    /// packages without textures.
+    convenience init?(contentsOfFile path: String, sheet: StyleSheet? = nil) {
+        guard let attributes = try? FileManager.default.attributesOfItem(atPath: path),
+            (attributes[.size] as? NSNumber)?.intValue ?? 0 > 0,
+            let file = try? IconAtlasFile(contentsOfFile: path) else { return nil }
+        self.init(file: file, sheet: sheet)
+    }
+
+    /// Interned ID of the icon drawn for features of `type`, nil if it has none.
+    func icon(forType type: Symbol) -> Int32? {
+        lock.lock()
+        defer { lock.unlock() }
+        if let icon = iconOfType[type] {
+            return icon < 0 ? nil : icon
+        }
+        var name = type.string
+        if let colon = name.index(of: ":") {
+            name = String(name[..<colon])
+        }
+        var candidates = [name]
+        if name.hasPrefix("icon_") {
+            name = String(name.dropFirst(5))
+            candidates.append(name)
+        }
+        if name.hasSuffix("_outdoor") {
+            name = String(name.dropLast(8))
+            candidates.append(name)
+        }
+        if let alias = IconAtlas.aliases[name] {
+            candidates.append(alias)
+        }
+        var icon: Int32 = -1
+        for candidate in candidates {
+            if let index = file.entries.index(where: { $0.name == candidate }) {
+                icon = Int32(index)
+                break
+            }
+        }
+        iconOfType[type] = icon
+        return icon < 0 ? nil : icon
+    }
+
+    /// The icon for features of `type`, decoded for drawing at `size` pixels.
+    func image(forType type: Symbol, size: Int) -> IconImage? {
+        return icon(forType: type).flatMap { image(for: $0, size: size) }
+    }
+
+    func image(for icon: Int32, size: Int) -> IconImage? {
+        lock.lock()
+        defer { lock.unlock() }
+        guard icon >= 0 && Int(icon) < file.entries.count, referenced?.contains(icon) ?? true else { return nil }
+        let entry = file.entries[Int(icon)]
+        guard entry.page < file.pages.count, !file.pages[entry.page].isEmpty else { return nil }
+
+        // smallest level on which the icon is still at least `size` pixels wide
+        var level = 0
+        while level + 1 < file.pages[entry.page].count,
+            let next = file.size(page: entry.page, level: level + 1), Int(entry.width * Float(next.width)) >= size {
+            level += 1
+        }
+        let key = ImageKey(icon: icon, level: level)
+        if let image = images[key] {
+            return image
+        }
+        guard let image = decode(entry, level: level) else { return nil }
+        images[key] = image
+        decodedIcons += 1
+        return image
+    }
+
+    /// Drops all decoded icons and levels.
+    func evict() {
+        lock.lock()
+        images = [:]
+        pages = []
+        levels = [:]
+        evictions += 1
+        lock.unlock()
+    }
+
+    private func decode(_ entry: IconAtlasFile.Entry, level: Int) -> IconImage? {
+        let levelKey = entry.page << 8 | level
+        if levels[levelKey] == nil {
+            guard let decoded = PNGDecoder.decode(file.png(page: entry.page, level: level)) else { return nil }
+            levels[levelKey] = (decoded.width, decoded.height, decoded.pixels)
+            decodedLevels += 1
+        }
+        let source = levels[levelKey]!
+
+        let left = max(0, Int((entry.u * Float(source.width)).rounded()))
+        let top = max(0, Int((entry.v * Float(source.height)).rounded()))
+        let width = min(source.width - left, max(1, Int((entry.width * Float(source.width)).rounded())))
+        let height = min(source.height - top, max(1, Int((entry.height * Float(source.height)).rounded())))
+        guard width > 0 && height > 0 else { return nil }
+
+        // the first page with room, a new one if none has
+        var placement: (page: IconPage, x: Int, y: Int)?
+        for page in pages where page.width >= width && page.height >= height {
+            if let origin = page.allocate(width: width, height: height) {
+                placement = (page, origin.x, origin.y)
+                break
+            }
+        }
+        if placement == nil {
+            let page = IconPage(width: max(pageSize, width), height: max(pageSize, height))
+            pages.append(page)
+            let origin = page.allocate(width: width, height: height)!
+            placement = (page, origin.x, origin.y)
+        }
+        let target = placement!
+        source.pixels.withUnsafeBufferPointer { pixels in
+            for row in 0..<height {
+                let from = ((top + row) * source.width + left) * 4
+                let to = ((target.y + row) * target.page.width + target.x) * 4
+                (target.page.pixels + to).assign(from: pixels.baseAddress! + from, count: width * 4)
+            }
+        }
+        return IconImage(page: target.page, x: target.x, y: target.y, width: width, height: height)
+    }
+}
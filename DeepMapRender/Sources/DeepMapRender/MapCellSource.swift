@@ -0,0 +1,159 @@
+//
+//  MapCellSource.swift
+//  DeepMapRender
+//
+//  Created by agent on 18.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+import Foundation
+
+/// `meta/metafile.hsm` of a package's cells folder: the CRS, extent and layer names.
+struct MapCellMetadata {
+    let name: String
+    /// PROJ.4 definition of the CRS all cell coordinates are in, e.g. "+proj=utm +zone=32 ...".
+    let proj4: String
+    /// Layer names by layer ID; they are the style sheet types of the layer's features.
+    let layers: [UInt8: Symbol]
+    let center: RenderPoint
+    /// Extent of all cells as (minX, minY, maxX, maxY).
+    let bounds: (Double, Double, Double, Double)
+
+    /// The projection of `proj4`, nil if it is no UTM zone.
+    var projection: UTMProjection? {
+        return UTMProjection(proj4: proj4)
+    }
+
+    init(contentsOfFile path: String) throws {
+        let bytes = try Zlib.inflate([UInt8](try Data(contentsOf: URL(fileURLWithPath: path))))
+        var strings: [String] = [], extent: [Double] = []
+        var layers: [UInt8: Symbol] = [:]
+        try bytes.withUnsafeBufferPointer { bytes in
+            let buffer = FlatBuffer(bytes: bytes.baseAddress!, count: bytes.count)
+            let root = try buffer.root()
+            strings = try (0...1).map { try buffer.string(root, field: $0) ?? "" }
+            for layer in try buffer.tables(root, field: 3) {
+                if let id = try buffer.uint8(layer, field: 0), let name = try buffer.string(layer, field: 1) {
+                    layers[id] = Symbol(name)
+                }
+            }
+            extent = try (6...11).map { try buffer.double(root, field: $0) ?? 0 }
+        }
+        name = strings[0]
+        proj4 = strings[1]
+        self.layers = layers
+        center = RenderPoint(x: extent[0], y: extent[1])
+        bounds = (extent[2], extent[3], extent[4], extent[5])
+    }
+}
+
+/// Floor plans, buildings, ways and icons of a map package, read from its cells.
+///
+/// The cells (`z/x/y.hsg` below the package's cells folder) are zlib-compressed FlatBuffers
+/// of nested objects, each with a layer and a feature made of polygon, line and point parts
+/// in the package's planar CRS. Every part becomes a primitive typed by its layer name, on the
+/// floor of the feature's `level` attribute and at the elevation of its lowest point. The
+/// features' height ranges are kept in `heights`.
+final class MapCellSource: RenderGeometrySource {
+
+    let metadata: MapCellMetadata
+    /// Lowest and highest elevation of every feature, in meters.
+    let heights: [UInt64: (minimum: Float, maximum: Float)]
+
+    private let primitivesByLevel: [Float: [RenderPrimitive]]
+
+    /// Reads all cells below `path`, e.g. `MapResources.cellPath`. Parses every cell, so call
+    /// it off the main thread.
+    init(cellPath path: String) throws {
+        let metadata = try MapCellMetadata(contentsOfFile: path + "/meta/metafile.hsm")
+        var primitivesByLevel: [Float: [RenderPrimitive]] = [:]
+        var heights: [UInt64: (minimum: Float, maximum: Float)] = [:]
+        let cells = (FileManager.default.subpaths(atPath: path) ?? [])
+            .filter { $0.hasSuffix(".hsg") && !$0.hasPrefix("meta/") }
+            .sorted()
+        for cell in cells {
+            let bytes = try Zlib.inflate([UInt8](try Data(contentsOf: URL(fileURLWithPath: path + "/" + cell))))
+            try bytes.withUnsafeBufferPointer { bytes in
+                let buffer = FlatBuffer(bytes: bytes.baseAddress!, count: bytes.count)
+                try MapCellSource.read(buffer, layers: metadata.layers, primitives: &primitivesByLevel, heights: &heights)
+            }
+        }
+        self.metadata = metadata
+        self.primitivesByLevel = primitivesByLevel
+        self.heights = heights
+    }
+
+    var levels: [Float] {
+        return primitivesByLevel.keys.sorted()
+    }
+
+    func primitives(level: Float?) -> [RenderPrimitive] {
+        if let level = level {
+            return primitivesByLevel[level] ?? []
+        }
+        return levels.flatMap { primitivesByLevel[$0]! }
+    }
+
+    private static let levelKey = "level"
+
+    /// Appends the primitives of one cell, parents before their children.
+    private static func read(_ buffer: FlatBuffer, layers: [UInt8: Symbol], primitives: inout [Float: [RenderPrimitive]],
+                             heights: inout [UInt64: (minimum: Float, maximum: Float)]) throws {
+        let root = try buffer.root()
+        guard let content = try buffer.table(root, field: 1) else { return }
+        let keys = try buffer.tables(root, field: 4).map { try buffer.string($0, field: 0) }
+        let values = try buffer.tables(root, field: 5).map { try buffer.string($0, field: 0) }
+        let levelKey = keys.index(where: { $0 == MapCellSource.levelKey }).map { UInt16($0) }
+
+        var pending = Array(try buffer.tables(content, field: 2).reversed())
+        while let object = pending.popLast() {
+            pending += try buffer.tables(object, field: 2).reversed()
+            guard let type = try layers[buffer.uint8(object, field: 0) ?? 0],
+                let feature = try buffer.table(object, field: 1),
+                let attributes = try buffer.table(feature, field: 1) else { continue }
+
+            let featureId = try buffer.uint64(attributes, field: 0) ?? 0
+            let minimum = try buffer.float(attributes, field: 1) ?? 0
+            let maximum = try buffer.float(attributes, field: 2) ?? minimum
+            heights[featureId] = (minimum, maximum)
+            var level: Float = 0
+            for attribute in try buffer.tables(attributes, field: 4) {
+                guard let key = try buffer.uint16(attribute, field: 0), key == levelKey,
+                    let value = try buffer.uint16(attribute, field: 1), Int(value) < values.count else { continue }
+                level = values[Int(value)].flatMap { Float($0) } ?? 0
+            }
+
+            for part in try buffer.tables(feature, field: 0) {
+                guard let geometry = try buffer.table(part, field: 1),
+                    let shape = try self.geometry(of: geometry, kind: try buffer.uint8(part, field: 0) ?? 0,
+                                                  elevation: Double(minimum), in: buffer) else { continue }
+                primitives[level, default: []].append(RenderPrimitive(featureId: featureId, type: type, level: level,
+                                                                      geometry: shape))
+            }
+        }
+    }
+
+    private static func geometry(of table: Int, kind: UInt8, elevation: Double, in buffer: FlatBuffer) throws -> RenderPrimitive.Geometry? {
+        func ring(_ ring: Int) throws -> [RenderPoint] {
+            // vector of (x, y) structs of two doubles
+            guard let range = try buffer.vector(ring, field: 0, elementSize: 16) else { return [] }
+            return try stride(from: range.lowerBound, to: range.upperBound, by: 16).map {
+                RenderPoint(x: try buffer.double(at: $0), y: try buffer.double(at: $0 + 8), z: elevation)
+            }
+        }
+        switch kind {
+        case 1:
+            let rings = try buffer.tables(table, field: 0).map(ring).filter { $0.count >= 3 }
+            return rings.isEmpty ? nil : .polygon(rings)
+        case 2:
+            guard let position = try buffer.position(table, field: 0) else { return nil }
+            return .point(RenderPoint(x: try buffer.double(at: position), y: try buffer.double(at: position + 8), z: elevation))
+        case 3:
+            guard let line = try buffer.table(table, field: 0) else { return nil }
+            let points = try ring(line)
+            return points.count >= 2 ? .line(points) : nil
+        default:
+            return nil
+        }
+    }
+}
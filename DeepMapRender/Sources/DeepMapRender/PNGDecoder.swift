@@ -0,0 +1,120 @@
+//
+//  PNGDecoder.swift
+//  DeepMapRender
+//
+//  Created by agent on 18.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+import Foundation
+
+/// Minimal PNG reader for the images of map packages and `PNGEncoder` output.
+///
+/// Reads non-interlaced images of 8 bits per channel (grayscale, RGB, with or without alpha)
+/// into straight-alpha RGBA, which covers the icon textures and rendered references. Decoding
+/// is exact and needs no image framework, so icons look the same on every platform the
+/// renderer runs on.
+enum PNGDecoder {
+
+    private static let signature: [UInt8] = [0x89, 0x50, 0x4E, 0x47, 0x0D, 0x0A, 0x1A, 0x0A]
+
+    /// The image in `data`, nil if it is no PNG or uses an unsupported format.
+    static func decode(_ data: Data) -> RenderImage? {
+        let bytes = [UInt8](data)
+        guard bytes.count > 8, Array(bytes[0..<8]) == signature else { return nil }
+        func uint32(at offset: Int) -> Int {
+            return bytes[offset..<offset + 4].reduce(0) { $0 << 8 | Int($1) }
+        }
+
+        var width = 0, height = 0, channels = 0
+        var compressed: [UInt8] = []
+        var offset = 8
+        while offset + 12 <= bytes.count {
+            let length = uint32(at: offset)
+            let type = String(bytes: bytes[offset + 4..<offset + 8], encoding: .ascii) ?? ""
+            guard offset + 12 + length <= bytes.count else { return nil }
+            let payload = offset + 8..<offset + 8 + length
+            switch type {
+            case "IHDR":
+                // bit depth 8, no interlace
+                guard length == 13, bytes[payload.lowerBound + 8] == 8, bytes[payload.lowerBound + 12] == 0 else { return nil }
+                width = uint32(at: payload.lowerBound)
+                height = uint32(at: payload.lowerBound + 4)
+                switch bytes[payload.lowerBound + 9] {
+                case 0: channels = 1
+                case 2: channels = 3
+                case 4: channels = 2
+                case 6: channels = 4
+                default: return nil
+                }
+            case "IDAT":
+                compressed += bytes[payload]
+            case "IEND":
+                offset = bytes.count
+                continue
+            default:
+                break
+            }
+            offset += 12 + length
+        }
+        guard width > 0 && height > 0 && channels > 0,
+            var scanlines = try? Zlib.inflate(compressed) else { return nil }
+        let stride = width * channels
+        guard scanlines.count >= (stride + 1) * height else { return nil }
+
+        var image = RenderImage(width: width, height: height, pixels: [UInt8](repeating: 0, count: width * height * 4))
+        for row in 0..<height {
+            let start = row * (stride + 1) + 1
+            guard unfilter(&scanlines, filter: scanlines[start - 1], start: start, stride: stride,
+                           channels: channels, hasPrevious: row > 0) else { return nil }
+            for column in 0..<width {
+                let from = start + column * channels, to = (row * width + column) * 4
+                switch channels {
+                case 1, 2:
+                    image.pixels[to] = scanlines[from]
+                    image.pixels[to + 1] = scanlines[from]
+                    image.pixels[to + 2] = scanlines[from]
+                    image.pixels[to + 3] = channels == 2 ? scanlines[from + 1] : 255
+                default:
+                    image.pixels[to] = scanlines[from]
+                    image.pixels[to + 1] = scanlines[from + 1]
+                    image.pixels[to + 2] = scanlines[from + 2]
+                    image.pixels[to + 3] = channels == 4 ? scanlines[from + 3] : 255
+                }
+            }
+        }
+        return image
+    }
+
+    /// Reverses the filter of the scanline at `start`, in place; the previous scanline has
+    /// already been reversed.
+    private static func unfilter(_ bytes: inout [UInt8], filter: UInt8, start: Int, stride: Int,
+                                 channels: Int, hasPrevious: Bool) -> Bool {
+        let previous = start - stride - 1
+        for index in start..<start + stride {
+            let left = index - start >= channels ? Int(bytes[index - channels]) : 0
+            let up = hasPrevious ? Int(bytes[index - stride - 1]) : 0
+            let upLeft = hasPrevious && index - start >= channels ? Int(bytes[previous + index - start - channels]) : 0
+            let predictor: Int
+            switch filter {
+            case 0: predictor = 0
+            case 1: predictor = left
+            case 2: predictor = up
+            case 3: predictor = (left + up) / 2
+            case 4:
+                let estimate = left + up - upLeft
+                let distances = (abs(estimate - left), abs(estimate - up), abs(estimate - upLeft))
+                if distances.0 <= distances.1 && distances.0 <= distances.2 {
+                    predictor = left
+                } else if distances.1 <= distances.2 {
+                    predictor = up
+                } else {
+                    predictor = upLeft
+                }
+            default: return false
+            }
+            bytes[index] = UInt8(truncatingIfNeeded: Int(bytes[index]) + predictor)
+        }
+        return true
+    }
+}
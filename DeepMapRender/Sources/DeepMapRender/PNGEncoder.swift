@@ -0,0 +1,106 @@
+//
+//  PNGEncoder.swift
+//  DeepMapRender
+//
+//  Created by agent on 18.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+import Foundation
+
+/// Minimal PNG writer for RGBA images, usable off the main thread and without UIKit.
+///
+/// By default image data is stored in uncompressed deflate blocks, so files are about as large
+/// as the raw pixels but encoding is a copy; snapshots and test references care more about
+/// speed than size. Archived output (map tiles) is deflated with `Zlib` instead.
+enum PNGEncoder {
+
+    private static let signature: [UInt8] = [0x89, 0x50, 0x4E, 0x47, 0x0D, 0x0A, 0x1A, 0x0A]
+    private static let maximumStoredBlock = 65535
+
+    private static let crcTable: [UInt32] = (0..<256).map { index -> UInt32 in
+        var crc = UInt32(index)
+        for _ in 0..<8 {
+            crc = crc & 1 != 0 ? 0xEDB88320 ^ (crc >> 1) : crc >> 1
+        }
+        return crc
+    }
+
+    /// Encodes `rgba`, 8 bits per channel with straight alpha, rows top to bottom.
+    ///
+    /// - parameter compressed: Deflate the image data; falls back to stored blocks if that fails.
+    static func encode(rgba: [UInt8], width: Int, height: Int, compressed: Bool = false) -> Data {
+        precondition(rgba.count == width * height * 4, "pixel count does not match size")
+        var png = Data(signature)
+
+        var header: [UInt8] = []
+        append(UInt32(width), to: &header)
+        append(UInt32(height), to: &header)
+        header += [8, 6, 0, 0, 0] // bit depth, RGBA, deflate, adaptive filtering, no interlace
+        appendChunk("IHDR", header, to: &png)
+
+        // each scanline is preceded by its filter type, 0 (none)
+        let stride = width * 4
+        var scanlines = [UInt8](repeating: 0, count: (stride + 1) * height)
+        for row in 0..<height {
+            scanlines.replaceSubrange((stride + 1) * row + 1..<(stride + 1) * (row + 1), with: rgba[stride * row..<stride * (row + 1)])
+        }
+        appendChunk("IDAT", (compressed ? Zlib.deflate(scanlines) : nil) ?? zlibStored(scanlines), to: &png)
+        appendChunk("IEND", [], to: &png)
+        return png
+    }
+
+    /// Wraps `bytes` into a zlib stream of stored deflate blocks.
+    private static func zlibStored(_ bytes: [UInt8]) -> [UInt8] {
+        var stream: [UInt8] = [0x78, 0x01]
+        stream.reserveCapacity(bytes.count + bytes.count / maximumStoredBlock * 5 + 11)
+        var offset = 0
+        repeat {
+            let length = min(maximumStoredBlock, bytes.count - offset)
+            let final: UInt8 = offset + length == bytes.count ? 1 : 0
+            stream += [final, UInt8(length & 0xFF), UInt8(length >> 8), UInt8(~length & 0xFF), UInt8(~length >> 8 & 0xFF)]
+            stream += bytes[offset..<offset + length]
+            offset += length
+        } while offset < bytes.count
+        append(adler32(bytes), to: &stream)
+        return stream
+    }
+
+    private static func appendChunk(_ type: String, _ payload: [UInt8], to png: inout Data) {
+        var chunk: [UInt8] = []
+        append(UInt32(payload.count), to: &chunk)
+        let typeAndPayload = Array(type.utf8) + payload
+        chunk += typeAndPayload
+        append(crc32(typeAndPayload), to: &chunk)
+        png.append(contentsOf: chunk)
+    }
+
+    private static func append(_ value: UInt32, to bytes: inout [UInt8]) {
+        bytes += [UInt8(value >> 24), UInt8(value >> 16 & 0xFF), UInt8(value >> 8 & 0xFF), UInt8(value & 0xFF)]
+    }
+
+    static func crc32(_ bytes: [UInt8]) -> UInt32 {
+        var crc = UInt32.max
+        for byte in bytes {
+            crc = crcTable[Int((crc ^ UInt32(byte)) & 0xFF)] ^ (crc >> 8)
+        }
+        return ~crc
+    }
+
+    static func adler32(_ bytes: [UInt8]) -> UInt32 {
+        var a: UInt32 = 1, b: UInt32 = 0
+        // 5552 is the largest run that cannot overflow before the modulo
+        var offset = 0
+        while offset < bytes.count {
+            let end = min(offset + 5552, bytes.count)
+            for index in offset..<end {
+                a += UInt32(bytes[index])
+                b += a
+            }
+            a %= 65521
+            b %= 65521
+            offset = end
+        }
+        return b << 16 | a
+    }
+}
@@ -0,0 +1,231 @@
+//
+//  RenderGeometry.swift
+//  DeepMapRender
+//
+//  Created by agent on 18.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+import Foundation
+
+/// A point in the renderer's planar CRS (UTM easting/northing and elevation, in meters).
+struct RenderPoint {
+    var x: Double
+    var y: Double
+    var z: Double
+
+    init(x: Double, y: Double, z: Double = 0) {
+        self.x = x
+        self.y = y
+        self.z = z
+    }
+}
+
+/// One drawable feature part.
+struct RenderPrimitive {
+
+    enum Geometry {
+        /// Outer ring followed by holes, filled with the even-odd rule.
+        case polygon([[RenderPoint]])
+        case line([RenderPoint])
+        case point(RenderPoint)
+    }
+
+    let featureId: UInt64
+    /// Style sheet type, e.g. "routing.line" or "stair".
+    let type: Symbol
+    let level: Float
+    let geometry: Geometry
+
+    /// Smallest rectangle containing all vertices, as (minX, minY, maxX, maxY).
+    var bounds: (Double, Double, Double, Double) {
+        var bounds = (Double.infinity, Double.infinity, -Double.infinity, -Double.infinity)
+        func extend(_ point: RenderPoint) {
+            bounds = (min(bounds.0, point.x), min(bounds.1, point.y), max(bounds.2, point.x), max(bounds.3, point.y))
+        }
+        switch geometry {
+        case .polygon(let rings):
+            rings.forEach { $0.forEach(extend) }
+        case .line(let points):
+            points.forEach(extend)
+        case .point(let point):
+            extend(point)
+        }
+        return bounds
+    }
+}
+
+/// Provides the geometry drawn by `SoftwareRenderer`.
+///
+/// The map's .hsg/.hsm cells are only readable by the framework's engine, so geometry enters
+/// the headless renderer through sources: the routing network and feature locations of the
+/// query database are built in, other sources (e.g. floor plans exported as GeoJSON) can be
+/// added by conforming to this protocol.
+protocol RenderGeometrySource {
+    /// Primitives on `level`, or on all levels if nil.
+    func primitives(level: Float?) -> [RenderPrimitive]
+}
+
+/// Transverse Mercator projection of WGS84 coordinates into one UTM zone.
+struct UTMProjection {
+
+    let zone: Int
+    let northernHemisphere: Bool
+
+    private static let a = 6378137.0
+    private static let f = 1 / 298.257223563
+    private static let k0 = 0.9996
+
+    init(zone: Int, northernHemisphere: Bool = true) {
+        self.zone = zone
+        self.northernHemisphere = northernHemisphere
+    }
+
+    /// The zone of a PROJ.4 definition such as "+proj=utm +zone=32 +datum=WGS84 +units=m", nil
+    /// if it is no WGS84 UTM projection in meters.
+    init?(proj4: String) {
+        var parameters: [String: String] = [:]
+        for term in proj4.split(separator: " ") where term.hasPrefix("+") {
+            let pair = term.dropFirst().split(separator: "=", maxSplits: 1).map(String.init)
+            if let name = pair.first {
+                parameters[name] = pair.count > 1 ? pair[1] : ""
+            }
+        }
+        guard parameters["proj"] == "utm", let zone = parameters["zone"].flatMap({ Int($0) }), (1...60).contains(zone),
+            parameters["datum"] ?? parameters["ellps"] == "WGS84", parameters["units"] ?? "m" == "m" else { return nil }
+        self.init(zone: zone, northernHemisphere: parameters["south"] == nil)
+    }
+
+    /// The zone of the map packages this app ships (Heidelberg).
+    static let zone32N = UTMProjection(zone: 32)
+
+    /// Projects longitude/latitude in degrees to easting/northing in meters.
+    func project(longitude: Double, latitude: Double, elevation: Double = 0) -> RenderPoint {
+        let e2 = UTMProjection.f * (2 - UTMProjection.f)
+        let e4 = e2 * e2, e6 = e4 * e2
+        let ep2 = e2 / (1 - e2)
+        let phi = latitude * .pi / 180
+        let lambda0 = Double(zone * 6 - 183) * .pi / 180
+        let sinPhi = sin(phi), cosPhi = cos(phi), tanPhi = tan(phi)
+
+        let n = UTMProjection.a / (1 - e2 * sinPhi * sinPhi).squareRoot()
+        let t = tanPhi * tanPhi
+        let c = ep2 * cosPhi * cosPhi
+        let a = cosPhi * (longitude * .pi / 180 - lambda0)
+        let m = UTMProjection.a * ((1 - e2 / 4 - 3 * e4 / 64 - 5 * e6 / 256) * phi
+            - (3 * e2 / 8 + 3 * e4 / 32 + 45 * e6 / 1024) * sin(2 * phi)
+            + (15 * e4 / 256 + 45 * e6 / 1024) * sin(4 * phi)
+            - (35 * e6 / 3072) * sin(6 * phi))
+
+        let a2 = a * a, a3 = a2 * a, a4 = a3 * a, a5 = a4 * a, a6 = a5 * a
+        let easting = UTMProjection.k0 * n * (a + (1 - t + c) * a3 / 6 + (5 - 18 * t + t * t + 72 * c - 58 * ep2) * a5 / 120) + 500000
+        var northing = UTMProjection.k0 * (m + n * tanPhi * (a2 / 2 + (5 - t + 9 * c + 4 * c * c) * a4 / 24
+            + (61 - 58 * t + t * t + 600 * c - 330 * ep2) * a6 / 720))
+        if !northernHemisphere {
+            northing += 10000000
+        }
+        return RenderPoint(x: easting, y: northing, z: elevation)
+    }
+
+    /// Inverse of `project(longitude:latitude:elevation:)`, in degrees.
+    func unproject(_ point: RenderPoint) -> (longitude: Double, latitude: Double) {
+        let e2 = UTMProjection.f * (2 - UTMProjection.f)
+        let e4 = e2 * e2, e6 = e4 * e2
+        let ep2 = e2 / (1 - e2)
+        let e1 = (1 - (1 - e2).squareRoot()) / (1 + (1 - e2).squareRoot())
+        let lambda0 = Double(zone * 6 - 183) * .pi / 180
+
+        let m = (northernHemisphere ? point.y : point.y - 10000000) / UTMProjection.k0
+        let mu = m / (UTMProjection.a * (1 - e2 / 4 - 3 * e4 / 64 - 5 * e6 / 256))
+        let phi1 = mu + (3 * e1 / 2 - 27 * pow(e1, 3) / 32) * sin(2 * mu)
+            + (21 * e1 * e1 / 16 - 55 * pow(e1, 4) / 32) * sin(4 * mu)
+            + (151 * pow(e1, 3) / 96) * sin(6 * mu)
+            + (1097 * pow(e1, 4) / 512) * sin(8 * mu)
+        let sinPhi1 = sin(phi1), cosPhi1 = cos(phi1), tanPhi1 = tan(phi1)
+
+        let n1 = UTMProjection.a / (1 - e2 * sinPhi1 * sinPhi1).squareRoot()
+        let t1 = tanPhi1 * tanPhi1
+        let c1 = ep2 * cosPhi1 * cosPhi1
+        let r1 = UTMProjection.a * (1 - e2) / pow(1 - e2 * sinPhi1 * sinPhi1, 1.5)
+        let d = (point.x - 500000) / (n1 * UTMProjection.k0)
+        let d2 = d * d, d3 = d2 * d, d4 = d3 * d, d5 = d4 * d, d6 = d5 * d
+
+        let latitude = phi1 - n1 * tanPhi1 / r1 * (d2 / 2 - (5 + 3 * t1 + 10 * c1 - 4 * c1 * c1 - 9 * ep2) * d4 / 24
+            + (61 + 90 * t1 + 298 * c1 + 45 * t1 * t1 - 252 * ep2 - 3 * c1 * c1) * d6 / 720)
+        let longitude = lambda0 + (d - (1 + 2 * t1 + c1) * d3 / 6
+            + (5 - 2 * c1 + 28 * t1 - 3 * c1 * c1 + 8 * ep2 + 24 * t1 * t1) * d5 / 120) / cosPhi1
+        return (longitude * 180 / .pi, latitude * 180 / .pi)
+    }
+}
+
+/// Routing network of a Deep Map database as lines, one per edge, typed "routing.line".
+final class RoutingNetworkSource: RenderGeometrySource {
+
+    private let edgesByLevel: [Float: [RenderPrimitive]]
+
+    /// Reads `routing_nodes` (ISO WKB PointZ in the map's UTM zone) and `routing_edges`.
+    init(databasePath path: String) throws {
+        let reader = try SQLiteReader(path: path)
+        var nodes: [Int64: (RenderPoint, Float)] = [:]
+        try reader.query("SELECT id, level, geom FROM routing_nodes") { row, _ in
+            let level = Float(row.int64(at: 1))
+            if let point = row.withBytes(at: 2, { RoutingNetworkSource.point(fromWKB: $0) }) {
+                nodes[row.int64(at: 0)] = (point, level)
+            }
+            return true
+        }
+
+        var edgesByLevel: [Float: [RenderPrimitive]] = [:]
+        let type = Symbol("routing.line")
+        try reader.query("SELECT id, from_node_id, to_node_id FROM routing_edges") { row, _ in
+            guard let from = nodes[row.int64(at: 1)], let to = nodes[row.int64(at: 2)] else { return true }
+            // edges between floors (stairs) are drawn on the lower floor
+            let level = min(from.1, to.1)
+            let edge = RenderPrimitive(featureId: UInt64(bitPattern: row.int64(at: 0)), type: type, level: level,
+                                       geometry: .line([from.0, to.0]))
+            edgesByLevel[level, default: []].append(edge)
+            return true
+        }
+        self.edgesByLevel = edgesByLevel
+    }
+
+    var levels: [Float] {
+        return edgesByLevel.keys.sorted()
+    }
+
+    func primitives(level: Float?) -> [RenderPrimitive] {
+        if let level = level {
+            return edgesByLevel[level] ?? []
+        }
+        return levels.flatMap { edgesByLevel[$0]! }
+    }
+
+    /// Decodes a 2D or 3D WKB point (ISO or EWKB flavour, either byte order).
+    static func point(fromWKB bytes: UnsafeRawBufferPointer) -> RenderPoint? {
+        guard bytes.count >= 21 else { return nil }
+        let littleEndian = bytes[0] == 1
+        func uint32(at offset: Int) -> UInt32 {
+            var value: UInt32 = 0
+            for index in 0..<4 {
+                value |= UInt32(bytes[offset + index]) << UInt32(8 * (littleEndian ? index : 3 - index))
+            }
+            return value
+        }
+        func double(at offset: Int) -> Double {
+            var bits: UInt64 = 0
+            for index in 0..<8 {
+                bits |= UInt64(bytes[offset + index]) << UInt64(8 * (littleEndian ? index : 7 - index))
+            }
+            return Double(bitPattern: bits)
+        }
+
+        let rawType = uint32(at: 1)
+        let hasZ = rawType & 0x80000000 != 0 || (rawType & 0xFFFF) / 1000 == 1 || (rawType & 0xFFFF) / 1000 == 3
+        var offset = 5
+        if rawType & 0x20000000 != 0 {
+            offset += 4 // EWKB SRID
+        }
+        guard (rawType & 0xFFFF) % 1000 == 1, bytes.count >= offset + (hasZ ? 24 : 16) else { return nil }
+        return RenderPoint(x: double(at: offset), y: double(at: offset + 8), z: hasZ ? double(at: offset + 16) : 0)
+    }
+}
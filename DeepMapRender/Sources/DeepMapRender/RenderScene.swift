@@ -0,0 +1,222 @@
+//
+//  RenderScene.swift
+//  DeepMapRender
+//
+//  Created by agent on 18.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+import Foundation
+
+/// Drawing parameters resolved from a feature's style; features with equal values share a batch.
+struct RenderStyle: Hashable {
+    var fill: UInt32?
+    var stroke: UInt32?
+    /// Line width; in meters if `widthInMeters`, else pixels.
+    var width: Double = 1
+    var widthInMeters = false
+    var iconSize: Double = 6
+
+    var hashValue: Int {
+        return Int(fill ?? 0) ^ Int(stroke ?? 0) << 32 ^ width.hashValue ^ iconSize.hashValue << 1 ^ (widthInMeters ? 1 : 0)
+    }
+
+    static func == (lhs: RenderStyle, rhs: RenderStyle) -> Bool {
+        return lhs.fill == rhs.fill && lhs.stroke == rhs.stroke && lhs.width == rhs.width
+            && lhs.widthInMeters == rhs.widthInMeters && lhs.iconSize == rhs.iconSize
+    }
+}
+
+/// One icon, drawn as an instanced quad.
+struct IconInstance {
+    let featureId: UInt64
+    let position: RenderPoint
+    /// Index into `RenderScene.icons`.
+    let icon: Int32
+    /// Edge length, in pixels.
+    let size: Float
+    /// Clockwise, in degrees.
+    let rotation: Float
+    let color: UInt32
+}
+
+/// Primitives grouped into draw batches by resolved style.
+///
+/// Areas and lines whose styles resolve to the same `RenderStyle` are merged into one batch
+/// with a shared vertex buffer, whatever their feature type, so the many room and corridor
+/// classes of the style sheet that only differ by name cost one draw call. All points become
+/// instances of a single icon batch referencing `icons`. Batches are ordered areas, lines,
+/// icons, each in order of first appearance.
+///
+/// A scene only depends on the primitives, the style sheet and the selection, so it can be
+/// drawn for any number of frames; rebuild it when one of those changes. Visibility is
+/// checked per part when drawing.
+final class RenderScene {
+
+    enum BatchKind: Int {
+        case area
+        case line
+        case icon
+    }
+
+    /// A range of rings of a batch belonging to one feature.
+    struct Part {
+        let featureId: UInt64
+        let rings: CountableRange<Int32>
+    }
+
+    struct Batch {
+        let kind: BatchKind
+        let style: RenderStyle
+        /// Vertices of all parts; ring `i` spans `ringOffsets[i]..<ringOffsets[i + 1]`.
+        fileprivate(set) var vertices: [RenderPoint] = []
+        fileprivate(set) var ringOffsets: [Int32] = [0]
+        fileprivate(set) var parts: [Part] = []
+        fileprivate(set) var instances: [IconInstance] = []
+
+        fileprivate init(kind: BatchKind, style: RenderStyle) {
+            self.kind = kind
+            self.style = style
+        }
+
+        fileprivate mutating func append(_ featureId: UInt64, rings: [[RenderPoint]]) {
+            let first = Int32(ringOffsets.count - 1)
+            for ring in rings {
+                vertices += ring
+                ringOffsets.append(Int32(vertices.count))
+            }
+            parts.append(Part(featureId: featureId, rings: first..<Int32(ringOffsets.count - 1)))
+        }
+    }
+
+    private(set) var batches: [Batch] = []
+    /// Icon types, by `IconInstance.icon`.
+    private(set) var icons: [Symbol] = []
+    /// Primitives left out as invisible by style or without a color to draw with.
+    private(set) var skipped = 0
+
+    private struct StyleKey: Hashable {
+        let type: Symbol
+        let selected: Bool
+
+        var hashValue: Int {
+            return Int(type.rawValue) << 1 | (selected ? 1 : 0)
+        }
+
+        static func == (lhs: StyleKey, rhs: StyleKey) -> Bool {
+            return lhs.type == rhs.type && lhs.selected == rhs.selected
+        }
+    }
+
+    /// Groups `primitives`; features selected or highlighted in `states` are styled with
+    /// `isSelected()` true.
+    init(primitives: [RenderPrimitive], sheet: StyleSheet?, context: StyleContext = StyleContext(),
+         states: FeatureStateBuffer? = nil) {
+        let resolver = StyleResolver(sheet: sheet)
+        var styles: [StyleKey: RenderStyle?] = [:]
+        var areaIndex: [RenderStyle: Int] = [:], lineIndex: [RenderStyle: Int] = [:]
+        var areas: [Batch] = [], lines: [Batch] = []
+        var iconBatch = Batch(kind: .icon, style: RenderStyle())
+        var iconIndex: [Symbol: Int32] = [:]
+
+        for primitive in primitives {
+            let selected = states.map { !$0.state(of: primitive.featureId).isEmpty } ?? false
+            let key = StyleKey(type: primitive.type, selected: selected)
+            if styles[key] == nil {
+                var featureContext = context
+                featureContext.isSelected = selected
+                styles[key] = resolver.style(for: primitive.type, context: featureContext)
+            }
+            guard let style = styles[key]! else {
+                skipped += 1
+                continue
+            }
+
+            switch primitive.geometry {
+            case .polygon(let rings):
+                guard style.fill != nil else {
+                    skipped += 1
+                    continue
+                }
+                if areaIndex[style] == nil {
+                    areaIndex[style] = areas.count
+                    areas.append(Batch(kind: .area, style: style))
+                }
+                areas[areaIndex[style]!].append(primitive.featureId, rings: rings)
+
+            case .line(let points):
+                guard style.stroke != nil, points.count >= 2 else {
+                    skipped += 1
+                    continue
+                }
+                if lineIndex[style] == nil {
+                    lineIndex[style] = lines.count
+                    lines.append(Batch(kind: .line, style: style))
+                }
+                lines[lineIndex[style]!].append(primitive.featureId, rings: [points])
+
+            case .point(let point):
+                guard let color = style.stroke ?? style.fill else {
+                    skipped += 1
+                    continue
+                }
+                if iconIndex[primitive.type] == nil {
+                    iconIndex[primitive.type] = Int32(icons.count)
+                    icons.append(primitive.type)
+                }
+                let icon = iconIndex[primitive.type]!
+                iconBatch.instances.append(IconInstance(featureId: primitive.featureId, position: point, icon: icon,
+                                                        size: Float(style.iconSize), rotation: 0, color: color))
+            }
+        }
+        batches = areas + lines + (iconBatch.instances.isEmpty ? [] : [iconBatch])
+    }
+
+    /// Number of areas, lines and icons in the scene.
+    var partCount: Int {
+        return batches.reduce(0) { $0 + $1.parts.count + $1.instances.count }
+    }
+}
+
+/// Turns style sheet entries into `RenderStyle`s.
+private struct StyleResolver {
+    let sheet: StyleSheet?
+    let fillColor: StyleProperty?
+    let lineColor: StyleProperty?
+    let lineWidth: StyleProperty?
+    let textColor: StyleProperty?
+    let iconSize: StyleProperty?
+    let visibility: StyleProperty?
+
+    init(sheet: StyleSheet?) {
+        self.sheet = sheet
+        fillColor = sheet?.property("fill-color")
+        lineColor = sheet?.property("line-color")
+        lineWidth = sheet?.property("line-width")
+        textColor = sheet?.property("text-color")
+        iconSize = sheet?.property("icon-size")
+        visibility = sheet?.property("visibility")
+    }
+
+    /// nil if the type is unknown or has `visibility: none`.
+    func style(for type: Symbol, context: StyleContext) -> RenderStyle? {
+        guard let sheet = sheet else {
+            return RenderStyle(fill: 0xD0D0D0FF, stroke: 0xEA857DFF, width: 1, widthInMeters: false, iconSize: 6)
+        }
+        guard let style = sheet.style(for: type, context: context) else { return nil }
+        if let visibility = visibility.flatMap({ style.string($0) }), visibility == "none" {
+            return nil
+        }
+        var renderStyle = RenderStyle()
+        renderStyle.fill = fillColor.flatMap { style.color($0) }?.rgba
+        renderStyle.stroke = (lineColor.flatMap { style.color($0) } ?? textColor.flatMap { style.color($0) })?.rgba
+        if let width = lineWidth, let value = style.number(width) {
+            renderStyle.width = value
+            renderStyle.widthInMeters = style.string(width)?.hasSuffix("m") ?? false
+        }
+        if let size = iconSize.flatMap({ style.number($0) }) {
+            renderStyle.iconSize = max(4, size)
+        }
+        return renderStyle
+    }
+}
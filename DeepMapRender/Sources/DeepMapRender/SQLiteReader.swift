@@ -0,0 +1,131 @@
+//
+//  SQLiteReader.swift
+//  DeepMapRender
+//
+//  Created by agent on 18.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+import Foundation
+#if SWIFT_PACKAGE
+import CSQLite
+#else
+import SQLite3
+#endif
+
+/// A read-only connection to the query database of a Deep Map package.
+///
+/// The connection is opened with `SQLITE_OPEN_NOMUTEX`, so an instance must only be used
+/// from one thread at a time. Only `interrupt()` may be called from other threads.
+final class SQLiteReader {
+
+    enum ReaderError: Error {
+        case open(String)
+        case prepare(String)
+        case step(String)
+        case interrupted
+    }
+
+    /// A single result row, only valid inside the row callback of `query(_:row:)`.
+    struct Row {
+        fileprivate let statement: OpaquePointer
+
+        func int64(at column: Int32) -> Int64 {
+            return sqlite3_column_int64(statement, column)
+        }
+
+        func double(at column: Int32) -> Double {
+            return sqlite3_column_double(statement, column)
+        }
+
+        func string(at column: Int32) -> String? {
+            guard let text = sqlite3_column_text(statement, column) else { return nil }
+            return String(cString: text)
+        }
+
+        func isNull(at column: Int32) -> Bool {
+            return sqlite3_column_type(statement, column) == SQLITE_NULL
+        }
+
+        /// Calls `body` with the raw bytes of a BLOB or TEXT column without copying them.
+        func withBytes<R>(at column: Int32, _ body: (UnsafeRawBufferPointer) throws -> R) rethrows -> R {
+            let count = Int(sqlite3_column_bytes(statement, column))
+            let bytes = sqlite3_column_blob(statement, column)
+            return try body(UnsafeRawBufferPointer(start: bytes, count: bytes == nil ? 0 : count))
+        }
+    }
+
+    let path: String
+    private var handle: OpaquePointer?
+
+    init(path: String) throws {
+        self.path = path
+        let flags = SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX
+        if sqlite3_open_v2(path, &handle, flags, nil) != SQLITE_OK {
+            let message = handle.map { String(cString: sqlite3_errmsg($0)) } ?? "unable to open \(path)"
+            sqlite3_close(handle)
+            handle = nil
+            throw ReaderError.open(message)
+        }
+        // package databases ship in rollback-journal mode and are never written while installed,
+        // so readers don't need WAL to run in parallel; just make sure nobody writes through us
+        sqlite3_exec(handle, "PRAGMA query_only = 1", nil, nil, nil)
+    }
+
+    deinit {
+        sqlite3_close(handle)
+    }
+
+    /// Aborts the statement currently running on this connection.
+    func interrupt() {
+        sqlite3_interrupt(handle)
+    }
+
+    /// Runs `sql` and calls `row` once per result row. Returning false from `row` stops the query early.
+    ///
+    /// - parameter column: Name of a column to resolve before the first row is read; its index
+    ///   is passed to `row` (or -1 if the query does not return it).
+    func query(_ sql: String, column: String? = nil, row: (Row, Int32) throws -> Bool) throws {
+        let statement = try prepare(sql)
+        defer { sqlite3_finalize(statement) }
+
+        let index = column.flatMap { SQLiteReader.columnIndex(named: $0, statement: statement) } ?? -1
+        while true {
+            switch sqlite3_step(statement) {
+            case SQLITE_ROW:
+                if try !row(Row(statement: statement), index) {
+                    return
+                }
+            case SQLITE_DONE:
+                return
+            case SQLITE_INTERRUPT:
+                throw ReaderError.interrupted
+            default:
+                throw ReaderError.step(lastErrorMessage)
+            }
+        }
+    }
+
+    private func prepare(_ sql: String) throws -> OpaquePointer {
+        var statement: OpaquePointer?
+        guard sqlite3_prepare_v2(handle, sql, -1, &statement, nil) == SQLITE_OK, let prepared = statement else {
+            sqlite3_finalize(statement)
+            throw ReaderError.prepare(lastErrorMessage)
+        }
+        return prepared
+    }
+
+    private var lastErrorMessage: String {
+        guard let handle = handle else { return "database is not open" }
+        return String(cString: sqlite3_errmsg(handle))
+    }
+
+    private static func columnIndex(named name: String, statement: OpaquePointer) -> Int32? {
+        for column in 0..<sqlite3_column_count(statement) {
+            if let columnName = sqlite3_column_name(statement, column), String(cString: columnName) == name {
+                return column
+            }
+        }
+        return nil
+    }
+}
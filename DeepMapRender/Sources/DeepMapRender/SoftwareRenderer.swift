@@ -0,0 +1,588 @@
+//
+//  SoftwareRenderer.swift
+//  DeepMapRender
+//
+//  Created by agent on 18.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+import Foundation
+
+/// Perspective camera of the headless renderer, with the parameters of `HDMMapCamera`.
+struct RenderCamera {
+
+    /// Point looked at, in the renderer's planar CRS.
+    var center: RenderPoint
+    /// Distance of the eye from `center`, in meters.
+    var distance: Double
+    /// Direction shown up, in degrees clockwise from north.
+    var bearing: Double
+    /// Angle between the view direction and the ground, in degrees; 90 looks straight down.
+    var tilt: Double
+    /// Vertical field of view, in degrees. `HDMMapCamera` does not report the engine's; cameras
+    /// made from one assume 45, and anything drawn over the map with them is off by a factor
+    /// growing with the distance from the screen center if the engine uses another value.
+    var fieldOfView: Double = 45
+    var width: Int
+    var height: Int
+
+    private static let nearPlane = 0.1
+
+    init(center: RenderPoint, distance: Double, bearing: Double = 0, tilt: Double = 90, width: Int, height: Int) {
+        self.center = center
+        self.distance = distance
+        self.bearing = bearing
+        self.tilt = tilt
+        self.width = width
+        self.height = height
+    }
+
+    /// A camera looking straight down that shows all of `bounds` (minX, minY, maxX, maxY).
+    static func fitting(_ bounds: (Double, Double, Double, Double), width: Int, height: Int, margin: Double = 0.05) -> RenderCamera {
+        let halfWidth = (bounds.2 - bounds.0) / 2 * (1 + margin)
+        let halfHeight = (bounds.3 - bounds.1) / 2 * (1 + margin)
+        let aspect = Double(width) / Double(max(height, 1))
+        let halfExtent = max(halfHeight, halfWidth / aspect, 1)
+        var camera = RenderCamera(center: RenderPoint(x: (bounds.0 + bounds.2) / 2, y: (bounds.1 + bounds.3) / 2),
+                                  distance: 0, width: width, height: height)
+        camera.distance = halfExtent / tan(camera.fieldOfView * .pi / 360)
+        return camera
+    }
+
+    /// Orthonormal view basis, computed once per frame.
+    struct Basis {
+        let eye: RenderPoint
+        let right: RenderPoint
+        let up: RenderPoint
+        let forward: RenderPoint
+        /// Pixels per meter at one meter depth.
+        let focalLength: Double
+        fileprivate let halfWidth: Double
+        fileprivate let halfHeight: Double
+
+        /// Screen position (pixels, origin top left) and depth of a point, nil if behind the near plane.
+        func project(_ point: RenderPoint) -> (x: Double, y: Double, depth: Double)? {
+            let dx = point.x - eye.x, dy = point.y - eye.y, dz = point.z - eye.z
+            let depth = dx * forward.x + dy * forward.y + dz * forward.z
+            guard depth > RenderCamera.nearPlane else { return nil }
+            let x = dx * right.x + dy * right.y + dz * right.z
+            let y = dx * up.x + dy * up.y + dz * up.z
+            return (halfWidth + x * focalLength / depth, halfHeight - y * focalLength / depth, depth)
+        }
+
+        /// The point at height `z` seen at screen position (`x`, `y`), nil if the view ray
+        /// through it does not reach that height, e.g. above the horizon.
+        func unproject(x: Double, y: Double, z: Double = 0) -> RenderPoint? {
+            let sx = (x - halfWidth) / focalLength, sy = (halfHeight - y) / focalLength
+            let direction = RenderPoint(x: forward.x + right.x * sx + up.x * sy, y: forward.y + right.y * sx + up.y * sy,
+                                        z: forward.z + right.z * sx + up.z * sy)
+            guard abs(direction.z) > 1e-9 else { return nil }
+            let t = (z - eye.z) / direction.z
+            guard t > 0 else { return nil }
+            return RenderPoint(x: eye.x + direction.x * t, y: eye.y + direction.y * t, z: z)
+        }
+    }
+
+    var basis: Basis {
+        let b = bearing * .pi / 180, t = tilt * .pi / 180
+        let heading = (sin(b), cos(b))
+        let eye = RenderPoint(x: center.x - heading.0 * distance * cos(t), y: center.y - heading.1 * distance * cos(t),
+                              z: center.z + distance * sin(t))
+        let forward = RenderPoint(x: heading.0 * cos(t), y: heading.1 * cos(t), z: -sin(t))
+        let right = RenderPoint(x: heading.1, y: -heading.0, z: 0)
+        // up = right × forward
+        let up = RenderPoint(x: right.y * forward.z - right.z * forward.y,
+                             y: right.z * forward.x - right.x * forward.z,
+                             z: right.x * forward.y - right.y * forward.x)
+        return Basis(eye: eye, right: right, up: up, forward: forward,
+                     focalLength: Double(height) / 2 / tan(fieldOfView * .pi / 360),
+                     halfWidth: Double(width) / 2, halfHeight: Double(height) / 2)
+    }
+}
+
+/// An RGBA image with 8 bits per channel and straight alpha, rows top to bottom.
+struct RenderImage {
+    let width: Int
+    let height: Int
+    var pixels: [UInt8]
+
+    init(width: Int, height: Int, pixels: [UInt8]) {
+        precondition(pixels.count == width * height * 4, "pixel count does not match size")
+        self.width = width
+        self.height = height
+        self.pixels = pixels
+    }
+
+    init(width: Int, height: Int, fill: StyleColor) {
+        self.width = width
+        self.height = height
+        let rgba = [fill.red, fill.green, fill.blue, fill.alpha]
+        pixels = [UInt8](repeating: 0, count: width * height * 4)
+        for index in stride(from: 0, to: pixels.count, by: 4) {
+            pixels[index] = rgba[0]
+            pixels[index + 1] = rgba[1]
+            pixels[index + 2] = rgba[2]
+            pixels[index + 3] = rgba[3]
+        }
+    }
+
+    func color(x: Int, y: Int) -> StyleColor {
+        let index = (y * width + x) * 4
+        return StyleColor(rgba: UInt32(pixels[index]) << 24 | UInt32(pixels[index + 1]) << 16
+            | UInt32(pixels[index + 2]) << 8 | UInt32(pixels[index + 3]))
+    }
+
+    func pngData(compressed: Bool = false) -> Data {
+        return PNGEncoder.encode(rgba: pixels, width: width, height: height, compressed: compressed)
+    }
+
+    /// 64-bit FNV-1a hash of the pixels, for finding identical images.
+    var contentHash: UInt64 {
+        var hash: UInt64 = 0xCBF29CE484222325
+        for byte in pixels {
+            hash = (hash ^ UInt64(byte)) &* 0x100000001B3
+        }
+        return hash
+    }
+
+    /// A second 64-bit hash of the pixels, mixing whole RGBA words instead of bytes, to tell
+    /// images apart whose `contentHash` collides.
+    var contentChecksum: UInt64 {
+        var hash: UInt64 = 0x9E3779B97F4A7C15
+        for index in stride(from: 0, to: pixels.count, by: 4) {
+            let word = UInt64(pixels[index]) << 24 | UInt64(pixels[index + 1]) << 16
+                | UInt64(pixels[index + 2]) << 8 | UInt64(pixels[index + 3])
+            hash = (hash ^ word) &* 0xFF51AFD7ED558CCD
+            hash ^= hash >> 33
+        }
+        return hash
+    }
+
+    /// Compares two images of the same size, channel by channel.
+    ///
+    /// - parameter tolerance: Channel differences up to this value are ignored.
+    func difference(from other: RenderImage, tolerance: Int = 0) -> ImageDifference {
+        precondition(width == other.width && height == other.height, "images differ in size")
+        var differing = 0
+        var maximum = 0
+        for pixel in 0..<width * height {
+            var pixelDelta = 0
+            for channel in 0..<4 {
+                let index = pixel * 4 + channel
+                pixelDelta = max(pixelDelta, abs(Int(pixels[index]) - Int(other.pixels[index])))
+            }
+            if pixelDelta > tolerance {
+                differing += 1
+            }
+            maximum = max(maximum, pixelDelta)
+        }
+        return ImageDifference(differingPixels: differing, pixelCount: width * height, maximumDelta: maximum)
+    }
+}
+
+struct ImageDifference {
+    let differingPixels: Int
+    let pixelCount: Int
+    /// Largest difference of any channel of any pixel.
+    let maximumDelta: Int
+
+    var fraction: Double {
+        return pixelCount == 0 ? 0 : Double(differingPixels) / Double(pixelCount)
+    }
+}
+
+/// Counters of the last frame of a `SoftwareRenderer`.
+struct RenderStatistics: CustomStringConvertible {
+    var primitives = 0
+    /// Primitives dropped as hidden, invisible by style, behind the camera or off screen.
+    var culled = 0
+    var shapes = 0
+    /// Batches of the scene, and those that drew anything.
+    var batches = 0
+    var drawCalls = 0
+    /// Icon instances submitted.
+    var instances = 0
+    var tiles = 0
+    /// Tiles with at least one shape.
+    var occupiedTiles = 0
+    var setupTime: TimeInterval = 0
+    var rasterTime: TimeInterval = 0
+    /// Filled when a `FloorCuller` is attached; its time is part of `setupTime`.
+    var culling = CullStatistics()
+
+    var frameTime: TimeInterval {
+        return setupTime + rasterTime
+    }
+
+    var description: String {
+        return String(format: "%d primitives (%d culled), %d draw calls, %d shapes in %d/%d tiles, setup %.2f ms, raster %.2f ms",
+                      primitives, culled, drawCalls, shapes, occupiedTiles, tiles, setupTime * 1000, rasterTime * 1000)
+    }
+}
+
+/// Multithreaded tiled software rasterizer for map snapshots without a GPU.
+///
+/// A frame is drawn in two passes. Setup walks the batches of a `RenderScene`: each batch
+/// projects its shared vertex buffer through the camera once and turns its parts into screen
+/// space polygons (lines become quads per segment, icon instances quads of their size);
+/// shapes are binned into square tiles by their bounds. Raster then fills the tiles in
+/// parallel, each tile scan converting its shapes in batch order with alpha blending. Tiles
+/// never share pixels, so no locking is needed. Every batch with something on screen counts
+/// as one draw call in `statistics`.
+///
+/// Text is not drawn. Icons are drawn from `icons` when attached, else filled with their
+/// color. Features hidden in `visibility` are skipped when drawing.
+final class SoftwareRenderer {
+
+    fileprivate struct Edge {
+        let x0: Float, y0: Float, x1: Float, y1: Float
+    }
+
+    /// Maps the pixels of a rotated icon quad back to its image.
+    fileprivate struct Texture {
+        let image: IconImage
+        let centerX: Float, centerY: Float
+        let cosine: Float, sine: Float
+        let size: Float
+    }
+
+    fileprivate struct Shape {
+        var edges: [Edge]
+        var minX: Float, minY: Float, maxX: Float, maxY: Float
+        let color: UInt32
+        /// Lines overlap themselves at joints and use the nonzero rule, areas the even-odd rule.
+        let nonzero: Bool
+        /// Image of an icon quad, sampled instead of `color`.
+        var texture: Texture?
+
+        init(color: UInt32, nonzero: Bool) {
+            edges = []
+            minX = .infinity
+            minY = .infinity
+            maxX = -.infinity
+            maxY = -.infinity
+            self.color = color
+            self.nonzero = nonzero
+        }
+    }
+
+    let sheet: StyleSheet?
+    var background = StyleColor(rgba: 0xF1EEE8FF)
+    /// Edge length of the square tiles the frame is split into, in pixels.
+    var tileSize = 64
+    var visibility: FeatureVisibility?
+    /// Selection used when the renderer builds scenes itself.
+    var states: FeatureStateBuffer?
+    /// Limits drawing to the features it finds visible from the camera.
+    var culler: FloorCuller?
+    /// Icon images; icons are decoded on first use at the size they are drawn at.
+    var icons: IconAtlas?
+
+    private(set) var statistics = RenderStatistics()
+
+    init(sheet: StyleSheet?) {
+        self.sheet = sheet
+    }
+
+    /// Renders the primitives of `sources` on `level` (all levels if nil).
+    func render(_ sources: [RenderGeometrySource], level: Float?, camera: RenderCamera,
+                context: StyleContext = StyleContext()) -> RenderImage {
+        return render(sources.flatMap { $0.primitives(level: level) }, camera: camera, context: context)
+    }
+
+    /// Builds a scene of `primitives` and renders it once. Keep a `RenderScene` to draw
+    /// unchanged primitives repeatedly.
+    func render(_ primitives: [RenderPrimitive], camera: RenderCamera, context: StyleContext = StyleContext()) -> RenderImage {
+        let start = Date()
+        let scene = RenderScene(primitives: primitives, sheet: sheet, context: context, states: states)
+        let buildTime = Date().timeIntervalSince(start)
+        let image = render(scene, camera: camera)
+        statistics.primitives = primitives.count
+        statistics.culled += scene.skipped
+        statistics.setupTime += buildTime
+        return image
+    }
+
+    func render(_ scene: RenderScene, camera: RenderCamera) -> RenderImage {
+        let start = Date()
+        var statistics = RenderStatistics()
+        statistics.primitives = scene.partCount
+        statistics.batches = scene.batches.count
+
+        var image = RenderImage(width: camera.width, height: camera.height, fill: background)
+        var unculled: Set<UInt64>?
+        if let culler = culler {
+            unculled = Set(culler.visibleFeatures(camera: camera, statistics: &statistics.culling).values.joined())
+        }
+        let shapes = makeShapes(scene, camera: camera, unculled: unculled, statistics: &statistics)
+        statistics.shapes = shapes.count
+
+        let columns = (camera.width + tileSize - 1) / tileSize
+        let rows = (camera.height + tileSize - 1) / tileSize
+        var bins = [[Int32]](repeating: [], count: columns * rows)
+        let tile = Float(tileSize)
+        for (index, shape) in shapes.enumerated() {
+            let firstColumn = max(0, Int(shape.minX / tile)), lastColumn = min(columns - 1, Int(shape.maxX / tile))
+            let firstRow = max(0, Int(shape.minY / tile)), lastRow = min(rows - 1, Int(shape.maxY / tile))
+            guard firstColumn <= lastColumn && firstRow <= lastRow else { continue }
+            for row in firstRow...lastRow {
+                for column in firstColumn...lastColumn {
+                    bins[row * columns + column].append(Int32(index))
+                }
+            }
+        }
+        statistics.tiles = bins.count
+        statistics.occupiedTiles = bins.filter { !$0.isEmpty }.count
+        statistics.setupTime = Date().timeIntervalSince(start)
+
+        let rasterStart = Date()
+        let width = camera.width, height = camera.height, tileSize = self.tileSize
+        image.pixels.withUnsafeMutableBufferPointer { buffer in
+            let pixels = buffer.baseAddress!
+            DispatchQueue.concurrentPerform(iterations: bins.count) { tileIndex in
+                let bin = bins[tileIndex]
+                guard !bin.isEmpty else { return }
+                let x0 = (tileIndex % columns) * tileSize, y0 = (tileIndex / columns) * tileSize
+                let x1 = min(x0 + tileSize, width), y1 = min(y0 + tileSize, height)
+                var crossings: [(Float, Int32)] = []
+                for shapeIndex in bin {
+                    SoftwareRenderer.fill(shapes[Int(shapeIndex)], pixels: pixels, width: width,
+                                          clip: (x0, y0, x1, y1), crossings: &crossings)
+                }
+            }
+        }
+        statistics.rasterTime = Date().timeIntervalSince(rasterStart)
+        self.statistics = statistics
+        return image
+    }
+
+    // MARK: - Setup
+
+    private func makeShapes(_ scene: RenderScene, camera: RenderCamera, unculled: Set<UInt64>?,
+                            statistics: inout RenderStatistics) -> [Shape] {
+        let basis = camera.basis
+        let screen = (Float(0), Float(0), Float(camera.width), Float(camera.height))
+        var shapes: [Shape] = []
+        var projected: [(x: Double, y: Double, depth: Double)?] = []
+
+        for batch in scene.batches {
+            let shapeCount = shapes.count
+            func emit(_ shape: Shape) {
+                if !shape.edges.isEmpty && shape.maxX >= screen.0 && shape.minX <= screen.2
+                    && shape.maxY >= screen.1 && shape.minY <= screen.3 {
+                    shapes.append(shape)
+                } else {
+                    statistics.culled += 1
+                }
+            }
+
+            switch batch.kind {
+            case .area, .line:
+                // one transform of the shared vertex buffer per batch
+                projected = batch.vertices.map { basis.project($0) }
+                for part in batch.parts {
+                    if let visibility = visibility, !visibility.isVisible(part.featureId) {
+                        statistics.culled += 1
+                        continue
+                    }
+                    if let unculled = unculled, !unculled.contains(part.featureId) {
+                        statistics.culled += 1
+                        continue
+                    }
+                    if let shape = makeShape(part, of: batch, projected: projected, basis: basis) {
+                        emit(shape)
+                    } else {
+                        statistics.culled += 1
+                    }
+                }
+
+            case .icon:
+                statistics.instances += batch.instances.count
+                for instance in batch.instances {
+                    if let visibility = visibility, !visibility.isVisible(instance.featureId) {
+                        statistics.culled += 1
+                        continue
+                    }
+                    if let unculled = unculled, !unculled.contains(instance.featureId) {
+                        statistics.culled += 1
+                        continue
+                    }
+                    guard let center = basis.project(instance.position) else {
+                        statistics.culled += 1
+                        continue
+                    }
+                    var shape = Shape(color: instance.color, nonzero: true)
+                    let half = Double(instance.size) / 2
+                    let angle = Double(instance.rotation) * .pi / 180
+                    let corners = [(-half, -half), (half, -half), (half, half), (-half, half)].map { corner -> (Float, Float) in
+                        (Float(center.x + corner.0 * cos(angle) - corner.1 * sin(angle)),
+                         Float(center.y + corner.0 * sin(angle) + corner.1 * cos(angle)))
+                    }
+                    SoftwareRenderer.addRing(corners, to: &shape)
+                    if let image = icons?.image(forType: scene.icons[Int(instance.icon)], size: Int(instance.size.rounded(.up))) {
+                        shape.texture = Texture(image: image, centerX: Float(center.x), centerY: Float(center.y),
+                                                cosine: Float(cos(angle)), sine: Float(sin(angle)), size: instance.size)
+                    }
+                    emit(shape)
+                }
+            }
+            if shapes.count > shapeCount {
+                statistics.drawCalls += 1
+            }
+        }
+        return shapes
+    }
+
+    private func makeShape(_ part: RenderScene.Part, of batch: RenderScene.Batch,
+                           projected: [(x: Double, y: Double, depth: Double)?], basis: RenderCamera.Basis) -> Shape? {
+        let style = batch.style
+        if batch.kind == .area {
+            var shape = Shape(color: style.fill!, nonzero: false)
+            for ring in part.rings {
+                var points: [(Float, Float)] = []
+                for index in Int(batch.ringOffsets[Int(ring)])..<Int(batch.ringOffsets[Int(ring) + 1]) {
+                    guard let screen = projected[index] else { return nil }
+                    points.append((Float(screen.x), Float(screen.y)))
+                }
+                SoftwareRenderer.addRing(points, to: &shape)
+            }
+            return shape
+        }
+
+        var shape = Shape(color: style.stroke!, nonzero: true)
+        let ring = Int(part.rings.lowerBound)
+        var points: [(Double, Double, Double)] = []
+        for index in Int(batch.ringOffsets[ring])..<Int(batch.ringOffsets[ring + 1]) {
+            guard let screen = projected[index] else { return nil }
+            let width = style.widthInMeters ? style.width * basis.focalLength / screen.depth : style.width
+            points.append((screen.x, screen.y, max(width, 1) / 2))
+        }
+        for index in 1..<points.count {
+            let a = points[index - 1], b = points[index]
+            let length = ((b.0 - a.0) * (b.0 - a.0) + (b.1 - a.1) * (b.1 - a.1)).squareRoot()
+            guard length > 0 else { continue }
+            let nx = -(b.1 - a.1) / length, ny = (b.0 - a.0) / length
+            // counterclockwise quad, so overlapping segments add up under the nonzero rule
+            let quad = [(a.0 - nx * a.2, a.1 - ny * a.2), (b.0 - nx * b.2, b.1 - ny * b.2),
+                        (b.0 + nx * b.2, b.1 + ny * b.2), (a.0 + nx * a.2, a.1 + ny * a.2)]
+            SoftwareRenderer.addRing(quad.map { (Float($0.0), Float($0.1)) }, to: &shape)
+        }
+        return shape
+    }
+
+    private static func addRing(_ ring: [(Float, Float)], to shape: inout Shape) {
+        guard ring.count >= 3 else { return }
+        for index in 0..<ring.count {
+            let a = ring[index], b = ring[(index + 1) % ring.count]
+            shape.minX = min(shape.minX, a.0)
+            shape.minY = min(shape.minY, a.1)
+            shape.maxX = max(shape.maxX, a.0)
+            shape.maxY = max(shape.maxY, a.1)
+            if a.1 != b.1 {
+                shape.edges.append(Edge(x0: a.0, y0: a.1, x1: b.0, y1: b.1))
+            }
+        }
+    }
+
+    // MARK: - Raster
+
+    /// Scan converts `shape` into the pixels of `clip` (x0, y0, x1, y1), sampling pixel centers.
+    private static func fill(_ shape: Shape, pixels: UnsafeMutablePointer<UInt8>, width: Int,
+                             clip: (Int, Int, Int, Int), crossings: inout [(Float, Int32)]) {
+        let firstRow = max(clip.1, Int((shape.minY - 0.5).rounded(.up)))
+        let lastRow = min(clip.3 - 1, Int((shape.maxY - 0.5).rounded(.down)))
+        guard firstRow <= lastRow else { return }
+
+        let alpha = UInt32(shape.color & 0xFF)
+        let red = shape.color >> 24, green = shape.color >> 16 & 0xFF, blue = shape.color >> 8 & 0xFF
+        for row in firstRow...lastRow {
+            let sampleY = Float(row) + 0.5
+            crossings.removeAll(keepingCapacity: true)
+            for edge in shape.edges where (edge.y0 <= sampleY) != (edge.y1 <= sampleY) {
+                let x = edge.x0 + (sampleY - edge.y0) * (edge.x1 - edge.x0) / (edge.y1 - edge.y0)
+                crossings.append((x, edge.y1 > edge.y0 ? 1 : -1))
+            }
+            guard crossings.count >= 2 else { continue }
+            crossings.sort { $0.0 < $1.0 }
+
+            var winding: Int32 = 0
+            for index in 0..<crossings.count - 1 {
+                winding += shape.nonzero ? crossings[index].1 : 1
+                let inside = shape.nonzero ? winding != 0 : winding % 2 == 1
+                guard inside else { continue }
+                let start = max(clip.0, Int((crossings[index].0 - 0.5).rounded(.up)))
+                let end = min(clip.2, Int((crossings[index + 1].0 - 0.5).rounded(.up)))
+                guard start < end else { continue }
+                var pixel = pixels + (row * width + start) * 4
+                if let texture = shape.texture {
+                    for column in start..<end {
+                        // rotate the pixel center back into the icon's frame
+                        let dx = Float(column) + 0.5 - texture.centerX, dy = sampleY - texture.centerY
+                        let u = (dx * texture.cosine + dy * texture.sine) / texture.size + 0.5
+                        let v = (dy * texture.cosine - dx * texture.sine) / texture.size + 0.5
+                        blend(texture.image.color(u: u, v: v), alpha: alpha, into: pixel)
+                        pixel += 4
+                    }
+                    continue
+                }
+                for _ in start..<end {
+                    if alpha == 255 {
+                        pixel[0] = UInt8(red)
+                        pixel[1] = UInt8(green)
+                        pixel[2] = UInt8(blue)
+                        pixel[3] = 255
+                    } else {
+                        let inverse = 255 - alpha
+                        pixel[0] = UInt8((red * alpha + UInt32(pixel[0]) * inverse) / 255)
+                        pixel[1] = UInt8((green * alpha + UInt32(pixel[1]) * inverse) / 255)
+                        pixel[2] = UInt8((blue * alpha + UInt32(pixel[2]) * inverse) / 255)
+                        pixel[3] = UInt8(min(255, alpha + UInt32(pixel[3]) * inverse / 255))
+                    }
+                    pixel += 4
+                }
+            }
+        }
+    }
+
+    /// Blends a straight-alpha RGBA `color`, scaled by `alpha`, over one pixel.
+    private static func blend(_ color: UInt32, alpha: UInt32, into pixel: UnsafeMutablePointer<UInt8>) {
+        let opacity = (color & 0xFF) * alpha / 255
+        guard opacity > 0 else { return }
+        let inverse = 255 - opacity
+        pixel[0] = UInt8(((color >> 24) * opacity + UInt32(pixel[0]) * inverse) / 255)
+        pixel[1] = UInt8(((color >> 16 & 0xFF) * opacity + UInt32(pixel[1]) * inverse) / 255)
+        pixel[2] = UInt8(((color >> 8 & 0xFF) * opacity + UInt32(pixel[2]) * inverse) / 255)
+        pixel[3] = UInt8(min(255, opacity + UInt32(pixel[3]) * inverse / 255))
+    }
+}
+
+/// Frame time measurements of repeated renders, for tracking rendering performance.
+struct RenderBenchmark {
+
+    struct Result: CustomStringConvertible {
+        let frames: Int
+        let minimum: TimeInterval
+        let median: TimeInterval
+        let maximum: TimeInterval
+
+        var description: String {
+            return String(format: "%d frames: min %.2f ms, median %.2f ms, max %.2f ms",
+                          frames, minimum * 1000, median * 1000, maximum * 1000)
+        }
+    }
+
+    /// Runs `render` `warmup` times unmeasured, then `frames` times measured.
+    static func run(frames: Int = 20, warmup: Int = 2, _ render: () -> Void) -> Result {
+        for _ in 0..<warmup {
+            render()
+        }
+        var times: [TimeInterval] = []
+        for _ in 0..<max(frames, 1) {
+            let start = Date()
+            render()
+            times.append(Date().timeIntervalSince(start))
+        }
+        times.sort()
+        return Result(frames: times.count, minimum: times.first!, median: times[times.count / 2], maximum: times.last!)
+    }
+}
@@ -0,0 +1,1071 @@
+//
+//  StyleSheet.swift
+//  DeepMapRender
+//
+//  Created by agent on 18.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+import Foundation
+
+enum StyleSheetError: Error {
+    case syntax(line: Int, message: String)
+    case unknownParent(type: String, parent: String)
+    case inheritanceCycle(type: String)
+    case tooManyRules(type: String)
+}
+
+/// Packed 8-bit RGBA color of a style property.
+struct StyleColor: Equatable {
+    let rgba: UInt32
+
+    init(rgba: UInt32) {
+        self.rgba = rgba
+    }
+
+    /// Parses "#RGB", "#RRGGBB" and "#RRGGBBAA".
+    init?(_ text: String) {
+        guard text.hasPrefix("#"), let value = UInt32(text.dropFirst(), radix: 16) else { return nil }
+        switch text.utf8.count {
+        case 4:
+            let r = value >> 8 & 0xF, g = value >> 4 & 0xF, b = value & 0xF
+            rgba = (r * 17) << 24 | (g * 17) << 16 | (b * 17) << 8 | 0xFF
+        case 7:
+            rgba = value << 8 | 0xFF
+        case 9:
+            rgba = value
+        default:
+            return nil
+        }
+    }
+
+    var red: UInt8 { return UInt8(rgba >> 24) }
+    var green: UInt8 { return UInt8(rgba >> 16 & 0xFF) }
+    var blue: UInt8 { return UInt8(rgba >> 8 & 0xFF) }
+    var alpha: UInt8 { return UInt8(rgba & 0xFF) }
+
+    static func == (lhs: StyleColor, rhs: StyleColor) -> Bool {
+        return lhs.rgba == rhs.rgba
+    }
+}
+
+/// Values a rule condition is evaluated against.
+struct StyleContext {
+    /// Result of `isSelected()`.
+    var isSelected = false
+    /// Result of `distance()`: camera distance to the feature in meters.
+    var distance: Double = 0
+    /// Attributes set with `setFeatureAttribute`, queried by `attribute("key")` or a bare `key`.
+    var featureAttributes: [Symbol: String] = [:]
+    /// Attributes set with `setGlobalAttribute`, queried by `globalAttribute("key")` or a bare `key`.
+    var globalAttributes: [Symbol: String] = [:]
+}
+
+/// Inputs a rule condition reads, for re-evaluating only what a change can affect.
+struct StyleDependencies {
+    var featureAttributes = Set<Symbol>()
+    var globalAttributes = Set<Symbol>()
+    var selection = false
+    var distance = false
+
+    mutating func formUnion(_ other: StyleDependencies) {
+        featureAttributes.formUnion(other.featureAttributes)
+        globalAttributes.formUnion(other.globalAttributes)
+        selection = selection || other.selection
+        distance = distance || other.distance
+    }
+}
+
+/// Column handle of a style property of a `StyleSheet`.
+struct StyleProperty: Hashable {
+    let rawValue: Int32
+
+    var hashValue: Int {
+        return Int(rawValue)
+    }
+
+    static func == (lhs: StyleProperty, rhs: StyleProperty) -> Bool {
+        return lhs.rawValue == rhs.rawValue
+    }
+}
+
+/// A compiled rule condition such as `distance() < 200 && isSelected()`, run on a small stack machine.
+struct StyleCondition {
+
+    fileprivate enum Comparison {
+        case equal, notEqual, less, lessOrEqual, greater, greaterOrEqual
+    }
+
+    fileprivate enum Instruction {
+        case number(Double)
+        case string(String)
+        case isSelected
+        case distance
+        case attribute(Symbol)
+        case globalAttribute(Symbol)
+        case anyAttribute(Symbol)
+        case compare(Comparison)
+        case and
+        case or
+        case not
+    }
+
+    fileprivate enum Value {
+        case none
+        case number(Double)
+        case string(String)
+
+        init(_ attribute: String?) {
+            if let attribute = attribute {
+                self = .string(attribute)
+            } else {
+                self = .none
+            }
+        }
+
+        var truth: Bool {
+            switch self {
+            case .none: return false
+            case .number(let number): return number != 0
+            case .string(let string): return !string.isEmpty && string != "false"
+            }
+        }
+
+        var number: Double? {
+            switch self {
+            case .none: return nil
+            case .number(let number): return number
+            case .string(let string): return Double(string)
+            }
+        }
+
+        var string: String? {
+            switch self {
+            case .none: return nil
+            case .number(let number): return String(number)
+            case .string(let string): return string
+            }
+        }
+    }
+
+    fileprivate let code: [Instruction]
+
+    /// Condition of a rule without brackets.
+    static let always = StyleCondition(code: [])
+
+    fileprivate init(code: [Instruction]) {
+        self.code = code
+    }
+
+    /// Compiles the text between the quotes of a `["..."]` rule condition.
+    init(_ source: String) throws {
+        var parser = ConditionParser(source)
+        code = try parser.parse()
+    }
+
+    var isAlways: Bool {
+        return code.isEmpty
+    }
+
+    var dependencies: StyleDependencies {
+        var dependencies = StyleDependencies()
+        for instruction in code {
+            switch instruction {
+            case .isSelected:
+                dependencies.selection = true
+            case .distance:
+                dependencies.distance = true
+            case .attribute(let key):
+                dependencies.featureAttributes.insert(key)
+            case .globalAttribute(let key):
+                dependencies.globalAttributes.insert(key)
+            case .anyAttribute(let key):
+                dependencies.featureAttributes.insert(key)
+                dependencies.globalAttributes.insert(key)
+            default:
+                break
+            }
+        }
+        return dependencies
+    }
+
+    func and(_ other: StyleCondition) -> StyleCondition {
+        if isAlways { return other }
+        if other.isAlways { return self }
+        return StyleCondition(code: code + other.code + [.and])
+    }
+
+    func evaluate(_ context: StyleContext) -> Bool {
+        if code.isEmpty {
+            return true
+        }
+        var stack: [Value] = []
+        stack.reserveCapacity(4)
+        for instruction in code {
+            switch instruction {
+            case .number(let number):
+                stack.append(.number(number))
+            case .string(let string):
+                stack.append(.string(string))
+            case .isSelected:
+                stack.append(.number(context.isSelected ? 1 : 0))
+            case .distance:
+                stack.append(.number(context.distance))
+            case .attribute(let key):
+                stack.append(Value(context.featureAttributes[key]))
+            case .globalAttribute(let key):
+                stack.append(Value(context.globalAttributes[key]))
+            case .anyAttribute(let key):
+                stack.append(Value(context.featureAttributes[key] ?? context.globalAttributes[key]))
+            case .compare(let comparison):
+                let rhs = stack.removeLast(), lhs = stack.removeLast()
+                stack.append(.number(StyleCondition.compare(lhs, rhs, comparison) ? 1 : 0))
+            case .and:
+                let rhs = stack.removeLast(), lhs = stack.removeLast()
+                stack.append(.number(lhs.truth && rhs.truth ? 1 : 0))
+            case .or:
+                let rhs = stack.removeLast(), lhs = stack.removeLast()
+                stack.append(.number(lhs.truth || rhs.truth ? 1 : 0))
+            case .not:
+                stack.append(.number(stack.removeLast().truth ? 0 : 1))
+            }
+        }
+        return stack.last?.truth ?? false
+    }
+
+    private static func compare(_ lhs: Value, _ rhs: Value, _ comparison: Comparison) -> Bool {
+        if case .none = lhs { return comparison == .notEqual && rhs.string != nil }
+        if case .none = rhs { return comparison == .notEqual }
+        if let a = lhs.number, let b = rhs.number {
+            switch comparison {
+            case .equal: return a == b
+            case .notEqual: return a != b
+            case .less: return a < b
+            case .lessOrEqual: return a <= b
+            case .greater: return a > b
+            case .greaterOrEqual: return a >= b
+            }
+        }
+        let a = lhs.string ?? "", b = rhs.string ?? ""
+        switch comparison {
+        case .equal: return a == b
+        case .notEqual: return a != b
+        case .less: return a < b
+        case .lessOrEqual: return a <= b
+        case .greater: return a > b
+        case .greaterOrEqual: return a >= b
+        }
+    }
+}
+
+/// Style of one feature type with the rules matching one context applied.
+struct ResolvedStyle {
+    let sheet: StyleSheet
+    fileprivate let slots: [UInt32]
+
+    func string(_ property: StyleProperty) -> String? {
+        let slot = slots[Int(property.rawValue)]
+        return slot == StyleSheet.absent ? nil : sheet.values[Int(slot)]
+    }
+
+    /// Numeric value, with a trailing unit such as "m" ignored.
+    func number(_ property: StyleProperty) -> Double? {
+        let slot = slots[Int(property.rawValue)]
+        return slot == StyleSheet.absent ? nil : sheet.numbers[Int(slot)]
+    }
+
+    func color(_ property: StyleProperty) -> StyleColor? {
+        let slot = slots[Int(property.rawValue)]
+        return slot == StyleSheet.absent ? nil : sheet.colors[Int(slot)]
+    }
+
+    func string(_ property: Symbol) -> String? {
+        return sheet.property(property).flatMap { string($0) }
+    }
+}
+
+/// A Deep Map Style and Rule file compiled into flat tables.
+///
+/// Feature blocks (`feature stair:visibility_in_building_icon { ... }`) are flattened along
+/// their inheritance chain into one row of value slots per type, so a property lookup is two
+/// array accesses. Rules (`rule r(type) ["distance() < 200"] { ... }`) apply to their target
+/// type and all types inheriting from it; nested rules add their parent's condition.
+/// For a feature, the conditions of the rules of its type are evaluated into a bit mask and
+/// each distinct (type, mask) pair is resolved once into another row.
+final class StyleSheet {
+
+    fileprivate static let absent = UInt32.max
+    private static let noParent = Int32(-1)
+
+    private struct Rule {
+        let name: Symbol
+        let target: Int32
+        let condition: StyleCondition
+        let declarations: [(Int32, UInt32)]
+    }
+
+    private struct VariantKey: Hashable {
+        let type: Int32
+        let mask: UInt64
+
+        var hashValue: Int {
+            return Int(type) &* 31 ^ mask.hashValue
+        }
+
+        static func == (lhs: VariantKey, rhs: VariantKey) -> Bool {
+            return lhs.type == rhs.type && lhs.mask == rhs.mask
+        }
+    }
+
+    /// Declared feature types and rule targets, in declaration order.
+    let featureTypes: [Symbol]
+    /// All properties declared anywhere in the sheet.
+    let properties: [Symbol]
+    /// Parent type of every feature type, -1 for roots.
+    let parents: [Int32]
+    /// Time spent parsing and compiling.
+    let compileDuration: TimeInterval
+
+    fileprivate let values: [String]
+    fileprivate let numbers: [Double?]
+    fileprivate let colors: [StyleColor?]
+
+    private let typeIndices: [Symbol: Int32]
+    private let propertyIndex: [Symbol: StyleProperty]
+    private let rules: [Rule]
+    private let rulesOfType: [[Int32]]
+    /// What the rules of each type read.
+    private let dependenciesOfType: [StyleDependencies]
+    private let typesReadingFeatureAttribute: [Symbol: [Int32]]
+    private let typesReadingGlobalAttribute: [Symbol: [Int32]]
+
+    private let lock = NSLock()
+    private var rows: [[UInt32]]
+    private var variants: [VariantKey: Int32] = [:]
+
+    /// Compiles the concatenation of `paths`, e.g. the map's style and rule file. A path
+    /// given twice is read once.
+    convenience init(contentsOfFiles paths: [String]) throws {
+        var sources: [String] = []
+        var seen = Set<String>()
+        for path in paths where seen.insert(path).inserted {
+            sources.append(try String(contentsOfFile: path, encoding: .utf8))
+        }
+        try self.init(source: sources.joined(separator: "\n"))
+    }
+
+    init(source: String) throws {
+        let start = Date()
+        var scanner = MapCSSScanner(source)
+        let (features, ruleBlocks) = try scanner.parseSheet()
+
+        var typeIndices: [Symbol: Int32] = [:]
+        var featureTypes: [Symbol] = []
+        var parentNames: [String?] = []
+        var declarationsOfType: [[(String, String)]] = []
+        func addType(_ name: String) -> Int32 {
+            let symbol = Symbol(name)
+            if let index = typeIndices[symbol] {
+                return index
+            }
+            let index = Int32(featureTypes.count)
+            typeIndices[symbol] = index
+            featureTypes.append(symbol)
+            parentNames.append(nil)
+            declarationsOfType.append([])
+            return index
+        }
+        for block in features {
+            let index = Int(addType(block.name))
+            // a repeated block extends the earlier one
+            parentNames[index] = block.parent ?? parentNames[index]
+            declarationsOfType[index] += block.declarations
+        }
+
+        var parents = [Int32](repeating: StyleSheet.noParent, count: featureTypes.count)
+        for (index, parent) in parentNames.enumerated() {
+            guard let parent = parent else { continue }
+            guard let parentIndex = typeIndices[Symbol(parent)] else {
+                throw StyleSheetError.unknownParent(type: featureTypes[index].string, parent: parent)
+            }
+            parents[index] = parentIndex
+        }
+
+        var propertyIndex: [Symbol: StyleProperty] = [:]
+        var properties: [Symbol] = []
+        var values: [String] = []
+        var valueIndex: [String: UInt32] = [:]
+        func declaration(_ property: String, _ value: String) -> (Int32, UInt32) {
+            let symbol = Symbol(property)
+            let column: StyleProperty
+            if let existing = propertyIndex[symbol] {
+                column = existing
+            } else {
+                column = StyleProperty(rawValue: Int32(properties.count))
+                propertyIndex[symbol] = column
+                properties.append(symbol)
+            }
+            let slot: UInt32
+            if let existing = valueIndex[value] {
+                slot = existing
+            } else {
+                slot = UInt32(values.count)
+                valueIndex[value] = slot
+                values.append(value)
+            }
+            return (column.rawValue, slot)
+        }
+
+        // rules in document order, each before the rules nested in it
+        var rules: [Rule] = []
+        func flatten(_ block: RuleBlock, inherited: StyleCondition) throws {
+            let condition = try block.conditions.reduce(inherited) { $0.and(try StyleCondition($1)) }
+            let target = addType(block.target)
+            rules.append(Rule(name: Symbol(block.name), target: target, condition: condition,
+                              declarations: block.declarations.map { declaration($0.0, $0.1) }))
+            for child in block.children {
+                try flatten(child, inherited: condition)
+            }
+        }
+        let typeDeclarations = declarationsOfType.map { $0.map { declaration($0.0, $0.1) } }
+        for block in ruleBlocks {
+            try flatten(block, inherited: .always)
+        }
+        // rule targets that are not declared as features are roots
+        parents += [Int32](repeating: StyleSheet.noParent, count: featureTypes.count - parents.count)
+
+        // flatten inheritance: a type's row starts as a copy of its parent's
+        var rows = [[UInt32]?](repeating: nil, count: featureTypes.count)
+        var visiting = Set<Int32>()
+        func row(of type: Int32) throws -> [UInt32] {
+            if let row = rows[Int(type)] {
+                return row
+            }
+            guard visiting.insert(type).inserted else {
+                throw StyleSheetError.inheritanceCycle(type: featureTypes[Int(type)].string)
+            }
+            var slots = [UInt32](repeating: StyleSheet.absent, count: properties.count)
+            if parents[Int(type)] != StyleSheet.noParent {
+                slots = try row(of: parents[Int(type)])
+            }
+            if Int(type) < typeDeclarations.count {
+                for (column, slot) in typeDeclarations[Int(type)] {
+                    slots[Int(column)] = slot
+                }
+            }
+            visiting.remove(type)
+            rows[Int(type)] = slots
+            return slots
+        }
+        var baseRows: [[UInt32]] = []
+        baseRows.reserveCapacity(featureTypes.count)
+        for type in 0..<featureTypes.count {
+            baseRows.append(try row(of: Int32(type)))
+        }
+
+        var rulesOfType = [[Int32]](repeating: [], count: featureTypes.count)
+        for type in 0..<featureTypes.count {
+            var ancestors = Set<Int32>()
+            var current = Int32(type)
+            while current != StyleSheet.noParent {
+                ancestors.insert(current)
+                current = parents[Int(current)]
+            }
+            rulesOfType[type] = rules.indices.filter { ancestors.contains(rules[$0].target) }.map { Int32($0) }
+            if rulesOfType[type].count > 64 {
+                throw StyleSheetError.tooManyRules(type: featureTypes[type].string)
+            }
+        }
+
+        self.featureTypes = featureTypes
+        self.properties = properties
+        self.parents = parents
+        self.values = values
+        self.numbers = values.map { StyleSheet.number(from: $0) }
+        self.colors = values.map { StyleColor($0) }
+        self.typeIndices = typeIndices
+        self.propertyIndex = propertyIndex
+        self.rules = rules
+        self.rulesOfType = rulesOfType
+        let dependenciesOfType = rulesOfType.map { candidates -> StyleDependencies in
+            var dependencies = StyleDependencies()
+            for rule in candidates {
+                dependencies.formUnion(rules[Int(rule)].condition.dependencies)
+            }
+            return dependencies
+        }
+        var typesReadingFeatureAttribute: [Symbol: [Int32]] = [:]
+        var typesReadingGlobalAttribute: [Symbol: [Int32]] = [:]
+        for (type, dependencies) in dependenciesOfType.enumerated() {
+            for key in dependencies.featureAttributes {
+                typesReadingFeatureAttribute[key, default: []].append(Int32(type))
+            }
+            for key in dependencies.globalAttributes {
+                typesReadingGlobalAttribute[key, default: []].append(Int32(type))
+            }
+        }
+        self.dependenciesOfType = dependenciesOfType
+        self.typesReadingFeatureAttribute = typesReadingFeatureAttribute
+        self.typesReadingGlobalAttribute = typesReadingGlobalAttribute
+        self.rows = baseRows
+        self.compileDuration = Date().timeIntervalSince(start)
+    }
+
+    // MARK: - Dependencies
+
+    func dependencies(ofType type: Int32) -> StyleDependencies {
+        return type >= 0 ? dependenciesOfType[Int(type)] : StyleDependencies()
+    }
+
+    /// Types with a rule reading the feature attribute `key`, e.g. "occupancy".
+    func types(readingFeatureAttribute key: Symbol) -> [Int32] {
+        return typesReadingFeatureAttribute[key] ?? []
+    }
+
+    /// Types with a rule reading the global attribute `key`.
+    func types(readingGlobalAttribute key: Symbol) -> [Int32] {
+        return typesReadingGlobalAttribute[key] ?? []
+    }
+
+    /// Types whose style changes with `setFeatureStyle` on `type`: the type and its descendants.
+    func types(inheritingFrom type: Int32) -> [Int32] {
+        guard type >= 0 else { return [] }
+        return (0..<Int32(parents.count)).filter { candidate in
+            var current = candidate
+            while current >= 0 {
+                if current == type {
+                    return true
+                }
+                current = parents[Int(current)]
+            }
+            return false
+        }
+    }
+
+    // MARK: - Lookup
+
+    func property(_ name: Symbol) -> StyleProperty? {
+        return propertyIndex[name]
+    }
+
+    /// Index of a feature type, -1 if the sheet does not style it.
+    func typeIndex(of type: Symbol) -> Int32 {
+        return typeIndices[type] ?? StyleSheet.noParent
+    }
+
+    /// Row of the style of `type` in `context`. Rows stay valid for the lifetime of the sheet;
+    /// rows below `featureTypes.count` are the types' styles without rules.
+    func variant(ofType type: Int32, context: StyleContext) -> Int32 {
+        let candidates = rulesOfType[Int(type)]
+        var mask: UInt64 = 0
+        for (bit, rule) in candidates.enumerated() where rules[Int(rule)].condition.evaluate(context) {
+            mask |= 1 << UInt64(bit)
+        }
+        if mask == 0 {
+            return type
+        }
+
+        lock.lock()
+        defer { lock.unlock() }
+        let key = VariantKey(type: type, mask: mask)
+        if let variant = variants[key] {
+            return variant
+        }
+        var row = rows[Int(type)]
+        for (bit, rule) in candidates.enumerated() where mask & 1 << UInt64(bit) != 0 {
+            for (column, slot) in rules[Int(rule)].declarations {
+                row[Int(column)] = slot
+            }
+        }
+        let variant = Int32(rows.count)
+        rows.append(row)
+        variants[key] = variant
+        return variant
+    }
+
+    func style(atVariant variant: Int32) -> ResolvedStyle {
+        lock.lock()
+        defer { lock.unlock() }
+        return ResolvedStyle(sheet: self, slots: rows[Int(variant)])
+    }
+
+    func style(for type: Symbol, context: StyleContext = StyleContext()) -> ResolvedStyle? {
+        let index = typeIndex(of: type)
+        guard index >= 0 else { return nil }
+        return style(atVariant: variant(ofType: index, context: context))
+    }
+
+    private static func number(from value: String) -> Double? {
+        if let number = Double(value) {
+            return number
+        }
+        return value.hasSuffix("m") ? Double(value.dropLast()) : nil
+    }
+}
+
+/// Resolved styles per feature, aligned with the rows of a `FeatureTagStore`.
+///
+/// A feature's type and style row are looked up once and kept until `invalidate()`, which
+/// must be called when anything read by rule conditions changes (selection, global
+/// attributes, camera distance).
+final class FeatureStyleCache {
+
+    private static let unknownType = UInt16.max
+
+    let sheet: StyleSheet
+    let store: FeatureTagStore
+
+    private let lock = NSLock()
+    private var types: [UInt16]
+    private var variants: [Int32]
+    private var generations: [UInt32]
+    private var generation: UInt32 = 1
+
+    /// Types of the features are taken from `types`, e.g. the primitives of a
+    /// `MapCellSource`; see also `setFeatureType(_:forFeature:)`.
+    init(sheet: StyleSheet, store: FeatureTagStore, types: [RenderPrimitive] = []) {
+        self.sheet = sheet
+        self.store = store
+        self.types = [UInt16](repeating: FeatureStyleCache.unknownType, count: store.count)
+        variants = [Int32](repeating: 0, count: store.count)
+        generations = [UInt32](repeating: 0, count: store.count)
+        for primitive in types {
+            let index = sheet.typeIndex(of: primitive.type)
+            if index >= 0, let row = store.row(ofFeature: primitive.featureId) {
+                self.types[row] = UInt16(index)
+            }
+        }
+    }
+
+    /// Records the feature type reported by the map, e.g. `HDMFeature.featureType`.
+    func setFeatureType(_ type: Symbol, forFeature featureId: UInt64) {
+        guard let row = store.row(ofFeature: featureId) else { return }
+        let index = sheet.typeIndex(of: type)
+        lock.lock()
+        types[row] = index < 0 ? FeatureStyleCache.unknownType : UInt16(index)
+        generations[row] = 0
+        lock.unlock()
+    }
+
+    /// Invalidates all features, e.g. after the camera moved and `distance()` rules must be re-evaluated.
+    func invalidate() {
+        lock.lock()
+        generation = generation &+ 1
+        lock.unlock()
+    }
+
+    /// Invalidates single features, e.g. after their attributes changed.
+    func invalidate(features featureIds: [UInt64]) {
+        let rows = featureIds.flatMap { store.row(ofFeature: $0) }
+        lock.lock()
+        for row in rows {
+            generations[row] = 0
+        }
+        lock.unlock()
+    }
+
+    /// Invalidates all features of the given `StyleSheet` types and returns their IDs.
+    @discardableResult
+    func invalidate(types: [Int32]) -> [UInt64] {
+        guard !types.isEmpty else { return [] }
+        var selected = [Bool](repeating: false, count: sheet.featureTypes.count)
+        for type in types where type >= 0 {
+            selected[Int(type)] = true
+        }
+        var featureIds: [UInt64] = []
+        lock.lock()
+        for (row, type) in self.types.enumerated() where type != FeatureStyleCache.unknownType && selected[Int(type)] {
+            generations[row] = 0
+            featureIds.append(store.featureIds[row])
+        }
+        lock.unlock()
+        return featureIds
+    }
+
+    /// `StyleSheet` type index of a feature, -1 if not recorded.
+    func typeIndex(ofFeature featureId: UInt64) -> Int32 {
+        guard let row = store.row(ofFeature: featureId) else { return -1 }
+        lock.lock()
+        defer { lock.unlock() }
+        return types[row] == FeatureStyleCache.unknownType ? -1 : Int32(types[row])
+    }
+
+    /// Style of a feature whose type has been recorded; `context` is only evaluated when the
+    /// cached row is out of date.
+    func style(forFeature featureId: UInt64, context: @autoclosure () -> StyleContext) -> ResolvedStyle? {
+        guard let row = store.row(ofFeature: featureId) else { return nil }
+        lock.lock()
+        let type = types[row]
+        if type == FeatureStyleCache.unknownType {
+            lock.unlock()
+            return nil
+        }
+        if generations[row] == generation {
+            let variant = variants[row]
+            lock.unlock()
+            return sheet.style(atVariant: variant)
+        }
+        let current = generation
+        lock.unlock()
+
+        let variant = sheet.variant(ofType: Int32(type), context: context())
+        lock.lock()
+        if generation == current {
+            variants[row] = variant
+            generations[row] = current
+        }
+        lock.unlock()
+        return sheet.style(atVariant: variant)
+    }
+}
+
+// MARK: - Parsing
+
+private struct FeatureBlock {
+    let name: String
+    let parent: String?
+    let declarations: [(String, String)]
+}
+
+private struct RuleBlock {
+    let name: String
+    let target: String
+    let conditions: [String]
+    let declarations: [(String, String)]
+    let children: [RuleBlock]
+}
+
+/// Recursive descent parser over the UTF-8 bytes of a MapCSS file.
+private struct MapCSSScanner {
+
+    private let bytes: [UInt8]
+    private var position = 0
+    private var line = 1
+
+    init(_ source: String) {
+        bytes = Array(source.utf8)
+    }
+
+    mutating func parseSheet() throws -> ([FeatureBlock], [RuleBlock]) {
+        var features: [FeatureBlock] = []
+        var rules: [RuleBlock] = []
+        while peek() != nil {
+            let keyword = try identifier()
+            switch keyword {
+            case "feature":
+                let name = try identifier()
+                var parent: String?
+                if consume(UInt8(ascii: ":")) {
+                    parent = try identifier()
+                }
+                try expect(UInt8(ascii: "{"))
+                let (declarations, _) = try body(allowsRules: false)
+                features.append(FeatureBlock(name: name, parent: parent, declarations: declarations))
+            case "rule":
+                rules.append(try rule())
+            default:
+                throw error("unexpected '\(keyword)'")
+            }
+        }
+        return (features, rules)
+    }
+
+    private mutating func rule() throws -> RuleBlock {
+        let name = try identifier()
+        try expect(UInt8(ascii: "("))
+        let target = try identifier()
+        try expect(UInt8(ascii: ")"))
+        var conditions: [String] = []
+        while consume(UInt8(ascii: "[")) {
+            try expect(UInt8(ascii: "\""))
+            conditions.append(try text(until: UInt8(ascii: "\"")))
+            try expect(UInt8(ascii: "]"))
+        }
+        try expect(UInt8(ascii: "{"))
+        let (declarations, children) = try body(allowsRules: true)
+        return RuleBlock(name: name, target: target, conditions: conditions, declarations: declarations, children: children)
+    }
+
+    /// Declarations and nested rules up to and including the closing brace.
+    private mutating func body(allowsRules: Bool) throws -> ([(String, String)], [RuleBlock]) {
+        var declarations: [(String, String)] = []
+        var rules: [RuleBlock] = []
+        while true {
+            guard let next = peek() else { throw error("unterminated block") }
+            if next == UInt8(ascii: "}") {
+                position += 1
+                return (declarations, rules)
+            }
+            let name = try identifier()
+            if allowsRules && name == "rule" && peek() != UInt8(ascii: ":") {
+                rules.append(try rule())
+                continue
+            }
+            try expect(UInt8(ascii: ":"))
+            declarations.append((name, value()))
+            _ = consume(UInt8(ascii: ";"))
+        }
+    }
+
+    // MARK: Tokens
+
+    private mutating func skipTrivia() {
+        while position < bytes.count {
+            let byte = bytes[position]
+            if byte == 0x0A {
+                line += 1
+                position += 1
+            } else if byte == 0x20 || byte == 0x09 || byte == 0x0D {
+                position += 1
+            } else if byte == UInt8(ascii: "/") && position + 1 < bytes.count && bytes[position + 1] == UInt8(ascii: "*") {
+                position += 2
+                while position < bytes.count && !(bytes[position] == UInt8(ascii: "*") && position + 1 < bytes.count && bytes[position + 1] == UInt8(ascii: "/")) {
+                    if bytes[position] == 0x0A {
+                        line += 1
+                    }
+                    position += 1
+                }
+                position = min(position + 2, bytes.count)
+            } else if byte == UInt8(ascii: "/") && position + 1 < bytes.count && bytes[position + 1] == UInt8(ascii: "/") {
+                while position < bytes.count && bytes[position] != 0x0A {
+                    position += 1
+                }
+            } else {
+                return
+            }
+        }
+    }
+
+    private mutating func peek() -> UInt8? {
+        skipTrivia()
+        return position < bytes.count ? bytes[position] : nil
+    }
+
+    private mutating func consume(_ byte: UInt8) -> Bool {
+        if peek() == byte {
+            position += 1
+            return true
+        }
+        return false
+    }
+
+    private mutating func expect(_ byte: UInt8) throws {
+        guard consume(byte) else {
+            throw error("expected '\(Character(UnicodeScalar(byte)))'")
+        }
+    }
+
+    private mutating func identifier() throws -> String {
+        skipTrivia()
+        let start = position
+        while position < bytes.count && MapCSSScanner.isIdentifier(bytes[position]) {
+            position += 1
+        }
+        guard position > start else { throw error("expected a name") }
+        return String(decoding: bytes[start..<position], as: UTF8.self)
+    }
+
+    /// Property value up to `;` or `}`, trimmed; semicolons inside quotes are kept.
+    private mutating func value() -> String {
+        skipTrivia()
+        let start = position
+        var quoted = false
+        while position < bytes.count {
+            let byte = bytes[position]
+            if byte == UInt8(ascii: "\"") {
+                quoted = !quoted
+            } else if !quoted && (byte == UInt8(ascii: ";") || byte == UInt8(ascii: "}")) {
+                break
+            } else if byte == 0x0A {
+                line += 1
+            }
+            position += 1
+        }
+        return String(decoding: bytes[start..<position], as: UTF8.self).trimmingCharacters(in: .whitespacesAndNewlines)
+    }
+
+    private mutating func text(until terminator: UInt8) throws -> String {
+        let start = position
+        while position < bytes.count && bytes[position] != terminator {
+            position += 1
+        }
+        guard position < bytes.count else { throw error("unterminated string") }
+        let text = String(decoding: bytes[start..<position], as: UTF8.self)
+        position += 1
+        return text
+    }
+
+    private func error(_ message: String) -> StyleSheetError {
+        return .syntax(line: line, message: message)
+    }
+
+    private static func isIdentifier(_ byte: UInt8) -> Bool {
+        switch byte {
+        case UInt8(ascii: "a")...UInt8(ascii: "z"), UInt8(ascii: "A")...UInt8(ascii: "Z"), UInt8(ascii: "0")...UInt8(ascii: "9"),
+             UInt8(ascii: "_"), UInt8(ascii: "-"), UInt8(ascii: "."):
+            return true
+        default:
+            return false
+        }
+    }
+}
+
+/// Compiles a rule condition into postfix `StyleCondition` instructions.
+///
+/// Grammar: `or := and ('||' and)*`, `and := unary ('&&' unary)*`, `unary := '!' unary | comparison`,
+/// `comparison := primary (op primary)?`, `primary := number | 'string' | "string" | name | name(args) | (or)`.
+private struct ConditionParser {
+
+    private let scalars: [UnicodeScalar]
+    private var position = 0
+
+    init(_ source: String) {
+        scalars = Array(source.unicodeScalars)
+    }
+
+    mutating func parse() throws -> [StyleCondition.Instruction] {
+        var code: [StyleCondition.Instruction] = []
+        try or(&code)
+        skipSpaces()
+        guard position == scalars.count else { throw error("unexpected '\(Character(scalars[position]))'") }
+        return code
+    }
+
+    private mutating func or(_ code: inout [StyleCondition.Instruction]) throws {
+        try and(&code)
+        while consume("||") {
+            try and(&code)
+            code.append(.or)
+        }
+    }
+
+    private mutating func and(_ code: inout [StyleCondition.Instruction]) throws {
+        try unary(&code)
+        while consume("&&") {
+            try unary(&code)
+            code.append(.and)
+        }
+    }
+
+    private mutating func unary(_ code: inout [StyleCondition.Instruction]) throws {
+        skipSpaces()
+        if !lookingAt("!=") && consume("!") {
+            try unary(&code)
+            code.append(.not)
+            return
+        }
+        try primary(&code)
+        let operators: [(String, StyleCondition.Comparison)] = [
+            ("==", .equal), ("!=", .notEqual), ("<=", .lessOrEqual), (">=", .greaterOrEqual),
+            ("<", .less), (">", .greater), ("=", .equal),
+        ]
+        for (text, comparison) in operators where consume(text) {
+            try primary(&code)
+            code.append(.compare(comparison))
+            return
+        }
+    }
+
+    private mutating func primary(_ code: inout [StyleCondition.Instruction]) throws {
+        skipSpaces()
+        guard position < scalars.count else { throw error("unexpected end of condition") }
+        let scalar = scalars[position]
+
+        if consume("(") {
+            try or(&code)
+            guard consume(")") else { throw error("expected ')'") }
+        } else if scalar == "\"" || scalar == "'" {
+            code.append(.string(try quoted()))
+        } else if CharacterSet.decimalDigits.contains(scalar) || scalar == "-" || scalar == "." {
+            let start = position
+            position += 1
+            while position < scalars.count && (CharacterSet.decimalDigits.contains(scalars[position]) || scalars[position] == ".") {
+                position += 1
+            }
+            guard let number = Double(String(String.UnicodeScalarView(scalars[start..<position]))) else {
+                throw error("invalid number")
+            }
+            code.append(.number(number))
+        } else {
+            let name = try identifier()
+            guard consume("(") else {
+                code.append(.anyAttribute(Symbol(name)))
+                return
+            }
+            var arguments: [String] = []
+            skipSpaces()
+            if !consume(")") {
+                repeat {
+                    skipSpaces()
+                    arguments.append(try quoted())
+                } while consume(",")
+                guard consume(")") else { throw error("expected ')'") }
+            }
+            switch (name, arguments.count) {
+            case ("isSelected", 0):
+                code.append(.isSelected)
+            case ("distance", 0):
+                code.append(.distance)
+            case ("attribute", 1):
+                code.append(.attribute(Symbol(arguments[0])))
+            case ("globalAttribute", 1):
+                code.append(.globalAttribute(Symbol(arguments[0])))
+            default:
+                throw error("unknown function \(name)/\(arguments.count)")
+            }
+        }
+    }
+
+    private mutating func identifier() throws -> String {
+        skipSpaces()
+        let start = position
+        while position < scalars.count && (CharacterSet.alphanumerics.contains(scalars[position])
+            || scalars[position] == "_" || scalars[position] == ":" || scalars[position] == "-") {
+            position += 1
+        }
+        guard position > start else { throw error("expected a name") }
+        return String(String.UnicodeScalarView(scalars[start..<position]))
+    }
+
+    private mutating func quoted() throws -> String {
+        guard position < scalars.count, scalars[position] == "\"" || scalars[position] == "'" else {
+            throw error("expected a string")
+        }
+        let quote = scalars[position]
+        position += 1
+        let start = position
+        while position < scalars.count && scalars[position] != quote {
+            position += 1
+        }
+        guard position < scalars.count else { throw error("unterminated string") }
+        let text = String(String.UnicodeScalarView(scalars[start..<position]))
+        position += 1
+        return text
+    }
+
+    private mutating func skipSpaces() {
+        while position < scalars.count && CharacterSet.whitespacesAndNewlines.contains(scalars[position]) {
+            position += 1
+        }
+    }
+
+    private mutating func lookingAt(_ text: String) -> Bool {
+        skipSpaces()
+        var index = position
+        for scalar in text.unicodeScalars {
+            guard index < scalars.count && scalars[index] == scalar else { return false }
+            index += 1
+        }
+        return true
+    }
+
+    private mutating func consume(_ text: String) -> Bool {
+        guard lookingAt(text) else { return false }
+        position += text.unicodeScalars.count
+        return true
+    }
+
+    private func error(_ message: String) -> StyleSheetError {
+        return .syntax(line: 0, message: "condition: \(message)")
+    }
+}
@@ -0,0 +1,41 @@
+//
+//  StyleTarget.swift
+//  DeepMapRender
+//
+//  Created by agent on 18.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+import Foundation
+
+/// The map calls a `StyleUpdater` makes; `HDMMapView` in the app.
+protocol StyleTarget: class {
+    func setFeatureStyle(_ featureName: String, propertyName: String, value: String, update: Bool) -> Bool
+    func showFeatures(_ featureName: String, update: Bool)
+    func hideFeatures(_ featureName: String, update: Bool)
+    func reloadStyle()
+    func setFeatureAttribute(_ key: String, value: String, withFeatureId featureId: UInt64)
+    func removeFeatureAttribute(_ key: String, withFeatureId featureId: UInt64)
+    func setGlobalAttribute(_ key: String, value: String)
+    func removeGlobalAtribute(_ key: String)
+    func selectFeature(withId featureId: UInt64)
+    func deselectFeature(withId featureId: UInt64)
+    func highlightFeature(withId featureId: UInt64)
+    func unhighlightFeature(withId featureId: UInt64)
+}
+
+extension StyleTarget {
+
+    func showFeatures(_ featureType: Symbol, update: Bool = true) {
+        showFeatures(featureType.string, update: update)
+    }
+
+    func hideFeatures(_ featureType: Symbol, update: Bool = true) {
+        hideFeatures(featureType.string, update: update)
+    }
+
+    @discardableResult
+    func setFeatureStyle(_ featureType: Symbol, property: Symbol, value: String, update: Bool = true) -> Bool {
+        return setFeatureStyle(featureType.string, propertyName: property.string, value: value, update: update)
+    }
+}
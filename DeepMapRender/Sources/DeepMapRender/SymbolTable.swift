@@ -0,0 +1,147 @@
+//
+//  SymbolTable.swift
+//  DeepMapRender
+//
+//  Created by agent on 18.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+import Foundation
+
+/// An interned string: feature type, attribute key, style property or selector.
+///
+/// Symbols are 32-bit IDs into `SymbolTable.shared` and compare by ID. Convert from and to
+/// `String` only where the framework API needs strings.
+struct Symbol: Hashable, Comparable, CustomStringConvertible, ExpressibleByStringLiteral {
+    let rawValue: UInt32
+
+    init(rawValue: UInt32) {
+        self.rawValue = rawValue
+    }
+
+    /// Interns `string` in the shared table.
+    init(_ string: String) {
+        self = SymbolTable.shared.intern(string)
+    }
+
+    init(stringLiteral value: String) {
+        self.init(value)
+    }
+
+    var string: String {
+        return SymbolTable.shared.string(for: self)
+    }
+
+    var description: String {
+        return string
+    }
+
+    var hashValue: Int {
+        return Int(rawValue)
+    }
+
+    static func == (lhs: Symbol, rhs: Symbol) -> Bool {
+        #if DEBUG
+        SymbolTable.shared.countComparison()
+        #endif
+        return lhs.rawValue == rhs.rawValue
+    }
+
+    /// Orders by ID, i.e. by first interning, not alphabetically.
+    static func < (lhs: Symbol, rhs: Symbol) -> Bool {
+        return lhs.rawValue < rhs.rawValue
+    }
+}
+
+/// Process-wide table of interned strings.
+final class SymbolTable {
+
+    static let shared = SymbolTable()
+
+    private let lock = NSLock()
+    private var strings: [String] = []
+    private var symbols: [String: Symbol] = [:]
+
+    /// Returns the symbol for `string`, adding it to the table if needed.
+    func intern(_ string: String) -> Symbol {
+        lock.lock()
+        defer { lock.unlock() }
+        #if DEBUG
+        counters.internCalls += 1
+        #endif
+        if let symbol = symbols[string] {
+            return symbol
+        }
+        let symbol = Symbol(rawValue: UInt32(strings.count))
+        strings.append(string)
+        symbols[string] = symbol
+        #if DEBUG
+        counters.stringBytes += string.utf8.count
+        #endif
+        return symbol
+    }
+
+    /// Returns the symbol for `string` if it has been interned, without adding it.
+    func lookup(_ string: String) -> Symbol? {
+        lock.lock()
+        defer { lock.unlock() }
+        return symbols[string]
+    }
+
+    func string(for symbol: Symbol) -> String {
+        lock.lock()
+        defer { lock.unlock() }
+        return strings[Int(symbol.rawValue)]
+    }
+
+    var count: Int {
+        lock.lock()
+        defer { lock.unlock() }
+        return strings.count
+    }
+
+    #if DEBUG
+
+    /// Usage counters, only collected in debug builds.
+    struct Statistics: CustomStringConvertible {
+        var symbolCount = 0
+        var stringBytes = 0
+        var internCalls = 0
+        /// Symbol comparisons, i.e. the string comparisons they replace.
+        var comparisons = 0
+
+        var description: String {
+            return "\(symbolCount) symbols, \(stringBytes) bytes of strings, \(internCalls) intern calls, \(comparisons) comparisons"
+        }
+    }
+
+    private var counters = Statistics()
+    /// Comparisons happen in every dictionary probe on every thread, so they are counted under
+    /// a mutex of their own rather than the table's lock.
+    private let comparisonLock: UnsafeMutablePointer<pthread_mutex_t> = {
+        let lock = UnsafeMutablePointer<pthread_mutex_t>.allocate(capacity: 1)
+        lock.initialize(to: pthread_mutex_t())
+        pthread_mutex_init(lock, nil)
+        return lock
+    }()
+    private var comparisons = 0
+
+    var statistics: Statistics {
+        lock.lock()
+        var statistics = counters
+        statistics.symbolCount = strings.count
+        lock.unlock()
+        pthread_mutex_lock(comparisonLock)
+        statistics.comparisons = comparisons
+        pthread_mutex_unlock(comparisonLock)
+        return statistics
+    }
+
+    fileprivate func countComparison() {
+        pthread_mutex_lock(comparisonLock)
+        comparisons += 1
+        pthread_mutex_unlock(comparisonLock)
+    }
+
+    #endif
+}
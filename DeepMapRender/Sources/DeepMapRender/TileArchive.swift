@@ -0,0 +1,378 @@
+//
+//  TileArchive.swift
+//  DeepMapRender
+//
+//  Created by agent on 18.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+import Foundation
+#if SWIFT_PACKAGE
+import CSQLite
+#else
+import SQLite3
+#endif
+
+/// An XYZ (slippy map) tile: column `x` from west, row `y` from north.
+struct TileCoordinate: Hashable, CustomStringConvertible {
+    let zoom: Int
+    let x: Int
+    let y: Int
+
+    init(zoom: Int, x: Int, y: Int) {
+        self.zoom = zoom
+        self.x = x
+        self.y = y
+    }
+
+    /// The tile at `zoom` containing a WGS84 position, clamped to the Web Mercator range.
+    init(zoom: Int, longitude: Double, latitude: Double) {
+        let n = Double(1 << zoom)
+        let phi = max(-85.0511, min(85.0511, latitude)) * .pi / 180
+        let x = Int(((longitude + 180) / 360 * n).rounded(.down))
+        let y = Int(((1 - log(tan(phi) + 1 / cos(phi)) / .pi) / 2 * n).rounded(.down))
+        self.init(zoom: zoom, x: max(0, min(1 << zoom - 1, x)), y: max(0, min(1 << zoom - 1, y)))
+    }
+
+    /// Longitude of the west and east edges and latitude of the south and north edges.
+    var bounds: (west: Double, south: Double, east: Double, north: Double) {
+        let n = Double(1 << zoom)
+        func latitude(_ row: Int) -> Double {
+            return atan(sinh(.pi * (1 - 2 * Double(row) / n))) * 180 / .pi
+        }
+        return (Double(x) / n * 360 - 180, latitude(y + 1), Double(x + 1) / n * 360 - 180, latitude(y))
+    }
+
+    /// Row in the bottom-up TMS scheme used by MBTiles.
+    var tmsY: Int {
+        return (1 << zoom) - 1 - y
+    }
+
+    var description: String {
+        return "\(zoom)/\(x)/\(y)"
+    }
+
+    var hashValue: Int {
+        return zoom << 58 ^ x << 29 ^ y
+    }
+
+    static func == (lhs: TileCoordinate, rhs: TileCoordinate) -> Bool {
+        return lhs.zoom == rhs.zoom && lhs.x == rhs.x && lhs.y == rhs.y
+    }
+}
+
+/// A single-file tile archive in the MBTiles layout, with one pyramid per floor.
+///
+/// Images are stored once in `images` and referenced from `map`, so identical tiles (plain
+/// room interiors, corridors) share a row; the `tiles` view joins both into the usual
+/// MBTiles table, extended by a `level` column. Lookups go through the unique index on
+/// (level, zoom_level, tile_column, tile_row). All writes of one archive happen inside a
+/// single transaction that `finish()` commits. Use from one thread.
+final class TileArchiveWriter {
+
+    enum WriterError: Error {
+        case open(String)
+        case execute(String)
+    }
+
+    let path: String
+    private var handle: OpaquePointer?
+    private var insertImage: OpaquePointer?
+    private var insertTile: OpaquePointer?
+    private var nextImageId: Int64 = 1
+
+    /// Creates the archive at `path`, replacing an existing file.
+    init(path: String) throws {
+        self.path = path
+        try? FileManager.default.removeItem(atPath: path)
+        let flags = SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_NOMUTEX
+        if sqlite3_open_v2(path, &handle, flags, nil) != SQLITE_OK {
+            let message = handle.map { String(cString: sqlite3_errmsg($0)) } ?? "unable to open \(path)"
+            sqlite3_close(handle)
+            handle = nil
+            throw WriterError.open(message)
+        }
+        try execute("""
+            PRAGMA journal_mode = OFF;
+            PRAGMA synchronous = OFF;
+            CREATE TABLE metadata (name TEXT PRIMARY KEY, value TEXT);
+            CREATE TABLE images (tile_id INTEGER PRIMARY KEY, tile_data BLOB);
+            CREATE TABLE map (level REAL, zoom_level INTEGER, tile_column INTEGER, tile_row INTEGER, tile_id INTEGER);
+            CREATE UNIQUE INDEX map_index ON map (level, zoom_level, tile_column, tile_row);
+            CREATE VIEW tiles AS
+                SELECT map.level, map.zoom_level, map.tile_column, map.tile_row, images.tile_data
+                FROM map JOIN images ON images.tile_id = map.tile_id;
+            BEGIN;
+            """)
+        insertImage = try prepare("INSERT INTO images (tile_id, tile_data) VALUES (?, ?)")
+        insertTile = try prepare("INSERT OR REPLACE INTO map (level, zoom_level, tile_column, tile_row, tile_id) VALUES (?, ?, ?, ?, ?)")
+    }
+
+    deinit {
+        sqlite3_finalize(insertImage)
+        sqlite3_finalize(insertTile)
+        sqlite3_close(handle)
+    }
+
+    func setMetadata(_ name: String, _ value: String) throws {
+        let statement = try prepare("INSERT OR REPLACE INTO metadata (name, value) VALUES (?, ?)")
+        defer { sqlite3_finalize(statement) }
+        sqlite3_bind_text(statement, 1, name, -1, TileArchiveWriter.transient)
+        sqlite3_bind_text(statement, 2, value, -1, TileArchiveWriter.transient)
+        try step(statement)
+    }
+
+    /// Stores an encoded image and returns its id for `addTile(_:level:image:)`.
+    func addImage(_ data: Data) throws -> Int64 {
+        let id = nextImageId
+        sqlite3_reset(insertImage)
+        sqlite3_bind_int64(insertImage, 1, id)
+        _ = data.withUnsafeBytes { (bytes: UnsafePointer<UInt8>) in
+            sqlite3_bind_blob(insertImage, 2, bytes, Int32(data.count), TileArchiveWriter.transient)
+        }
+        try step(insertImage)
+        nextImageId += 1
+        return id
+    }
+
+    func addTile(_ tile: TileCoordinate, level: Float, image: Int64) throws {
+        sqlite3_reset(insertTile)
+        sqlite3_bind_double(insertTile, 1, Double(level))
+        sqlite3_bind_int64(insertTile, 2, Int64(tile.zoom))
+        sqlite3_bind_int64(insertTile, 3, Int64(tile.x))
+        sqlite3_bind_int64(insertTile, 4, Int64(tile.tmsY))
+        sqlite3_bind_int64(insertTile, 5, image)
+        try step(insertTile)
+    }
+
+    /// Commits all writes. The archive must not be written afterwards.
+    func finish() throws {
+        try execute("COMMIT; ANALYZE;")
+    }
+
+    // SQLITE_TRANSIENT is a C macro not visible to Swift
+    private static let transient = unsafeBitCast(-1, to: sqlite3_destructor_type.self)
+
+    private func execute(_ sql: String) throws {
+        var message: UnsafeMutablePointer<Int8>?
+        if sqlite3_exec(handle, sql, nil, nil, &message) != SQLITE_OK {
+            let text = message.map { String(cString: $0) } ?? lastErrorMessage
+            sqlite3_free(message)
+            throw WriterError.execute(text)
+        }
+    }
+
+    private func prepare(_ sql: String) throws -> OpaquePointer {
+        var statement: OpaquePointer?
+        guard sqlite3_prepare_v2(handle, sql, -1, &statement, nil) == SQLITE_OK, let prepared = statement else {
+            sqlite3_finalize(statement)
+            throw WriterError.execute(lastErrorMessage)
+        }
+        return prepared
+    }
+
+    private func step(_ statement: OpaquePointer?) throws {
+        guard sqlite3_step(statement) == SQLITE_DONE else {
+            throw WriterError.execute(lastErrorMessage)
+        }
+    }
+
+    private var lastErrorMessage: String {
+        guard let handle = handle else { return "database is not open" }
+        return String(cString: sqlite3_errmsg(handle))
+    }
+}
+
+/// Renders XYZ raster tile pyramids of every floor into a `TileArchiveWriter`, for clients
+/// that cannot run the map engine (web viewers, printed floor plans). `deepmap-render tiles`
+/// runs it on a package.
+///
+/// Per floor and zoom level, primitives are binned into the tiles their bounds touch, so
+/// tiles without geometry are never rendered. The remaining tiles are rendered in parallel
+/// batches, each with its own `SoftwareRenderer`; tiles whose size and two independent pixel
+/// hashes match an already written image only add a reference to it, so they are neither
+/// encoded nor stored twice.
+///
+/// Tiles are rendered top-down in the UTM zone of the package (`MapCellMetadata.projection`),
+/// rotated so the tile's meridian points up; within a tile this matches Web Mercator to well
+/// below a pixel.
+final class TilePyramidRenderer {
+
+    struct Report: CustomStringConvertible {
+        var rendered = 0
+        /// Tiles touched by primitive bounds that came out empty.
+        var empty = 0
+        /// Tiles stored as a reference to an identical image.
+        var duplicates = 0
+        var bytes = 0
+        var duration: TimeInterval = 0
+
+        var description: String {
+            return String(format: "%d tiles rendered (%d empty, %d duplicates), %d bytes in %.1f s",
+                          rendered, empty, duplicates, bytes, duration)
+        }
+    }
+
+    /// Identifies a written image without keeping its pixels.
+    private struct ImageKey: Hashable {
+        let width: Int
+        let height: Int
+        let hash: UInt64
+        let checksum: UInt64
+
+        init(_ image: RenderImage) {
+            width = image.width
+            height = image.height
+            hash = image.contentHash
+            checksum = image.contentChecksum
+        }
+
+        var hashValue: Int {
+            return Int(truncatingIfNeeded: hash)
+        }
+
+        static func == (lhs: ImageKey, rhs: ImageKey) -> Bool {
+            return lhs.hash == rhs.hash && lhs.checksum == rhs.checksum && lhs.width == rhs.width && lhs.height == rhs.height
+        }
+    }
+
+    let sources: [RenderGeometrySource]
+    let sheet: StyleSheet?
+    let projection: UTMProjection
+    var tileSize = 256
+    var background = StyleColor(rgba: 0xF1EEE8FF)
+    /// Extra border, in pixels, by which primitive bounds are grown when binning, so wide
+    /// lines and point discs reach into neighbouring tiles.
+    var overdraw = 16.0
+    /// Features hidden here are left out. Must not change while `render` runs.
+    var visibility: FeatureVisibility?
+    /// Icon images; without, icons are drawn as squares of their color.
+    var icons: IconAtlas?
+
+    /// - parameter projection: The CRS of the primitives of `sources`.
+    init(sources: [RenderGeometrySource], sheet: StyleSheet?, projection: UTMProjection) {
+        self.sources = sources
+        self.sheet = sheet
+        self.projection = projection
+    }
+
+    /// Renders `zoomLevels` of every level of `levels` into `archive` and finishes it.
+    /// Runs for a long time; call it off the main thread.
+    ///
+    /// - parameter progress: Called after each batch with the tiles done and the tiles to do of the current floor and zoom level.
+    @discardableResult
+    func render(levels: [Float], zoomLevels: CountableClosedRange<Int>, into archive: TileArchiveWriter,
+                progress: ((Int, Int) -> Void)? = nil) throws -> Report {
+        let start = Date()
+        var report = Report()
+        var images: [ImageKey: Int64] = [:]
+        var west = Double.infinity, south = Double.infinity, east = -Double.infinity, north = -Double.infinity
+
+        for level in levels {
+            let all = sources.flatMap { $0.primitives(level: level) }
+            let primitives = visibility.map { visibility in all.filter { visibility.isVisible($0.featureId) } } ?? all
+            let bounds = primitives.map { geographicBounds(of: $0.bounds) }
+            for box in bounds {
+                west = min(west, box.0)
+                south = min(south, box.1)
+                east = max(east, box.2)
+                north = max(north, box.3)
+            }
+
+            for zoom in zoomLevels {
+                let bins = binPrimitives(bounds, zoom: zoom)
+                let tiles = bins.keys.sorted { ($0.y, $0.x) < ($1.y, $1.x) }
+                let batch = ProcessInfo.processInfo.activeProcessorCount * 2
+                var done = 0
+                while done < tiles.count {
+                    let chunk = Array(tiles[done..<min(done + batch, tiles.count)])
+                    var results = [RenderImage?](repeating: nil, count: chunk.count)
+                    results.withUnsafeMutableBufferPointer { buffer in
+                        DispatchQueue.concurrentPerform(iterations: chunk.count) { index in
+                            let tilePrimitives = bins[chunk[index]]!.map { primitives[Int($0)] }
+                            buffer[index] = renderTile(chunk[index], primitives: tilePrimitives)
+                        }
+                    }
+
+                    for (tile, image) in zip(chunk, results) {
+                        guard let image = image else {
+                            report.empty += 1
+                            continue
+                        }
+                        report.rendered += 1
+                        let key = ImageKey(image)
+                        if let existing = images[key] {
+                            report.duplicates += 1
+                            try archive.addTile(tile, level: level, image: existing)
+                        } else {
+                            let data = image.pngData(compressed: true)
+                            let id = try archive.addImage(data)
+                            images[key] = id
+                            report.bytes += data.count
+                            try archive.addTile(tile, level: level, image: id)
+                        }
+                    }
+                    done += chunk.count
+                    progress?(done, tiles.count)
+                }
+            }
+        }
+
+        try archive.setMetadata("name", URL(fileURLWithPath: archive.path).deletingPathExtension().lastPathComponent)
+        try archive.setMetadata("format", "png")
+        try archive.setMetadata("type", "baselayer")
+        try archive.setMetadata("minzoom", "\(zoomLevels.lowerBound)")
+        try archive.setMetadata("maxzoom", "\(zoomLevels.upperBound)")
+        try archive.setMetadata("levels", levels.map { "\($0)" }.joined(separator: ","))
+        if west <= east {
+            try archive.setMetadata("bounds", "\(west),\(south),\(east),\(north)")
+        }
+        try archive.finish()
+        report.duration = Date().timeIntervalSince(start)
+        return report
+    }
+
+    /// WGS84 bounds (west, south, east, north) of planar bounds (minX, minY, maxX, maxY).
+    private func geographicBounds(of bounds: (Double, Double, Double, Double)) -> (Double, Double, Double, Double) {
+        let corners = [projection.unproject(RenderPoint(x: bounds.0, y: bounds.1)), projection.unproject(RenderPoint(x: bounds.2, y: bounds.1)),
+                       projection.unproject(RenderPoint(x: bounds.0, y: bounds.3)), projection.unproject(RenderPoint(x: bounds.2, y: bounds.3))]
+        return (corners.map { $0.longitude }.min()!, corners.map { $0.latitude }.min()!,
+                corners.map { $0.longitude }.max()!, corners.map { $0.latitude }.max()!)
+    }
+
+    /// Indices of the primitives touching each tile of `zoom`.
+    private func binPrimitives(_ bounds: [(Double, Double, Double, Double)], zoom: Int) -> [TileCoordinate: [Int32]] {
+        var bins: [TileCoordinate: [Int32]] = [:]
+        // degrees of longitude per pixel; latitude is padded by the same angle, which is more
+        // than needed away from the equator
+        let padding = overdraw * 360 / Double(tileSize << zoom)
+        for (index, box) in bounds.enumerated() {
+            let northWest = TileCoordinate(zoom: zoom, longitude: box.0 - padding, latitude: box.3 + padding)
+            let southEast = TileCoordinate(zoom: zoom, longitude: box.2 + padding, latitude: box.1 - padding)
+            for y in northWest.y...southEast.y {
+                for x in northWest.x...southEast.x {
+                    bins[TileCoordinate(zoom: zoom, x: x, y: y), default: []].append(Int32(index))
+                }
+            }
+        }
+        return bins
+    }
+
+    private func renderTile(_ tile: TileCoordinate, primitives: [RenderPrimitive]) -> RenderImage? {
+        let edges = tile.bounds
+        let center = projection.project(longitude: (edges.west + edges.east) / 2, latitude: (edges.south + edges.north) / 2)
+        let top = projection.project(longitude: (edges.west + edges.east) / 2, latitude: edges.north)
+        let bottom = projection.project(longitude: (edges.west + edges.east) / 2, latitude: edges.south)
+        let dx = top.x - bottom.x, dy = top.y - bottom.y
+
+        var camera = RenderCamera(center: center, distance: 0, bearing: atan2(dx, dy) * 180 / .pi,
+                                  width: tileSize, height: tileSize)
+        camera.distance = (dx * dx + dy * dy).squareRoot() / 2 / tan(camera.fieldOfView * .pi / 360)
+
+        let renderer = SoftwareRenderer(sheet: sheet)
+        renderer.background = background
+        renderer.icons = icons
+        let image = renderer.render(primitives, camera: camera)
+        return renderer.statistics.shapes == 0 ? nil : image
+    }
+}
@@ -0,0 +1,104 @@
+//
+//  Zlib.swift
+//  DeepMapRender
+//
+//  Created by agent on 18.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+import Foundation
+#if SWIFT_PACKAGE
+import CZlib
+#else
+import Compression
+#endif
+
+/// zlib streams (RFC 1950), as in PNG image data and the cells of a map package.
+///
+/// The app uses the system's Compression library, which reads and writes raw deflate data,
+/// so the zlib header and Adler-32 trailer are handled here. Package builds (the command line
+/// renderer) link the system zlib instead, which is available on Linux as well.
+enum Zlib {
+
+    enum ZlibError: Error {
+        case data
+    }
+
+    private static let chunkSize = 64 * 1024
+
+    /// Decompresses a complete zlib stream.
+    static func inflate(_ stream: [UInt8]) throws -> [UInt8] {
+        // CM 8 (deflate) and a valid header check, no preset dictionary
+        guard stream.count >= 6, stream[0] & 0x0F == 8, stream[1] & 0x20 == 0,
+            (UInt16(stream[0]) << 8 | UInt16(stream[1])) % 31 == 0 else { throw ZlibError.data }
+        var output: [UInt8] = []
+        var buffer = [UInt8](repeating: 0, count: chunkSize)
+
+        #if SWIFT_PACKAGE
+        var z = z_stream()
+        guard inflateInit_(&z, ZLIB_VERSION, Int32(MemoryLayout<z_stream>.size)) == Z_OK else { throw ZlibError.data }
+        defer { inflateEnd(&z) }
+        var input = stream
+        var status = Z_OK
+        try input.withUnsafeMutableBufferPointer { input in
+            z.next_in = input.baseAddress
+            z.avail_in = uInt(input.count)
+            repeat {
+                try buffer.withUnsafeMutableBufferPointer { chunk in
+                    z.next_out = chunk.baseAddress
+                    z.avail_out = uInt(chunk.count)
+                    status = CZlib.inflate(&z, Z_NO_FLUSH)
+                    guard status == Z_OK || status == Z_STREAM_END else { throw ZlibError.data }
+                    output += chunk[0..<chunk.count - Int(z.avail_out)]
+                }
+            } while status != Z_STREAM_END
+        }
+        #else
+        let z = UnsafeMutablePointer<compression_stream>.allocate(capacity: 1)
+        defer { z.deallocate(capacity: 1) }
+        guard compression_stream_init(z, COMPRESSION_STREAM_DECODE, COMPRESSION_ZLIB) == COMPRESSION_STATUS_OK else {
+            throw ZlibError.data
+        }
+        defer { compression_stream_destroy(z) }
+        var status = COMPRESSION_STATUS_OK
+        try stream.withUnsafeBufferPointer { input in
+            z.pointee.src_ptr = input.baseAddress! + 2
+            z.pointee.src_size = input.count - 6
+            repeat {
+                try buffer.withUnsafeMutableBufferPointer { chunk in
+                    z.pointee.dst_ptr = chunk.baseAddress!
+                    z.pointee.dst_size = chunk.count
+                    status = compression_stream_process(z, Int32(COMPRESSION_STREAM_FINALIZE.rawValue))
+                    guard status != COMPRESSION_STATUS_ERROR else { throw ZlibError.data }
+                    output += chunk[0..<chunk.count - z.pointee.dst_size]
+                }
+            } while status == COMPRESSION_STATUS_OK
+        }
+        let trailer = stream[(stream.count - 4)...].reduce(UInt32(0)) { $0 << 8 | UInt32($1) }
+        guard PNGEncoder.adler32(output) == trailer else { throw ZlibError.data }
+        #endif
+        return output
+    }
+
+    /// Compresses `bytes` into a zlib stream, nil if compression fails.
+    static func deflate(_ bytes: [UInt8]) -> [UInt8]? {
+        #if SWIFT_PACKAGE
+        var length = compressBound(uLong(bytes.count))
+        var stream = [UInt8](repeating: 0, count: Int(length))
+        guard compress2(&stream, &length, bytes, uLong(bytes.count), Z_DEFAULT_COMPRESSION) == Z_OK else { return nil }
+        stream.removeSubrange(Int(length)...)
+        return stream
+        #else
+        // COMPRESSION_ZLIB writes raw deflate data, without the zlib header and checksum
+        let capacity = bytes.count + bytes.count / 8 + 64
+        var deflated = [UInt8](repeating: 0, count: capacity)
+        let count = compression_encode_buffer(&deflated, capacity, bytes, bytes.count, nil, COMPRESSION_ZLIB)
+        guard count > 0 else { return nil }
+        var stream: [UInt8] = [0x78, 0x9C]
+        stream += deflated[0..<count]
+        let adler = PNGEncoder.adler32(bytes)
+        stream += [UInt8(adler >> 24), UInt8(adler >> 16 & 0xFF), UInt8(adler >> 8 & 0xFF), UInt8(adler & 0xFF)]
+        return stream
+        #endif
+    }
+}
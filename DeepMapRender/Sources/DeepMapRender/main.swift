@@ -0,0 +1,173 @@
+//
+//  main.swift
+//  DeepMapRender
+//
+//  Created by agent on 18.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+import Foundation
+
+// Command line front end of the software renderer, for servers and CI machines without a GPU
+// or the Deep Map framework. Build with `swift build -c release` in DeepMapRender; the app
+// compiles the same sources, minus this file.
+
+let usage = """
+    usage: deepmap-render <command> <package> [options]
+
+    <package> is a map package folder with a map_resources.plist, e.g. DeepMapTestIOS/DeepMap.
+
+    commands:
+      render      render one image to --output
+      benchmark   render --frames frames and print frame times; with --reference, also compare
+                  the last frame to that image and fail if more than --max-differing of the
+                  pixels differ by more than --tolerance
+      tiles       render raster tile pyramids of all floors into the MBTiles archive --output
+
+    options:
+      --output <file>           image or archive to write (default map.png, map.mbtiles)
+      --zoom <min>-<max>        zoom levels of the tiles (default 16-20)
+      --level <n>               floor to draw (default 0)
+      --size <width>x<height>   image size in pixels (default 1024x768)
+      --center <x>,<y>          point looked at, in the package's CRS (default: center of the cells)
+      --distance <m>            camera distance (default: fit the cells)
+      --bearing <deg>, --tilt <deg>
+      --style <file.mapcss>     style sheet (default: the package's)
+      --frames <n>              measured frames (benchmark; default 20)
+      --reference <file.png>    expected image (benchmark)
+      --tolerance <n>           ignored channel difference (default 2)
+      --max-differing <f>       allowed fraction of differing pixels (default 0.001)
+
+    """
+
+func fail(_ message: String) -> Never {
+    FileHandle.standardError.write((message + "\n").data(using: .utf8)!)
+    exit(1)
+}
+
+/// The files of a map package, as listed in its `map_resources.plist`.
+struct MapPackage {
+    let cells: MapCellSource
+    let routing: RoutingNetworkSource?
+    let sheet: StyleSheet?
+    let icons: IconAtlas?
+
+    init(path: String, stylePath: String?) throws {
+        let plist = try Data(contentsOf: URL(fileURLWithPath: path + "/map_resources.plist"))
+        guard let resources = try PropertyListSerialization.propertyList(from: plist, options: [], format: nil)
+            as? [String: String], let cellPath = resources["tilesfolder"] else {
+                throw CocoaError(.fileReadCorruptFile)
+        }
+        cells = try MapCellSource(cellPath: path + "/" + cellPath)
+        routing = try resources["database"].map { try RoutingNetworkSource(databasePath: path + "/" + $0) }
+        sheet = try (stylePath ?? resources["mapcss"].map { path + "/" + $0 })
+            .map { try StyleSheet(contentsOfFiles: [$0]) }
+        icons = resources["icons"].flatMap { IconAtlas(contentsOfFile: path + "/" + $0, sheet: sheet) }
+    }
+
+    var sources: [RenderGeometrySource] {
+        return [cells as RenderGeometrySource] + (routing.map { [$0 as RenderGeometrySource] } ?? [])
+    }
+}
+
+var arguments = Array(CommandLine.arguments.dropFirst())
+guard arguments.count >= 2 && !arguments.contains("--help") else {
+    print(usage)
+    exit(arguments.contains("--help") ? 0 : 1)
+}
+let command = arguments.removeFirst()
+let packagePath = arguments.removeFirst()
+
+var options: [String: String] = [:]
+while !arguments.isEmpty {
+    let name = arguments.removeFirst()
+    guard name.hasPrefix("--"), !arguments.isEmpty else { fail("missing value for \(name)\n\n\(usage)") }
+    options[String(name.dropFirst(2))] = arguments.removeFirst()
+}
+func number(_ name: String) -> Double? {
+    guard let text = options[name] else { return nil }
+    guard let value = Double(text) else { fail("--\(name) is not a number: \(text)") }
+    return value
+}
+func pair(_ name: String, separator: Character) -> (Double, Double)? {
+    guard let text = options[name] else { return nil }
+    let parts = text.split(separator: separator).flatMap { Double(String($0)) }
+    guard parts.count == 2 else { fail("--\(name) must be <a>\(separator)<b>: \(text)") }
+    return (parts[0], parts[1])
+}
+
+let package: MapPackage
+do {
+    package = try MapPackage(path: packagePath, stylePath: options["style"])
+} catch {
+    fail("cannot read package \(packagePath): \(error)")
+}
+
+let size = pair("size", separator: "x") ?? (1024, 768)
+let level = Float(number("level") ?? 0)
+var camera = RenderCamera.fitting(package.cells.metadata.bounds, width: Int(size.0), height: Int(size.1))
+if let center = pair("center", separator: ",") {
+    camera.center = RenderPoint(x: center.0, y: center.1)
+}
+camera.distance = number("distance") ?? camera.distance
+camera.bearing = number("bearing") ?? camera.bearing
+camera.tilt = number("tilt") ?? camera.tilt
+
+let renderer = SoftwareRenderer(sheet: package.sheet)
+renderer.icons = package.icons
+let scene = RenderScene(primitives: package.sources.flatMap { $0.primitives(level: level) }, sheet: package.sheet)
+
+switch command {
+case "render":
+    let image = renderer.render(scene, camera: camera)
+    let output = options["output"] ?? "map.png"
+    do {
+        try image.pngData(compressed: true).write(to: URL(fileURLWithPath: output))
+    } catch {
+        fail("cannot write \(output): \(error)")
+    }
+    print(renderer.statistics)
+
+case "benchmark":
+    var image: RenderImage?
+    let result = RenderBenchmark.run(frames: Int(number("frames") ?? 20)) {
+        image = renderer.render(scene, camera: camera)
+    }
+    print(renderer.statistics)
+    print(result)
+    if let reference = options["reference"] {
+        guard let data = try? Data(contentsOf: URL(fileURLWithPath: reference)), let expected = PNGDecoder.decode(data) else {
+            fail("cannot read reference image \(reference)")
+        }
+        guard expected.width == camera.width && expected.height == camera.height else {
+            fail("reference is \(expected.width)x\(expected.height), frames are \(camera.width)x\(camera.height)")
+        }
+        let difference = image!.difference(from: expected, tolerance: Int(number("tolerance") ?? 2))
+        print(String(format: "%d of %d pixels differ (%.4f%%), largest difference %d", difference.differingPixels,
+                     difference.pixelCount, difference.fraction * 100, difference.maximumDelta))
+        if difference.fraction > number("max-differing") ?? 0.001 {
+            fail("frame differs from \(reference)")
+        }
+    }
+
+case "tiles":
+    guard let projection = package.cells.metadata.projection else {
+        fail("tiles need a UTM package, this one is in \(package.cells.metadata.proj4)")
+    }
+    let zoom = pair("zoom", separator: "-") ?? (16, 20)
+    guard zoom.0 >= 0 && zoom.0 <= zoom.1 && zoom.1 <= 24 else { fail("--zoom must be within 0-24") }
+    let output = options["output"] ?? "map.mbtiles"
+    let tiles = TilePyramidRenderer(sources: package.sources, sheet: package.sheet, projection: projection)
+    tiles.icons = package.icons
+    let levels = Set(package.cells.levels + (package.routing?.levels ?? [])).sorted()
+    do {
+        let report = try tiles.render(levels: levels, zoomLevels: Int(zoom.0)...Int(zoom.1),
+                                      into: TileArchiveWriter(path: output))
+        print(report)
+    } catch {
+        fail("cannot write \(output): \(error)")
+    }
+
+default:
+    fail("unknown command \(command)\n\n\(usage)")
+}
@@ -0,0 +1,386 @@
+//
+//  AnnotationClusterer.swift
+//  DeepMapTestIOS
+//
+//  Created by agent on 18.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+import Foundation
+import HDMMapCore
+
+/// A lightweight pin, drawn in batches and backed by an `HDMPinAnnotation` only when needed.
+struct MapPin {
+    let id: Int
+    /// In the map's API CRS (WGS84).
+    var coordinate: HDMMapCoordinate
+    /// Floor the pin is on, or `AnnotationClusterer.allLevels`.
+    var level: Float
+    var color: UInt32
+    var title: String?
+
+    init(id: Int, coordinate: HDMMapCoordinate, level: Float = AnnotationClusterer.allLevels,
+         color: UInt32 = 0xEA857DFF, title: String? = nil) {
+        self.id = id
+        self.coordinate = coordinate
+        self.level = level
+        self.color = color
+        self.title = title
+    }
+}
+
+/// A pin or a cluster of pins to draw.
+struct AnnotationMarker {
+    /// Screen position, pixels from the top left.
+    let x: Double
+    let y: Double
+    /// Centroid of the clustered pins, projected.
+    let position: RenderPoint
+    let count: Int
+    /// ID of the pin if `count` is 1.
+    let pin: Int?
+    let color: UInt32
+}
+
+/// Hierarchical grid over one floor for clustering points.
+///
+/// Level 0 cells are `baseCellSize` meters wide and list their points; each further level
+/// doubles the cell size and keeps only the count and coordinate sums of its four children.
+/// Inserting or removing a point updates one cell per level, so the grid stays current as
+/// points change, and any cluster size is a lookup of a single level.
+final class ClusterGrid {
+
+    private struct Cell {
+        var count = 0
+        var sumX = 0.0
+        var sumY = 0.0
+    }
+
+    let baseCellSize: Double
+    let depth: Int
+
+    private var levels: [[Int64: Cell]]
+    private var members: [Int64: [Int32]] = [:]
+
+    init(baseCellSize: Double = 1, depth: Int = 16) {
+        self.baseCellSize = baseCellSize
+        self.depth = depth
+        levels = [[Int64: Cell]](repeating: [:], count: depth)
+    }
+
+    func cellSize(atLevel level: Int) -> Double {
+        return baseCellSize * Double(1 << level)
+    }
+
+    /// The finest level whose cells are at least `size` meters wide.
+    func level(forCellSize size: Double) -> Int {
+        var level = 0
+        while level < depth - 1 && cellSize(atLevel: level) < size {
+            level += 1
+        }
+        return level
+    }
+
+    func insert(_ item: Int32, at point: RenderPoint) {
+        var (x, y) = cell(of: point)
+        members[ClusterGrid.key(x, y), default: []].append(item)
+        for level in 0..<depth {
+            let key = ClusterGrid.key(x, y)
+            var cell = levels[level][key] ?? Cell()
+            cell.count += 1
+            cell.sumX += point.x
+            cell.sumY += point.y
+            levels[level][key] = cell
+            x >>= 1
+            y >>= 1
+        }
+    }
+
+    func remove(_ item: Int32, at point: RenderPoint) {
+        var (x, y) = cell(of: point)
+        let memberKey = ClusterGrid.key(x, y)
+        guard var list = members[memberKey], let index = list.index(of: item) else { return }
+        list.remove(at: index)
+        members[memberKey] = list.isEmpty ? nil : list
+        for level in 0..<depth {
+            let key = ClusterGrid.key(x, y)
+            if var cell = levels[level][key] {
+                cell.count -= 1
+                cell.sumX -= point.x
+                cell.sumY -= point.y
+                levels[level][key] = cell.count > 0 ? cell : nil
+            }
+            x >>= 1
+            y >>= 1
+        }
+    }
+
+    /// Moves a point; levels where it stays in the same cell only update their sums.
+    func move(_ item: Int32, from old: RenderPoint, to new: RenderPoint) {
+        var (oldX, oldY) = cell(of: old), (newX, newY) = cell(of: new)
+        if oldX != newX || oldY != newY {
+            let oldKey = ClusterGrid.key(oldX, oldY)
+            if var list = members[oldKey], let index = list.index(of: item) {
+                list.remove(at: index)
+                members[oldKey] = list.isEmpty ? nil : list
+            }
+            members[ClusterGrid.key(newX, newY), default: []].append(item)
+        }
+        for level in 0..<depth {
+            let oldKey = ClusterGrid.key(oldX, oldY), newKey = ClusterGrid.key(newX, newY)
+            if var cell = levels[level][oldKey] {
+                cell.count -= oldKey == newKey ? 0 : 1
+                cell.sumX -= old.x
+                cell.sumY -= old.y
+                levels[level][oldKey] = cell.count > 0 ? cell : nil
+            }
+            var cell = levels[level][newKey] ?? Cell()
+            cell.count += oldKey == newKey ? 0 : 1
+            cell.sumX += new.x
+            cell.sumY += new.y
+            levels[level][newKey] = cell
+            oldX >>= 1
+            oldY >>= 1
+            newX >>= 1
+            newY >>= 1
+        }
+    }
+
+    /// Calls `body` with the count, centroid and, for single points, the item of every
+    /// non-empty cell of `level` intersecting the given bounds.
+    func forEachCell(level: Int, minX: Double, minY: Double, maxX: Double, maxY: Double,
+                     _ body: (Int, Double, Double, Int32?) -> Void) {
+        let size = cellSize(atLevel: level)
+        let x0 = Int32(clamping: Int64((minX / size).rounded(.down))), x1 = Int32(clamping: Int64((maxX / size).rounded(.down)))
+        let y0 = Int32(clamping: Int64((minY / size).rounded(.down))), y1 = Int32(clamping: Int64((maxY / size).rounded(.down)))
+        guard x0 <= x1 && y0 <= y1 else { return }
+        let cells = levels[level]
+        var hits: [(Int64, Cell)] = []
+        // walk the range if it is smaller than the level, else filter the level
+        if (Int64(x1) - Int64(x0) + 1) * (Int64(y1) - Int64(y0) + 1) <= Int64(cells.count) {
+            for x in x0...x1 {
+                for y in y0...y1 {
+                    let key = ClusterGrid.key(x, y)
+                    if let cell = cells[key] {
+                        hits.append((key, cell))
+                    }
+                }
+            }
+        } else {
+            for (key, cell) in cells {
+                let x = Int32(truncatingIfNeeded: key >> 32), y = Int32(truncatingIfNeeded: key)
+                if x >= x0 && x <= x1 && y >= y0 && y <= y1 {
+                    hits.append((key, cell))
+                }
+            }
+        }
+        for (key, cell) in hits {
+            body(cell.count, cell.sumX / Double(cell.count), cell.sumY / Double(cell.count),
+                 cell.count == 1 ? representative(level: level, key: key) : nil)
+        }
+    }
+
+    /// Calls `body` with every item in a level 0 cell intersecting the given bounds.
+    func forEachItem(minX: Double, minY: Double, maxX: Double, maxY: Double, _ body: (Int32) -> Void) {
+        let (x0, y0) = cell(of: RenderPoint(x: minX, y: minY)), (x1, y1) = cell(of: RenderPoint(x: maxX, y: maxY))
+        guard x0 <= x1 && y0 <= y1 else { return }
+        for x in x0...x1 {
+            for y in y0...y1 {
+                members[ClusterGrid.key(x, y)]?.forEach(body)
+            }
+        }
+    }
+
+    /// Some item of a non-empty cell, found by descending to level 0.
+    private func representative(level: Int, key: Int64) -> Int32? {
+        var level = level, x = Int32(truncatingIfNeeded: key >> 32), y = Int32(truncatingIfNeeded: key)
+        while level > 0 {
+            level -= 1
+            var found = false
+            for child in [(x << 1, y << 1), (x << 1 | 1, y << 1), (x << 1, y << 1 | 1), (x << 1 | 1, y << 1 | 1)]
+                where levels[level][ClusterGrid.key(child.0, child.1)] != nil {
+                (x, y) = child
+                found = true
+                break
+            }
+            guard found else { return nil }
+        }
+        return members[ClusterGrid.key(x, y)]?.first
+    }
+
+    private func cell(of point: RenderPoint) -> (Int32, Int32) {
+        return (Int32(clamping: Int64((point.x / baseCellSize).rounded(.down))),
+                Int32(clamping: Int64((point.y / baseCellSize).rounded(.down))))
+    }
+
+    private static func key(_ x: Int32, _ y: Int32) -> Int64 {
+        return Int64(x) << 32 | Int64(UInt32(bitPattern: y))
+    }
+}
+
+/// Clusters large numbers of pins per floor for drawing at any zoom.
+///
+/// Pins are kept in flat storage and a `ClusterGrid` per floor. For a camera the grid level
+/// whose cells span about `clusterRadius` pixels is chosen and only its cells within the
+/// visible ground area are visited, so the cost of a frame depends on what is on screen, not
+/// on the number of pins. Use from one thread.
+final class AnnotationClusterer {
+
+    /// Level of pins shown on every floor.
+    static let allLevels = Float.infinity
+
+    let projection: UTMProjection
+    /// Projects pin coordinates into the map's display CRS; `projection` is used without one.
+    let projector: HDMProjector?
+    /// Pins closer than this on screen, in pixels, are drawn as one cluster.
+    var clusterRadius = 32.0
+
+    private var pins: [MapPin?] = []
+    private var positions: [RenderPoint] = []
+    private var freeSlots: [Int32] = []
+    private var slotOfPin: [Int: Int32] = [:]
+    private var grids: [Float: ClusterGrid] = [:]
+
+    /// Cells visited by the last `markers(camera:level:)`.
+    private(set) var visitedCells = 0
+    /// Counts calls removing pins, so users keeping per-pin state know when to drop some.
+    private(set) var removals = 0
+
+    init(projection: UTMProjection = .zone32N, projector: HDMProjector? = nil) {
+        self.projection = projection
+        self.projector = projector
+    }
+
+    /// Projected position of a coordinate in the map's API CRS. Any thread.
+    func project(_ coordinate: HDMMapCoordinate) -> RenderPoint {
+        guard let projector = projector else { return projection.project(coordinate) }
+        let display = projector.projectAPIToDisplayCoordinate(coordinate)
+        return RenderPoint(x: display.x, y: display.y, z: display.z)
+    }
+
+    var count: Int {
+        return slotOfPin.count
+    }
+
+    func pin(withId id: Int) -> MapPin? {
+        return slotOfPin[id].flatMap { pins[Int($0)] }
+    }
+
+    /// Projected position of a pin.
+    func position(ofPin id: Int) -> RenderPoint? {
+        return slotOfPin[id].map { positions[Int($0)] }
+    }
+
+    /// Moves a pin to `position` without changing its coordinate, e.g. during an animation.
+    func move(_ id: Int, to position: RenderPoint) {
+        guard let slot = slotOfPin[id], let pin = pins[Int(slot)] else { return }
+        grids[pin.level]?.move(slot, from: positions[Int(slot)], to: position)
+        positions[Int(slot)] = position
+    }
+
+    /// Sets the coordinate of a pin, which its annotation view shows, without moving it.
+    func setCoordinate(_ coordinate: HDMMapCoordinate, ofPin id: Int) {
+        guard let slot = slotOfPin[id] else { return }
+        pins[Int(slot)]?.coordinate = coordinate
+    }
+
+    /// Adds `pins`, replacing pins with the same ID.
+    func add(_ pins: [MapPin]) {
+        remove(ids: pins.map { $0.id }.filter { slotOfPin[$0] != nil })
+        for pin in pins {
+            let slot: Int32
+            let position = project(pin.coordinate)
+            if let free = freeSlots.popLast() {
+                slot = free
+                self.pins[Int(slot)] = pin
+                positions[Int(slot)] = position
+            } else {
+                slot = Int32(self.pins.count)
+                self.pins.append(pin)
+                positions.append(position)
+            }
+            slotOfPin[pin.id] = slot
+            grid(forLevel: pin.level).insert(slot, at: position)
+        }
+    }
+
+    func remove(ids: [Int]) {
+        removals += 1
+        for id in ids {
+            guard let slot = slotOfPin.removeValue(forKey: id), let pin = pins[Int(slot)] else { continue }
+            grids[pin.level]?.remove(slot, at: positions[Int(slot)])
+            pins[Int(slot)] = nil
+            freeSlots.append(slot)
+        }
+    }
+
+    func removeAll() {
+        removals += 1
+        pins = []
+        positions = []
+        freeSlots = []
+        slotOfPin = [:]
+        grids = [:]
+    }
+
+    /// Pins and clusters visible from `camera` on floor `level`.
+    func markers(camera: RenderCamera, level: Float) -> [AnnotationMarker] {
+        let basis = camera.basis
+        let metersPerPixel = camera.distance / basis.focalLength
+        let width = Double(camera.width), height = Double(camera.height)
+
+        // ground area seen by the camera; near the horizon, a generous area around the center
+        let corners = [(0.0, 0.0), (width, 0.0), (width, height), (0.0, height)].flatMap {
+            basis.unproject(x: $0.0, y: $0.1, z: camera.center.z)
+        }
+        var bounds = (minX: camera.center.x - camera.distance * 4, minY: camera.center.y - camera.distance * 4,
+                      maxX: camera.center.x + camera.distance * 4, maxY: camera.center.y + camera.distance * 4)
+        if corners.count == 4 {
+            bounds = (corners.map { $0.x }.min()!, corners.map { $0.y }.min()!, corners.map { $0.x }.max()!, corners.map { $0.y }.max()!)
+        }
+        let margin = clusterRadius * metersPerPixel
+
+        var markers: [AnnotationMarker] = []
+        visitedCells = 0
+        for floor in [level, AnnotationClusterer.allLevels] {
+            guard let grid = grids[floor] else { continue }
+            let gridLevel = grid.level(forCellSize: clusterRadius * metersPerPixel)
+            grid.forEachCell(level: gridLevel, minX: bounds.minX - margin, minY: bounds.minY - margin,
+                             maxX: bounds.maxX + margin, maxY: bounds.maxY + margin) { count, x, y, item in
+                visitedCells += 1
+                let position = RenderPoint(x: x, y: y, z: camera.center.z)
+                guard let screen = basis.project(position), screen.x >= -clusterRadius && screen.x <= width + clusterRadius
+                    && screen.y >= -clusterRadius && screen.y <= height + clusterRadius else { return }
+                let pin = item.flatMap { pins[Int($0)] }
+                markers.append(AnnotationMarker(x: screen.x, y: screen.y, position: position, count: count,
+                                                pin: pin?.id, color: pin?.color ?? 0x3F7FBFFF))
+            }
+        }
+        return markers
+    }
+
+    /// IDs of the pins on floor `level` within `radius` meters of `point`, nearest first.
+    func pins(near point: RenderPoint, radius: Double, level: Float) -> [(id: Int, distance: Double)] {
+        var found: [(id: Int, distance: Double)] = []
+        for floor in [level, AnnotationClusterer.allLevels] {
+            grids[floor]?.forEachItem(minX: point.x - radius, minY: point.y - radius,
+                                      maxX: point.x + radius, maxY: point.y + radius) { slot in
+                let position = positions[Int(slot)]
+                let distance = ((position.x - point.x) * (position.x - point.x) + (position.y - point.y) * (position.y - point.y)).squareRoot()
+                if distance <= radius, let pin = pins[Int(slot)] {
+                    found.append((pin.id, distance))
+                }
+            }
+        }
+        return found.sorted { $0.distance < $1.distance }
+    }
+
+    private func grid(forLevel level: Float) -> ClusterGrid {
+        if let grid = grids[level] {
+            return grid
+        }
+        let grid = ClusterGrid()
+        grids[level] = grid
+        return grid
+    }
+}
@@ -0,0 +1,298 @@
+//
+//  AnnotationMover.swift
+//  DeepMapTestIOS
+//
+//  Created by agent on 18.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+import UIKit
+import HDMMapCore
+
+/// Counters of an `AnnotationMover`.
+struct AnnotationMoverStatistics: CustomStringConvertible {
+    /// Position updates received.
+    var updates = 0
+    /// Updates replaced by a newer one for the same object before they were applied.
+    var coalesced = 0
+    /// Interpolated pin positions applied.
+    var pinMoves = 0
+    /// `updateCoordinate(_:animated:)` calls on annotations.
+    var annotationMoves = 0
+    var frames = 0
+
+    var description: String {
+        return "\(updates) updates (\(coalesced) coalesced), \(pinMoves) pin moves, \(annotationMoves) annotation moves in \(frames) frames"
+    }
+}
+
+/// Moves many annotations smoothly from high-frequency position updates.
+///
+/// Updates for fleets of tracked objects are accepted in batches from any thread, in the
+/// map's API CRS, and coalesced per object, so only the newest position of an object is
+/// ever applied. Pins of an `AnnotationClusterer` are projected into the display CRS in one
+/// pass on the caller's thread, by the clusterer's projector, and then glide towards their new position over the interval at which their
+/// updates arrive; per frame at most `maximumMovesPerFrame` pins are moved, taking turns,
+/// so the cost of a frame is bounded however many objects are tracked. `HDMAnnotation`s
+/// get one animated `updateCoordinate(_:animated:)` per frame at most. Interpolation state
+/// is kept in flat arrays, dropped for pins removed from the clusterer, and the display link
+/// pauses while nothing moves. The clusterer is only touched on the main thread.
+final class AnnotationMover {
+
+    let clusterer: AnnotationClusterer
+    var maximumMovesPerFrame = 2048
+    /// Longest time a pin takes to reach a new position.
+    var maximumDuration = 1.0
+    /// Called on the main thread after a frame moved anything, e.g. to update the overlay.
+    var didMove: (() -> Void)?
+
+    private(set) var statistics = AnnotationMoverStatistics()
+
+    private let lock = NSLock()
+    private var pendingPins: [Int: (HDMMapCoordinate, RenderPoint)] = [:]
+    private var pendingAnnotations: [ObjectIdentifier: (HDMAnnotation, HDMMapCoordinate)] = [:]
+    private var pendingUpdates = 0
+    private var pendingCoalesced = 0
+
+    // interpolation state, one entry per tracked pin
+    private var trackOfPin: [Int: Int] = [:]
+    private var pinIds: [Int] = []
+    private var fromX: [Double] = [], fromY: [Double] = [], fromZ: [Double] = []
+    private var toX: [Double] = [], toY: [Double] = [], toZ: [Double] = []
+    private var startTimes: [Double] = []
+    private var durations: [Double] = []
+    private var lastUpdates: [Double] = []
+    /// Tracks still moving; `cursor` is where the next frame starts when over budget.
+    private var moving: [Int] = []
+    private var isMoving: [Bool] = []
+    private var cursor = 0
+    /// `clusterer.removals` when the tracks were last pruned.
+    private var prunedRemovals = 0
+
+    private var displayLink: CADisplayLink?
+
+    init(clusterer: AnnotationClusterer) {
+        self.clusterer = clusterer
+    }
+
+    deinit {
+        displayLink?.invalidate()
+    }
+
+    /// Starts applying updates at display rate.
+    func start() {
+        guard displayLink == nil else { return }
+        let link = CADisplayLink(target: MoverLinkTarget(self), selector: #selector(MoverLinkTarget.tick(_:)))
+        link.add(to: .main, forMode: .commonModes)
+        displayLink = link
+    }
+
+    func stop() {
+        displayLink?.invalidate()
+        displayLink = nil
+    }
+
+    /// Moves pins of the clusterer to new coordinates. Any thread.
+    func update(pins moves: [(id: Int, coordinate: HDMMapCoordinate)]) {
+        let clusterer = self.clusterer
+        let projected = moves.map { ($0.id, $0.coordinate, clusterer.project($0.coordinate)) }
+        lock.lock()
+        for (id, coordinate, position) in projected {
+            if pendingPins.updateValue((coordinate, position), forKey: id) != nil {
+                pendingCoalesced += 1
+            }
+        }
+        pendingUpdates += moves.count
+        lock.unlock()
+        wake()
+    }
+
+    /// Moves annotations to new coordinates. Any thread.
+    func update(_ moves: [(annotation: HDMAnnotation, coordinate: HDMMapCoordinate)]) {
+        lock.lock()
+        for (annotation, coordinate) in moves {
+            if pendingAnnotations.updateValue((annotation, coordinate), forKey: ObjectIdentifier(annotation)) != nil {
+                pendingCoalesced += 1
+            }
+        }
+        pendingUpdates += moves.count
+        lock.unlock()
+        wake()
+    }
+
+    /// Whether pins are still on their way.
+    var isAnimating: Bool {
+        return !moving.isEmpty
+    }
+
+    /// Pins with interpolation state.
+    var trackCount: Int {
+        return pinIds.count
+    }
+
+    /// Applies pending updates and advances pins to `time`; called by the display link.
+    func step(at time: CFTimeInterval) {
+        lock.lock()
+        let pins = pendingPins, annotations = pendingAnnotations
+        pendingPins = [:]
+        pendingAnnotations = [:]
+        statistics.updates += pendingUpdates
+        statistics.coalesced += pendingCoalesced
+        pendingUpdates = 0
+        pendingCoalesced = 0
+        lock.unlock()
+
+        if prunedRemovals != clusterer.removals {
+            prunedRemovals = clusterer.removals
+            pruneTracks()
+        }
+        for (annotation, coordinate) in annotations.values {
+            annotation.updateCoordinate(coordinate, animated: true)
+        }
+        statistics.annotationMoves += annotations.count
+        for (id, update) in pins {
+            retarget(id, coordinate: update.0, position: update.1, at: time)
+        }
+
+        let moves = advance(to: time)
+        statistics.frames += 1
+        displayLink?.isPaused = moving.isEmpty
+        if moves > 0 || !annotations.isEmpty {
+            didMove?()
+        }
+    }
+
+    private func retarget(_ id: Int, coordinate: HDMMapCoordinate, position: RenderPoint, at time: Double) {
+        guard let current = clusterer.position(ofPin: id) else { return }
+        let track: Int
+        if let existing = trackOfPin[id] {
+            track = existing
+            // glide over the interval updates arrive at, so the pin keeps moving until the next one
+            durations[track] = min(max(time - lastUpdates[track], 1.0 / 30), maximumDuration)
+        } else {
+            track = pinIds.count
+            trackOfPin[id] = track
+            pinIds.append(id)
+            fromX.append(0)
+            fromY.append(0)
+            fromZ.append(0)
+            toX.append(0)
+            toY.append(0)
+            toZ.append(0)
+            startTimes.append(0)
+            lastUpdates.append(0)
+            // nothing is known about the update rate yet
+            durations.append(min(0.25, maximumDuration))
+            isMoving.append(false)
+        }
+        fromX[track] = current.x
+        fromY[track] = current.y
+        fromZ[track] = current.z
+        toX[track] = position.x
+        toY[track] = position.y
+        toZ[track] = position.z
+        startTimes[track] = time
+        lastUpdates[track] = time
+        // the pin's coordinate is its destination; views of it animate there on their own
+        clusterer.setCoordinate(coordinate, ofPin: id)
+        if !isMoving[track] {
+            isMoving[track] = true
+            moving.append(track)
+        }
+    }
+
+    /// Drops the tracks of pins no longer in the clusterer, moving the last track into each gap.
+    private func pruneTracks() {
+        for track in (0..<pinIds.count).reversed() where clusterer.position(ofPin: pinIds[track]) == nil {
+            if isMoving[track], let index = moving.index(of: track) {
+                moving.swapAt(index, moving.count - 1)
+                moving.removeLast()
+            }
+            trackOfPin[pinIds[track]] = nil
+            let last = pinIds.count - 1
+            if track != last {
+                if isMoving[last], let index = moving.index(of: last) {
+                    moving[index] = track
+                }
+                pinIds[track] = pinIds[last]
+                fromX[track] = fromX[last]
+                fromY[track] = fromY[last]
+                fromZ[track] = fromZ[last]
+                toX[track] = toX[last]
+                toY[track] = toY[last]
+                toZ[track] = toZ[last]
+                startTimes[track] = startTimes[last]
+                durations[track] = durations[last]
+                lastUpdates[track] = lastUpdates[last]
+                isMoving[track] = isMoving[last]
+                trackOfPin[pinIds[track]] = track
+            }
+            pinIds.removeLast()
+            fromX.removeLast()
+            fromY.removeLast()
+            fromZ.removeLast()
+            toX.removeLast()
+            toY.removeLast()
+            toZ.removeLast()
+            startTimes.removeLast()
+            durations.removeLast()
+            lastUpdates.removeLast()
+            isMoving.removeLast()
+        }
+    }
+
+    /// Moves up to `maximumMovesPerFrame` pins; returns the number moved.
+    private func advance(to time: Double) -> Int {
+        let count = min(moving.count, maximumMovesPerFrame)
+        guard count > 0 else { return 0 }
+        if cursor >= moving.count {
+            cursor = 0
+        }
+        var finished: [Int] = []
+        for step in 0..<count {
+            let index = (cursor + step) % moving.count
+            let track = moving[index]
+            let t = min(max((time - startTimes[track]) / durations[track], 0), 1)
+            let position = RenderPoint(x: fromX[track] + (toX[track] - fromX[track]) * t,
+                                       y: fromY[track] + (toY[track] - fromY[track]) * t,
+                                       z: fromZ[track] + (toZ[track] - fromZ[track]) * t)
+            clusterer.move(pinIds[track], to: position)
+            if t >= 1 {
+                finished.append(index)
+            }
+        }
+        cursor += count
+        statistics.pinMoves += count
+
+        // remove arrived tracks from the back so indices stay valid
+        for index in finished.sorted(by: >) {
+            isMoving[moving[index]] = false
+            moving.swapAt(index, moving.count - 1)
+            moving.removeLast()
+        }
+        return count
+    }
+
+    private func wake() {
+        DispatchQueue.main.async {
+            self.displayLink?.isPaused = false
+        }
+    }
+}
+
+/// Breaks the retain cycle between a display link and its mover.
+private final class MoverLinkTarget: NSObject {
+    private weak var mover: AnnotationMover?
+
+    init(_ mover: AnnotationMover) {
+        self.mover = mover
+    }
+
+    @objc func tick(_ link: CADisplayLink) {
+        if let mover = mover {
+            mover.step(at: link.timestamp)
+        } else {
+            link.invalidate()
+        }
+    }
+}
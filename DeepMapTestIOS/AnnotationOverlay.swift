@@ -0,0 +1,253 @@
+//
+//  AnnotationOverlay.swift
+//  DeepMapTestIOS
+//
+//  Created by agent on 18.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+import UIKit
+import CoreText
+import HDMMapCore
+
+/// Draws pins and clusters over the map in one pass.
+///
+/// Pins of a color are filled as a single path and clusters as another, so the cost of a
+/// redraw grows with the number of markers on screen only, and no view exists per pin. Pin
+/// titles placed by `labels` are drawn on top, and redrawn while they fade.
+final class AnnotationOverlayView: UIView {
+
+    var pinRadius: CGFloat = 6
+    var clusterColor = UIColor(red: 0.25, green: 0.5, blue: 0.75, alpha: 0.9)
+
+    /// IDs of pins drawn by `HDMPinAnnotation`s instead.
+    var hiddenPins: Set<Int> = [] {
+        didSet { setNeedsDisplay() }
+    }
+
+    var markers: [AnnotationMarker] = [] {
+        didSet { setNeedsDisplay() }
+    }
+
+    weak var labels: LabelEngine?
+
+    override init(frame: CGRect) {
+        super.init(frame: frame)
+        isOpaque = false
+        backgroundColor = .clear
+        isUserInteractionEnabled = false
+        contentMode = .redraw
+        autoresizingMask = [.flexibleWidth, .flexibleHeight]
+    }
+
+    required init?(coder aDecoder: NSCoder) {
+        fatalError("init(coder:) has not been implemented")
+    }
+
+    override func draw(_ rect: CGRect) {
+        guard let context = UIGraphicsGetCurrentContext() else { return }
+        let bounds = rect.insetBy(dx: -pinRadius * 4, dy: -pinRadius * 4)
+
+        var pins: [UInt32: CGMutablePath] = [:]
+        let clusters = CGMutablePath()
+        var counts: [(String, CGPoint, CGFloat)] = []
+        for marker in markers {
+            let center = CGPoint(x: marker.x, y: marker.y)
+            guard bounds.contains(center) else { continue }
+            if let pin = marker.pin {
+                guard !hiddenPins.contains(pin) else { continue }
+                let path = pins[marker.color] ?? CGMutablePath()
+                path.addEllipse(in: CGRect(x: center.x - pinRadius, y: center.y - pinRadius, width: pinRadius * 2, height: pinRadius * 2))
+                pins[marker.color] = path
+            } else {
+                // larger clusters get larger circles, up to twice the base size
+                let radius = pinRadius * (1.5 + min(CGFloat(log10(Double(marker.count))) / 2, 1.5))
+                clusters.addEllipse(in: CGRect(x: center.x - radius, y: center.y - radius, width: radius * 2, height: radius * 2))
+                counts.append((marker.count < 1000 ? "\(marker.count)" : "\(marker.count / 1000)k", center, radius))
+            }
+        }
+
+        context.setStrokeColor(UIColor.white.cgColor)
+        context.setLineWidth(1.5)
+        for (color, path) in pins {
+            context.setFillColor(AnnotationOverlayView.color(color).cgColor)
+            context.addPath(path)
+            context.drawPath(using: .fillStroke)
+        }
+        context.setFillColor(clusterColor.cgColor)
+        context.addPath(clusters)
+        context.drawPath(using: .fillStroke)
+
+        for (text, center, radius) in counts {
+            let attributes: [NSAttributedStringKey: Any] = [.font: UIFont.boldSystemFont(ofSize: radius * 0.9),
+                                                            .foregroundColor: UIColor.white]
+            let size = (text as NSString).size(withAttributes: attributes)
+            (text as NSString).draw(at: CGPoint(x: center.x - size.width / 2, y: center.y - size.height / 2), withAttributes: attributes)
+        }
+
+        guard let labels = labels else { return }
+        let time = CACurrentMediaTime()
+        for label in labels.labels(at: time) {
+            let candidate = labels.candidates[label.candidate]
+            let color = AnnotationOverlayView.color(candidate.color)
+            let attributes: [NSAttributedStringKey: Any] = [.font: UIFont.systemFont(ofSize: CGFloat(candidate.size)),
+                                                            .foregroundColor: color.withAlphaComponent(CGFloat(label.opacity))]
+            let size = (candidate.text as NSString).size(withAttributes: attributes)
+            let center = CGPoint(x: CGFloat(label.rect.minX + label.rect.maxX) / 2, y: CGFloat(label.rect.minY + label.rect.maxY) / 2)
+            (candidate.text as NSString).draw(at: CGPoint(x: center.x - size.width / 2, y: center.y - size.height / 2), withAttributes: attributes)
+        }
+        if labels.isAnimating(at: time) {
+            DispatchQueue.main.async { self.setNeedsDisplay() }
+        }
+    }
+
+    static func color(_ rgba: UInt32) -> UIColor {
+        return UIColor(red: CGFloat(rgba >> 24 & 0xFF) / 255, green: CGFloat(rgba >> 16 & 0xFF) / 255,
+                       blue: CGFloat(rgba >> 8 & 0xFF) / 255, alpha: CGFloat(rgba & 0xFF) / 255)
+    }
+}
+
+/// Shows tens of thousands of pins on a map view.
+///
+/// Each `HDMAnnotation` is backed by a UIView the map lays out every frame, which does not
+/// scale past a few hundred. The layer keeps pins in an `AnnotationClusterer`, draws what is
+/// visible as pins and clusters in an `AnnotationOverlayView`, and creates real
+/// `HDMPinAnnotation`s, with callouts, only for selected pins and, once zoomed in far enough,
+/// for the few visible single pins. The titles of the other visible single pins are placed
+/// by a `LabelEngine`, so they don't overlap. Call `update()` when the camera or floor
+/// changes. Use from the main thread.
+final class AnnotationLayer {
+
+    private(set) weak var mapView: HDMMapView?
+    let clusterer: AnnotationClusterer
+    let overlay: AnnotationOverlayView
+    /// Visible single pins are given annotation views while there are at most this many.
+    var maximumViews = 16
+    /// Vertical field of view of the map's camera, in degrees. The engine does not expose it,
+    /// so pins are projected with this assumed value; adjust it if overlay pins drift from the
+    /// annotation views toward the screen edges.
+    var fieldOfView = 45.0 {
+        didSet { update() }
+    }
+
+    /// Places the titles of visible single pins drawn by the overlay.
+    let labels = LabelEngine()
+    /// Sizes of pin titles in the system font the overlay draws them in, shaped once per title.
+    let titleText = ShapedTextCache(font: CTFontCreateUIFontForLanguage(.system, 32, nil)!)
+    /// Font size of pin titles, in points.
+    var titleSize: Float = 12
+    var titleColor: UInt32 = 0x202020FF
+
+    /// Pins always shown with an annotation view.
+    var selectedPins: Set<Int> = [] {
+        didSet { update() }
+    }
+
+    private var views: [Int: HDMPinAnnotation] = [:]
+
+    init(mapView: HDMMapView, projection: UTMProjection = .zone32N) {
+        self.mapView = mapView
+        clusterer = AnnotationClusterer(projection: projection, projector: mapView.projector)
+        overlay = AnnotationOverlayView(frame: mapView.bounds)
+        overlay.labels = labels
+        labels.measure = { [titleText = self.titleText] text, size in
+            return titleText.measure(text, size: size)
+        }
+        mapView.addSubview(overlay)
+        labels.didPlace = { [weak overlay = self.overlay] in
+            overlay?.setNeedsDisplay()
+        }
+    }
+
+    deinit {
+        overlay.removeFromSuperview()
+    }
+
+    func add(_ pins: [MapPin]) {
+        clusterer.add(pins)
+        update()
+    }
+
+    func remove(ids: [Int]) {
+        clusterer.remove(ids: ids)
+        update()
+    }
+
+    func removeAll() {
+        clusterer.removeAll()
+        update()
+    }
+
+    func update() {
+        guard let mapView = mapView else { return }
+        var camera = RenderCamera(camera: mapView.camera, projection: clusterer.projection,
+                                  width: Int(mapView.bounds.width), height: Int(mapView.bounds.height))
+        camera.center = clusterer.project(mapView.camera.lookAt)
+        camera.fieldOfView = fieldOfView
+        let markers = clusterer.markers(camera: camera, level: mapView.currentLevel)
+
+        var wanted = Set(selectedPins.filter { clusterer.pin(withId: $0) != nil })
+        let singles = markers.flatMap { $0.pin }
+        if singles.count == markers.count && singles.count <= maximumViews {
+            wanted.formUnion(singles)
+        }
+        syncViews(wanted)
+        updateTitles(markers, camera: camera)
+        overlay.hiddenPins = Set(views.keys)
+        overlay.markers = markers
+    }
+
+    /// Whether `annotation` is one of the layer's annotation views.
+    func owns(_ annotation: HDMAnnotation) -> Bool {
+        return views.values.contains { $0 === annotation }
+    }
+
+    /// Labels the visible single pins that have a title and no annotation view, above the pin.
+    private func updateTitles(_ markers: [AnnotationMarker], camera: RenderCamera) {
+        let views = self.views, clusterer = self.clusterer, size = titleSize, color = titleColor
+        let offsetY = -Float(overlay.pinRadius) - size
+        let candidates = markers.flatMap { marker -> LabelCandidate? in
+            guard let id = marker.pin, views[id] == nil, let title = clusterer.pin(withId: id)?.title, !title.isEmpty else { return nil }
+            return LabelCandidate(featureId: UInt64(bitPattern: Int64(id)), anchor: marker.position, text: title, size: size,
+                                  color: color, offset: (0, offsetY), priority: 0)
+        }
+        let unchanged = candidates.elementsEqual(labels.candidates) { lhs, rhs in
+            lhs.featureId == rhs.featureId && lhs.text == rhs.text && lhs.anchor.x == rhs.anchor.x && lhs.anchor.y == rhs.anchor.y
+        }
+        if !unchanged {
+            labels.setCandidates(candidates)
+        }
+        labels.update(camera: camera)
+    }
+
+    /// Adds and removes annotation views so exactly the pins in `wanted` have one, and moves
+    /// views whose pin moved.
+    private func syncViews(_ wanted: Set<Int>) {
+        guard let mapView = mapView else { return }
+        let stale = views.keys.filter { !wanted.contains($0) }
+        if !stale.isEmpty {
+            mapView.remove(stale.flatMap { views.removeValue(forKey: $0) })
+        }
+        var added: [HDMAnnotation] = []
+        for id in wanted {
+            guard let pin = clusterer.pin(withId: id) else { continue }
+            if let annotation = views[id] {
+                // moved pins; the map animates the view
+                let current = annotation.coordinate
+                if current.x != pin.coordinate.x || current.y != pin.coordinate.y || current.z != pin.coordinate.z {
+                    annotation.updateCoordinate(pin.coordinate, animated: true)
+                }
+                continue
+            }
+            let annotation = HDMPinAnnotation(coordinate: pin.coordinate)
+            annotation.title = pin.title
+            annotation.canShowCallout = pin.title != nil
+            annotation.pinColor = AnnotationOverlayView.color(pin.color)
+            views[id] = annotation
+            added.append(annotation)
+        }
+        if !added.isEmpty {
+            mapView.addAnnotations(added)
+        }
+    }
+}
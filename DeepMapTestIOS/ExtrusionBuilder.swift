@@ -0,0 +1,460 @@
+//
+//  ExtrusionBuilder.swift
+//  DeepMapTestIOS
+//
+//  Created by agent on 18.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+import Foundation
+import HDMMapCore
+
+/// A polygon to extrude, in projected meters.
+struct ExtrusionFootprint {
+    let featureId: UInt64
+    let level: Float
+    /// Elevations of the bottom and the top, in meters.
+    let base: Double
+    let top: Double
+    /// Outer ring followed by holes.
+    let rings: [[RenderPoint]]
+}
+
+/// How much of a building is drawn.
+enum ExtrusionDetail: Int {
+    /// A wall along every footprint edge and a triangulated roof.
+    case full
+    /// The footprint's enclosing rectangle as a box.
+    case block
+    case hidden
+}
+
+/// The extruded footprints of one level and grid cell, merged into one mesh per detail.
+///
+/// Mesh positions are meters relative to `origin`, with x east, y up and z south, the .obj
+/// convention. Every wall has its own four vertices so walls are lit flat.
+struct ExtrusionBatch {
+    let level: Float
+    /// Projected ground point the meshes are placed at.
+    let origin: RenderPoint
+    let bounds: RenderBounds
+    let featureIds: [UInt64]
+    /// Meshes by `ExtrusionDetail.rawValue`, full and block.
+    let meshes: [OBJMesh]
+}
+
+/// Builds extrusion meshes from footprint polygons and the elevations of their features.
+///
+/// Runs on any thread; building a campus takes a few milliseconds, so it happens in the
+/// background when a package is opened rather than on the main thread.
+enum ExtrusionBuilder {
+
+    /// Footprints of the polygons in `primitives` whose feature spans a height in `heights`.
+    static func footprints(in primitives: [RenderPrimitive],
+                           heights: (UInt64) -> (minimum: Double, maximum: Double)?) -> [ExtrusionFootprint] {
+        var footprints: [ExtrusionFootprint] = []
+        for primitive in primitives {
+            guard case .polygon(let rings) = primitive.geometry, let first = rings.first, first.count >= 3,
+                let height = heights(primitive.featureId), height.maximum > height.minimum else { continue }
+            footprints.append(ExtrusionFootprint(featureId: primitive.featureId, level: primitive.level,
+                                                 base: height.minimum, top: height.maximum, rings: rings))
+        }
+        return footprints
+    }
+
+    /// The elevations of the objects of a package's cells, the same the engine draws them at.
+    static func heights(in cells: MapCellSource) -> (UInt64) -> (minimum: Double, maximum: Double)? {
+        let heights = cells.heights
+        return { featureId in
+            return heights[featureId].map { (minimum: Double($0.minimum), maximum: Double($0.maximum)) }
+        }
+    }
+
+    /// Merges footprints into batches per level and `cellSize` grid cell.
+    static func batches(_ footprints: [ExtrusionFootprint], cellSize: Double = 64) -> [ExtrusionBatch] {
+        var cells: [String: [Int]] = [:]
+        for (index, footprint) in footprints.enumerated() {
+            let center = bounds(of: footprint).center
+            let key = "\(footprint.level)/\(Int((center.x / cellSize).rounded(.down)))/\(Int((center.y / cellSize).rounded(.down)))"
+            cells[key, default: []].append(index)
+        }
+        return cells.keys.sorted().map { (key: String) -> ExtrusionBatch in
+            let members = cells[key]!.map { footprints[$0] }
+            var batchBounds = RenderBounds.empty
+            for footprint in members {
+                batchBounds.formUnion(bounds(of: footprint))
+            }
+            let origin = RenderPoint(x: (batchBounds.minX + batchBounds.maxX) / 2, y: (batchBounds.minY + batchBounds.maxY) / 2)
+            var full = OBJMesh(), block = OBJMesh()
+            for footprint in members {
+                appendFull(footprint, origin: origin, to: &full)
+                appendBlock(footprint, origin: origin, to: &block)
+            }
+            return ExtrusionBatch(level: members[0].level, origin: origin, bounds: batchBounds,
+                                  featureIds: members.map { $0.featureId }, meshes: [full, block])
+        }
+    }
+
+    static func bounds(of footprint: ExtrusionFootprint) -> RenderBounds {
+        var bounds = RenderBounds.empty
+        for point in footprint.rings[0] {
+            bounds.extend(RenderPoint(x: point.x, y: point.y, z: footprint.base))
+        }
+        bounds.maxZ = footprint.top
+        return bounds
+    }
+
+    // MARK: - Geometry
+
+    private static func appendFull(_ footprint: ExtrusionFootprint, origin: RenderPoint, to mesh: inout OBJMesh) {
+        var rings: [[RenderPoint]] = []
+        for (index, ring) in footprint.rings.enumerated() {
+            let points = open(ring)
+            guard points.count >= 3 else { continue }
+            // outer rings counterclockwise, holes clockwise, so walls face away from the solid
+            rings.append((signedArea(points) > 0) == (index == 0) ? points : Array(points.reversed()))
+        }
+        guard !rings.isEmpty else { return }
+        for ring in rings {
+            appendWalls(ring, base: footprint.base, top: footprint.top, origin: origin, to: &mesh)
+        }
+        let (points, triangles) = triangulate(rings)
+        appendRoof(points, triangles: triangles, height: footprint.top, origin: origin, to: &mesh)
+    }
+
+    private static func appendBlock(_ footprint: ExtrusionFootprint, origin: RenderPoint, to mesh: inout OBJMesh) {
+        let outer = open(footprint.rings[0])
+        guard outer.count >= 3 else { return }
+        let corners = enclosingRectangle(outer)
+        appendWalls(corners, base: footprint.base, top: footprint.top, origin: origin, to: &mesh)
+        appendRoof(corners, triangles: [0, 1, 2, 0, 2, 3], height: footprint.top, origin: origin, to: &mesh)
+    }
+
+    private static func appendWalls(_ ring: [RenderPoint], base: Double, top: Double, origin: RenderPoint, to mesh: inout OBJMesh) {
+        for index in 0..<ring.count {
+            let a = ring[index], b = ring[(index + 1) % ring.count]
+            let dx = b.x - a.x, dy = b.y - a.y, length = (dx * dx + dy * dy).squareRoot()
+            guard length > 1e-6 else { continue }
+            let first = UInt32(mesh.vertexCount)
+            for (point, height) in [(a, base), (b, base), (b, top), (a, top)] {
+                appendVertex(point, height: height, normal: (dy / length, -dx / length, 0), origin: origin, to: &mesh)
+            }
+            mesh.indices += [first, first + 1, first + 2, first, first + 2, first + 3]
+        }
+    }
+
+    private static func appendRoof(_ points: [RenderPoint], triangles: [Int], height: Double, origin: RenderPoint,
+                                   to mesh: inout OBJMesh) {
+        let first = mesh.vertexCount
+        for point in points {
+            appendVertex(point, height: height, normal: (0, 0, 1), origin: origin, to: &mesh)
+        }
+        mesh.indices += triangles.map { UInt32(first + $0) }
+    }
+
+    /// Adds a vertex given east, north and up, stored as .obj x, y, z.
+    private static func appendVertex(_ point: RenderPoint, height: Double, normal: (Double, Double, Double),
+                                     origin: RenderPoint, to mesh: inout OBJMesh) {
+        mesh.positions += [Float(point.x - origin.x), Float(height), Float(origin.y - point.y)]
+        mesh.normals += [Float(normal.0), Float(normal.2), Float(-normal.1)]
+    }
+
+    /// A ring without the closing copy of its first point.
+    private static func open(_ ring: [RenderPoint]) -> [RenderPoint] {
+        guard let first = ring.first, let last = ring.last, ring.count > 1, first.x == last.x && first.y == last.y else {
+            return ring
+        }
+        return Array(ring.dropLast())
+    }
+
+    /// Twice the area, positive for counterclockwise rings.
+    static func signedArea(_ ring: [RenderPoint]) -> Double {
+        var area = 0.0
+        for index in 0..<ring.count {
+            let a = ring[index], b = ring[(index + 1) % ring.count]
+            area += a.x * b.y - b.x * a.y
+        }
+        return area
+    }
+
+    /// Triangulates a counterclockwise outer ring with clockwise holes by ear clipping, after
+    /// joining each hole to the outline with a bridge edge. Returns the joined points and
+    /// three indices into them per counterclockwise triangle.
+    static func triangulate(_ rings: [[RenderPoint]]) -> (points: [RenderPoint], triangles: [Int]) {
+        var polygon = rings[0]
+        // bridge holes from the rightmost one, so later bridges cannot cross earlier ones
+        let holes = rings.dropFirst().filter { $0.count >= 3 }.sorted {
+            ($0.map { $0.x }.max() ?? 0) > ($1.map { $0.x }.max() ?? 0)
+        }
+        for (index, hole) in holes.enumerated() {
+            let start = hole.indices.max { hole[$0].x < hole[$1].x }!
+            let m = hole[start]
+            let others = holes[(index + 1)...]
+            var best: Int?
+            var bestDistance = Double.infinity
+            for (candidate, p) in polygon.enumerated() {
+                let distance = (p.x - m.x) * (p.x - m.x) + (p.y - m.y) * (p.y - m.y)
+                guard distance < bestDistance, !crosses(m, p, polygon) && !others.contains(where: { crosses(m, p, $0) })
+                    && !crosses(m, p, hole) else { continue }
+                best = candidate
+                bestDistance = distance
+            }
+            guard let bridge = best else { continue }
+            let loop = Array(hole[start...] + hole[..<start]) + [m, polygon[bridge]]
+            polygon.insert(contentsOf: loop, at: bridge + 1)
+        }
+
+        var remaining = Array(polygon.indices)
+        var triangles: [Int] = []
+        while remaining.count > 3 {
+            var clipped = false
+            for position in 0..<remaining.count {
+                let i = remaining[(position + remaining.count - 1) % remaining.count]
+                let j = remaining[position], k = remaining[(position + 1) % remaining.count]
+                guard isEar(i, j, k, of: polygon, remaining: remaining) else { continue }
+                triangles += [i, j, k]
+                remaining.remove(at: position)
+                clipped = true
+                break
+            }
+            if !clipped {
+                // degenerate outline; fan the rest rather than leave a hole in the roof
+                for position in 1..<remaining.count - 1 {
+                    triangles += [remaining[0], remaining[position], remaining[position + 1]]
+                }
+                remaining = []
+            }
+        }
+        if remaining.count == 3 {
+            triangles += remaining
+        }
+        return (polygon, triangles)
+    }
+
+    private static func cross(_ a: RenderPoint, _ b: RenderPoint, _ c: RenderPoint) -> Double {
+        return (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x)
+    }
+
+    private static func isEar(_ i: Int, _ j: Int, _ k: Int, of polygon: [RenderPoint], remaining: [Int]) -> Bool {
+        let a = polygon[i], b = polygon[j], c = polygon[k]
+        guard cross(a, b, c) > 1e-12 else { return false }
+        for index in remaining where index != i && index != j && index != k {
+            let p = polygon[index]
+            // bridge vertices appear twice; their copies do not block the ear
+            if (p.x == a.x && p.y == a.y) || (p.x == b.x && p.y == b.y) || (p.x == c.x && p.y == c.y) {
+                continue
+            }
+            if cross(a, b, p) >= 0 && cross(b, c, p) >= 0 && cross(c, a, p) >= 0 {
+                return false
+            }
+        }
+        return true
+    }
+
+    /// Whether segment `a`–`b` properly crosses an edge of `ring`.
+    private static func crosses(_ a: RenderPoint, _ b: RenderPoint, _ ring: [RenderPoint]) -> Bool {
+        for index in 0..<ring.count {
+            let c = ring[index], d = ring[(index + 1) % ring.count]
+            let d1 = cross(a, b, c), d2 = cross(a, b, d), d3 = cross(c, d, a), d4 = cross(c, d, b)
+            if ((d1 > 0 && d2 < 0) || (d1 < 0 && d2 > 0)) && ((d3 > 0 && d4 < 0) || (d3 < 0 && d4 > 0)) {
+                return true
+            }
+        }
+        return false
+    }
+
+    /// The smallest rectangle aligned with one of the ring's edges that contains it, as four
+    /// counterclockwise corners.
+    static func enclosingRectangle(_ ring: [RenderPoint]) -> [RenderPoint] {
+        var best: (area: Double, axis: (Double, Double), bounds: (Double, Double, Double, Double))?
+        for index in 0..<ring.count {
+            let a = ring[index], b = ring[(index + 1) % ring.count]
+            let length = ((b.x - a.x) * (b.x - a.x) + (b.y - a.y) * (b.y - a.y)).squareRoot()
+            guard length > 1e-6 else { continue }
+            let axis = ((b.x - a.x) / length, (b.y - a.y) / length)
+            var bounds = (Double.infinity, Double.infinity, -Double.infinity, -Double.infinity)
+            for p in ring {
+                let u = p.x * axis.0 + p.y * axis.1, v = p.y * axis.0 - p.x * axis.1
+                bounds = (min(bounds.0, u), min(bounds.1, v), max(bounds.2, u), max(bounds.3, v))
+            }
+            let area = (bounds.2 - bounds.0) * (bounds.3 - bounds.1)
+            if best == nil || area < best!.area {
+                best = (area, axis, bounds)
+            }
+        }
+        guard let rectangle = best else { return Array(ring.prefix(4)) }
+        let (ux, uy) = rectangle.axis, b = rectangle.bounds
+        func corner(_ u: Double, _ v: Double) -> RenderPoint {
+            return RenderPoint(x: u * ux - v * uy, y: u * uy + v * ux)
+        }
+        return [corner(b.0, b.1), corner(b.2, b.1), corner(b.2, b.3), corner(b.0, b.3)]
+    }
+}
+
+/// Counters of an `ExtrusionLayer`.
+struct ExtrusionStatistics: CustomStringConvertible {
+    var batches = 0
+    var footprints = 0
+    /// Batches per `ExtrusionDetail` after the last update.
+    var full = 0
+    var blocks = 0
+    var hidden = 0
+    /// Triangles placed on the map after the last update.
+    var triangles = 0
+    /// Meshes placed or removed because a batch changed detail.
+    var swaps = 0
+
+    var description: String {
+        return "\(batches) batches of \(footprints) footprints: \(full) full, \(blocks) blocks, \(hidden) hidden, \(triangles) triangles, \(swaps) swaps"
+    }
+}
+
+/// Shows extruded buildings on the map in 3D mode, simplified by camera distance.
+///
+/// Footprints are read from a package's cells and extruded in the background; each batch's
+/// meshes are written once as .obj files named by content hash and placed with
+/// `createMeshFeature`. On camera changes every batch picks a detail from its size on
+/// screen: full walls and roofs up close, one box per building further out, nothing when it
+/// would cover only a few pixels. Floors above the current one are hidden. Only batches
+/// that change detail touch the map, and thresholds have some hysteresis so a batch does
+/// not flip back and forth at the boundary. Use from the main thread.
+final class ExtrusionLayer {
+
+    private(set) weak var mapView: HDMMapView?
+    let projection: UTMProjection
+    let directory: URL
+    /// Size on screen, in points, from which batches are drawn in full.
+    var fullDetailSize = 160.0
+    /// Size on screen below which batches are not drawn.
+    var minimumSize = 12.0
+    /// Feature type of the placed meshes.
+    var type = "extrusion"
+    /// Extrusions show only while enabled, i.e. in 3D mode.
+    var isEnabled = false {
+        didSet {
+            if isEnabled != oldValue {
+                refresh()
+            }
+        }
+    }
+
+    private(set) var batches: [ExtrusionBatch] = []
+    private(set) var statistics = ExtrusionStatistics()
+
+    /// .obj files by batch and detail.
+    private var files: [[String]] = []
+    private var placed: [(detail: ExtrusionDetail, featureId: UInt64)?] = []
+    private var lastView: (camera: RenderCamera, level: Float)?
+
+    init(mapView: HDMMapView, projection: UTMProjection = .zone32N, directory: URL? = nil) {
+        self.mapView = mapView
+        self.projection = projection
+        self.directory = directory ?? FileManager.default.urls(for: .cachesDirectory, in: .userDomainMask)[0]
+            .appendingPathComponent("extrusions", isDirectory: true)
+    }
+
+    /// Extrudes the polygons of `cells` to their objects' elevations in the background.
+    func load(_ cells: MapCellSource, completion: (() -> Void)? = nil) {
+        let directory = self.directory
+        DispatchQueue.global(qos: .utility).async {
+            let footprints = ExtrusionBuilder.footprints(in: cells.primitives(level: nil), heights: ExtrusionBuilder.heights(in: cells))
+            let batches = ExtrusionBuilder.batches(footprints)
+            let files = (try? ExtrusionLayer.write(batches, to: directory)) ?? []
+            DispatchQueue.main.async {
+                self.removeAll()
+                self.batches = files.isEmpty ? [] : batches
+                self.files = files
+                self.placed = [(detail: ExtrusionDetail, featureId: UInt64)?](repeating: nil, count: self.batches.count)
+                self.statistics.batches = self.batches.count
+                self.statistics.footprints = footprints.count
+                self.refresh()
+                completion?()
+            }
+        }
+    }
+
+    /// Picks each batch's detail for `camera` on `level` and swaps meshes where it changed.
+    func update(camera: RenderCamera, level: Float) {
+        lastView = (camera, level)
+        guard isEnabled else { return }
+        let basis = camera.basis
+        var counts = [0, 0, 0]
+        var triangles = 0
+        for (index, batch) in batches.enumerated() {
+            let center = batch.bounds.center
+            let dx = center.x - basis.eye.x, dy = center.y - basis.eye.y, dz = center.z - basis.eye.z
+            let extent = ((batch.bounds.maxX - batch.bounds.minX) * (batch.bounds.maxX - batch.bounds.minX)
+                + (batch.bounds.maxY - batch.bounds.minY) * (batch.bounds.maxY - batch.bounds.minY)).squareRoot()
+            let size = extent * basis.focalLength / max((dx * dx + dy * dy + dz * dz).squareRoot(), 1)
+            let detail = batch.level > level ? ExtrusionDetail.hidden
+                : ExtrusionLayer.detail(forSize: size, current: placed[index]?.detail, full: fullDetailSize, minimum: minimumSize)
+            place(index, detail: detail)
+            counts[detail.rawValue] += 1
+            if detail != .hidden {
+                triangles += batch.meshes[detail.rawValue].indices.count / 3
+            }
+        }
+        statistics.full = counts[0]
+        statistics.blocks = counts[1]
+        statistics.hidden = counts[2]
+        statistics.triangles = triangles
+    }
+
+    /// The detail of a batch `size` points large that currently shows `current`. Leaving a
+    /// detail takes a size a fifth beyond its threshold.
+    static func detail(forSize size: Double, current: ExtrusionDetail?, full: Double, minimum: Double) -> ExtrusionDetail {
+        let slack = 1.2
+        switch current {
+        case .full?:
+            return size * slack >= full ? .full : size * slack >= minimum ? .block : .hidden
+        case .block?:
+            return size >= full * slack ? .full : size * slack >= minimum ? .block : .hidden
+        default:
+            return size >= full * slack ? .full : size >= minimum * slack ? .block : .hidden
+        }
+    }
+
+    func removeAll() {
+        for index in placed.indices {
+            place(index, detail: .hidden)
+        }
+    }
+
+    private func refresh() {
+        if isEnabled, let view = lastView {
+            update(camera: view.camera, level: view.level)
+        } else if !isEnabled {
+            removeAll()
+        }
+    }
+
+    private func place(_ index: Int, detail: ExtrusionDetail) {
+        guard let mapView = mapView, placed[index]?.detail ?? .hidden != detail else { return }
+        if let current = placed[index] {
+            mapView.removeFeature(HDMFeature(id: current.featureId, location: nil, attributes: [:]))
+            statistics.swaps += 1
+        }
+        placed[index] = nil
+        guard detail != .hidden else { return }
+        let origin = projection.unproject(batches[index].origin)
+        let featureId = mapView.createMeshFeature(HDMMapCoordinateMake(origin.longitude, origin.latitude, 0), withType: type,
+                                                  meshFile: files[index][detail.rawValue], animated: false)
+        placed[index] = (detail, featureId)
+        statistics.swaps += 1
+    }
+
+    /// Writes the meshes of `batches`, skipping files that already exist.
+    private static func write(_ batches: [ExtrusionBatch], to directory: URL) throws -> [[String]] {
+        try FileManager.default.createDirectory(at: directory, withIntermediateDirectories: true, attributes: nil)
+        return try batches.map { batch in
+            try batch.meshes.map { (mesh: OBJMesh) -> String in
+                let data = mesh.objData()
+                let path = directory.appendingPathComponent(String(format: "%016llx.obj", MeshCache.hash([UInt8](data)))).path
+                if !FileManager.default.fileExists(atPath: path) {
+                    try data.write(to: URL(fileURLWithPath: path), options: .atomic)
+                }
+                return path
+            }
+        }
+    }
+}
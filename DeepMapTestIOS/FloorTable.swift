@@ -0,0 +1,215 @@
+//
+//  FloorTable.swift
+//  DeepMapTestIOS
+//
+//  Created by agent on 18.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+import Foundation
+import HDMMapCore
+
+/// Axis-aligned bounds of the features on one floor, in the locator's API CRS.
+struct FloorBounds {
+    var minX: Double
+    var minY: Double
+    var maxX: Double
+    var maxY: Double
+
+    init(coordinate: HDMMapCoordinate) {
+        minX = coordinate.x
+        minY = coordinate.y
+        maxX = coordinate.x
+        maxY = coordinate.y
+    }
+
+    mutating func extend(_ coordinate: HDMMapCoordinate) {
+        minX = min(minX, coordinate.x)
+        minY = min(minY, coordinate.y)
+        maxX = max(maxX, coordinate.x)
+        maxY = max(maxY, coordinate.y)
+    }
+
+    var center: HDMMapCoordinate {
+        return HDMMapCoordinateMake((minX + maxX) / 2, (minY + maxY) / 2, 0)
+    }
+}
+
+/// Metadata of a single floor.
+struct FloorInfo {
+    let level: Float
+    /// ID of the floor feature returned by `HDMLocator.floors`, if the map has one for this level.
+    let floorFeatureId: UInt64?
+    /// All features tagged with this level, ascending.
+    let featureIds: [UInt64]
+}
+
+/// The `HDMLocator` calls a `FloorTable` makes.
+protocol FloorLocator: class {
+    func floors() -> [HDMFeature]
+    func __getFeatures(byIds featureIds: [NSNumber]) -> [HDMFeature]
+    func getLocalizedFloorName(_ floor: Float, withLocale localeStr: String, shortName: Bool) -> String
+    func getLocalizedNumericFloorName(_ floor: Float, withLocale localeStr: String) -> String
+}
+
+extension HDMLocator: FloorLocator {}
+
+/// In-memory table of all floors of a Deep Map database.
+///
+/// Built once per database (see `LocatorQueryExecutor.floorTable(completion:)`), after which
+/// floor lookups and localized floor names no longer touch the database. Names are prepared
+/// for the locales found in the map's `name:*` keys; other locales are resolved on first use
+/// and remembered.
+final class FloorTable {
+
+    private struct NameKey: Hashable {
+        let level: Float
+        let locale: Symbol
+        let style: Int
+
+        var hashValue: Int {
+            return level.hashValue ^ Int(locale.rawValue) << 2 ^ style
+        }
+
+        static func == (lhs: NameKey, rhs: NameKey) -> Bool {
+            return lhs.level == rhs.level && lhs.locale == rhs.locale && lhs.style == rhs.style
+        }
+    }
+
+    private static let longName = 0
+    private static let shortName = 1
+    private static let numericName = 2
+
+    /// Floors ordered by level, ascending.
+    let floors: [FloorInfo]
+    /// Same as `HDMLocator.floors`.
+    let floorFeatures: [HDMFeature]
+
+    private let locator: FloorLocator
+    private let lock = NSLock()
+    private var names: [NameKey: String] = [:]
+    private var boundsByLevel: [Float: FloorBounds?] = [:]
+
+    /// Reads the floors of the database at `path`. Runs queries, so call it off the main thread.
+    convenience init(databasePath path: String, projector: HDMProjector, locales: [String] = []) {
+        self.init(databasePath: path, locator: HDMLocator(withDb: path, projector: projector), locales: locales)
+    }
+
+    init(databasePath path: String, locator: FloorLocator, locales: [String] = []) {
+        let floorFeatures = locator.floors()
+
+        var idsByLevel: [Float: [UInt64]] = [:]
+        var localesInMap = Set(locales)
+        if let reader = try? SQLiteReader(path: path) {
+            _ = try? reader.query("SELECT object_id, value FROM tags WHERE key = 'level' ORDER BY object_id") { row, _ in
+                if let value = row.string(at: 1), let level = Float(value) {
+                    idsByLevel[level, default: []].append(UInt64(bitPattern: row.int64(at: 0)))
+                }
+                return true
+            }
+            _ = try? reader.query("SELECT DISTINCT key FROM tags WHERE key LIKE 'name:%'") { row, _ in
+                if let key = row.string(at: 0) {
+                    localesInMap.insert(String(key.dropFirst("name:".count)))
+                }
+                return true
+            }
+        }
+
+        var floorFeatureIds: [Float: UInt64] = [:]
+        for feature in floorFeatures {
+            if let value = feature.attributes["level"] as? String, let level = Float(value) {
+                floorFeatureIds[level] = feature.featureId
+                if idsByLevel[level] == nil {
+                    idsByLevel[level] = []
+                }
+            }
+        }
+
+        floors = idsByLevel.keys.sorted().map { level in
+            FloorInfo(level: level, floorFeatureId: floorFeatureIds[level], featureIds: idsByLevel[level]!)
+        }
+        self.locator = locator
+        self.floorFeatures = floorFeatures
+
+        for locale in localesInMap {
+            for floor in floors {
+                _ = localizedFloorName(floor.level, locale: locale, shortName: false)
+                _ = localizedFloorName(floor.level, locale: locale, shortName: true)
+                _ = localizedNumericFloorName(floor.level, locale: locale)
+            }
+        }
+    }
+
+    /// Same as `HDMLocator.getMinimumLevel`.
+    var minimumLevel: Float {
+        return floors.first?.level ?? 0
+    }
+
+    /// Same as `HDMLocator.getMaximumLevel`.
+    var maximumLevel: Float {
+        return floors.last?.level ?? 0
+    }
+
+    func floor(at level: Float) -> FloorInfo? {
+        var low = 0
+        var high = floors.count
+        while low < high {
+            let mid = (low + high) / 2
+            if floors[mid].level < level {
+                low = mid + 1
+            } else {
+                high = mid
+            }
+        }
+        return low < floors.count && floors[low].level == level ? floors[low] : nil
+    }
+
+    /// Bounds of the feature locations on a floor, nil for unknown or empty floors.
+    ///
+    /// Every feature of the floor is materialized to read its location, so bounds are only
+    /// computed for floors that are asked for, and then kept.
+    func bounds(at level: Float) -> FloorBounds? {
+        lock.lock()
+        defer { lock.unlock() }
+        if let cached = boundsByLevel[level] {
+            return cached
+        }
+        var floorBounds: FloorBounds?
+        for feature in locator.__getFeatures(byIds: (floor(at: level)?.featureIds ?? []).map { NSNumber(value: $0) }) {
+            let coordinate = feature.location.coordinate
+            if floorBounds == nil {
+                floorBounds = FloorBounds(coordinate: coordinate)
+            } else {
+                floorBounds!.extend(coordinate)
+            }
+        }
+        boundsByLevel[level] = .some(floorBounds)
+        return floorBounds
+    }
+
+    /// Same as `HDMLocator.getLocalizedFloorName:withLocale:shortName:`.
+    func localizedFloorName(_ level: Float, locale: String, shortName: Bool) -> String {
+        let style = shortName ? FloorTable.shortName : FloorTable.longName
+        return name(NameKey(level: level, locale: Symbol(locale), style: style)) {
+            $0.getLocalizedFloorName(level, withLocale: locale, shortName: shortName)
+        }
+    }
+
+    /// Same as `HDMLocator.getLocalizedNumericFloorName:withLocale:`.
+    func localizedNumericFloorName(_ level: Float, locale: String) -> String {
+        return name(NameKey(level: level, locale: Symbol(locale), style: FloorTable.numericName)) {
+            $0.getLocalizedNumericFloorName(level, withLocale: locale)
+        }
+    }
+
+    private func name(_ key: NameKey, resolve: (FloorLocator) -> String) -> String {
+        lock.lock()
+        defer { lock.unlock() }
+        if let name = names[key] {
+            return name
+        }
+        let name = resolve(locator)
+        names[key] = name
+        return name
+    }
+}
@@ -0,0 +1,257 @@
+//
+//  FrameScheduler.swift
+//  DeepMapTestIOS
+//
+//  Created by agent on 18.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+import GLKit
+import UIKit.UIGestureRecognizerSubclass
+import HDMMapCore
+
+/// What made the map need a new frame.
+enum FrameReason: Int {
+    case camera
+    case animation
+    case annotation
+    case style
+    case location
+    case interaction
+    case request
+
+    static let count = 7
+}
+
+/// Lets the map's GL render loop run only while something changes.
+///
+/// The map view redraws from a `GLKViewController` at display rate whether or not anything
+/// moved. The scheduler pauses that loop once the map has been static for `idleDelay`, and
+/// resumes it, capped at the display's maximum rate, when a frame is requested: camera
+/// changes, annotation moves, style or selection changes, location updates and touches on
+/// the map (tracked without interfering with the map's own gestures). Animations keep the
+/// loop running for their duration. While paused the scheduler's own display link is
+/// stopped as well, so an idle map costs no CPU or GPU time.
+///
+/// The engine does not report when it has finished changing on its own: after a camera move,
+/// a style reload or the start of a map it streams in cells and fades labels over the next
+/// frames. Those requests (`.camera`, `.style`, `.request`) therefore keep the loop running
+/// for `settleDelay` instead. Engine camera animations are covered by `animate(for:)`, which
+/// callers of the map's `animated:` methods must use, and by the camera delegate calls the
+/// engine makes on every animated frame; user tracking moves the camera on location updates.
+///
+/// If the map view has no `GLKViewController` the loop cannot be paused and the scheduler
+/// only counts requests. Use from the main thread.
+final class FrameScheduler: NSObject {
+
+    private(set) weak var controller: HDMMapViewController?
+    /// Current time, in the timebase of `CADisplayLink` timestamps.
+    var clock: () -> CFTimeInterval = { CACurrentMediaTime() }
+    /// Time the loop keeps running after the last request, for inertia and fades.
+    var idleDelay: TimeInterval = 0.5
+    /// Time the loop keeps running after requests the engine keeps working on unreported.
+    var settleDelay: TimeInterval = 2
+    /// Called when the loop is paused (true) or resumed (false).
+    var idleDidChange: ((Bool) -> Void)?
+
+    private(set) var isIdle = false
+    private(set) var requests = [Int](repeating: 0, count: FrameReason.count)
+    /// Number of times the loop was paused.
+    private(set) var idleTransitions = 0
+
+    private weak var renderLoop: GLKViewController?
+    private var displayLink: CADisplayLink?
+    private var activeUntil: CFTimeInterval = 0
+    private var interactions = 0
+    private var touchObserver: TouchObserver?
+
+    init(controller: HDMMapViewController) {
+        self.controller = controller
+        super.init()
+    }
+
+    /// Controls `renderLoop` directly, without display link or touch observer; for tests.
+    init(renderLoop: GLKViewController) {
+        self.renderLoop = renderLoop
+        super.init()
+    }
+
+    deinit {
+        displayLink?.invalidate()
+    }
+
+    /// Whether the map's render loop was found and is controlled.
+    var isControllingRenderLoop: Bool {
+        return renderLoop != nil
+    }
+
+    /// Takes over the render loop of the map view; call once the map has started.
+    func start() {
+        guard let controller = controller, displayLink == nil else { return }
+        renderLoop = FrameScheduler.findRenderLoop(in: controller)
+        renderLoop?.preferredFramesPerSecond = UIScreen.main.maximumFramesPerSecond
+
+        let observer = TouchObserver(scheduler: self)
+        controller.mapView.addGestureRecognizer(observer)
+        touchObserver = observer
+
+        let link = CADisplayLink(target: WeakTarget(self), selector: #selector(WeakTarget.tick(_:)))
+        link.add(to: .main, forMode: .commonModes)
+        displayLink = link
+        requestFrame(.request)
+    }
+
+    func stop() {
+        displayLink?.invalidate()
+        displayLink = nil
+        if let observer = touchObserver {
+            observer.view?.removeGestureRecognizer(observer)
+        }
+        touchObserver = nil
+        renderLoop?.isPaused = false
+        isIdle = false
+    }
+
+    /// Asks for the map to be redrawn soon.
+    func requestFrame(_ reason: FrameReason = .request) {
+        requests[reason.rawValue] += 1
+        switch reason {
+        case .camera, .style, .request:
+            activeUntil = max(activeUntil, clock() + settleDelay)
+        default:
+            activeUntil = max(activeUntil, clock() + idleDelay)
+        }
+        wake()
+    }
+
+    /// Keeps the map drawing for an animation of `duration` seconds.
+    func animate(for duration: TimeInterval) {
+        requests[FrameReason.animation.rawValue] += 1
+        activeUntil = max(activeUntil, clock() + duration + idleDelay)
+        wake()
+    }
+
+    /// Keeps the map drawing until the matching `endInteraction()`.
+    func beginInteraction() {
+        interactions += 1
+        requestFrame(.interaction)
+    }
+
+    func endInteraction() {
+        interactions = max(0, interactions - 1)
+        requestFrame(.interaction)
+    }
+
+    // MARK: - Loop
+
+    private func wake() {
+        displayLink?.isPaused = false
+        if isIdle {
+            isIdle = false
+            renderLoop?.isPaused = false
+            idleDidChange?(false)
+        }
+    }
+
+    fileprivate func tick(_ link: CADisplayLink) {
+        if step(at: link.timestamp) {
+            link.isPaused = true
+        }
+    }
+
+    /// Pauses the render loop if nothing kept it running until `time`.
+    ///
+    /// - returns: Whether the scheduler's display link can stop.
+    @discardableResult
+    func step(at time: CFTimeInterval) -> Bool {
+        guard interactions == 0 && time >= activeUntil else { return false }
+        guard let renderLoop = renderLoop, !isIdle else { return true }
+        renderLoop.isPaused = true
+        isIdle = true
+        idleTransitions += 1
+        idleDidChange?(true)
+        return true
+    }
+
+    private static func findRenderLoop(in controller: UIViewController) -> GLKViewController? {
+        for child in controller.childViewControllers {
+            if let loop = child as? GLKViewController ?? findRenderLoop(in: child) {
+                return loop
+            }
+        }
+        return nil
+    }
+}
+
+/// Breaks the retain cycle between a display link and its target.
+private final class WeakTarget: NSObject {
+    private weak var scheduler: FrameScheduler?
+
+    init(_ scheduler: FrameScheduler) {
+        self.scheduler = scheduler
+    }
+
+    @objc func tick(_ link: CADisplayLink) {
+        if let scheduler = scheduler {
+            scheduler.tick(link)
+        } else {
+            link.invalidate()
+        }
+    }
+}
+
+/// Observes touches on the map without recognizing anything itself.
+private final class TouchObserver: UIGestureRecognizer {
+    private weak var scheduler: FrameScheduler?
+    private var touching = false
+
+    init(scheduler: FrameScheduler) {
+        self.scheduler = scheduler
+        super.init(target: nil, action: nil)
+        cancelsTouchesInView = false
+        delaysTouchesBegan = false
+        delaysTouchesEnded = false
+    }
+
+    override func canPrevent(_ preventedGestureRecognizer: UIGestureRecognizer) -> Bool {
+        return false
+    }
+
+    override func canBePrevented(by preventingGestureRecognizer: UIGestureRecognizer) -> Bool {
+        return false
+    }
+
+    override func touchesBegan(_ touches: Set<UITouch>, with event: UIEvent) {
+        if !touching {
+            touching = true
+            scheduler?.beginInteraction()
+        }
+    }
+
+    override func touchesMoved(_ touches: Set<UITouch>, with event: UIEvent) {
+        scheduler?.requestFrame(.interaction)
+    }
+
+    override func touchesEnded(_ touches: Set<UITouch>, with event: UIEvent) {
+        finishIfNeeded(event)
+    }
+
+    override func touchesCancelled(_ touches: Set<UITouch>, with event: UIEvent) {
+        finishIfNeeded(event)
+    }
+
+    override func reset() {
+        if touching {
+            touching = false
+            scheduler?.endInteraction()
+        }
+    }
+
+    private func finishIfNeeded(_ event: UIEvent) {
+        let active = event.allTouches?.filter { $0.phase != .ended && $0.phase != .cancelled } ?? []
+        if active.isEmpty {
+            reset()
+            state = .failed
+        }
+    }
+}
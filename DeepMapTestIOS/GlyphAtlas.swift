@@ -0,0 +1,428 @@
+//
+//  GlyphAtlas.swift
+//  DeepMapTestIOS
+//
+//  Created by agent on 18.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+import Foundation
+import CoreText
+import Compression
+
+/// Where a glyph's distance field lies in a `GlyphAtlas`, in pixels at the atlas' `fontSize`.
+struct GlyphMetrics {
+    let glyph: CGGlyph
+    /// Top left corner and size of the field in the atlas; zero-sized for blank glyphs.
+    let x, y, width, height: UInt16
+    /// Offset of the field's bottom left corner from the pen position, y up.
+    let left, bottom: Float
+}
+
+/// A glyph of a label as a textured quad.
+struct GlyphQuad {
+    /// Corners relative to the label's baseline origin, in pixels, y down.
+    let minX, minY, maxX, maxY: Float
+    /// Texture coordinates in the atlas, 0...1.
+    let u0, v0, u1, v1: Float
+}
+
+/// Signed distance fields of a font's glyphs, packed into one 8-bit texture.
+///
+/// Every glyph is rasterized once at `fontSize` and stored as its distance to the outline:
+/// 128 on the outline, growing inside, reaching 0 and 255 `spread` pixels away. Thresholding
+/// the bilinearly filtered field draws sharp text at any size, so labels are never
+/// rasterized again when zooming. Atlases cover the glyphs of a package's label strings;
+/// they are built offline by `GlyphAtlasBuilder` and read from `glyphs.sdf` next to the
+/// font. The bundled package ships none, so text is measured from the font alone.
+final class GlyphAtlas {
+
+    enum FileError: Error {
+        case format
+        case compression
+    }
+
+    static let fileName = "glyphs.sdf"
+    private static let magic: UInt32 = 0x41464453 // "SDFA"
+    private static let version: UInt32 = 1
+
+    /// PostScript name of the font the glyph IDs belong to.
+    let fontName: String
+    let fontSize: Float
+    let spread: Float
+    let width: Int
+    let height: Int
+    /// Distance values, rows top to bottom.
+    let pixels: [UInt8]
+    private let metrics: [CGGlyph: GlyphMetrics]
+
+    init(fontName: String, fontSize: Float, spread: Float, width: Int, height: Int, pixels: [UInt8], glyphs: [GlyphMetrics]) {
+        precondition(pixels.count == width * height, "pixel count does not match size")
+        self.fontName = fontName
+        self.fontSize = fontSize
+        self.spread = spread
+        self.width = width
+        self.height = height
+        self.pixels = pixels
+        var metrics: [CGGlyph: GlyphMetrics] = [:]
+        for glyph in glyphs {
+            metrics[glyph.glyph] = glyph
+        }
+        self.metrics = metrics
+    }
+
+    var glyphCount: Int {
+        return metrics.count
+    }
+
+    func metrics(for glyph: CGGlyph) -> GlyphMetrics? {
+        return metrics[glyph]
+    }
+
+    /// Path of the atlas shipped with the font at `fontPath`.
+    static func path(besideFont fontPath: String) -> String {
+        return ((fontPath as NSString).deletingLastPathComponent as NSString).appendingPathComponent(fileName)
+    }
+
+    /// Quads for the glyphs of `text` drawn at `size` pixels; glyphs missing from the atlas
+    /// are left out.
+    func quads(for text: ShapedText, size: Float) -> [GlyphQuad] {
+        let scale = size / fontSize
+        let shapeScale = fontSize / text.fontSize
+        var quads: [GlyphQuad] = []
+        quads.reserveCapacity(text.glyphs.count)
+        for glyph in text.glyphs {
+            guard let metrics = metrics[glyph.glyph], metrics.width > 0 else { continue }
+            let left = (glyph.x * shapeScale + metrics.left) * scale
+            let bottom = (glyph.y * shapeScale + metrics.bottom) * scale
+            quads.append(GlyphQuad(minX: left, minY: -(bottom + Float(metrics.height) * scale),
+                                   maxX: left + Float(metrics.width) * scale, maxY: -bottom,
+                                   u0: Float(metrics.x) / Float(width), v0: Float(metrics.y) / Float(height),
+                                   u1: Float(Int(metrics.x) + Int(metrics.width)) / Float(width),
+                                   v1: Float(Int(metrics.y) + Int(metrics.height)) / Float(height)))
+        }
+        return quads
+    }
+
+    // MARK: - File
+
+    /// The atlas in its file format: a little-endian header, the glyph table and the
+    /// LZFSE-compressed pixels.
+    func data() -> Data {
+        var bytes: [UInt8] = []
+        GlyphAtlas.append(GlyphAtlas.magic, to: &bytes)
+        GlyphAtlas.append(GlyphAtlas.version, to: &bytes)
+        GlyphAtlas.append(UInt32(width), to: &bytes)
+        GlyphAtlas.append(UInt32(height), to: &bytes)
+        GlyphAtlas.append(fontSize.bitPattern, to: &bytes)
+        GlyphAtlas.append(spread.bitPattern, to: &bytes)
+        let name = Array(fontName.utf8)
+        GlyphAtlas.append(UInt32(name.count), to: &bytes)
+        bytes += name
+
+        GlyphAtlas.append(UInt32(metrics.count), to: &bytes)
+        for glyph in metrics.values.sorted(by: { $0.glyph < $1.glyph }) {
+            for value in [glyph.glyph, glyph.x, glyph.y, glyph.width, glyph.height] {
+                bytes += [UInt8(value & 0xFF), UInt8(value >> 8)]
+            }
+            GlyphAtlas.append(glyph.left.bitPattern, to: &bytes)
+            GlyphAtlas.append(glyph.bottom.bitPattern, to: &bytes)
+        }
+
+        let capacity = pixels.count + 1024
+        var compressed = [UInt8](repeating: 0, count: capacity)
+        let count = compression_encode_buffer(&compressed, capacity, pixels, pixels.count, nil, COMPRESSION_LZFSE)
+        // 1 if compressed, 0 if stored as is
+        if count > 0 {
+            GlyphAtlas.append(1, to: &bytes)
+            GlyphAtlas.append(UInt32(count), to: &bytes)
+            bytes += compressed[0..<count]
+        } else {
+            GlyphAtlas.append(0, to: &bytes)
+            GlyphAtlas.append(UInt32(pixels.count), to: &bytes)
+            bytes += pixels
+        }
+        return Data(bytes)
+    }
+
+    convenience init(data: Data) throws {
+        var reader = ByteReader(bytes: [UInt8](data))
+        guard try reader.u32() == GlyphAtlas.magic, try reader.u32() == GlyphAtlas.version else { throw FileError.format }
+        let width = Int(try reader.u32()), height = Int(try reader.u32())
+        let fontSize = Float(bitPattern: try reader.u32()), spread = Float(bitPattern: try reader.u32())
+        let nameLength = Int(try reader.u32())
+        guard let fontName = String(bytes: try reader.bytes(nameLength), encoding: .utf8) else { throw FileError.format }
+
+        let glyphCount = Int(try reader.u32())
+        var glyphs: [GlyphMetrics] = []
+        glyphs.reserveCapacity(glyphCount)
+        for _ in 0..<glyphCount {
+            glyphs.append(GlyphMetrics(glyph: try reader.u16(), x: try reader.u16(), y: try reader.u16(),
+                                       width: try reader.u16(), height: try reader.u16(),
+                                       left: Float(bitPattern: try reader.u32()), bottom: Float(bitPattern: try reader.u32())))
+        }
+
+        let compressed = try reader.u32() != 0
+        let length = Int(try reader.u32())
+        let stored = try reader.bytes(length)
+        var pixels: [UInt8]
+        if !compressed {
+            guard length == width * height else { throw FileError.format }
+            pixels = Array(stored)
+        } else {
+            let capacity = width * height
+            pixels = [UInt8](repeating: 0, count: capacity)
+            let count = Array(stored).withUnsafeBufferPointer { source in
+                compression_decode_buffer(&pixels, capacity, source.baseAddress!, length, nil, COMPRESSION_LZFSE)
+            }
+            guard count == capacity else { throw FileError.compression }
+        }
+        self.init(fontName: fontName, fontSize: fontSize, spread: spread, width: width, height: height, pixels: pixels, glyphs: glyphs)
+    }
+
+    convenience init(contentsOfFile path: String) throws {
+        try self.init(data: try Data(contentsOf: URL(fileURLWithPath: path), options: .alwaysMapped))
+    }
+
+    private static func append(_ value: UInt32, to bytes: inout [UInt8]) {
+        bytes += [UInt8(value & 0xFF), UInt8(value >> 8 & 0xFF), UInt8(value >> 16 & 0xFF), UInt8(value >> 24)]
+    }
+
+    private struct ByteReader {
+        let buffer: [UInt8]
+        var offset = 0
+
+        init(bytes: [UInt8]) {
+            buffer = bytes
+        }
+
+        mutating func bytes(_ count: Int) throws -> ArraySlice<UInt8> {
+            guard count >= 0 && offset + count <= buffer.count else { throw FileError.format }
+            defer { offset += count }
+            return buffer[offset..<offset + count]
+        }
+
+        mutating func u16() throws -> UInt16 {
+            let slice = try bytes(2)
+            return UInt16(slice[slice.startIndex]) | UInt16(slice[slice.startIndex + 1]) << 8
+        }
+
+        mutating func u32() throws -> UInt32 {
+            let slice = try bytes(4)
+            return slice.reversed().reduce(0) { $0 << 8 | UInt32($1) }
+        }
+    }
+}
+
+/// Builds a `GlyphAtlas` for the label strings of a map package. Run offline; building
+/// rasterizes every glyph and is far too slow for app start.
+final class GlyphAtlasBuilder {
+
+    let font: CTFont
+    /// Distance in pixels at which the field saturates; also the margin around each glyph.
+    let spread: Float
+    var atlasWidth = 1024
+
+    init(font: CTFont, spread: Float = 6) {
+        self.font = font
+        self.spread = spread
+    }
+
+    /// Loads the font file of a map package, e.g. `DejaVuSans.ttf`.
+    convenience init?(fontPath: String, fontSize: CGFloat = 32, spread: Float = 6) {
+        guard let provider = CGDataProvider(url: URL(fileURLWithPath: fontPath) as CFURL),
+            let graphicsFont = CGFont(provider) else { return nil }
+        self.init(font: CTFontCreateWithGraphicsFont(graphicsFont, fontSize, nil, nil), spread: spread)
+    }
+
+    /// All distinct values of `maplabel`, `name` and their localized variants.
+    static func labelStrings(in store: FeatureTagStore) -> [String] {
+        let keys = store.keySymbols.enumerated().filter { _, symbol in
+            let key = symbol.string
+            return key == "name" || key == "maplabel" || key.hasPrefix("name:") || key.hasPrefix("maplabel:")
+        }.map { AttributeKey(rawValue: UInt32($0.offset)) }
+        var strings = Set<String>()
+        for row in 0..<store.count {
+            let view = FeatureView(store: store, row: row)
+            for key in keys {
+                if let value = view.value(for: key) {
+                    strings.insert(value)
+                }
+            }
+        }
+        return strings.sorted()
+    }
+
+    /// Rasterizes the glyphs needed to shape `strings` with the builder's font.
+    func build(strings: [String]) -> GlyphAtlas {
+        var glyphs = Set<CGGlyph>()
+        for string in Set(strings) {
+            for glyph in ShapedTextCache.shape(string, font: font).glyphs {
+                glyphs.insert(glyph.glyph)
+            }
+        }
+        return build(glyphs: glyphs.sorted())
+    }
+
+    func build(glyphs: [CGGlyph]) -> GlyphAtlas {
+        let margin = Int(spread.rounded(.up))
+        var fields: [(glyph: CGGlyph, width: Int, height: Int, left: Float, bottom: Float, pixels: [UInt8])] = []
+        for glyph in glyphs {
+            var glyph = glyph
+            var rect = CGRect.zero
+            CTFontGetBoundingRectsForGlyphs(font, .horizontal, &glyph, &rect, 1)
+            guard rect.width > 0 && rect.height > 0 else {
+                fields.append((glyph, 0, 0, 0, 0, []))
+                continue
+            }
+            let originX = Int(rect.minX.rounded(.down)), originY = Int(rect.minY.rounded(.down))
+            let width = Int(rect.maxX.rounded(.up)) - originX + 2 * margin
+            let height = Int(rect.maxY.rounded(.up)) - originY + 2 * margin
+            let coverage = rasterize(glyph, width: width, height: height,
+                                     origin: CGPoint(x: margin - originX, y: margin - originY))
+            fields.append((glyph, width, height, Float(originX - margin), Float(originY - margin),
+                           SignedDistanceField.make(coverage: coverage, width: width, height: height, spread: spread)))
+        }
+
+        let packing = ShelfPacker.pack(fields.map { ($0.width, $0.height) }, width: atlasWidth)
+        var height = 1
+        while height < packing.height {
+            height <<= 1
+        }
+        var pixels = [UInt8](repeating: 0, count: atlasWidth * height)
+        var metrics: [GlyphMetrics] = []
+        for (field, position) in zip(fields, packing.positions) {
+            for row in 0..<field.height {
+                let target = (position.y + row) * atlasWidth + position.x
+                pixels.replaceSubrange(target..<target + field.width, with: field.pixels[row * field.width..<(row + 1) * field.width])
+            }
+            metrics.append(GlyphMetrics(glyph: field.glyph, x: UInt16(position.x), y: UInt16(position.y),
+                                        width: UInt16(field.width), height: UInt16(field.height), left: field.left, bottom: field.bottom))
+        }
+        return GlyphAtlas(fontName: CTFontCopyPostScriptName(font) as String, fontSize: Float(CTFontGetSize(font)), spread: spread,
+                          width: atlasWidth, height: height, pixels: pixels, glyphs: metrics)
+    }
+
+    /// Glyph coverage, rows top to bottom.
+    private func rasterize(_ glyph: CGGlyph, width: Int, height: Int, origin: CGPoint) -> [UInt8] {
+        var coverage = [UInt8](repeating: 0, count: width * height)
+        coverage.withUnsafeMutableBytes { buffer in
+            guard let context = CGContext(data: buffer.baseAddress, width: width, height: height, bitsPerComponent: 8,
+                                          bytesPerRow: width, space: CGColorSpaceCreateDeviceGray(),
+                                          bitmapInfo: CGImageAlphaInfo.none.rawValue) else { return }
+            context.setFillColor(gray: 1, alpha: 1)
+            var glyph = glyph
+            var position = origin
+            CTFontDrawGlyphs(font, &glyph, &position, 1, context)
+        }
+        return coverage
+    }
+}
+
+/// Euclidean distance transform of a coverage bitmap, after Felzenszwalb and Huttenlocher.
+enum SignedDistanceField {
+
+    private static let infinity: Float = 1e20
+
+    /// Distance field of `coverage` (rows of 0...255, inside from 128): 128 on the outline,
+    /// 255 at `spread` pixels inside, 0 at `spread` pixels outside.
+    static func make(coverage: [UInt8], width: Int, height: Int, spread: Float) -> [UInt8] {
+        // squared distances to the nearest inside and outside pixel
+        var toInside = coverage.map { $0 >= 128 ? 0 : infinity }
+        var toOutside = coverage.map { $0 >= 128 ? infinity : 0 }
+        transform(&toInside, width: width, height: height)
+        transform(&toOutside, width: width, height: height)
+
+        var field = [UInt8](repeating: 0, count: coverage.count)
+        for index in 0..<coverage.count {
+            // pixel centers are half a pixel off the outline between inside and outside
+            let distance = toInside[index] > 0 ? toInside[index].squareRoot() - 0.5 : 0.5 - toOutside[index].squareRoot()
+            field[index] = UInt8(max(0, min(255, (128 - distance / spread * 127).rounded())))
+        }
+        return field
+    }
+
+    private static func transform(_ grid: inout [Float], width: Int, height: Int) {
+        let count = max(width, height)
+        var line = [Float](repeating: 0, count: count)
+        var distances = [Float](repeating: 0, count: count)
+        var vertices = [Int](repeating: 0, count: count)
+        var boundaries = [Float](repeating: 0, count: count + 1)
+        for x in 0..<width {
+            for y in 0..<height {
+                line[y] = grid[y * width + x]
+            }
+            transform(line, count: height, distances: &distances, vertices: &vertices, boundaries: &boundaries)
+            for y in 0..<height {
+                grid[y * width + x] = distances[y]
+            }
+        }
+        for y in 0..<height {
+            for x in 0..<width {
+                line[x] = grid[y * width + x]
+            }
+            transform(line, count: width, distances: &distances, vertices: &vertices, boundaries: &boundaries)
+            for x in 0..<width {
+                grid[y * width + x] = distances[x]
+            }
+        }
+    }
+
+    /// 1D transform: lower envelope of the parabolas rooted at `f`.
+    private static func transform(_ f: [Float], count: Int, distances: inout [Float], vertices: inout [Int], boundaries: inout [Float]) {
+        guard count > 0 else { return }
+        func intersection(_ q: Int, _ r: Int) -> Float {
+            return ((f[q] + Float(q * q)) - (f[r] + Float(r * r))) / Float(2 * (q - r))
+        }
+        var k = 0
+        vertices[0] = 0
+        boundaries[0] = -infinity
+        boundaries[1] = infinity
+        for q in 1..<count {
+            var s = intersection(q, vertices[k])
+            while s <= boundaries[k] {
+                k -= 1
+                s = intersection(q, vertices[k])
+            }
+            k += 1
+            vertices[k] = q
+            boundaries[k] = s
+            boundaries[k + 1] = infinity
+        }
+        k = 0
+        for q in 0..<count {
+            while boundaries[k + 1] < Float(q) {
+                k += 1
+            }
+            let offset = q - vertices[k]
+            distances[q] = Float(offset * offset) + f[vertices[k]]
+        }
+    }
+}
+
+/// Packs rectangles into rows of a fixed width, tallest first.
+enum ShelfPacker {
+
+    /// Top left corners in input order and the total height used. Zero-sized rectangles
+    /// are placed at the origin; rectangles wider than `width` are not supported.
+    static func pack(_ sizes: [(width: Int, height: Int)], width: Int, padding: Int = 1) -> (positions: [(x: Int, y: Int)], height: Int) {
+        var positions = [(x: Int, y: Int)](repeating: (0, 0), count: sizes.count)
+        let order = sizes.indices.filter { sizes[$0].width > 0 && sizes[$0].height > 0 }.sorted { lhs, rhs in
+            sizes[lhs].height != sizes[rhs].height ? sizes[lhs].height > sizes[rhs].height : lhs < rhs
+        }
+        var x = 0, y = 0, shelfHeight = 0
+        for index in order {
+            let size = sizes[index]
+            precondition(size.width <= width, "rectangle wider than the atlas")
+            if x + size.width > width {
+                y += shelfHeight + padding
+                x = 0
+                shelfHeight = 0
+            }
+            positions[index] = (x, y)
+            x += size.width + padding
+            shelfHeight = max(shelfHeight, size.height)
+        }
+        return (positions, y + shelfHeight)
+    }
+}
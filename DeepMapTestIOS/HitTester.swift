@@ -0,0 +1,232 @@
+//
+//  HitTester.swift
+//  DeepMapTestIOS
+//
+//  Created by agent on 18.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+import Foundation
+import HDMMapCore
+
+/// Something under a touch.
+struct MapHit {
+
+    enum Target {
+        case pin(Int)
+        case feature(UInt64, Symbol)
+    }
+
+    let target: Target
+    /// Meters from the touch to the geometry; 0 inside polygons.
+    let distance: Double
+    /// Area of a hit polygon, in square meters.
+    let area: Double
+
+    var featureId: UInt64? {
+        if case .feature(let featureId, _) = target {
+            return featureId
+        }
+        return nil
+    }
+
+    var pin: Int? {
+        if case .pin(let id) = target {
+            return id
+        }
+        return nil
+    }
+}
+
+/// Counters of the hit tests of a `HitTester`.
+struct HitTestStatistics: CustomStringConvertible {
+    var queries = 0
+    /// Features whose bounds matched and were tested precisely.
+    var candidates = 0
+    var lastTime: TimeInterval = 0
+    var maximumTime: TimeInterval = 0
+    var totalTime: TimeInterval = 0
+
+    var description: String {
+        return String(format: "%d hit tests, %d candidates, last %.3f ms, average %.3f ms, max %.3f ms", queries, candidates,
+                      lastTime * 1000, queries > 0 ? totalTime / Double(queries) * 1000 : 0, maximumTime * 1000)
+    }
+}
+
+/// Resolves taps and long presses to the pins and features under the finger.
+///
+/// Features are kept in a `BoundingVolumeHierarchy` per floor, so a touch tests only the few
+/// features whose bounds are near it, whatever the venue's size; those are then tested
+/// precisely: points by distance, lines by distance to their segments widened by their
+/// `line-width`, polygons by containment. Types the style sheet hides or does not mark
+/// `floor-selectable: true` are never hit. Results are ordered pins first, then points,
+/// lines and polygons, nearest or smallest first, so a room wins over its building.
+final class HitTester {
+
+    /// Pins tested before features.
+    var annotations: AnnotationClusterer?
+    /// Touch radius in pixels, used by `hitTest(at:level:camera:)`.
+    var touchRadius = 22.0
+
+    let sheet: StyleSheet?
+    private(set) var statistics = HitTestStatistics()
+
+    private let projection: UTMProjection
+    private var trees: [Float: BoundingVolumeHierarchy] = [:]
+    private var primitives: [Float: [UInt64: [RenderPrimitive]]] = [:]
+    /// Whether a type can be hit and the half width of its lines, per type.
+    private var typeInfo: [Symbol: (selectable: Bool, halfWidth: Double)] = [:]
+
+    init(primitives: [RenderPrimitive] = [], sheet: StyleSheet? = nil, projection: UTMProjection = .zone32N) {
+        self.sheet = sheet
+        self.projection = projection
+        var boxes: [Float: [UInt64: RenderBounds]] = [:]
+        for primitive in primitives {
+            self.primitives[primitive.level, default: [:]][primitive.featureId, default: []].append(primitive)
+            boxes[primitive.level, default: [:]][primitive.featureId, default: .empty].formUnion(bounds(of: primitive))
+        }
+        for (level, features) in boxes {
+            trees[level] = BoundingVolumeHierarchy(features.map { ($0.key, $0.value) })
+        }
+    }
+
+    /// Adds a primitive to its feature.
+    func insert(_ primitive: RenderPrimitive) {
+        var parts = primitives[primitive.level, default: [:]][primitive.featureId] ?? []
+        parts.append(primitive)
+        primitives[primitive.level, default: [:]][primitive.featureId] = parts
+        var bounds = RenderBounds.empty
+        parts.forEach { bounds.formUnion(self.bounds(of: $0)) }
+        let tree = trees[primitive.level] ?? BoundingVolumeHierarchy()
+        trees[primitive.level] = tree
+        tree.insert(primitive.featureId, bounds: bounds)
+    }
+
+    func remove(_ featureId: UInt64, level: Float) {
+        primitives[level]?.removeValue(forKey: featureId)
+        trees[level]?.remove(featureId)
+    }
+
+    /// Hits within `touchRadius` pixels of `coordinate` as seen from `camera`.
+    func hitTest(at coordinate: HDMMapCoordinate, level: Float, camera: RenderCamera) -> [MapHit] {
+        let metersPerPixel = camera.distance / camera.basis.focalLength
+        return hitTest(at: projection.project(coordinate), level: level, radius: touchRadius * metersPerPixel)
+    }
+
+    /// Hits within `radius` meters of `point` on floor `level`.
+    func hitTest(at point: RenderPoint, level: Float, radius: Double) -> [MapHit] {
+        let start = Date()
+        var hits: [MapHit] = []
+        var candidates = 0
+
+        for (id, distance) in annotations?.pins(near: point, radius: radius, level: level) ?? [] {
+            hits.append(MapHit(target: .pin(id), distance: distance, area: 0))
+        }
+
+        if let tree = trees[level], let features = primitives[level] {
+            let query = RenderBounds(minX: point.x - radius, minY: point.y - radius, minZ: -.infinity,
+                                     maxX: point.x + radius, maxY: point.y + radius, maxZ: .infinity)
+            var featureHits: [(rank: Int, hit: MapHit)] = []
+            tree.forEach(intersecting: query) { featureId in
+                candidates += 1
+                var best: (rank: Int, hit: MapHit)?
+                for primitive in features[featureId] ?? [] {
+                    guard let hit = self.hit(primitive, at: point, radius: radius) else { continue }
+                    if best.map({ hit.rank < $0.rank || hit.rank == $0.rank && hit.hit.distance < $0.hit.distance }) ?? true {
+                        best = hit
+                    }
+                }
+                if let best = best {
+                    featureHits.append(best)
+                }
+            }
+            featureHits.sort {
+                if $0.rank != $1.rank {
+                    return $0.rank < $1.rank
+                }
+                return $0.rank == 2 ? $0.hit.area < $1.hit.area : $0.hit.distance < $1.hit.distance
+            }
+            hits += featureHits.map { $0.hit }
+        }
+
+        let time = Date().timeIntervalSince(start)
+        statistics.queries += 1
+        statistics.candidates += candidates
+        statistics.lastTime = time
+        statistics.totalTime += time
+        statistics.maximumTime = max(statistics.maximumTime, time)
+        return hits
+    }
+
+    /// The hit of one primitive and its rank: 0 points, 1 lines, 2 polygons.
+    private func hit(_ primitive: RenderPrimitive, at point: RenderPoint, radius: Double) -> (rank: Int, hit: MapHit)? {
+        let info = self.info(for: primitive.type)
+        guard info.selectable else { return nil }
+        let target = MapHit.Target.feature(primitive.featureId, primitive.type)
+        switch primitive.geometry {
+        case .point(let location):
+            let distance = HitTester.distance(point, location)
+            return distance <= radius ? (0, MapHit(target: target, distance: distance, area: 0)) : nil
+        case .line(let points):
+            var distance = Double.infinity
+            for index in 1..<max(points.count, 1) {
+                distance = min(distance, HitTester.distance(point, points[index - 1], points[index]))
+            }
+            if points.count == 1 {
+                distance = HitTester.distance(point, points[0])
+            }
+            return distance <= radius + info.halfWidth ? (1, MapHit(target: target, distance: distance, area: 0)) : nil
+        case .polygon(let rings):
+            guard FloorSlab.contains(rings, x: point.x, y: point.y) else { return nil }
+            return (2, MapHit(target: target, distance: 0, area: HitTester.area(rings.first ?? [])))
+        }
+    }
+
+    private func info(for type: Symbol) -> (selectable: Bool, halfWidth: Double) {
+        if let info = typeInfo[type] {
+            return info
+        }
+        var info = (selectable: true, halfWidth: 0.0)
+        if let sheet = sheet {
+            let style = sheet.style(for: type)
+            info.selectable = style?.string("floor-selectable") == "true" && style?.string("visibility") != "none"
+            // only widths in meters scale with the map; pixel widths are covered by the touch radius
+            if let width = style?.string("line-width"), width.hasSuffix("m"), let meters = Double(String(width.dropLast())) {
+                info.halfWidth = meters / 2
+            }
+        }
+        typeInfo[type] = info
+        return info
+    }
+
+    /// Bounds of `primitive`, widened by the half width of lines.
+    private func bounds(of primitive: RenderPrimitive) -> RenderBounds {
+        let box = primitive.bounds
+        let margin = info(for: primitive.type).halfWidth
+        return RenderBounds(minX: box.0 - margin, minY: box.1 - margin, minZ: 0, maxX: box.2 + margin, maxY: box.3 + margin, maxZ: 0)
+    }
+
+    private static func distance(_ a: RenderPoint, _ b: RenderPoint) -> Double {
+        return ((a.x - b.x) * (a.x - b.x) + (a.y - b.y) * (a.y - b.y)).squareRoot()
+    }
+
+    /// Distance from `point` to the segment from `a` to `b`, in the plane.
+    private static func distance(_ point: RenderPoint, _ a: RenderPoint, _ b: RenderPoint) -> Double {
+        let dx = b.x - a.x, dy = b.y - a.y
+        let lengthSquared = dx * dx + dy * dy
+        guard lengthSquared > 0 else { return distance(point, a) }
+        let t = min(max(((point.x - a.x) * dx + (point.y - a.y) * dy) / lengthSquared, 0), 1)
+        return distance(point, RenderPoint(x: a.x + dx * t, y: a.y + dy * t))
+    }
+
+    private static func area(_ ring: [RenderPoint]) -> Double {
+        guard ring.count >= 3 else { return 0 }
+        var sum = 0.0
+        var previous = ring[ring.count - 1]
+        for point in ring {
+            sum += previous.x * point.y - point.x * previous.y
+            previous = point
+        }
+        return abs(sum) / 2
+    }
+}
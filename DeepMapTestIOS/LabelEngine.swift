@@ -0,0 +1,307 @@
+//
+//  LabelEngine.swift
+//  DeepMapTestIOS
+//
+//  Created by agent on 18.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+import Foundation
+import QuartzCore
+
+/// A text label that may be shown for a feature.
+struct LabelCandidate {
+    let featureId: UInt64
+    let anchor: RenderPoint
+    let text: String
+    /// Font size in pixels, from `text-size`.
+    let size: Float
+    let color: UInt32
+    /// Screen offset of the label center from the anchor, from `label_offsetx`/`label_offsety`.
+    let offset: (x: Float, y: Float)
+    /// Higher priorities are placed first.
+    let priority: Int
+}
+
+/// Screen rectangle, origin top left.
+struct LabelRect {
+    var minX, minY, maxX, maxY: Float
+
+    func intersects(_ other: LabelRect) -> Bool {
+        return minX < other.maxX && other.minX < maxX && minY < other.maxY && other.minY < maxY
+    }
+
+    func offsetBy(x: Float, y: Float) -> LabelRect {
+        return LabelRect(minX: minX + x, minY: minY + y, maxX: maxX + x, maxY: maxY + y)
+    }
+}
+
+/// A label to draw, with its current fade.
+struct PlacedLabel {
+    let candidate: Int
+    let featureId: UInt64
+    let rect: LabelRect
+    let opacity: Float
+}
+
+/// Uniform grid over the screen for label collision tests, cleared for every placement.
+struct LabelCollisionGrid {
+
+    let cellSize: Float
+    private let columns: Int
+    private let rows: Int
+    private var cells: [[LabelRect]]
+
+    init(width: Int, height: Int, cellSize: Float = 64) {
+        self.cellSize = cellSize
+        columns = max(1, Int((Float(width) / cellSize).rounded(.up)))
+        rows = max(1, Int((Float(height) / cellSize).rounded(.up)))
+        cells = [[LabelRect]](repeating: [], count: columns * rows)
+    }
+
+    /// Tests `rect` against the labels in the cells it touches and inserts it if it is free.
+    mutating func insertIfFree(_ rect: LabelRect) -> Bool {
+        let (x0, y0, x1, y1) = range(of: rect)
+        for row in y0...y1 {
+            for column in x0...x1 {
+                for other in cells[row * columns + column] where other.intersects(rect) {
+                    return false
+                }
+            }
+        }
+        for row in y0...y1 {
+            for column in x0...x1 {
+                cells[row * columns + column].append(rect)
+            }
+        }
+        return true
+    }
+
+    private func range(of rect: LabelRect) -> (Int, Int, Int, Int) {
+        return (max(0, min(columns - 1, Int(rect.minX / cellSize))), max(0, min(rows - 1, Int(rect.minY / cellSize))),
+                max(0, min(columns - 1, Int(rect.maxX / cellSize))), max(0, min(rows - 1, Int(rect.maxY / cellSize))))
+    }
+}
+
+/// Places feature labels on screen without overlaps, off the main thread.
+///
+/// Placement projects every candidate, sorts them by priority (labels shown in the previous
+/// placement first, so labels don't flicker between equal candidates) and accepts each one
+/// whose rectangle is free in a `LabelCollisionGrid`, so a test only looks at nearby labels.
+/// It runs on a worker queue; `update(camera:)` returns immediately and the result replaces
+/// the current placement on the main queue, unless a newer camera or candidate list arrived
+/// meanwhile.
+///
+/// A camera that only moved sideways by less than `reuseDistance` pixels, at the same
+/// distance, bearing and tilt, shifts the previous placement instead of placing again.
+/// `labels(at:)` fades labels in and out over `fadeDuration`. Use from the main thread.
+final class LabelEngine {
+
+    /// Width and height of `text` at `size`, in pixels.
+    typealias Measure = (String, Float) -> (width: Float, height: Float)
+
+    private(set) var candidates: [LabelCandidate] = []
+    var fadeDuration: TimeInterval = 0.2
+    var reuseDistance: Float = 48
+    /// Spacing kept around every label, in pixels.
+    var padding: Float = 2
+    var measure: Measure = { text, size in (Float(text.count) * size * 0.55, size * 1.2) }
+    /// Called on the main queue when a new placement has been applied.
+    var didPlace: (() -> Void)?
+
+    /// Counters for instrumentation.
+    private(set) var placements = 0
+    private(set) var reusedPlacements = 0
+    private(set) var lastPlacementTime: TimeInterval = 0
+
+    private let queue = DispatchQueue(label: "LabelEngine.placement", qos: .userInteractive)
+    private var generation = 0
+    private var placedCamera: RenderCamera?
+    private var shown: [Int: LabelRect] = [:]
+    /// Rectangles of labels that are fading out, at their last placed position.
+    private var lastRects: [Int: LabelRect] = [:]
+    private var shift: (x: Float, y: Float) = (0, 0)
+    private var fades: [Int: (opacity: Float, target: Float, time: CFTimeInterval)] = [:]
+    private var sizes: [(width: Float, height: Float)] = []
+
+    init() {
+    }
+
+    /// Replaces the candidates and places them again on the next `update(camera:)`. Labels of
+    /// features that remain candidates keep their fade and are placed first, so a changing
+    /// candidate list, e.g. while panning, does not make the remaining labels flicker.
+    func setCandidates(_ candidates: [LabelCandidate]) {
+        generation += 1
+        var indexOfFeature: [UInt64: Int] = [:]
+        for (index, candidate) in candidates.enumerated() {
+            indexOfFeature[candidate.featureId] = index
+        }
+        let old = self.candidates
+        func carried<Value>(_ values: [Int: Value]) -> [Int: Value] {
+            var result: [Int: Value] = [:]
+            for (index, value) in values {
+                if let newIndex = indexOfFeature[old[index].featureId] {
+                    result[newIndex] = value
+                }
+            }
+            return result
+        }
+        shown = carried(shown)
+        lastRects = carried(lastRects)
+        fades = carried(fades)
+        self.candidates = candidates
+        sizes = candidates.map { measure($0.text, $0.size) }
+        placedCamera = nil
+    }
+
+    /// Places labels for `camera`, reusing the current placement if it moved only slightly.
+    func update(camera: RenderCamera) {
+        if let placed = placedCamera, let delta = LabelEngine.translation(from: placed, to: camera), abs(delta.x) <= reuseDistance && abs(delta.y) <= reuseDistance {
+            // a placement still running was started for a camera further away
+            generation += 1
+            shift = delta
+            reusedPlacements += 1
+            return
+        }
+
+        generation += 1
+        let generation = self.generation
+        let candidates = self.candidates, sizes = self.sizes, padding = self.padding
+        let previous = Set(shown.keys)
+        queue.async { [weak self] in
+            let start = Date()
+            let placed = LabelEngine.place(candidates, sizes: sizes, camera: camera, padding: padding, previous: previous)
+            let duration = Date().timeIntervalSince(start)
+            DispatchQueue.main.async {
+                guard let engine = self, engine.generation == generation else { return }
+                engine.apply(placed, camera: camera, duration: duration)
+            }
+        }
+    }
+
+    /// Labels to draw at `time`, including labels fading out.
+    func labels(at time: CFTimeInterval = CACurrentMediaTime()) -> [PlacedLabel] {
+        var labels: [PlacedLabel] = []
+        for (index, fade) in fades {
+            let step = fadeDuration > 0 ? Float((time - fade.time) / fadeDuration) : 1
+            let opacity = fade.target > fade.opacity ? min(fade.target, fade.opacity + step) : max(fade.target, fade.opacity - step)
+            guard opacity > 0, let rect = shown[index] ?? lastRects[index] else { continue }
+            labels.append(PlacedLabel(candidate: index, featureId: candidates[index].featureId,
+                                      rect: rect.offsetBy(x: shift.x, y: shift.y), opacity: opacity))
+        }
+        return labels
+    }
+
+    /// Whether any label is still fading, i.e. frames are needed.
+    func isAnimating(at time: CFTimeInterval = CACurrentMediaTime()) -> Bool {
+        return fades.values.contains { fade in
+            fade.opacity != fade.target && time - fade.time < fadeDuration
+        }
+    }
+
+    // MARK: - Placement
+
+    private func apply(_ placed: [Int: LabelRect], camera: RenderCamera, duration: TimeInterval) {
+        let now = CACurrentMediaTime()
+        for (index, fade) in fades {
+            // keep the current opacity as the start of the next fade
+            let step = fadeDuration > 0 ? Float((now - fade.time) / fadeDuration) : 1
+            let opacity = fade.target > fade.opacity ? min(fade.target, fade.opacity + step) : max(fade.target, fade.opacity - step)
+            fades[index] = (opacity, placed[index] == nil ? 0 : 1, now)
+            if placed[index] == nil, let rect = shown[index] {
+                lastRects[index] = rect.offsetBy(x: shift.x, y: shift.y)
+            }
+        }
+        for index in placed.keys where fades[index] == nil {
+            fades[index] = (0, 1, now)
+        }
+        for (index, fade) in fades where fade.opacity == 0 && fade.target == 0 {
+            fades[index] = nil
+            lastRects[index] = nil
+        }
+        shown = placed
+        shift = (0, 0)
+        placedCamera = camera
+        placements += 1
+        lastPlacementTime = duration
+        didPlace?()
+    }
+
+    private static func place(_ candidates: [LabelCandidate], sizes: [(width: Float, height: Float)], camera: RenderCamera,
+                              padding: Float, previous: Set<Int>) -> [Int: LabelRect] {
+        let basis = camera.basis
+        var grid = LabelCollisionGrid(width: camera.width, height: camera.height)
+        let width = Float(camera.width), height = Float(camera.height)
+
+        var order: [(index: Int, rect: LabelRect)] = []
+        for (index, candidate) in candidates.enumerated() {
+            guard let screen = basis.project(candidate.anchor) else { continue }
+            let centerX = Float(screen.x) + candidate.offset.x, centerY = Float(screen.y) + candidate.offset.y
+            let size = sizes[index]
+            let rect = LabelRect(minX: centerX - size.width / 2 - padding, minY: centerY - size.height / 2 - padding,
+                                 maxX: centerX + size.width / 2 + padding, maxY: centerY + size.height / 2 + padding)
+            guard rect.minX >= 0 && rect.minY >= 0 && rect.maxX <= width && rect.maxY <= height else { continue }
+            order.append((index, rect))
+        }
+        order.sort { lhs, rhs in
+            let lhsShown = previous.contains(lhs.index), rhsShown = previous.contains(rhs.index)
+            if lhsShown != rhsShown {
+                return lhsShown
+            }
+            let lhsPriority = candidates[lhs.index].priority, rhsPriority = candidates[rhs.index].priority
+            return lhsPriority != rhsPriority ? lhsPriority > rhsPriority : lhs.index < rhs.index
+        }
+
+        var placed: [Int: LabelRect] = [:]
+        for (index, rect) in order where grid.insertIfFree(rect) {
+            placed[index] = rect
+        }
+        return placed
+    }
+
+    /// Screen movement between two cameras that differ only by their center, nil otherwise.
+    private static func translation(from old: RenderCamera, to new: RenderCamera) -> (x: Float, y: Float)? {
+        guard old.width == new.width && old.height == new.height && abs(old.distance - new.distance) < old.distance * 1e-3
+            && abs(old.bearing - new.bearing) < 0.05 && abs(old.tilt - new.tilt) < 0.05 && old.fieldOfView == new.fieldOfView,
+            let before = old.basis.project(new.center), let after = new.basis.project(new.center) else { return nil }
+        return (Float(after.x - before.x), Float(after.y - before.y))
+    }
+}
+
+extension LabelEngine {
+
+    /// Label candidates for feature locations, using `maplabel:<locale>` or else `name:<locale>`
+    /// and the feature type's `text-size`, `text-color` and `text-visibility`.
+    static func candidates(for points: [RenderPrimitive], store: FeatureTagStore, sheet: StyleSheet?,
+                           locale: String) -> [LabelCandidate] {
+        let mapLabel = store.localizedKey("maplabel", locale: locale)
+        let name = store.localizedKey("name", locale: locale)
+        let offsetX = store.key("label_offsetx"), offsetY = store.key("label_offsety")
+        let textSize = sheet?.property("text-size"), textColor = sheet?.property("text-color")
+        let textVisibility = sheet?.property("text-visibility")
+        var styles: [Symbol: (Float, UInt32)?] = [:]
+
+        var candidates: [LabelCandidate] = []
+        for point in points {
+            guard case .point(let anchor) = point.geometry, let view = store.view(forFeature: point.featureId) else { continue }
+            let labelText = view.value(for: mapLabel)
+            guard let text = labelText ?? view.value(for: name), !text.isEmpty else { continue }
+            if styles[point.type] == nil {
+                let style = sheet?.style(for: point.type)
+                if let visibility = textVisibility.flatMap({ style?.string($0) }), visibility == "none" {
+                    styles[point.type] = .some(nil)
+                } else {
+                    styles[point.type] = (Float(textSize.flatMap { style?.number($0) } ?? 12),
+                                          textColor.flatMap { style?.color($0) }?.rgba ?? 0x000000FF)
+                }
+            }
+            guard let style = styles[point.type]! else { continue }
+            let offset = (x: offsetX.flatMap { view.value(for: $0) }.flatMap { Float($0) } ?? 0,
+                          y: offsetY.flatMap { view.value(for: $0) }.flatMap { Float($0) } ?? 0)
+            // explicit map labels win over plain names, then bigger text
+            candidates.append(LabelCandidate(featureId: point.featureId, anchor: anchor, text: text, size: style.0, color: style.1,
+                                             offset: offset, priority: (labelText != nil ? 1000 : 0) + Int(style.0)))
+        }
+        return candidates
+    }
+}
@@ -0,0 +1,117 @@
+//
+//  LocatorGeometry.swift
+//  DeepMapTestIOS
+//
+//  Created by agent on 18.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+import Foundation
+import HDMMapCore
+
+// The parts of the renderer and style code that need the Deep Map framework. Everything else
+// lives in DeepMapRender and builds without it.
+
+extension HDMFeature {
+
+    /// `featureType` as a symbol.
+    var featureTypeSymbol: Symbol? {
+        return featureType.map { Symbol($0) }
+    }
+}
+
+extension HDMMapView {
+
+    func getFeatureTypeSymbol(byId featureId: UInt64) -> Symbol? {
+        return getFeatureType(byId: featureId).map { Symbol($0) }
+    }
+}
+
+extension FeatureTagStore {
+
+    /// Views for the features reported by the map, e.g. in `tappedAtCoordinate:features:`.
+    func views(for features: [HDMFeature]) -> [FeatureView] {
+        return views(forFeatures: features.map { $0.featureId })
+    }
+}
+
+extension FeatureView {
+
+    /// Materializes an `HDMFeature`, for APIs that require one.
+    func makeFeature(location: HDMLocation? = nil) -> HDMFeature {
+        return HDMFeature(id: featureId, location: location, attributes: attributes)
+    }
+}
+
+extension FeatureStyleCache {
+
+    /// Same as `style(forFeature:context:)`, recording the feature's type on first use.
+    func style(for feature: HDMFeature, context: @autoclosure () -> StyleContext) -> ResolvedStyle? {
+        if typeIndex(ofFeature: feature.featureId) < 0, let type = feature.featureTypeSymbol {
+            setFeatureType(type, forFeature: feature.featureId)
+        }
+        return style(forFeature: feature.featureId, context: context())
+    }
+}
+
+extension UTMProjection {
+
+    /// Projects an `HDMMapCoordinate` of a WGS84 API CRS (x longitude, y latitude).
+    func project(_ coordinate: HDMMapCoordinate) -> RenderPoint {
+        return project(longitude: coordinate.x, latitude: coordinate.y, elevation: coordinate.z)
+    }
+}
+
+extension FloorCuller {
+
+    /// A culler stacking floors as far apart as `mapView` draws them.
+    convenience init(primitives: [RenderPrimitive], mapView: HDMMapView) {
+        self.init(primitives: primitives, floorHeight: Double(mapView.minFloorDistance))
+    }
+}
+
+extension RenderCamera {
+
+    /// The camera of a map view, with `lookAt` in a WGS84 API CRS.
+    init(camera: HDMMapCamera, projection: UTMProjection = .zone32N, width: Int, height: Int) {
+        self.init(center: projection.project(camera.lookAt), distance: camera.distance, bearing: camera.bearingAngle,
+                  tilt: camera.tiltAngle, width: width, height: height)
+    }
+}
+
+/// Feature locations as points, e.g. icons and labels, typed by the map's feature types.
+final class FeatureLocationSource: RenderGeometrySource {
+
+    private let pointsByLevel: [Float: [RenderPrimitive]]
+
+    /// Reads the location and level of every feature of `store`. Runs queries, so call it off
+    /// the main thread.
+    init(store: FeatureTagStore, locator: FloorLocator, projection: UTMProjection = .zone32N,
+         type: (HDMFeature) -> Symbol? = { $0.featureTypeSymbol }) {
+        let levelKey = store.key("level")
+        var pointsByLevel: [Float: [RenderPrimitive]] = [:]
+        let batch = 512
+        var start = 0
+        while start < store.count {
+            let ids = store.featureIds[start..<min(start + batch, store.count)]
+            for feature in locator.__getFeatures(byIds: ids.map { NSNumber(value: $0) }) {
+                guard let featureType = type(feature) else { continue }
+                let level = store.view(forFeature: feature.featureId)
+                    .flatMap { view in levelKey.flatMap { view.value(for: $0) } }
+                    .flatMap { Float($0) } ?? 0
+                let point = projection.project(feature.location.coordinate)
+                pointsByLevel[level, default: []].append(RenderPrimitive(featureId: feature.featureId, type: featureType,
+                                                                         level: level, geometry: .point(point)))
+            }
+            start += batch
+        }
+        self.pointsByLevel = pointsByLevel
+    }
+
+    func primitives(level: Float?) -> [RenderPrimitive] {
+        if let level = level {
+            return pointsByLevel[level] ?? []
+        }
+        return pointsByLevel.keys.sorted().flatMap { pointsByLevel[$0]! }
+    }
+}
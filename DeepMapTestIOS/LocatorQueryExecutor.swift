@@ -0,0 +1,339 @@
+//
+//  LocatorQueryExecutor.swift
+//  DeepMapTestIOS
+//
+//  Created by agent on 18.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+import Foundation
+import HDMMapCore
+
+/// Handle for a query submitted to a `LocatorQueryExecutor`.
+final class LocatorQuery {
+
+    /// The query, nil for searches that don't run SQL.
+    let sql: String?
+    let group: String?
+
+    private let lock = NSLock()
+    private var cancelled = false
+    private var interruptHandler: (() -> Void)?
+
+    fileprivate let sequence: Int
+
+    fileprivate init(sql: String?, group: String?, sequence: Int) {
+        self.sql = sql
+        self.group = group
+        self.sequence = sequence
+    }
+
+    var isCancelled: Bool {
+        lock.lock()
+        defer { lock.unlock() }
+        return cancelled
+    }
+
+    /// Cancels the query. A cancelled query never calls its completion handler; if it is
+    /// already running on a reader, the SQLite statement is interrupted.
+    func cancel() {
+        lock.lock()
+        defer { lock.unlock() }
+        cancelled = true
+        // under the lock, so the reader cannot have moved on to its next query yet
+        interruptHandler?()
+    }
+
+    /// Installs the interrupt for the duration of `body`. Returns false without running `body`
+    /// if the query was cancelled before it reached a reader.
+    fileprivate func running(interrupt: @escaping () -> Void, _ body: () -> Void) -> Bool {
+        lock.lock()
+        if cancelled {
+            lock.unlock()
+            return false
+        }
+        interruptHandler = interrupt
+        lock.unlock()
+
+        body()
+
+        lock.lock()
+        interruptHandler = nil
+        lock.unlock()
+        return true
+    }
+}
+
+/// Runs `HDMLocator` lookups asynchronously on a pool of background readers.
+///
+/// Every reader owns its own `HDMLocator` and its own read-only SQLite connection, so queries
+/// run in parallel without sharing a database handle. Results are delivered on `deliveryQueue`
+/// in the order the queries were submitted, skipping cancelled ones.
+final class LocatorQueryExecutor {
+
+    /// Called with the results, or with an empty array and the error if the query failed.
+    typealias Completion = ([HDMFeature], Error?) -> Void
+
+    /// State of one reader; everything but `pending` is only touched on `queue`.
+    private final class Reader {
+        let queue: DispatchQueue
+        let projector: HDMProjector
+        var path: String
+        var connection: SQLiteReader?
+        var pending = 0
+        private var locatorState: HDMLocator?
+
+        init(index: Int, path: String, projector: HDMProjector) {
+            self.queue = DispatchQueue(label: "DeepMapTestIOS.locator-reader.\(index)", qos: .userInitiated)
+            self.projector = projector
+            self.path = path
+            self.connection = try? SQLiteReader(path: path)
+        }
+
+        /// Created on first use; most queries only need `connection`.
+        var locator: HDMLocator {
+            if let locator = locatorState {
+                return locator
+            }
+            let locator = HDMLocator(withDb: path, projector: projector)
+            locatorState = locator
+            return locator
+        }
+
+        func setDB(_ path: String) {
+            self.path = path
+            connection = try? SQLiteReader(path: path)
+            locatorState?.setDB(path)
+        }
+    }
+
+    /// Queue the completion handlers are called on. Defaults to the main queue.
+    let deliveryQueue: DispatchQueue
+    /// Builds the floor table of the database at a path, in the background.
+    var makeFloorTable: (String) -> FloorTable
+
+    private let readers: [Reader]
+    private let lock = NSLock()
+    private var databasePath: String
+    private var databaseGeneration = 0
+    private var floorTableState: FloorTable?
+    private var floorTableWaiters: [(FloorTable) -> Void]?
+    private var searchIndexState: TrigramIndex?
+    private var nextSequence = 0
+    private var nextDelivery = 0
+    private var finished: [Int: (LocatorQuery, () -> Void)] = [:]
+    private var latestInGroup: [String: LocatorQuery] = [:]
+
+    /// Rows between two cancellation checks while collecting object IDs.
+    private let cancellationCheckInterval = 256
+
+    init(databasePath path: String, projector: HDMProjector,
+         readerCount: Int = min(4, ProcessInfo.processInfo.activeProcessorCount),
+         deliveryQueue: DispatchQueue = .main) {
+        self.deliveryQueue = deliveryQueue
+        self.makeFloorTable = { FloorTable(databasePath: $0, projector: projector) }
+        self.databasePath = path
+        self.readers = (0..<max(1, readerCount)).map { Reader(index: $0, path: path, projector: projector) }
+    }
+
+    /// Points every reader to another database and drops the floor table. Queries submitted
+    /// before the call still run against the old database.
+    func setDB(_ path: String) {
+        lock.lock()
+        databasePath = path
+        databaseGeneration += 1
+        floorTableState = nil
+        let floorTableWaiters = self.floorTableWaiters ?? []
+        self.floorTableWaiters = nil
+        lock.unlock()
+
+        // callers waiting for the old table get the table of the new database instead
+        floorTableWaiters.forEach { floorTable(completion: $0) }
+
+        for reader in readers {
+            reader.queue.async {
+                reader.setDB(path)
+            }
+        }
+    }
+
+    /// Looks up features asynchronously, see `HDMLocator.getFeatures(withSQL:)`.
+    ///
+    /// - parameter group: Queries sharing a group supersede each other: submitting a new one
+    ///   cancels the previous query of that group (e.g. search-as-you-type).
+    @discardableResult
+    func features(withSQL sql: String, group: String? = nil, completion: @escaping Completion) -> LocatorQuery {
+        return submit(sql, group: group, work: { reader, query in
+            let ids = try self.featureIds(for: query, on: reader)
+            return reader.locator.__getFeatures(byIds: ids.map { NSNumber(value: $0) })
+        }, completion: completion)
+    }
+
+    /// Like `features(withSQL:group:completion:)`, but resolves the result to views on `store`
+    /// instead of materializing an `HDMFeature` per result.
+    @discardableResult
+    func featureViews(withSQL sql: String, in store: FeatureTagStore, group: String? = nil,
+                      completion: @escaping ([FeatureView], Error?) -> Void) -> LocatorQuery {
+        return submit(sql, group: group, work: { reader, query in
+            store.views(forFeatures: try self.featureIds(for: query, on: reader))
+        }, completion: completion)
+    }
+
+    /// Looks up features by ID asynchronously, see `HDMLocator.getFeaturesByIds`.
+    @discardableResult
+    func features(withIds featureIds: [UInt64], completion: @escaping Completion) -> LocatorQuery {
+        let ids = featureIds.map { String($0) }.joined(separator: ",")
+        return features(withSQL: "SELECT DISTINCT object_id FROM tags WHERE object_id IN (\(ids))", completion: completion)
+    }
+
+    /// Index used by `fuzzySearch`. Searches complete with no results while it is nil.
+    var searchIndex: TrigramIndex? {
+        get {
+            lock.lock()
+            defer { lock.unlock() }
+            return searchIndexState
+        }
+        set {
+            lock.lock()
+            searchIndexState = newValue
+            lock.unlock()
+        }
+    }
+
+    /// Runs `TrigramIndex.fuzzySearch` on a reader, with the same ordering and cancellation
+    /// as the SQL queries; use one `group` for search-as-you-type.
+    @discardableResult
+    func fuzzySearch(_ text: String, locale: String, level: Float? = nil, limit: Int = 10, group: String? = nil,
+                     completion: @escaping ([FuzzySearchResult], Error?) -> Void) -> LocatorQuery {
+        let index = searchIndex
+        return submit(nil, group: group, work: { _, _ in
+            index?.fuzzySearch(text, locale: locale, level: level, limit: limit) ?? []
+        }, completion: completion)
+    }
+
+    /// Floor metadata of the current database. The table is built in the background on first
+    /// use and kept until the next `setDB(_:)`; later calls complete immediately.
+    func floorTable(completion: @escaping (FloorTable) -> Void) {
+        lock.lock()
+        if let table = floorTableState {
+            lock.unlock()
+            deliveryQueue.async { completion(table) }
+            return
+        }
+        if floorTableWaiters != nil {
+            floorTableWaiters!.append(completion)
+            lock.unlock()
+            return
+        }
+        floorTableWaiters = [completion]
+        let path = databasePath
+        let generation = databaseGeneration
+        let makeFloorTable = self.makeFloorTable
+        lock.unlock()
+
+        DispatchQueue.global(qos: .userInitiated).async {
+            let table = makeFloorTable(path)
+
+            self.lock.lock()
+            guard generation == self.databaseGeneration, let waiters = self.floorTableWaiters else {
+                // the database changed while building, setDB(_:) handed the waiters on
+                self.lock.unlock()
+                return
+            }
+            self.floorTableState = table
+            self.floorTableWaiters = nil
+            self.lock.unlock()
+
+            self.deliveryQueue.async {
+                waiters.forEach { $0(table) }
+            }
+        }
+    }
+
+    // MARK: - Private
+
+    /// Runs `work` on the least busy reader; errors it throws are passed to `completion`.
+    private func submit<Result>(_ sql: String?, group: String?,
+                                work: @escaping (Reader, LocatorQuery) throws -> [Result],
+                                completion: @escaping ([Result], Error?) -> Void) -> LocatorQuery {
+        lock.lock()
+        let query = LocatorQuery(sql: sql, group: group, sequence: nextSequence)
+        nextSequence += 1
+        var superseded: LocatorQuery?
+        if let group = group {
+            superseded = latestInGroup[group]
+            latestInGroup[group] = query
+        }
+        let reader = readers.min { $0.pending < $1.pending }!
+        reader.pending += 1
+        lock.unlock()
+
+        superseded?.cancel()
+
+        reader.queue.async {
+            var result: [Result] = []
+            var failure: Error?
+            // the connection is captured here, cancel() must not read it while setDB(_:) replaces it
+            let connection = reader.connection
+            _ = query.running(interrupt: { connection?.interrupt() }) {
+                do {
+                    result = try work(reader, query)
+                } catch {
+                    failure = error
+                }
+            }
+            self.finish(query, reader: reader) {
+                completion(result, failure)
+            }
+        }
+        return query
+    }
+
+    private func featureIds(for query: LocatorQuery, on reader: Reader) throws -> [UInt64] {
+        guard let sql = query.sql else { return [] }
+        guard let connection = reader.connection else {
+            // no direct connection, fall back to the locator's own (uninterruptible) lookup
+            return reader.locator.getFeatures(withSQL: sql).map { $0.featureId }
+        }
+
+        var ids: [UInt64] = []
+        var seen = Set<Int64>()
+        var rows = 0
+        try connection.query(sql, column: "object_id") { row, column in
+            guard column >= 0 else { return false }
+            let id = row.int64(at: column)
+            if seen.insert(id).inserted {
+                ids.append(UInt64(bitPattern: id))
+            }
+            rows += 1
+            return rows % self.cancellationCheckInterval != 0 || !query.isCancelled
+        }
+        if query.isCancelled {
+            throw SQLiteReader.ReaderError.interrupted
+        }
+        return ids
+    }
+
+    private func finish(_ query: LocatorQuery, reader: Reader, deliver: @escaping () -> Void) {
+        var ready: [(LocatorQuery, () -> Void)] = []
+
+        lock.lock()
+        reader.pending -= 1
+        if let group = query.group, latestInGroup[group] === query {
+            latestInGroup[group] = nil
+        }
+        finished[query.sequence] = (query, deliver)
+        while let next = finished.removeValue(forKey: nextDelivery) {
+            ready.append(next)
+            nextDelivery += 1
+        }
+        lock.unlock()
+
+        guard !ready.isEmpty else { return }
+        deliveryQueue.async {
+            for (query, deliver) in ready where !query.isCancelled {
+                deliver()
+            }
+        }
+    }
+}
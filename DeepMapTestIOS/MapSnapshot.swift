@@ -0,0 +1,111 @@
+//
+//  MapSnapshot.swift
+//  DeepMapTestIOS
+//
+//  Created by agent on 18.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+import Foundation
+import HDMMapCore
+
+/// Everything the app derives from one map package and style: tags, styles, search and hit
+/// testing.
+///
+/// Built by `build(...)` or `restyled(...)` on a worker thread and not changed afterwards, so a
+/// `SnapshotBuffer` can swap it in while the previous snapshot keeps serving. Switching maps
+/// or styles then costs the main thread only the assignments in `ViewController.apply(_:)`.
+final class MapSnapshot {
+    let databasePath: String
+    /// Style and rule file the sheet was compiled from.
+    let stylePaths: [String]
+    /// Style and rule file of the package, which the engine loads with it.
+    let packageStylePaths: [String]
+    let store: FeatureTagStore?
+    let styleSheet: StyleSheet?
+    /// Resolved styles per feature, typed from the feature locations. Handed to the
+    /// `StyleUpdater`, which invalidates it when styles change.
+    let styleCache: FeatureStyleCache?
+    let searchIndex: TrigramIndex?
+    let hitTester: HitTester
+    /// Type, profile and floor membership of every feature. Handed to the `StyleUpdater` when a
+    /// package is opened, which changes it from then on; restyled snapshots share it.
+    let visibility: FeatureVisibility?
+
+    /// Geometry and elevations of the package's map objects.
+    let cells: MapCellSource?
+
+    private let locations: FeatureLocationSource?
+
+    private init(databasePath: String, stylePaths: [String], packageStylePaths: [String], store: FeatureTagStore?,
+                 styleSheet: StyleSheet?, searchIndex: TrigramIndex?, locations: FeatureLocationSource?, cells: MapCellSource?,
+                 visibility: FeatureVisibility?) {
+        self.databasePath = databasePath
+        self.stylePaths = stylePaths
+        self.packageStylePaths = packageStylePaths
+        self.store = store
+        self.styleSheet = styleSheet
+        let types = locations?.primitives(level: nil) ?? []
+        if let store = store, let styleSheet = styleSheet {
+            self.styleCache = FeatureStyleCache(sheet: styleSheet, store: store, types: types)
+        } else {
+            self.styleCache = nil
+        }
+        self.searchIndex = searchIndex
+        self.locations = locations
+        self.cells = cells
+        self.visibility = visibility
+        // touches are resolved against the objects' outlines; feature locations are only points
+        self.hitTester = HitTester(primitives: cells?.primitives(level: nil) ?? [], sheet: styleSheet,
+                                   projection: cells?.metadata.projection ?? .zone32N)
+    }
+
+    /// Reads a package's database, cells and style; independent stages run in parallel.
+    /// Returns nil if `isSuperseded` turns true between stages.
+    static func build(resources: MapResources, projector: HDMProjector,
+                      isSuperseded: () -> Bool) -> MapSnapshot? {
+        guard let databasePath = resources.databasePath else { return nil }
+        let stylePaths = [resources.stylePath, resources.rulePath].flatMap { $0 }
+        let cellPath = resources.cellPath
+
+        // the tag store, the cells and the style sheet do not depend on each other
+        var store: FeatureTagStore?
+        var cells: MapCellSource?
+        var styleSheet: StyleSheet?
+        DispatchQueue.concurrentPerform(iterations: 3) { stage in
+            switch stage {
+            case 0: store = try? FeatureTagStore(databasePath: databasePath)
+            case 1: cells = cellPath.flatMap { try? MapCellSource(cellPath: $0) }
+            default: styleSheet = try? StyleSheet(contentsOfFiles: stylePaths)
+            }
+        }
+        guard !isSuperseded() else { return nil }
+
+        // the rest only reads the store
+        var searchIndex: TrigramIndex?
+        var locations: FeatureLocationSource?
+        DispatchQueue.concurrentPerform(iterations: 2) { stage in
+            guard let store = store else { return }
+            switch stage {
+            case 0: searchIndex = TrigramIndex(store: store)
+            default: locations = FeatureLocationSource(store: store, locator: HDMLocator(withDb: databasePath, projector: projector))
+            }
+        }
+        guard !isSuperseded() else { return nil }
+        // types come from the feature locations, so hiding a type hides its features
+        let visibility = store.map { FeatureVisibility(store: $0, types: locations?.primitives(level: nil) ?? []) }
+
+        return MapSnapshot(databasePath: databasePath, stylePaths: stylePaths, packageStylePaths: stylePaths, store: store,
+                           styleSheet: styleSheet, searchIndex: searchIndex, locations: locations, cells: cells,
+                           visibility: visibility)
+    }
+
+    /// A copy with another style and rule file; the package's data is shared, not read again.
+    func restyled(stylePaths: [String], isSuperseded: () -> Bool) -> MapSnapshot? {
+        let styleSheet = try? StyleSheet(contentsOfFiles: stylePaths)
+        guard !isSuperseded() else { return nil }
+        return MapSnapshot(databasePath: databasePath, stylePaths: stylePaths, packageStylePaths: packageStylePaths, store: store,
+                           styleSheet: styleSheet, searchIndex: searchIndex, locations: locations, cells: cells,
+                           visibility: visibility)
+    }
+}
@@ -0,0 +1,219 @@
+//
+//  MapUpdateTransaction.swift
+//  DeepMapTestIOS
+//
+//  Created by agent on 18.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+import Foundation
+import HDMMapCore
+
+/// A batch of attribute, style, visibility, selection and highlight changes.
+///
+/// Record changes from one thread at a time, any thread, then hand the transaction to `StyleUpdater.commit(_:completion:)`.
+/// Committed transactions are coalesced on a worker queue (the last change to the same
+/// attribute, style property or feature state wins) and applied together in one main thread
+/// pass, followed by at most one scene refresh, so the map never shows half of a batch.
+/// A transaction must not be modified after it has been committed.
+final class MapUpdateTransaction {
+
+    fileprivate enum Change {
+        case attribute(featureId: UInt64, key: Symbol, value: String?)
+        case globalAttribute(key: Symbol, value: String?)
+        case style(type: Symbol, property: Symbol, value: String)
+        case visibility(type: Symbol, visible: Bool)
+        case selection(featureId: UInt64, selected: Bool)
+        case highlight(featureId: UInt64, highlighted: Bool)
+    }
+
+    fileprivate var changes: [Change] = []
+
+    init() {
+    }
+
+    /// Number of recorded changes, before coalescing.
+    var count: Int {
+        return changes.count
+    }
+
+    func setFeatureAttribute(_ key: Symbol, value: String, featureId: UInt64) {
+        changes.append(.attribute(featureId: featureId, key: key, value: value))
+    }
+
+    func removeFeatureAttribute(_ key: Symbol, featureId: UInt64) {
+        changes.append(.attribute(featureId: featureId, key: key, value: nil))
+    }
+
+    func setGlobalAttribute(_ key: Symbol, value: String) {
+        changes.append(.globalAttribute(key: key, value: value))
+    }
+
+    func removeGlobalAttribute(_ key: Symbol) {
+        changes.append(.globalAttribute(key: key, value: nil))
+    }
+
+    func setFeatureStyle(_ type: Symbol, property: Symbol, value: String) {
+        changes.append(.style(type: type, property: property, value: value))
+    }
+
+    func showFeatures(_ type: Symbol) {
+        changes.append(.visibility(type: type, visible: true))
+    }
+
+    func hideFeatures(_ type: Symbol) {
+        changes.append(.visibility(type: type, visible: false))
+    }
+
+    func selectFeature(_ featureId: UInt64) {
+        changes.append(.selection(featureId: featureId, selected: true))
+    }
+
+    func deselectFeature(_ featureId: UInt64) {
+        changes.append(.selection(featureId: featureId, selected: false))
+    }
+
+    func highlightFeature(_ featureId: UInt64) {
+        changes.append(.highlight(featureId: featureId, highlighted: true))
+    }
+
+    func unhighlightFeature(_ featureId: UInt64) {
+        changes.append(.highlight(featureId: featureId, highlighted: false))
+    }
+
+    /// The changes with earlier writes to the same target dropped, in order of each target's
+    /// last write. Attribute changes are grouped by feature.
+    fileprivate func coalesced() -> [Change] {
+        var lastWrite: [ChangeTarget: Int] = [:]
+        lastWrite.reserveCapacity(changes.count)
+        for (index, change) in changes.enumerated() {
+            lastWrite[ChangeTarget(change)] = index
+        }
+        let kept = lastWrite.values.sorted()
+        var attributes: [Change] = []
+        var others: [Change] = []
+        for index in kept {
+            if case .attribute = changes[index] {
+                attributes.append(changes[index])
+            } else {
+                others.append(changes[index])
+            }
+        }
+        attributes.sort { lhs, rhs in
+            guard case .attribute(let a, _, _) = lhs, case .attribute(let b, _, _) = rhs else { return false }
+            return a < b
+        }
+        // styles and global attributes first, so per-feature changes see the final rule inputs
+        return others + attributes
+    }
+}
+
+/// Identity of what a change writes, for coalescing.
+private struct ChangeTarget: Hashable {
+    let kind: Int
+    let featureId: UInt64
+    let first: Symbol
+    let second: Symbol
+
+    init(_ change: MapUpdateTransaction.Change) {
+        let none = Symbol(rawValue: UInt32.max)
+        var featureId: UInt64 = 0
+        var first = none
+        var second = none
+        switch change {
+        case .attribute(let id, let key, _):
+            kind = 0
+            featureId = id
+            first = key
+        case .globalAttribute(let key, _):
+            kind = 1
+            first = key
+        case .style(let type, let property, _):
+            kind = 2
+            first = type
+            second = property
+        case .visibility(let type, _):
+            kind = 3
+            first = type
+        case .selection(let id, _):
+            kind = 4
+            featureId = id
+        case .highlight(let id, _):
+            kind = 5
+            featureId = id
+        }
+        self.featureId = featureId
+        self.first = first
+        self.second = second
+    }
+
+    var hashValue: Int {
+        return featureId.hashValue ^ Int(first.rawValue) << 8 ^ Int(second.rawValue) << 32 ^ kind
+    }
+
+    static func == (lhs: ChangeTarget, rhs: ChangeTarget) -> Bool {
+        return lhs.kind == rhs.kind && lhs.featureId == rhs.featureId && lhs.first.rawValue == rhs.first.rawValue
+            && lhs.second.rawValue == rhs.second.rawValue
+    }
+}
+
+/// Coalesces committed transactions in commit order.
+private let coalescingQueue = DispatchQueue(label: "MapUpdateTransaction.coalescing", qos: .userInitiated)
+
+extension StyleUpdater {
+
+    /// Coalesces `transaction` off the main thread, then applies it in a single main thread pass
+    /// with at most one scene refresh. Transactions are applied in the order they are committed.
+    ///
+    /// - parameter completion: Called on the main queue with the number of changes applied after coalescing.
+    func commit(_ transaction: MapUpdateTransaction, completion: ((Int) -> Void)? = nil) {
+        coalescingQueue.async {
+            let changes = transaction.coalesced()
+            DispatchQueue.main.async { [weak self] in
+                guard let updater = self else { return }
+                for change in changes {
+                    updater.apply(change)
+                }
+                updater.flush()
+                completion?(changes.count)
+            }
+        }
+    }
+
+    fileprivate func apply(_ change: MapUpdateTransaction.Change) {
+        switch change {
+        case .attribute(let featureId, let key, let value):
+            if let value = value {
+                setFeatureAttribute(key, value: value, featureId: featureId)
+            } else {
+                removeFeatureAttribute(key, featureId: featureId)
+            }
+        case .globalAttribute(let key, let value):
+            if let value = value {
+                setGlobalAttribute(key, value: value)
+            } else {
+                removeGlobalAttribute(key)
+            }
+        case .style(let type, let property, let value):
+            setFeatureStyle(type, property: property, value: value)
+        case .visibility(let type, let visible):
+            if visible {
+                showFeatures(type)
+            } else {
+                hideFeatures(type)
+            }
+        case .selection(let featureId, let selected):
+            if selected {
+                selectFeature(featureId)
+            } else {
+                deselectFeature(featureId)
+            }
+        case .highlight(let featureId, let highlighted):
+            if highlighted {
+                highlightFeature(featureId)
+            } else {
+                unhighlightFeature(featureId)
+            }
+        }
+    }
+}
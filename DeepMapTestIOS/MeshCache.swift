@@ -0,0 +1,681 @@
+//
+//  MeshCache.swift
+//  DeepMapTestIOS
+//
+//  Created by agent on 18.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+import Foundation
+import HDMMapCore
+
+enum MeshError: Error {
+    case format
+    case source(String)
+}
+
+/// An indexed triangle mesh read from a Wavefront .obj file.
+struct OBJMesh {
+    /// x, y, z per vertex.
+    var positions: [Float] = []
+    /// x, y, z per vertex, or empty.
+    var normals: [Float] = []
+    /// Three per triangle.
+    var indices: [UInt32] = []
+
+    var vertexCount: Int {
+        return positions.count / 3
+    }
+
+    /// The mesh as an .obj file.
+    func objData() -> Data {
+        var text = ""
+        for vertex in 0..<vertexCount {
+            text += String(format: "v %.4f %.4f %.4f\n", positions[vertex * 3], positions[vertex * 3 + 1], positions[vertex * 3 + 2])
+        }
+        for vertex in 0..<normals.count / 3 {
+            text += String(format: "vn %.3f %.3f %.3f\n", normals[vertex * 3], normals[vertex * 3 + 1], normals[vertex * 3 + 2])
+        }
+        for triangle in stride(from: 0, to: indices.count - indices.count % 3, by: 3) {
+            let a = indices[triangle] + 1, b = indices[triangle + 1] + 1, c = indices[triangle + 2] + 1
+            text += normals.isEmpty ? "f \(a) \(b) \(c)\n" : "f \(a)//\(a) \(b)//\(b) \(c)//\(c)\n"
+        }
+        return text.data(using: .utf8)!
+    }
+
+    /// Reads the `v`, `vn` and `f` statements of an .obj file; faces are triangulated as fans
+    /// and vertices shared by faces are stored once. Everything else is ignored.
+    static func parse(_ data: Data) throws -> OBJMesh {
+        return try data.withUnsafeBytes { (bytes: UnsafePointer<UInt8>) throws -> OBJMesh in
+            var scanner = OBJScanner(bytes: bytes, count: data.count)
+            var sourcePositions: [Float] = []
+            var sourceNormals: [Float] = []
+            var mesh = OBJMesh()
+            var vertexOfCorner: [Int64: UInt32] = [:]
+            var face: [UInt32] = []
+
+            while scanner.nextLine() {
+                switch scanner.keyword() {
+                case .vertex:
+                    sourcePositions += [try scanner.float(), try scanner.float(), try scanner.float()]
+                case .normal:
+                    sourceNormals += [try scanner.float(), try scanner.float(), try scanner.float()]
+                case .face:
+                    face.removeAll(keepingCapacity: true)
+                    while let corner = try scanner.corner() {
+                        // indices are 1-based, negative ones count back from the latest vertex
+                        let position = corner.position < 0 ? sourcePositions.count / 3 + corner.position : corner.position - 1
+                        let normal = corner.normal.map { $0 < 0 ? sourceNormals.count / 3 + $0 : $0 - 1 }
+                        guard position >= 0 && position < sourcePositions.count / 3 else { throw MeshError.format }
+                        if let normal = normal, normal < 0 || normal >= sourceNormals.count / 3 {
+                            throw MeshError.format
+                        }
+                        let key = Int64(position) << 32 | Int64(normal.map { $0 + 1 } ?? 0)
+                        if let vertex = vertexOfCorner[key] {
+                            face.append(vertex)
+                            continue
+                        }
+                        let vertex = UInt32(mesh.positions.count / 3)
+                        vertexOfCorner[key] = vertex
+                        mesh.positions += sourcePositions[position * 3..<position * 3 + 3]
+                        if let normal = normal {
+                            mesh.normals += sourceNormals[normal * 3..<normal * 3 + 3]
+                        } else if !sourceNormals.isEmpty {
+                            mesh.normals += [0, 0, 0]
+                        }
+                        face.append(vertex)
+                    }
+                    for index in 2..<max(face.count, 2) {
+                        mesh.indices += [face[0], face[index - 1], face[index]]
+                    }
+                case .other:
+                    break
+                }
+            }
+            if mesh.normals.count != mesh.positions.count {
+                mesh.normals = []
+            }
+            return mesh
+        }
+    }
+}
+
+/// Splits an .obj file into lines and tokens without creating strings.
+private struct OBJScanner {
+
+    enum Keyword {
+        case vertex
+        case normal
+        case face
+        case other
+    }
+
+    let bytes: UnsafePointer<UInt8>
+    let count: Int
+    private var offset = 0
+    private var lineEnd = 0
+
+    init(bytes: UnsafePointer<UInt8>, count: Int) {
+        self.bytes = bytes
+        self.count = count
+    }
+
+    /// Moves to the next line; false at the end of the file.
+    mutating func nextLine() -> Bool {
+        offset = lineEnd
+        while offset < count && (bytes[offset] == 10 || bytes[offset] == 13) {
+            offset += 1
+        }
+        guard offset < count else { return false }
+        lineEnd = offset
+        while lineEnd < count && bytes[lineEnd] != 10 && bytes[lineEnd] != 13 {
+            lineEnd += 1
+        }
+        return true
+    }
+
+    mutating func keyword() -> Keyword {
+        skipSpaces()
+        let start = offset
+        while offset < lineEnd && !isSpace(bytes[offset]) {
+            offset += 1
+        }
+        guard offset > start else { return .other }
+        switch (offset - start, bytes[start], offset - start > 1 ? bytes[start + 1] : 0) {
+        case (1, 118, _): return .vertex // "v"
+        case (2, 118, 110): return .normal // "vn"
+        case (1, 102, _): return .face // "f"
+        default: return .other
+        }
+    }
+
+    mutating func float() throws -> Float {
+        skipSpaces()
+        var negative = false
+        if offset < lineEnd && (bytes[offset] == 45 || bytes[offset] == 43) {
+            negative = bytes[offset] == 45
+            offset += 1
+        }
+        var value = 0.0, digits = 0
+        while offset < lineEnd, let digit = self.digit(bytes[offset]) {
+            value = value * 10 + Double(digit)
+            offset += 1
+            digits += 1
+        }
+        if offset < lineEnd && bytes[offset] == 46 {
+            offset += 1
+            var scale = 0.1
+            while offset < lineEnd, let digit = self.digit(bytes[offset]) {
+                value += Double(digit) * scale
+                scale /= 10
+                offset += 1
+                digits += 1
+            }
+        }
+        guard digits > 0 else { throw MeshError.format }
+        if offset < lineEnd && (bytes[offset] == 101 || bytes[offset] == 69) {
+            offset += 1
+            let exponent = try integer()
+            value *= pow(10, Double(exponent))
+        }
+        return Float(negative ? -value : value)
+    }
+
+    /// The next face corner, "p", "p/t", "p//n" or "p/t/n"; nil at the end of the line.
+    mutating func corner() throws -> (position: Int, normal: Int?)? {
+        skipSpaces()
+        guard offset < lineEnd else { return nil }
+        let position = try integer()
+        var normal: Int?
+        if offset < lineEnd && bytes[offset] == 47 {
+            offset += 1
+            if offset < lineEnd && bytes[offset] != 47 && !isSpace(bytes[offset]) {
+                _ = try integer() // texture coordinate
+            }
+            if offset < lineEnd && bytes[offset] == 47 {
+                offset += 1
+                normal = try integer()
+            }
+        }
+        return (position, normal)
+    }
+
+    private mutating func integer() throws -> Int {
+        var negative = false
+        if offset < lineEnd && (bytes[offset] == 45 || bytes[offset] == 43) {
+            negative = bytes[offset] == 45
+            offset += 1
+        }
+        var value = 0, digits = 0
+        while offset < lineEnd, let digit = self.digit(bytes[offset]) {
+            value = value * 10 + digit
+            offset += 1
+            digits += 1
+        }
+        guard digits > 0 else { throw MeshError.format }
+        return negative ? -value : value
+    }
+
+    private mutating func skipSpaces() {
+        while offset < lineEnd && isSpace(bytes[offset]) {
+            offset += 1
+        }
+    }
+
+    private func isSpace(_ byte: UInt8) -> Bool {
+        return byte == 32 || byte == 9
+    }
+
+    private func digit(_ byte: UInt8) -> Int? {
+        return byte >= 48 && byte <= 57 ? Int(byte - 48) : nil
+    }
+}
+
+/// A mesh in the binary cache format, read in place from a mapped file.
+///
+/// Vertices are indexed and quantized to 16 bits per coordinate within the mesh's bounds,
+/// normals to 8 bits per component, which keeps the mapped file small. Level 0 holds all
+/// triangles; further levels are simplified by clustering vertices on ever coarser grids and
+/// reuse the vertices of level 0. `MeshFeatureLoader` picks a level by camera distance.
+final class CompiledMesh {
+
+    struct Level {
+        let indices: CountableRange<Int>
+        /// Largest distance a vertex was moved by simplification, in the mesh's units.
+        let error: Float
+    }
+
+    fileprivate static let magic: UInt32 = 0x48534D48 // "HMSH"
+    fileprivate static let version: UInt32 = 2
+    private static let headerSize = 64
+
+    /// Identifies the source file the mesh was compiled from, e.g. its size and date.
+    let sourceStamp: UInt64
+    /// Hash of the source file's contents; identical meshes share it.
+    let contentHash: UInt64
+    let vertexCount: Int
+    let hasNormals: Bool
+    let minimum: (x: Float, y: Float, z: Float)
+    let maximum: (x: Float, y: Float, z: Float)
+    let levels: [Level]
+
+    private let data: Data
+    private let positionOffset: Int
+    private let normalOffset: Int
+    private let indexOffset: Int
+
+    convenience init(contentsOfFile path: String) throws {
+        try self.init(data: try Data(contentsOf: URL(fileURLWithPath: path), options: .alwaysMapped))
+    }
+
+    init(data: Data) throws {
+        guard data.count >= CompiledMesh.headerSize else { throw MeshError.format }
+        func word(_ offset: Int) -> UInt32 {
+            return data[offset..<offset + 4].reversed().reduce(0) { $0 << 8 | UInt32($1) }
+        }
+        guard word(0) == CompiledMesh.magic && word(4) == CompiledMesh.version else { throw MeshError.format }
+        let vertexCount = Int(word(24)), hasNormals = word(28) & 1 != 0
+        let levelCount = Int(word(32)), indexCount = Int(word(36))
+
+        // sections follow the header and level table, each 4-byte aligned
+        let levelOffset = CompiledMesh.headerSize
+        let positionOffset = levelOffset + levelCount * 12
+        let normalOffset = positionOffset + CompiledMesh.aligned(vertexCount * 6)
+        let indexOffset = normalOffset + (hasNormals ? CompiledMesh.aligned(vertexCount * 3) : 0)
+        guard levelCount <= 16, indexOffset + indexCount * 4 <= data.count else { throw MeshError.format }
+
+        var levels: [Level] = []
+        for level in 0..<levelCount {
+            let base = levelOffset + level * 12
+            let indices = Int(word(base))..<Int(word(base)) + Int(word(base + 4))
+            guard indices.upperBound <= indexCount else { throw MeshError.format }
+            levels.append(Level(indices: indices, error: Float(bitPattern: word(base + 8))))
+        }
+        self.levels = levels
+        self.data = data
+        self.vertexCount = vertexCount
+        self.hasNormals = hasNormals
+        sourceStamp = UInt64(word(8)) | UInt64(word(12)) << 32
+        contentHash = UInt64(word(16)) | UInt64(word(20)) << 32
+        minimum = (Float(bitPattern: word(40)), Float(bitPattern: word(44)), Float(bitPattern: word(48)))
+        maximum = (Float(bitPattern: word(52)), Float(bitPattern: word(56)), Float(bitPattern: word(60)))
+        self.positionOffset = positionOffset
+        self.normalOffset = normalOffset
+        self.indexOffset = indexOffset
+    }
+
+    func position(at vertex: Int) -> (x: Float, y: Float, z: Float) {
+        let offset = positionOffset + vertex * 6, minimum = self.minimum, maximum = self.maximum
+        return data.withUnsafeBytes { (bytes: UnsafePointer<UInt8>) -> (x: Float, y: Float, z: Float) in
+            let raw = UnsafeRawPointer(bytes + offset)
+            func value(_ component: Int, _ low: Float, _ high: Float) -> Float {
+                return low + Float(UInt16(littleEndian: raw.load(fromByteOffset: component * 2, as: UInt16.self))) / 65535 * (high - low)
+            }
+            return (value(0, minimum.x, maximum.x), value(1, minimum.y, maximum.y), value(2, minimum.z, maximum.z))
+        }
+    }
+
+    func normal(at vertex: Int) -> (x: Float, y: Float, z: Float)? {
+        guard hasNormals else { return nil }
+        let offset = normalOffset + vertex * 3
+        return data.withUnsafeBytes { (bytes: UnsafePointer<UInt8>) -> (x: Float, y: Float, z: Float) in
+            let base = bytes + offset
+            return (Float(Int8(bitPattern: base[0])) / 127, Float(Int8(bitPattern: base[1])) / 127, Float(Int8(bitPattern: base[2])) / 127)
+        }
+    }
+
+    func indices(level: Int) -> [UInt32] {
+        return words(at: indexOffset, range: levels[level].indices)
+    }
+
+    /// A level as a compact .obj file, holding only the vertices the level uses.
+    func objData(level: Int) -> Data {
+        let indices = self.indices(level: level)
+        var vertexOfIndex: [UInt32: Int] = [:]
+        var text = "# compiled mesh, level \(level)\n"
+        var faces = ""
+        for triangle in stride(from: 0, to: indices.count, by: 3) {
+            var corners: [Int] = []
+            for index in indices[triangle..<triangle + 3] {
+                if let vertex = vertexOfIndex[index] {
+                    corners.append(vertex)
+                    continue
+                }
+                let vertex = vertexOfIndex.count + 1
+                vertexOfIndex[index] = vertex
+                let p = position(at: Int(index))
+                text += String(format: "v %.4f %.4f %.4f\n", p.x, p.y, p.z)
+                if let n = normal(at: Int(index)) {
+                    text += String(format: "vn %.3f %.3f %.3f\n", n.x, n.y, n.z)
+                }
+                corners.append(vertex)
+            }
+            faces += hasNormals ? "f \(corners[0])//\(corners[0]) \(corners[1])//\(corners[1]) \(corners[2])//\(corners[2])\n"
+                : "f \(corners[0]) \(corners[1]) \(corners[2])\n"
+        }
+        return (text + faces).data(using: .utf8)!
+    }
+
+    private func words(at offset: Int, range: CountableRange<Int>) -> [UInt32] {
+        return data.withUnsafeBytes { (bytes: UnsafePointer<UInt8>) -> [UInt32] in
+            let raw = UnsafeRawPointer(bytes + offset)
+            return range.map { UInt32(littleEndian: raw.load(fromByteOffset: $0 * 4, as: UInt32.self)) }
+        }
+    }
+
+    fileprivate static func aligned(_ count: Int) -> Int {
+        return (count + 3) & ~3
+    }
+}
+
+/// Builds the binary cache format of `CompiledMesh`.
+enum MeshCompiler {
+
+    /// Compiles `mesh` with up to `levelCount` levels. Each level clusters vertices on a grid
+    /// half as fine as the last; grids that remove less than a quarter of the triangles are
+    /// skipped.
+    static func compile(_ mesh: OBJMesh, levelCount: Int = 3, sourceStamp: UInt64 = 0, contentHash: UInt64 = 0) -> Data {
+        var minimum = [Float](repeating: .infinity, count: 3), maximum = [Float](repeating: -.infinity, count: 3)
+        for (index, value) in mesh.positions.enumerated() {
+            minimum[index % 3] = min(minimum[index % 3], value)
+            maximum[index % 3] = max(maximum[index % 3], value)
+        }
+        if mesh.positions.isEmpty {
+            minimum = [0, 0, 0]
+            maximum = [0, 0, 0]
+        }
+
+        var levels: [(indices: [UInt32], error: Float)] = [(mesh.indices, 0)]
+        let extent = zip(minimum, maximum).map { $1 - $0 }.max() ?? 0
+        var cells = 64
+        while levels.count < levelCount && cells >= 4 {
+            let cellSize = extent / Float(cells)
+            guard cellSize > 0 else { break }
+            let simplified = simplify(mesh.positions, indices: levels[levels.count - 1].indices, cellSize: cellSize)
+            if simplified.count * 4 <= levels[levels.count - 1].indices.count * 3 {
+                levels.append((simplified, cellSize * Float(3).squareRoot()))
+            }
+            cells /= 2
+        }
+
+        var indices: [UInt32] = []
+        var levelTable: [UInt32] = []
+        for level in levels {
+            levelTable += [UInt32(indices.count), UInt32(level.indices.count), level.error.bitPattern]
+            indices += level.indices
+        }
+
+        let hasNormals = !mesh.normals.isEmpty
+        var header: [UInt32] = [CompiledMesh.magic, CompiledMesh.version,
+                                UInt32(truncatingIfNeeded: sourceStamp), UInt32(truncatingIfNeeded: sourceStamp >> 32),
+                                UInt32(truncatingIfNeeded: contentHash), UInt32(truncatingIfNeeded: contentHash >> 32)]
+        header += [UInt32(mesh.vertexCount), hasNormals ? 1 : 0, UInt32(levels.count), UInt32(indices.count)]
+        header += minimum.map { $0.bitPattern }
+        header += maximum.map { $0.bitPattern }
+
+        var bytes: [UInt8] = []
+        for word in header + levelTable {
+            append(word, to: &bytes)
+        }
+        for (index, value) in mesh.positions.enumerated() {
+            let range = maximum[index % 3] - minimum[index % 3]
+            let quantized = range > 0 ? UInt16(((value - minimum[index % 3]) / range * 65535).rounded()) : 0
+            bytes += [UInt8(quantized & 0xFF), UInt8(quantized >> 8)]
+        }
+        pad(&bytes)
+        if hasNormals {
+            bytes += mesh.normals.map { UInt8(bitPattern: Int8((max(-1, min(1, $0)) * 127).rounded())) }
+            pad(&bytes)
+        }
+        for word in indices {
+            append(word, to: &bytes)
+        }
+        return Data(bytes)
+    }
+
+    /// Merges the vertices in each cell of a grid into the first one and drops the triangles
+    /// that collapse.
+    static func simplify(_ positions: [Float], indices: [UInt32], cellSize: Float) -> [UInt32] {
+        guard cellSize > 0 else { return indices }
+        var representative: [Int64: UInt32] = [:]
+        var remapped: [UInt32] = []
+        var seen = Set<Int64>()
+        func cell(_ vertex: UInt32) -> UInt32 {
+            let base = Int(vertex) * 3
+            let x = Int64((positions[base] / cellSize).rounded(.down)) & 0x1FFFFF
+            let y = Int64((positions[base + 1] / cellSize).rounded(.down)) & 0x1FFFFF
+            let z = Int64((positions[base + 2] / cellSize).rounded(.down)) & 0x1FFFFF
+            let key = x << 42 | y << 21 | z
+            if let vertex = representative[key] {
+                return vertex
+            }
+            representative[key] = vertex
+            return vertex
+        }
+        for triangle in stride(from: 0, to: indices.count - indices.count % 3, by: 3) {
+            let a = cell(indices[triangle]), b = cell(indices[triangle + 1]), c = cell(indices[triangle + 2])
+            guard a != b && b != c && a != c else { continue }
+            // the same triangle may be left by several source triangles
+            let sorted = [a, b, c].sorted()
+            let key = Int64(sorted[0]) << 42 ^ Int64(sorted[1]) << 21 ^ Int64(sorted[2])
+            guard seen.insert(key).inserted else { continue }
+            remapped += [a, b, c]
+        }
+        return remapped
+    }
+
+    private static func append(_ value: UInt32, to bytes: inout [UInt8]) {
+        bytes += [UInt8(value & 0xFF), UInt8(value >> 8 & 0xFF), UInt8(value >> 16 & 0xFF), UInt8(value >> 24)]
+    }
+
+    private static func pad(_ bytes: inout [UInt8]) {
+        while bytes.count % 4 != 0 {
+            bytes.append(0)
+        }
+    }
+}
+
+/// Compiles .obj meshes once into the binary cache and shares them between uses.
+///
+/// On first use of a source file it is parsed and compiled to `<directory>/<name>.mesh`;
+/// later loads map that file. A cached mesh is recompiled when the source's size or date
+/// changes. Loaded meshes are kept per path, and compact .obj files for the map (which
+/// only takes .obj) are named by content hash, so one mesh placed many times, even from
+/// copies of the file, is read and written once. Loading runs on a background queue.
+final class MeshCache {
+
+    let directory: URL
+    var levelCount = 3
+
+    private let queue = DispatchQueue(label: "MeshCache", qos: .utility)
+    private let lock = NSLock()
+    private var meshes: [String: CompiledMesh] = [:]
+
+    init(directory: URL? = nil) {
+        self.directory = directory ?? FileManager.default.urls(for: .cachesDirectory, in: .userDomainMask)[0]
+            .appendingPathComponent("meshes", isDirectory: true)
+    }
+
+    /// The compiled mesh of the .obj file at `path`, compiling it if needed. Blocks; use
+    /// `load(_:completion:)` on the main thread.
+    func mesh(forFile path: String) throws -> CompiledMesh {
+        lock.lock()
+        let loaded = meshes[path]
+        lock.unlock()
+        let stamp = try MeshCache.stamp(ofFile: path)
+        if let mesh = loaded, mesh.sourceStamp == stamp {
+            return mesh
+        }
+
+        try FileManager.default.createDirectory(at: directory, withIntermediateDirectories: true, attributes: nil)
+        let cachePath = directory.appendingPathComponent(String(format: "%016llx.mesh", MeshCache.hash(Array(path.utf8)))).path
+        var mesh = try? CompiledMesh(contentsOfFile: cachePath)
+        if mesh?.sourceStamp != stamp {
+            let source = try Data(contentsOf: URL(fileURLWithPath: path))
+            let compiled = MeshCompiler.compile(try OBJMesh.parse(source), levelCount: levelCount, sourceStamp: stamp,
+                                                contentHash: MeshCache.hash([UInt8](source)))
+            try compiled.write(to: URL(fileURLWithPath: cachePath), options: .atomic)
+            mesh = try CompiledMesh(contentsOfFile: cachePath)
+        }
+        lock.lock()
+        meshes[path] = mesh
+        lock.unlock()
+        return mesh!
+    }
+
+    /// Loads a mesh in the background; `completion` runs on the main thread.
+    func load(_ path: String, completion: @escaping (CompiledMesh?) -> Void) {
+        queue.async {
+            let mesh = try? self.mesh(forFile: path)
+            DispatchQueue.main.async {
+                completion(mesh)
+            }
+        }
+    }
+
+    /// A compact .obj file of a level of `mesh`, written on first request.
+    func objFile(for mesh: CompiledMesh, level: Int = 0) throws -> String {
+        let level = min(level, mesh.levels.count - 1)
+        let path = directory.appendingPathComponent(String(format: "%016llx-%d.obj", mesh.contentHash, level)).path
+        if !FileManager.default.fileExists(atPath: path) {
+            try mesh.objData(level: level).write(to: URL(fileURLWithPath: path), options: .atomic)
+        }
+        return path
+    }
+
+    func removeAll() {
+        lock.lock()
+        meshes = [:]
+        lock.unlock()
+    }
+
+    /// Size and modification time of a file.
+    private static func stamp(ofFile path: String) throws -> UInt64 {
+        let attributes = try FileManager.default.attributesOfItem(atPath: path)
+        guard let size = attributes[.size] as? NSNumber, let date = attributes[.modificationDate] as? Date else {
+            throw MeshError.source(path)
+        }
+        return size.uint64Value << 32 ^ UInt64(max(0, date.timeIntervalSince1970 * 1000))
+    }
+
+    /// 64-bit FNV-1a.
+    static func hash(_ bytes: [UInt8]) -> UInt64 {
+        var hash: UInt64 = 0xCBF29CE484222325
+        for byte in bytes {
+            hash = (hash ^ UInt64(byte)) &* 0x100000001B3
+        }
+        return hash
+    }
+}
+
+/// Places meshes on the map through a `MeshCache`, simplified by camera distance.
+///
+/// Every placement of the same source shares one compiled mesh and one compact .obj file per
+/// level; parsing and compiling happen off the main thread, only the map calls run on it. On
+/// camera changes each instance shows the coarsest level whose simplification error stays
+/// within `tolerance` points on screen, with the same hysteresis as `ExtrusionLayer`. The map
+/// only takes .obj files, so a level change replaces the instance's feature. Mesh units are
+/// taken as meters. Use from the main thread.
+final class MeshFeatureLoader {
+
+    private struct Instance {
+        let position: HDMMapCoordinate
+        let point: RenderPoint
+        let type: String
+        let mesh: CompiledMesh
+        /// .obj files by level.
+        let files: [String]
+        var level: Int
+        var featureId: UInt64
+    }
+
+    private(set) weak var mapView: HDMMapView?
+    let cache: MeshCache
+    let projection: UTMProjection
+    /// Largest simplification error allowed on screen, in points.
+    var tolerance = 1.0
+    /// Number of features replaced for a change of level.
+    private(set) var swaps = 0
+
+    private var instances: [Instance] = []
+    private var lastCamera: RenderCamera?
+
+    init(mapView: HDMMapView, cache: MeshCache = MeshCache(), projection: UTMProjection = .zone32N) {
+        self.mapView = mapView
+        self.cache = cache
+        self.projection = projection
+    }
+
+    /// Places the mesh of the .obj file at `path`; `completion` gets the new instance, or nil
+    /// if the mesh could not be loaded. The instance's feature ID changes with its level; see
+    /// `featureId(of:)`.
+    func add(meshFile path: String, at position: HDMMapCoordinate, type: String, animated: Bool = false,
+             completion: ((Int?) -> Void)? = nil) {
+        let cache = self.cache
+        DispatchQueue.global(qos: .utility).async {
+            let mesh = try? cache.mesh(forFile: path)
+            let files = mesh.flatMap { mesh in try? (0..<mesh.levels.count).map { try cache.objFile(for: mesh, level: $0) } }
+            DispatchQueue.main.async {
+                guard let mesh = mesh, let files = files, let mapView = self.mapView else {
+                    completion?(nil)
+                    return
+                }
+                let point = self.projection.project(position)
+                let level = self.lastCamera.map { self.level(of: mesh, at: point, camera: $0, current: nil) } ?? 0
+                let featureId = mapView.createMeshFeature(position, withType: type, meshFile: files[level], animated: animated)
+                self.instances.append(Instance(position: position, point: point, type: type, mesh: mesh, files: files,
+                                               level: level, featureId: featureId))
+                completion?(self.instances.count - 1)
+            }
+        }
+    }
+
+    func featureId(of instance: Int) -> UInt64 {
+        return instances[instance].featureId
+    }
+
+    func level(of instance: Int) -> Int {
+        return instances[instance].level
+    }
+
+    /// Swaps the level of every instance whose distance to `camera` calls for another one.
+    func update(camera: RenderCamera) {
+        lastCamera = camera
+        guard let mapView = mapView else { return }
+        for index in instances.indices {
+            let instance = instances[index]
+            let level = self.level(of: instance.mesh, at: instance.point, camera: camera, current: instance.level)
+            guard level != instance.level else { continue }
+            mapView.removeFeature(HDMFeature(id: instance.featureId, location: nil, attributes: [:]))
+            instances[index].featureId = mapView.createMeshFeature(instance.position, withType: instance.type,
+                                                                   meshFile: instance.files[level], animated: false)
+            instances[index].level = level
+            swaps += 1
+        }
+    }
+
+    private func level(of mesh: CompiledMesh, at point: RenderPoint, camera: RenderCamera, current: Int?) -> Int {
+        let basis = camera.basis
+        let dx = point.x - basis.eye.x, dy = point.y - basis.eye.y, dz = point.z - basis.eye.z
+        return MeshFeatureLoader.level(of: mesh, distance: (dx * dx + dy * dy + dz * dz).squareRoot(),
+                                       focalLength: basis.focalLength, tolerance: tolerance, current: current)
+    }
+
+    /// The coarsest level of `mesh` whose error stays within `tolerance` points at `distance`
+    /// meters. Leaving `current` takes an error a fifth beyond or below the tolerance.
+    static func level(of mesh: CompiledMesh, distance: Double, focalLength: Double, tolerance: Double, current: Int?) -> Int {
+        let slack = 1.2
+        var level = 0
+        for (index, candidate) in mesh.levels.enumerated() {
+            let error = Double(candidate.error) * focalLength / max(distance, 1)
+            var allowed = tolerance
+            if let current = current {
+                allowed = index == current ? tolerance * slack : index > current ? tolerance / slack : tolerance
+            }
+            if error <= allowed {
+                level = index
+            }
+        }
+        return level
+    }
+}
@@ -0,0 +1,169 @@
+//
+//  ShapedTextCache.swift
+//  DeepMapTestIOS
+//
+//  Created by agent on 18.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+import Foundation
+import CoreText
+
+/// A glyph of a shaped text run, at its pen position.
+struct ShapedGlyph {
+    let glyph: CGGlyph
+    /// Pen position relative to the start of the baseline, in pixels at `ShapedText.fontSize`, y up.
+    let x: Float
+    let y: Float
+}
+
+/// Glyphs and metrics of a single-line label, independent of the size it is drawn at.
+struct ShapedText {
+    /// Glyphs of the shaping font; glyphs CoreText took from fallback fonts are left out.
+    let glyphs: [ShapedGlyph]
+    let fontSize: Float
+    let width: Float
+    let ascent: Float
+    let descent: Float
+    /// Number of glyphs from fallback fonts, which no atlas of the font covers.
+    let fallbackGlyphs: Int
+
+    /// Width and line height when drawn at `size` pixels.
+    func size(at size: Float) -> (width: Float, height: Float) {
+        let scale = size / fontSize
+        return (width * scale, (ascent + descent) * scale)
+    }
+}
+
+/// Shaped label text, keyed by string and font, so repeated labels are shaped only once.
+///
+/// Text is shaped by CoreText once at the font's size and scaled to the size it is drawn at;
+/// together with a `GlyphAtlas` of distance fields a label costs no shaping and no
+/// rasterization after it has first been seen. The cache keeps the `capacity` most recently
+/// used strings per generation: when the current generation is full it becomes the old one
+/// and strings still in use move back on their next lookup. Thread-safe.
+final class ShapedTextCache {
+
+    private struct Key: Hashable {
+        let text: String
+        let font: String
+
+        var hashValue: Int {
+            return text.hashValue ^ font.hashValue
+        }
+
+        static func == (lhs: Key, rhs: Key) -> Bool {
+            return lhs.text == rhs.text && lhs.font == rhs.font
+        }
+    }
+
+    let font: CTFont
+    /// Distance fields of `font`, if the map package ships them.
+    let atlas: GlyphAtlas?
+    var capacity = 4096
+
+    private(set) var hits = 0
+    private(set) var misses = 0
+
+    private let lock = NSLock()
+    private var recent: [Key: ShapedText] = [:]
+    private var older: [Key: ShapedText] = [:]
+
+    init(font: CTFont, atlas: GlyphAtlas? = nil) {
+        self.font = font
+        self.atlas = atlas
+    }
+
+    /// Loads the package font at `fontPath` at the size of its atlas, and the atlas beside it.
+    convenience init?(fontPath: String) {
+        let atlas = try? GlyphAtlas(contentsOfFile: GlyphAtlas.path(besideFont: fontPath))
+        guard let provider = CGDataProvider(url: URL(fileURLWithPath: fontPath) as CFURL),
+            let graphicsFont = CGFont(provider) else { return nil }
+        let font = CTFontCreateWithGraphicsFont(graphicsFont, CGFloat(atlas?.fontSize ?? 32), nil, nil)
+        // an atlas of another font would draw the wrong glyphs
+        self.init(font: font, atlas: atlas.flatMap { $0.fontName == CTFontCopyPostScriptName(font) as String ? $0 : nil })
+    }
+
+    /// `text` shaped with `font`, or with the cache's font.
+    func shapedText(_ text: String, font: CTFont? = nil) -> ShapedText {
+        let font = font ?? self.font
+        let key = Key(text: text, font: CTFontCopyPostScriptName(font) as String + "@\(CTFontGetSize(font))")
+        lock.lock()
+        if let shaped = recent[key] {
+            hits += 1
+            lock.unlock()
+            return shaped
+        }
+        if let shaped = older[key] {
+            hits += 1
+            store(shaped, for: key)
+            lock.unlock()
+            return shaped
+        }
+        misses += 1
+        lock.unlock()
+
+        let shaped = ShapedTextCache.shape(text, font: font)
+        lock.lock()
+        store(shaped, for: key)
+        lock.unlock()
+        return shaped
+    }
+
+    /// Label size at `size` pixels; usable as `LabelEngine.measure`.
+    func measure(_ text: String, size: Float) -> (width: Float, height: Float) {
+        return shapedText(text).size(at: size)
+    }
+
+    /// Shapes `strings` ahead of their first use, e.g. all labels of a floor.
+    func prepare(_ strings: [String]) {
+        for string in strings {
+            _ = shapedText(string)
+        }
+    }
+
+    func removeAll() {
+        lock.lock()
+        recent = [:]
+        older = [:]
+        lock.unlock()
+    }
+
+    private func store(_ shaped: ShapedText, for key: Key) {
+        if recent.count >= capacity {
+            older = recent
+            recent = [:]
+        }
+        recent[key] = shaped
+    }
+
+    /// Shapes one line of `text` with CoreText.
+    static func shape(_ text: String, font: CTFont) -> ShapedText {
+        let attributed = NSAttributedString(string: text, attributes: [NSAttributedStringKey(kCTFontAttributeName as String): font])
+        let line = CTLineCreateWithAttributedString(attributed)
+        var ascent: CGFloat = 0, descent: CGFloat = 0, leading: CGFloat = 0
+        let width = CTLineGetTypographicBounds(line, &ascent, &descent, &leading)
+
+        let fontName = CTFontCopyPostScriptName(font) as String
+        var glyphs: [ShapedGlyph] = []
+        var fallbackGlyphs = 0
+        for run in CTLineGetGlyphRuns(line) as! [CTRun] {
+            let count = CTRunGetGlyphCount(run)
+            let attributes = CTRunGetAttributes(run) as NSDictionary
+            let runFont = attributes[kCTFontAttributeName as String].map { $0 as! CTFont }
+            guard runFont.map({ CTFontCopyPostScriptName($0) as String == fontName }) ?? true else {
+                fallbackGlyphs += count
+                continue
+            }
+            var runGlyphs = [CGGlyph](repeating: 0, count: count)
+            var positions = [CGPoint](repeating: .zero, count: count)
+            CTRunGetGlyphs(run, CFRange(location: 0, length: 0), &runGlyphs)
+            CTRunGetPositions(run, CFRange(location: 0, length: 0), &positions)
+            for (glyph, position) in zip(runGlyphs, positions) {
+                glyphs.append(ShapedGlyph(glyph: glyph, x: Float(position.x), y: Float(position.y)))
+            }
+        }
+        return ShapedText(glyphs: glyphs, fontSize: Float(CTFontGetSize(font)), width: Float(width),
+                          ascent: Float(ascent), descent: Float(descent), fallbackGlyphs: fallbackGlyphs)
+    }
+}
@@ -0,0 +1,158 @@
+//
+//  SnapshotBuffer.swift
+//  DeepMapTestIOS
+//
+//  Created by agent on 18.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+import Foundation
+import QuartzCore
+
+/// Counters of the builds of a `SnapshotBuffer`.
+struct SnapshotStatistics: CustomStringConvertible {
+    var requested = 0
+    var published = 0
+    /// Builds dropped because a newer one was requested meanwhile, or given up by their builder.
+    var dropped = 0
+    var lastBuildTime: CFTimeInterval = 0
+    var totalBuildTime: CFTimeInterval = 0
+
+    var description: String {
+        return String(format: "%d builds requested, %d published, %d dropped, last %.1f ms, total %.1f ms",
+                      requested, published, dropped, lastBuildTime * 1000, totalBuildTime * 1000)
+    }
+}
+
+/// Double buffer of immutable snapshots built on worker threads.
+///
+/// `current` is the front snapshot; readers on any thread keep using the object they got for
+/// as long as they need it. `rebuild(_:)` builds the back snapshot on a worker queue while the
+/// front one keeps serving, then swaps it in with a single store under the lock, so nobody
+/// waits for a build and nobody sees a half-built snapshot. Only the newest request is
+/// published: older builds still running can stop early through `isSuperseded`, and their
+/// results are dropped even if they finish last. While requests arrive faster than a build
+/// takes, the front snapshot stays as it is until they settle.
+final class SnapshotBuffer<Snapshot: AnyObject> {
+
+    typealias Build = (_ isSuperseded: @escaping () -> Bool) -> Snapshot?
+
+    /// Called on the main thread after a swap, unless a newer snapshot was swapped in meanwhile.
+    var didSwap: ((Snapshot) -> Void)?
+
+    private let lock = NSLock()
+    private var front: Snapshot?
+    private var generation = 0
+    /// The newest requested build while it is running; the front snapshot is older then.
+    private var newestBuild: Build?
+    private var counters = SnapshotStatistics()
+    private let queue: DispatchQueue
+    private let builds = DispatchGroup()
+
+    init(_ initial: Snapshot? = nil, qos: DispatchQoS = .userInitiated) {
+        self.front = initial
+        self.queue = DispatchQueue(label: "SnapshotBuffer", qos: qos, attributes: .concurrent)
+    }
+
+    /// The front snapshot. Any thread.
+    var current: Snapshot? {
+        lock.lock()
+        defer { lock.unlock() }
+        return front
+    }
+
+    var statistics: SnapshotStatistics {
+        lock.lock()
+        defer { lock.unlock() }
+        return counters
+    }
+
+    /// Builds a new snapshot in the background and swaps it in when done. Any thread.
+    ///
+    /// `build` runs on a worker thread and returns nil to give up; it may call `isSuperseded`
+    /// between expensive stages to stop once a newer rebuild has been requested.
+    func rebuild(_ build: @escaping Build) {
+        lock.lock()
+        let requested = request(build)
+        lock.unlock()
+        run(build, requested: requested)
+    }
+
+    /// Builds a new snapshot from the newest one requested, e.g. with other settings. Any thread.
+    ///
+    /// That is the front snapshot, or the result of a newer build still running, which then
+    /// runs again as the first stage of this one instead of being dropped for it.
+    ///
+    /// - returns: False if there is neither a snapshot nor a build to derive from.
+    @discardableResult
+    func rebuild(derivingFrom derive: @escaping (Snapshot, _ isSuperseded: @escaping () -> Bool) -> Snapshot?) -> Bool {
+        lock.lock()
+        let base = newestBuild, front = self.front
+        guard base != nil || front != nil else {
+            lock.unlock()
+            return false
+        }
+        let build: Build = { isSuperseded in
+            let snapshot: Snapshot?
+            if let base = base {
+                snapshot = base(isSuperseded)
+            } else {
+                snapshot = front
+            }
+            guard let derived = snapshot, !isSuperseded() else { return nil }
+            return derive(derived, isSuperseded)
+        }
+        let requested = request(build)
+        lock.unlock()
+        run(build, requested: requested)
+        return true
+    }
+
+    /// Blocks until all requested builds have finished, e.g. in tests.
+    func waitForBuilds() {
+        builds.wait()
+    }
+
+    /// Registers `build` as the newest request; call with the lock held.
+    private func request(_ build: @escaping Build) -> Int {
+        generation += 1
+        counters.requested += 1
+        newestBuild = build
+        return generation
+    }
+
+    private func run(_ build: @escaping Build, requested: Int) {
+        queue.async(group: builds) {
+            let start = CACurrentMediaTime()
+            let snapshot = build { self.isSuperseded(requested) }
+            let time = CACurrentMediaTime() - start
+
+            self.lock.lock()
+            let published = snapshot != nil && requested == self.generation
+            if requested == self.generation {
+                self.newestBuild = nil
+            }
+            if published {
+                self.front = snapshot
+                self.counters.published += 1
+            } else {
+                self.counters.dropped += 1
+            }
+            self.counters.lastBuildTime = time
+            self.counters.totalBuildTime += time
+            self.lock.unlock()
+
+            guard published, let swapped = snapshot else { return }
+            DispatchQueue.main.async {
+                guard self.current === swapped else { return }
+                self.didSwap?(swapped)
+            }
+        }
+    }
+
+    private func isSuperseded(_ requested: Int) -> Bool {
+        lock.lock()
+        defer { lock.unlock() }
+        return requested != generation
+    }
+}
@@ -0,0 +1,354 @@
+//
+//  StyleUpdater.swift
+//  DeepMapTestIOS
+//
+//  Created by agent on 18.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+import Foundation
+import HDMMapCore
+
+/// Styles that may have changed, reported by `StyleUpdater.didInvalidate`.
+enum StyleInvalidation {
+    /// Features whose resolved style may have changed.
+    case features([UInt64])
+    /// All features, e.g. after an attribute read by rules of unknown types changed.
+    case all
+}
+
+extension HDMMapView: StyleTarget {}
+
+/// Applies style, attribute and global attribute changes to an `HDMMapView`.
+///
+/// Calls that would not change anything are dropped, and the scene is refreshed at most once
+/// per main run loop pass instead of once per call. With a compiled `StyleSheet`, the updater
+/// knows which types have rules reading an attribute: changing an attribute no rule reads
+/// does not refresh the scene at all, and only the cached styles of affected features are
+/// invalidated and reported through `didInvalidate`. With a `FeatureStyleCache` that knows
+/// the feature's type, a feature attribute or selection change goes through that invalidation
+/// set alone: the map already has the new value of that one feature, so it only needs a
+/// frame, not `reloadStyle()`. Use from the main thread.
+final class StyleUpdater {
+
+    private struct StyleKey: Hashable {
+        let type: Symbol
+        let property: Symbol
+
+        var hashValue: Int {
+            return Int(type.rawValue) << 20 ^ Int(property.rawValue)
+        }
+
+        static func == (lhs: StyleKey, rhs: StyleKey) -> Bool {
+            return lhs.type == rhs.type && lhs.property == rhs.property
+        }
+    }
+
+    weak var mapView: StyleTarget?
+    /// The sheet the map was loaded with. Without it every attribute change refreshes the scene.
+    var sheet: StyleSheet?
+    var styleCache: FeatureStyleCache?
+    /// Kept current with `showFeatures`/`hideFeatures`.
+    var visibility: FeatureVisibility?
+    /// Kept current with name changes, see `TrigramIndex.update(featureId:key:value:)`.
+    var searchIndex: TrigramIndex?
+    /// Called before the scene is refreshed with the styles invalidated since the last refresh.
+    var didInvalidate: ((StyleInvalidation) -> Void)?
+    /// Asked for a frame after every refresh that changed the map.
+    weak var frameScheduler: FrameScheduler?
+
+    /// Number of calls dropped because they would not have changed anything.
+    private(set) var skippedCalls = 0
+    /// Number of scene refreshes issued.
+    private(set) var updates = 0
+
+    private var styles: [StyleKey: String] = [:]
+    private var visibleTypes: [Symbol: Bool] = [:]
+    /// Values set through the updater; nil for removed values.
+    private var attributes: [UInt64: [Symbol: String?]] = [:]
+    private var globals: [Symbol: String?] = [:]
+
+    private var needsUpdate = false
+    private var flushScheduled = false
+    private var invalidatedFeatures: [UInt64] = []
+    private var invalidatedAll = false
+    /// Whether features were restyled without a scene refresh since the last flush.
+    private var restyledFeatures = false
+
+    init(mapView: StyleTarget, sheet: StyleSheet? = nil) {
+        self.mapView = mapView
+        self.sheet = sheet
+    }
+
+    // MARK: - Styles
+
+    /// Same as `setFeatureStyle:propertyName:value:update:` with the update deferred.
+    @discardableResult
+    func setFeatureStyle(_ type: Symbol, property: Symbol, value: String) -> Bool {
+        let key = StyleKey(type: type, property: property)
+        if (styles[key] ?? sheet?.style(for: type)?.string(property)) == value {
+            skippedCalls += 1
+            return true
+        }
+        guard let mapView = mapView, mapView.setFeatureStyle(type, property: property, value: value, update: false) else {
+            return false
+        }
+        styles[key] = value
+        invalidate(type: type)
+        return true
+    }
+
+    func showFeatures(_ type: Symbol) {
+        setVisible(true, type: type)
+    }
+
+    func hideFeatures(_ type: Symbol) {
+        setVisible(false, type: type)
+    }
+
+    private func setVisible(_ visible: Bool, type: Symbol) {
+        if visibleTypes[type] == visible {
+            skippedCalls += 1
+            return
+        }
+        if visible {
+            mapView?.showFeatures(type, update: false)
+        } else {
+            mapView?.hideFeatures(type, update: false)
+        }
+        visibleTypes[type] = visible
+        visibility?.setTypeVisible(visible, type)
+        invalidate(type: type)
+    }
+
+    // MARK: - Attributes
+
+    func setFeatureAttribute(_ key: Symbol, value: String, featureId: UInt64) {
+        if let current = attributes[featureId]?[key], current == value {
+            skippedCalls += 1
+            return
+        }
+        mapView?.setFeatureAttribute(key.string, value: value, withFeatureId: featureId)
+        attributes[featureId, default: [:]].updateValue(value, forKey: key)
+        searchIndex?.update(featureId: featureId, key: key, value: value)
+        invalidate(featureId: featureId, readingAttribute: key)
+    }
+
+    func removeFeatureAttribute(_ key: Symbol, featureId: UInt64) {
+        if let current = attributes[featureId]?[key], current == nil {
+            skippedCalls += 1
+            return
+        }
+        mapView?.removeFeatureAttribute(key.string, withFeatureId: featureId)
+        attributes[featureId, default: [:]].updateValue(nil, forKey: key)
+        searchIndex?.update(featureId: featureId, key: key, value: nil)
+        invalidate(featureId: featureId, readingAttribute: key)
+    }
+
+    func setGlobalAttribute(_ key: Symbol, value: String) {
+        if let current = globals[key], current == value {
+            skippedCalls += 1
+            return
+        }
+        mapView?.setGlobalAttribute(key.string, value: value)
+        globals.updateValue(value, forKey: key)
+        invalidate(readingGlobalAttribute: key)
+    }
+
+    func removeGlobalAttribute(_ key: Symbol) {
+        if let current = globals[key], current == nil {
+            skippedCalls += 1
+            return
+        }
+        mapView?.removeGlobalAtribute(key.string)
+        globals.updateValue(nil, forKey: key)
+        invalidate(readingGlobalAttribute: key)
+    }
+
+    // MARK: - Selection
+
+    /// Selection and highlight state; changes reach the map when the updater flushes, so
+    /// states toggled back and forth within one run loop pass cost no map calls.
+    /// Replace it through `replaceStates(with:)` once the `FeatureTagStore` is loaded.
+    private(set) var states = FeatureStateBuffer(store: nil)
+
+    /// Switches to another state buffer, e.g. one backed by a newly loaded store. Pending
+    /// changes of the current buffer are sent and its selections and highlights cleared on
+    /// the map first, so the map never keeps a state the new buffer does not know about.
+    func replaceStates(with buffer: FeatureStateBuffer) {
+        for featureId in states.featureIds(with: .selected) {
+            states.remove(.selected, featureId: featureId)
+        }
+        for featureId in states.featureIds(with: .highlighted) {
+            states.remove(.highlighted, featureId: featureId)
+        }
+        if let mapView = mapView, states.hasPendingChanges, states.apply(to: mapView) > 0 {
+            frameScheduler?.requestFrame(.style)
+        }
+        states = buffer
+    }
+
+    func selectFeature(_ featureId: UInt64) {
+        setState(.selected, true, featureId: featureId)
+    }
+
+    func deselectFeature(_ featureId: UInt64) {
+        setState(.selected, false, featureId: featureId)
+    }
+
+    func highlightFeature(_ featureId: UInt64) {
+        setState(.highlighted, true, featureId: featureId)
+    }
+
+    func unhighlightFeature(_ featureId: UInt64) {
+        setState(.highlighted, false, featureId: featureId)
+    }
+
+    /// Features selected through the updater.
+    var selectedFeatures: [UInt64] {
+        return states.featureIds(with: .selected)
+    }
+
+    private func setState(_ state: FeatureState, _ enabled: Bool, featureId: UInt64) {
+        let changed = enabled ? states.insert(state, featureId: featureId) : states.remove(state, featureId: featureId)
+        guard changed else {
+            skippedCalls += 1
+            return
+        }
+        if state.contains(.selected) {
+            invalidate(featureIdReadingSelection: featureId)
+        }
+        scheduleFlush()
+    }
+
+    /// Current global attributes, for evaluating rules with `StyleContext`.
+    var globalAttributes: [Symbol: String] {
+        return StyleUpdater.present(globals)
+    }
+
+    func featureAttributes(of featureId: UInt64) -> [Symbol: String] {
+        return StyleUpdater.present(attributes[featureId] ?? [:])
+    }
+
+    private static func present(_ values: [Symbol: String?]) -> [Symbol: String] {
+        return values.reduce(into: [:]) { result, entry in
+            if let value = entry.value {
+                result[entry.key] = value
+            }
+        }
+    }
+
+    // MARK: - Refreshing
+
+    /// Refreshes the scene now if anything changed, instead of at the end of the run loop pass.
+    func flush() {
+        flushScheduled = false
+        if invalidatedAll {
+            didInvalidate?(.all)
+        } else if !invalidatedFeatures.isEmpty {
+            didInvalidate?(.features(invalidatedFeatures))
+        }
+        invalidatedAll = false
+        invalidatedFeatures = []
+
+        var changed = restyledFeatures
+        restyledFeatures = false
+        if let mapView = mapView, states.hasPendingChanges {
+            changed = states.apply(to: mapView) > 0 || changed
+        }
+        if needsUpdate {
+            needsUpdate = false
+            updates += 1
+            mapView?.reloadStyle()
+            changed = true
+        }
+        if changed {
+            frameScheduler?.requestFrame(.style)
+        }
+    }
+
+    /// Forgets the values sent to the map, e.g. after the map or its style files were switched
+    /// and the map no longer has them. Changes not flushed yet are dropped.
+    func reset() {
+        styles = [:]
+        visibleTypes = [:]
+        attributes = [:]
+        globals = [:]
+        needsUpdate = false
+        invalidatedFeatures = []
+        invalidatedAll = false
+        restyledFeatures = false
+    }
+
+    private func setNeedsUpdate() {
+        needsUpdate = true
+        scheduleFlush()
+    }
+
+    private func scheduleFlush() {
+        guard !flushScheduled else { return }
+        flushScheduled = true
+        DispatchQueue.main.async { [weak self] in
+            if let updater = self, updater.flushScheduled {
+                updater.flush()
+            }
+        }
+    }
+
+    private func invalidate(type: Symbol) {
+        if let sheet = sheet, let cache = styleCache {
+            let index = sheet.typeIndex(of: type)
+            invalidatedFeatures += cache.invalidate(types: sheet.types(inheritingFrom: index))
+        } else {
+            invalidatedAll = true
+        }
+        setNeedsUpdate()
+    }
+
+    private func invalidate(featureId: UInt64, readingAttribute key: Symbol) {
+        guard let sheet = sheet else {
+            invalidatedAll = true
+            setNeedsUpdate()
+            return
+        }
+        let readers = sheet.types(readingFeatureAttribute: key)
+        guard !readers.isEmpty else { return }
+        let type = styleCache?.typeIndex(ofFeature: featureId) ?? -1
+        guard let cache = styleCache, type >= 0 else {
+            // which rules apply to the feature is unknown, so the whole scene is refreshed
+            invalidatedFeatures.append(featureId)
+            setNeedsUpdate()
+            return
+        }
+        guard readers.contains(type) else { return }
+        cache.invalidate(features: [featureId])
+        invalidatedFeatures.append(featureId)
+        restyledFeatures = true
+        scheduleFlush()
+    }
+
+    private func invalidate(featureIdReadingSelection featureId: UInt64) {
+        guard let sheet = sheet, let cache = styleCache else { return }
+        let type = cache.typeIndex(ofFeature: featureId)
+        guard type >= 0 && sheet.dependencies(ofType: type).selection else { return }
+        cache.invalidate(features: [featureId])
+        invalidatedFeatures.append(featureId)
+        restyledFeatures = true
+    }
+
+    private func invalidate(readingGlobalAttribute key: Symbol) {
+        guard let sheet = sheet else {
+            invalidatedAll = true
+            setNeedsUpdate()
+            return
+        }
+        let readers = sheet.types(readingGlobalAttribute: key)
+        guard !readers.isEmpty else { return }
+        if let cache = styleCache {
+            invalidatedFeatures += cache.invalidate(types: readers)
+        } else {
+            invalidatedAll = true
+        }
+        setNeedsUpdate()
+    }
+}
@@ -0,0 +1,268 @@
+//
+//  TrigramIndex.swift
+//  DeepMapTestIOS
+//
+//  Created by agent on 18.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+import Foundation
+import HDMMapCore
+
+/// A match returned by `TrigramIndex.fuzzySearch`.
+struct FuzzySearchResult {
+    let featureId: UInt64
+    /// Attribute key the match was found in, e.g. "name:en".
+    let key: Symbol
+    /// The attribute value that matched.
+    let text: String
+    /// Trigram similarity in (0, 1], 1 meaning identical after normalization.
+    let score: Float
+}
+
+/// Trigram index over the names of all features, for typo-tolerant search.
+///
+/// Every `name:<locale>` and `maplabel:<locale>` value is split into normalized words, and
+/// each word into trigrams ("  hall " → "  h", " ha", "hal", "all", "ll "). A query is
+/// ranked by the Jaccard similarity of its trigram set with each indexed value.
+/// The index is updated per value through `update(featureId:key:value:)`; no rebuild needed.
+final class TrigramIndex {
+
+    private struct Document {
+        let featureId: UInt64
+        let key: Symbol
+        let locale: Symbol
+        let text: String
+        let trigramCount: Int
+        var alive: Bool
+    }
+
+    private struct DocumentKey: Hashable {
+        let featureId: UInt64
+        let key: Symbol
+
+        var hashValue: Int {
+            return featureId.hashValue ^ key.hashValue
+        }
+
+        static func == (lhs: DocumentKey, rhs: DocumentKey) -> Bool {
+            return lhs.featureId == rhs.featureId && lhs.key == rhs.key
+        }
+    }
+
+    /// Attribute key prefixes whose values are indexed.
+    static let indexedKeyPrefixes = ["name:", "maplabel:"]
+
+    private let lock = NSLock()
+    private var documents: [Document] = []
+    private var documentIds: [DocumentKey: Int32] = [:]
+    private var postings: [UInt64: [Int32]] = [:]
+    private var levels: [UInt64: Float] = [:]
+    private var deadDocuments = 0
+    /// Locale of every key seen so far, nil for keys that are not indexed.
+    private var localesOfKeys: [Symbol: Symbol?] = [:]
+
+    /// Indexes all names of `store`.
+    init(store: FeatureTagStore) {
+        let levelKey = store.key("level")
+        let indexedKeys = store.keySymbols.filter { self.locale(ofKey: $0) != nil }.flatMap { store.key($0) }
+
+        for row in 0..<store.count {
+            let view = FeatureView(store: store, row: row)
+            if let levelKey = levelKey, let level = view.value(for: levelKey).flatMap({ Float($0) }) {
+                levels[view.featureId] = level
+            }
+            for key in indexedKeys {
+                if let value = view.value(for: key) {
+                    insert(featureId: view.featureId, key: store.symbol(of: key), value: value)
+                }
+            }
+        }
+    }
+
+    /// Number of indexed attribute values.
+    var count: Int {
+        lock.lock()
+        defer { lock.unlock() }
+        return documents.count - deadDocuments
+    }
+
+    /// Updates the index after an attribute of a feature changed. Keys that are not indexed
+    /// are ignored, except "level" which updates the level filter of the feature.
+    func update(featureId: UInt64, key: Symbol, value: String?) {
+        lock.lock()
+        defer { lock.unlock() }
+
+        if key == TrigramIndex.levelKey {
+            levels[featureId] = value.flatMap { Float($0) }
+            return
+        }
+        guard locale(ofKey: key) != nil else { return }
+
+        if let existing = documentIds.removeValue(forKey: DocumentKey(featureId: featureId, key: key)) {
+            remove(existing)
+        }
+        if let value = value {
+            insert(featureId: featureId, key: key, value: value)
+        }
+        if deadDocuments > 1024 && deadDocuments * 2 > documents.count {
+            compact()
+        }
+    }
+
+    /// Returns up to `limit` features whose names are similar to `query`, best match first.
+    ///
+    /// - parameter locale: Only names in this locale are considered.
+    /// - parameter level: If set, only features on this level are considered.
+    /// - parameter minimumScore: Matches with a lower similarity are dropped.
+    /// - parameter budget: Time after which scoring stops and the best matches so far are returned.
+    func fuzzySearch(_ query: String, locale: String, level: Float? = nil, limit: Int = 10,
+                     minimumScore: Float = 0.3, budget: TimeInterval = 0.005) -> [FuzzySearchResult] {
+        let queryTrigrams = TrigramIndex.trigrams(of: TrigramIndex.normalize(query))
+        guard !queryTrigrams.isEmpty, limit > 0, let locale = SymbolTable.shared.lookup(locale) else { return [] }
+        let deadline = Date(timeIntervalSinceNow: budget)
+
+        lock.lock()
+        defer { lock.unlock() }
+
+        // shared trigram count per document, visiting rare trigrams first so that the
+        // most selective postings are scored if the budget runs out
+        var shared: [Int32: Int] = [:]
+        let lists = queryTrigrams.flatMap { postings[$0] }.sorted { $0.count < $1.count }
+        for (index, list) in lists.enumerated() {
+            if index > 0 && Date() > deadline {
+                break
+            }
+            for document in list {
+                shared[document, default: 0] += 1
+            }
+        }
+
+        // one result per feature, from its best matching value
+        var best: [UInt64: (Int32, Float)] = [:]
+        for (documentId, count) in shared {
+            let document = documents[Int(documentId)]
+            guard document.alive, document.locale == locale else { continue }
+            if let level = level, levels[document.featureId] != level {
+                continue
+            }
+            let score = Float(count) / Float(queryTrigrams.count + document.trigramCount - count)
+            guard score >= minimumScore else { continue }
+
+            if let current = best[document.featureId], current.1 >= score {
+                continue
+            }
+            best[document.featureId] = (documentId, score)
+        }
+
+        return best.values
+            .sorted { $0.1 != $1.1 ? $0.1 > $1.1 : documents[Int($0.0)].text < documents[Int($1.0)].text }
+            .prefix(limit)
+            .map { match -> FuzzySearchResult in
+                let document = documents[Int(match.0)]
+                return FuzzySearchResult(featureId: document.featureId, key: document.key, text: document.text, score: match.1)
+            }
+    }
+
+    // MARK: - Private
+
+    private func insert(featureId: UInt64, key: Symbol, value: String) {
+        guard let locale = self.locale(ofKey: key) else { return }
+        let trigrams = TrigramIndex.trigrams(of: TrigramIndex.normalize(value))
+        guard !trigrams.isEmpty else { return }
+
+        let documentId = Int32(documents.count)
+        documents.append(Document(featureId: featureId, key: key, locale: locale, text: value,
+                                  trigramCount: trigrams.count, alive: true))
+        documentIds[DocumentKey(featureId: featureId, key: key)] = documentId
+        for trigram in trigrams {
+            postings[trigram, default: []].append(documentId)
+        }
+    }
+
+    private func remove(_ documentId: Int32) {
+        documents[Int(documentId)].alive = false
+        deadDocuments += 1
+        for trigram in TrigramIndex.trigrams(of: TrigramIndex.normalize(documents[Int(documentId)].text)) {
+            guard var list = postings[trigram] else { continue }
+            // posting lists are ascending, documents are only ever appended
+            var low = 0
+            var high = list.count
+            while low < high {
+                let mid = (low + high) / 2
+                if list[mid] < documentId {
+                    low = mid + 1
+                } else {
+                    high = mid
+                }
+            }
+            if low < list.count && list[low] == documentId {
+                list.remove(at: low)
+            }
+            postings[trigram] = list.isEmpty ? nil : list
+        }
+    }
+
+    private func compact() {
+        let live = documents.filter { $0.alive }
+        documents = []
+        documentIds = [:]
+        postings = [:]
+        deadDocuments = 0
+        for document in live {
+            insert(featureId: document.featureId, key: document.key, value: document.text)
+        }
+    }
+
+    private static let levelKey = Symbol("level")
+
+    /// Called with `lock` held, except from `init`.
+    private func locale(ofKey key: Symbol) -> Symbol? {
+        if let locale = localesOfKeys[key] {
+            return locale
+        }
+        let name = key.string
+        let locale = TrigramIndex.indexedKeyPrefixes.first { name.hasPrefix($0) }.map { Symbol(String(name.dropFirst($0.count))) }
+        localesOfKeys[key] = .some(locale)
+        return locale
+    }
+
+    static func normalize(_ text: String) -> String {
+        let folded = text.folding(options: [.caseInsensitive, .diacriticInsensitive, .widthInsensitive], locale: nil)
+        var scalars = String.UnicodeScalarView()
+        for scalar in folded.unicodeScalars {
+            scalars.append(CharacterSet.alphanumerics.contains(scalar) ? scalar : " ")
+        }
+        return String(scalars)
+    }
+
+    /// Trigrams of all words of a normalized string, each packed as three 21-bit scalars.
+    static func trigrams(of normalized: String) -> Set<UInt64> {
+        var trigrams = Set<UInt64>()
+        for word in normalized.split(separator: " ") {
+            var window: (UInt64, UInt64) = (32, 32)
+            for scalar in word.unicodeScalars {
+                let value = UInt64(scalar.value)
+                trigrams.insert(window.0 << 42 | window.1 << 21 | value)
+                window = (window.1, value)
+            }
+            trigrams.insert(window.0 << 42 | window.1 << 21 | 32)
+        }
+        return trigrams
+    }
+}
+
+extension HDMMapView {
+
+    /// `setFeatureAttribute:value:withFeatureId:` that also keeps a search index current.
+    func setFeatureAttribute(_ key: String, value: String, withFeatureId featureId: UInt64, updating index: TrigramIndex?) {
+        setFeatureAttribute(key, value: value, withFeatureId: featureId)
+        index?.update(featureId: featureId, key: Symbol(key), value: value)
+    }
+
+    /// `removeFeatureAttribute:withFeatureId:` that also keeps a search index current.
+    func removeFeatureAttribute(_ key: String, withFeatureId featureId: UInt64, updating index: TrigramIndex?) {
+        removeFeatureAttribute(key, withFeatureId: featureId)
+        index?.update(featureId: featureId, key: Symbol(key), value: nil)
+    }
+}
@@ -0,0 +1,436 @@
+//
+//  TweenSystem.swift
+//  DeepMapTestIOS
+//
+//  Created by agent on 18.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+import QuartzCore
+import simd
+import HDMMapCore
+
+/// Curve a tween follows from its start to its end value.
+///
+/// The built-in curves are those of `HDMCameraEasingMode`; more are added with
+/// `TweenSystem.register(_:)`.
+struct TweenEasing: Equatable {
+    let rawValue: Int
+
+    static let linear = TweenEasing(rawValue: 0)
+    static let quadraticIn = TweenEasing(rawValue: 1)
+    static let quadraticOut = TweenEasing(rawValue: 2)
+    static let quadraticInOut = TweenEasing(rawValue: 3)
+    static let cubicIn = TweenEasing(rawValue: 4)
+    static let cubicOut = TweenEasing(rawValue: 5)
+    static let cubicInOut = TweenEasing(rawValue: 6)
+    /// Keeps the start value until the end.
+    static let constant = TweenEasing(rawValue: 7)
+    /// Jumps to the end value at once.
+    static let instant = TweenEasing(rawValue: 8)
+
+    fileprivate static let builtInCount = 9
+
+    init(rawValue: Int) {
+        self.rawValue = rawValue
+    }
+
+    init(_ mode: HDMCameraEasingMode) {
+        rawValue = Int(mode.rawValue)
+    }
+
+    static func == (lhs: TweenEasing, rhs: TweenEasing) -> Bool {
+        return lhs.rawValue == rhs.rawValue
+    }
+}
+
+/// Counters of a `TweenSystem`.
+struct TweenStatistics: CustomStringConvertible {
+    var frames = 0
+    /// Tweens and animated values of the last frame.
+    var tweens = 0
+    var lanes = 0
+    var completed = 0
+    var cancelled = 0
+    /// Time the last frame spent evaluating curves and handing out values.
+    var evaluationTime: CFTimeInterval = 0
+    var applyTime: CFTimeInterval = 0
+    /// Time spent in all frames.
+    var totalTime: CFTimeInterval = 0
+
+    var description: String {
+        return String(format: "%d tweens (%d values): %.3f ms easing, %.3f ms applying; %d frames, %.1f ms total",
+                      tweens, lanes, evaluationTime * 1000, applyTime * 1000, frames, totalTime * 1000)
+    }
+}
+
+/// Runs all of the app's animations, camera, annotations and feature styles, in one pass
+/// per frame.
+///
+/// A tween animates one or more values ("lanes") from a start to an end over the same time.
+/// Lanes are stored per easing curve in flat arrays of `float4`, so progress, easing and
+/// values of four lanes are computed at once and a frame costs a few vector operations per
+/// four values, however many tweens run. Custom curves get the progress of all their lanes
+/// in one buffer (`BatchEasingFunction`); `HDMMapEasingFunction1f` callbacks are adapted to
+/// that. Each tween's `update` then gets its values, and finished tweens are removed in one
+/// compaction pass. The display link pauses while nothing animates. Use from the main
+/// thread.
+final class TweenSystem {
+
+    /// Maps progress in [0, 1] to eased progress, in place.
+    typealias BatchEasingFunction = (UnsafeMutableBufferPointer<Float>) -> Void
+
+    /// Asked for a frame while tweens run.
+    weak var frameScheduler: FrameScheduler?
+
+    private(set) var statistics = TweenStatistics()
+
+    private struct Tween {
+        let group: Int
+        var firstLane: Int
+        let laneCount: Int
+        /// End time, relative to `epoch`.
+        let end: Float
+        let update: ((UnsafeBufferPointer<Float>) -> Void)?
+        let completion: ((Bool) -> Void)?
+    }
+
+    private var tweens: [Int: Tween] = [:]
+    /// Lanes per easing, indexed by `TweenEasing.rawValue`.
+    private var groups = [TweenGroup](repeating: TweenGroup(), count: TweenEasing.builtInCount)
+    private var customEasings: [BatchEasingFunction] = []
+    /// Groups holding lanes of removed tweens.
+    private var staleGroups = Set<Int>()
+    private var nextId = 1
+    /// Times are kept as `Float` seconds since this time.
+    private var epoch: CFTimeInterval = 0
+    private var cameraTween: Int?
+
+    private var displayLink: CADisplayLink?
+
+    deinit {
+        displayLink?.invalidate()
+    }
+
+    /// Starts stepping at display rate.
+    func start() {
+        guard displayLink == nil else { return }
+        let link = CADisplayLink(target: TweenLinkTarget(self), selector: #selector(TweenLinkTarget.tick(_:)))
+        link.add(to: .main, forMode: .commonModes)
+        link.isPaused = tweens.isEmpty
+        displayLink = link
+    }
+
+    func stop() {
+        displayLink?.invalidate()
+        displayLink = nil
+    }
+
+    /// Number of running tweens.
+    var count: Int {
+        return tweens.count
+    }
+
+    var isAnimating: Bool {
+        return !tweens.isEmpty
+    }
+
+    /// Adds a curve evaluated by `function`.
+    func register(_ function: @escaping BatchEasingFunction) -> TweenEasing {
+        customEasings.append(function)
+        groups.append(TweenGroup())
+        return TweenEasing(rawValue: groups.count - 1)
+    }
+
+    /// Adds a curve evaluated by a map easing function, called with a duration of 1.
+    func register(_ function: HDMMapEasingFunction1f, data: HDMMapEasingData? = nil) -> TweenEasing {
+        return register { progress in
+            for index in progress.indices {
+                progress[index] = function(Double(progress[index]), 0, 1, 1, data)
+            }
+        }
+    }
+
+    /// Animates `from.count` values to `to` over `duration` seconds (at least a millisecond),
+    /// starting `delay` seconds after `time`. `update` gets the values every frame, the last
+    /// time with the end values; `completion` gets false if the tween was cancelled.
+    @discardableResult
+    func add(from: [Float], to: [Float], duration: Double, delay: Double = 0, easing: TweenEasing = .cubicInOut,
+             at time: CFTimeInterval = CACurrentMediaTime(),
+             update: ((UnsafeBufferPointer<Float>) -> Void)?, completion: ((Bool) -> Void)? = nil) -> Int {
+        precondition(from.count == to.count && easing.rawValue >= 0 && easing.rawValue < groups.count)
+        if tweens.isEmpty {
+            epoch = time
+        }
+        let start = Float(time + delay - epoch), span = Float(max(duration, 0.001))
+        let id = nextId
+        nextId += 1
+        let firstLane = groups[easing.rawValue].laneCount
+        for (source, destination) in zip(from, to) {
+            groups[easing.rawValue].append(start: start, rate: 1 / span, from: source, change: destination - source)
+        }
+        groups[easing.rawValue].tweens.append(id)
+        tweens[id] = Tween(group: easing.rawValue, firstLane: firstLane, laneCount: from.count, end: start + span,
+                           update: update, completion: completion)
+        displayLink?.isPaused = false
+        frameScheduler?.requestFrame(.animation)
+        return id
+    }
+
+    /// The current values of a tween.
+    func values(of id: Int) -> [Float]? {
+        guard let tween = tweens[id] else { return nil }
+        let blocks = groups[tween.group].values
+        return (tween.firstLane..<tween.firstLane + tween.laneCount).map { blocks[$0 / 4][$0 % 4] }
+    }
+
+    /// Stops a tween where it is.
+    func cancel(_ id: Int) {
+        guard let tween = tweens.removeValue(forKey: id) else { return }
+        staleGroups.insert(tween.group)
+        statistics.cancelled += 1
+        tween.completion?(false)
+    }
+
+    func cancelAll() {
+        for id in Array(tweens.keys) {
+            cancel(id)
+        }
+    }
+
+    /// Evaluates all tweens at `time`; called by the display link.
+    func step(at time: CFTimeInterval) {
+        let begin = CACurrentMediaTime()
+        let now = Float(time - epoch)
+        compactStaleGroups()
+        var laneCount = 0
+        for index in groups.indices where !groups[index].tweens.isEmpty {
+            let custom = index >= TweenEasing.builtInCount ? customEasings[index - TweenEasing.builtInCount] : nil
+            groups[index].evaluate(at: now, easing: index, custom: custom)
+            laneCount += groups[index].laneCount
+        }
+        let evaluated = CACurrentMediaTime()
+
+        var finished: [Int] = []
+        for index in groups.indices where !groups[index].tweens.isEmpty {
+            let group = groups[index]
+            group.values.withUnsafeBufferPointer { (blocks: UnsafeBufferPointer<float4>) in
+                blocks.baseAddress!.withMemoryRebound(to: Float.self, capacity: blocks.count * 4) { values in
+                    for id in group.tweens {
+                        // an update may have cancelled tweens after it
+                        guard let tween = self.tweens[id] else { continue }
+                        tween.update?(UnsafeBufferPointer(start: values + tween.firstLane, count: tween.laneCount))
+                        if tween.end <= now {
+                            finished.append(id)
+                        }
+                    }
+                }
+            }
+        }
+        var completions: [(Bool) -> Void] = []
+        for id in finished {
+            guard let tween = tweens.removeValue(forKey: id) else { continue }
+            staleGroups.insert(tween.group)
+            if let completion = tween.completion {
+                completions.append(completion)
+            }
+        }
+        compactStaleGroups()
+
+        let end = CACurrentMediaTime()
+        statistics.frames += 1
+        statistics.tweens = tweens.count + finished.count
+        statistics.lanes = laneCount
+        statistics.completed += finished.count
+        statistics.evaluationTime = evaluated - begin
+        statistics.applyTime = end - evaluated
+        statistics.totalTime += end - begin
+        if laneCount > 0 {
+            frameScheduler?.requestFrame(.animation)
+        }
+        displayLink?.isPaused = tweens.isEmpty
+        // completions may start new tweens
+        for completion in completions {
+            completion(true)
+        }
+    }
+
+    private func compactStaleGroups() {
+        for index in staleGroups {
+            compact(index)
+        }
+        staleGroups.removeAll()
+    }
+
+    /// Drops the lanes of removed tweens from a group.
+    private func compact(_ index: Int) {
+        let group = groups[index]
+        var compacted = TweenGroup()
+        for id in group.tweens {
+            guard var tween = tweens[id] else { continue }
+            let firstLane = compacted.laneCount
+            for lane in tween.firstLane..<tween.firstLane + tween.laneCount {
+                compacted.append(lane: lane, of: group)
+            }
+            tween.firstLane = firstLane
+            tweens[id] = tween
+            compacted.tweens.append(id)
+        }
+        groups[index] = compacted
+    }
+
+    // MARK: - Map
+
+    /// Moves the camera of `mapView` to `camera`, replacing the previous camera tween.
+    @discardableResult
+    func animateCamera(of mapView: HDMMapView, to camera: HDMMapCamera, duration: Double,
+                       easing: TweenEasing = .cubicInOut) -> Int {
+        if let previous = cameraTween {
+            cancel(previous)
+        }
+        let source = mapView.camera
+        let from = source.lookAt, to = camera.lookAt
+        // the look-at point animates through a progress lane; Float is too coarse for coordinates
+        let id = add(from: [0, Float(source.distance), Float(source.bearingAngle), Float(source.tiltAngle)],
+                     to: [1, Float(camera.distance), Float(camera.bearingAngle), Float(camera.tiltAngle)],
+                     duration: duration, easing: easing, update: { [weak mapView] values in
+            let t = Double(values[0])
+            let lookAt = HDMMapCoordinateMake(from.x + (to.x - from.x) * t, from.y + (to.y - from.y) * t,
+                                              from.z + (to.z - from.z) * t)
+            mapView?.setCamera(HDMMapCamera(lookAt: lookAt, distance: Double(values[1]), bearingAngle: Double(values[2]),
+                                            tiltAngle: Double(values[3])), animated: false)
+        })
+        cameraTween = id
+        return id
+    }
+
+    /// Moves an annotation to `coordinate`.
+    @discardableResult
+    func animate(_ annotation: HDMAnnotation, to coordinate: HDMMapCoordinate, duration: Double,
+                 easing: TweenEasing = .cubicInOut) -> Int {
+        let from = annotation.coordinate
+        return add(from: [0], to: [1], duration: duration, easing: easing, update: { [weak annotation] values in
+            let t = Double(values[0])
+            annotation?.updateCoordinate(HDMMapCoordinateMake(from.x + (coordinate.x - from.x) * t,
+                                                              from.y + (coordinate.y - from.y) * t,
+                                                              from.z + (coordinate.z - from.z) * t), animated: false)
+        })
+    }
+
+    /// Animates a numeric feature attribute read by the style, e.g. an opacity. Values are
+    /// rounded to hundredths, so frames that would not change the style cost no map call.
+    @discardableResult
+    func animate(attribute key: Symbol, of featureId: UInt64, from: Float, to: Float, duration: Double,
+                 easing: TweenEasing = .cubicInOut, updater: StyleUpdater) -> Int {
+        return add(from: [from], to: [to], duration: duration, easing: easing, update: { [weak updater] values in
+            updater?.setFeatureAttribute(key, value: String(format: "%.2f", values[0]), featureId: featureId)
+        })
+    }
+}
+
+/// The lanes of all tweens with one easing, four to a `float4`. Unused lanes of the last
+/// block have a rate of zero.
+private struct TweenGroup {
+    var starts: [float4] = []
+    var rates: [float4] = []
+    var from: [float4] = []
+    var change: [float4] = []
+    var values: [float4] = []
+    /// Scratch space for eased progress.
+    var progress: [float4] = []
+    var laneCount = 0
+    /// Tweens in lane order.
+    var tweens: [Int] = []
+
+    mutating func append(start: Float, rate: Float, from source: Float, change delta: Float) {
+        if laneCount % 4 == 0 {
+            starts.append(float4(0))
+            rates.append(float4(0))
+            from.append(float4(0))
+            change.append(float4(0))
+            values.append(float4(0))
+            progress.append(float4(0))
+        }
+        let block = laneCount / 4, lane = laneCount % 4
+        starts[block][lane] = start
+        rates[block][lane] = rate
+        from[block][lane] = source
+        change[block][lane] = delta
+        values[block][lane] = source
+        laneCount += 1
+    }
+
+    mutating func append(lane: Int, of group: TweenGroup) {
+        let block = lane / 4, index = lane % 4
+        append(start: group.starts[block][index], rate: group.rates[block][index],
+               from: group.from[block][index], change: group.change[block][index])
+        values[(laneCount - 1) / 4][(laneCount - 1) % 4] = group.values[block][index]
+    }
+
+    mutating func evaluate(at now: Float, easing: Int, custom: TweenSystem.BatchEasingFunction?) {
+        let time = float4(now), zero = float4(0), one = float4(1)
+        for block in 0..<starts.count {
+            progress[block] = clamp((time - starts[block]) * rates[block], min: zero, max: one)
+        }
+        if let custom = custom {
+            let lanes = laneCount
+            progress.withUnsafeMutableBufferPointer { (blocks: inout UnsafeMutableBufferPointer<float4>) in
+                blocks.baseAddress!.withMemoryRebound(to: Float.self, capacity: blocks.count * 4) {
+                    custom(UnsafeMutableBufferPointer(start: $0, count: lanes))
+                }
+            }
+        } else {
+            for block in 0..<progress.count {
+                progress[block] = TweenGroup.ease(progress[block], easing)
+            }
+        }
+        for block in 0..<values.count {
+            values[block] = from[block] + change[block] * progress[block]
+        }
+    }
+
+    /// The built-in curves, four lanes at a time.
+    static func ease(_ t: float4, _ easing: Int) -> float4 {
+        let one = float4(1), two = float4(2), four = float4(4), half = float4(0.5)
+        switch easing {
+        case TweenEasing.quadraticIn.rawValue:
+            return t * t
+        case TweenEasing.quadraticOut.rawValue:
+            return t * (two - t)
+        case TweenEasing.quadraticInOut.rawValue:
+            let u = one - t
+            return mix(two * t * t, one - two * u * u, t: step(t, edge: half))
+        case TweenEasing.cubicIn.rawValue:
+            return t * t * t
+        case TweenEasing.cubicOut.rawValue:
+            let u = t - one
+            return u * u * u + one
+        case TweenEasing.cubicInOut.rawValue:
+            let u = t - one
+            return mix(four * t * t * t, four * u * u * u + one, t: step(t, edge: half))
+        case TweenEasing.constant.rawValue:
+            return step(t, edge: one)
+        case TweenEasing.instant.rawValue:
+            return one
+        default:
+            return t
+        }
+    }
+}
+
+/// Breaks the retain cycle between a display link and its tween system.
+private final class TweenLinkTarget: NSObject {
+    private weak var system: TweenSystem?
+
+    init(_ system: TweenSystem) {
+        self.system = system
+    }
+
+    @objc func tick(_ link: CADisplayLink) {
+        if let system = system {
+            system.step(at: link.timestamp)
+        } else {
+            link.invalidate()
+        }
+    }
+}
@@ -16,31 +16,215 @@ class ViewController: HDMMapViewController, HDMMapViewControllerDelegate {
     @IBOutlet weak var Food: UIImageView!
     var startPoint : HDMMapCoordinate?
     var endPoint : HDMMapCoordinate?
-    
+    var queryExecutor : LocatorQueryExecutor?
+    var tagStore : FeatureTagStore?
+    var styleSheet : StyleSheet?
+    var styleUpdater : StyleUpdater?
+    var frameScheduler : FrameScheduler?
+    var annotationLayer : AnnotationLayer?
+    var hitTester : HitTester?
+    var annotationMover : AnnotationMover?
+    var tweens : TweenSystem?
+    var extrusionLayer : ExtrusionLayer?
+    var is3DMode = false
+    var databasePath : String?
+    var appliedSnapshot : MapSnapshot?
+
+    /// App state of the displayed map, rebuilt in the background on map and style switches.
+    let snapshots = SnapshotBuffer<MapSnapshot>()
+
+    func mapViewControllerDidStart(_ controller: HDMMapViewController, error: Error?) {
+        guard error == nil else {return}
+        guard let map = controller.map, let databasePath = map.mapResources.databasePath, let projector = controller.mapView.projector else {return}
+
+        if self.frameScheduler == nil {
+            self.styleUpdater = StyleUpdater(mapView: controller.mapView)
+            // pins are drawn and clustered in one overlay; only a few get annotation views
+            self.annotationLayer = AnnotationLayer(mapView: controller.mapView)
+
+            // draw only when something changes instead of at display rate all day
+            let frameScheduler = FrameScheduler(controller: controller)
+            frameScheduler.start()
+            self.frameScheduler = frameScheduler
+            self.styleUpdater?.frameScheduler = frameScheduler
+
+            // tracked objects report positions in batches; pins glide between them
+            if let clusterer = self.annotationLayer?.clusterer {
+                let mover = AnnotationMover(clusterer: clusterer)
+                mover.didMove = { [weak self] in
+                    self?.annotationLayer?.update()
+                    self?.frameScheduler?.requestFrame(.annotation)
+                }
+                mover.start()
+                self.annotationMover = mover
+            }
+            // camera, annotation and style animations step together once per frame
+            let tweens = TweenSystem()
+            tweens.frameScheduler = frameScheduler
+            tweens.start()
+            self.tweens = tweens
+            self.snapshots.didSwap = { [weak self] snapshot in
+                self?.apply(snapshot)
+            }
+        }
+        guard databasePath != self.databasePath else {return}
+        self.databasePath = databasePath
+
+        // locator lookups for search and lists run off the main thread
+        self.queryExecutor = LocatorQueryExecutor(databasePath: databasePath, projector: projector)
+        // the previous package keeps its tags and styles until the new snapshot is swapped in,
+        // but its features must not be picked on the new map
+        self.hitTester = nil
+        let resources = map.mapResources
+        self.snapshots.rebuild { isSuperseded in
+            return MapSnapshot.build(resources: resources, projector: projector, isSuperseded: isSuperseded)
+        }
+    }
+
+    /// Hands a freshly built snapshot to the parts of the app that use it. Main thread.
+    func apply(_ snapshot: MapSnapshot) {
+        let previous = self.appliedSnapshot
+        self.appliedSnapshot = snapshot
+        let store = snapshot.store, styleSheet = snapshot.styleSheet
+        self.tagStore = store
+        self.hitTester = snapshot.hitTester
+        snapshot.hitTester.annotations = self.annotationLayer?.clusterer
+        self.queryExecutor?.searchIndex = snapshot.searchIndex
+
+        let sameMap = previous?.databasePath == snapshot.databasePath
+        if !sameMap || previous?.stylePaths ?? [] != snapshot.stylePaths {
+            // the map dropped the styles and attributes sent for the previous map or style files
+            self.styleUpdater?.reset()
+        }
+        self.styleSheet = styleSheet
+        self.styleUpdater?.sheet = styleSheet
+        self.styleUpdater?.searchIndex = snapshot.searchIndex
+        self.styleUpdater?.styleCache = snapshot.styleCache
+
+        // the engine shows the previous snapshot's styles, or the package's own after a map switch
+        let shownStylePaths = sameMap ? previous?.stylePaths ?? [] : snapshot.packageStylePaths
+        if shownStylePaths != snapshot.stylePaths && snapshot.stylePaths.count == 2 {
+            // the engine restyles its scene in place
+            self.mapView.switchStyles(snapshot.stylePaths[0], ruleFile: snapshot.stylePaths[1])
+            self.frameScheduler?.requestFrame(.style)
+        }
+        guard !sameMap else {return}
+        if let store = store {
+            self.styleUpdater?.replaceStates(with: FeatureStateBuffer(store: store))
+            self.styleUpdater?.visibility = snapshot.visibility
+        }
+        // buildings and stands are extruded from the cells, in the cells' projection
+        self.extrusionLayer?.removeAll()
+        self.extrusionLayer = nil
+        if let cells = snapshot.cells {
+            let extrusionLayer = ExtrusionLayer(mapView: self.mapView, projection: cells.metadata.projection ?? .zone32N)
+            extrusionLayer.isEnabled = self.is3DMode
+            extrusionLayer.load(cells) { [weak self] in
+                self?.updateExtrusions()
+            }
+            self.extrusionLayer = extrusionLayer
+        }
+    }
+
+    /// Picks the detail of the extruded buildings for the current camera and floor.
+    func updateExtrusions() {
+        guard let extrusionLayer = self.extrusionLayer else {return}
+        let camera = RenderCamera(camera: self.mapView.camera, projection: extrusionLayer.projection,
+                                  width: Int(self.mapView.bounds.width), height: Int(self.mapView.bounds.height))
+        extrusionLayer.update(camera: camera, level: self.mapView.currentLevel)
+    }
+
+    /// Opens another map package, e.g. one of `DeepMap.installedMaps()` or a .zip package.
+    ///
+    /// The package is opened and installed in the background while the current map stays
+    /// interactive; only the engine's own switch runs on the main thread, and the app state of
+    /// the new map follows from `mapViewControllerDidStart` without blocking it.
+    func switchMap(toPackageAt path: String) {
+        DispatchQueue.global(qos: .userInitiated).async {
+            guard let map = path.hasSuffix(".zip") ? DeepMap(package: path) : DeepMap(path: path) else {return}
+            guard map.isInstalled || map.installMap() else {return}
+            DispatchQueue.main.async {
+                self.map = map
+            }
+        }
+    }
+
+    /// Replaces the map's style and rule file. The style sheet is compiled in the background
+    /// against the newest requested snapshot, so a package still being built is restyled
+    /// rather than dropped, and the engine is switched when it is swapped in.
+    func switchStyles(_ stylePath: String, ruleFile rulePath: String) {
+        let requested = self.snapshots.rebuild(derivingFrom: { snapshot, isSuperseded in
+            return snapshot.restyled(stylePaths: [stylePath, rulePath], isSuperseded: isSuperseded)
+        })
+        if !requested {
+            self.mapView.switchStyles(stylePath, ruleFile: rulePath)
+        }
+    }
+
+    func mapViewControllerCameraDidChange(_ controller: HDMMapViewController) {
+        self.frameScheduler?.requestFrame(.camera)
+        self.annotationLayer?.update()
+        self.updateExtrusions()
+    }
+
+    func mapViewController(_ controller: HDMMapViewController, didUpdate userLocation: HDMUserLocation?) {
+        self.frameScheduler?.requestFrame(.location)
+    }
+
     func mapViewController(_ controller: HDMMapViewController, longPressedAt coordinate: HDMMapCoordinate, features: [HDMFeature]) {
         print("Set routing start point!")
-        self.startPoint = coordinate
+        // a long press on a pin starts the route at the pin
+        let pin = self.hitTest(at: coordinate).first?.pin.flatMap { self.annotationLayer?.clusterer.pin(withId: $0) }
+        self.startPoint = pin?.coordinate ?? coordinate
+    }
+
+    /// Pins and selectable features under a touch, nearest and most specific first.
+    func hitTest(at coordinate: HDMMapCoordinate) -> [MapHit] {
+        guard let hitTester = self.hitTester else {return []}
+        let camera = RenderCamera(camera: self.mapView.camera, width: Int(self.mapView.bounds.width), height: Int(self.mapView.bounds.height))
+        return hitTester.hitTest(at: coordinate, level: self.mapView.currentLevel, camera: camera)
     }
     
     func mapViewController(_ controller: HDMMapViewController, tappedAt coordinate: HDMMapCoordinate, features: [HDMFeature]) {
         
         self.endPoint = coordinate
-        guard let feature = features.first else {return}
-        print("Selecting object with ID \(feature.featureId)")
+        let hits = self.hitTest(at: coordinate)
+        if let pin = hits.first?.pin {
+            self.annotationLayer?.selectedPins = [pin]
+            if let coordinate = self.annotationLayer?.clusterer.pin(withId: pin)?.coordinate {
+                let camera = self.mapView.camera
+                self.tweens?.animateCamera(of: self.mapView, to: HDMMapCamera(lookAt: coordinate, distance: camera.distance,
+                                                                             bearingAngle: camera.bearingAngle, tiltAngle: camera.tiltAngle),
+                                           duration: 0.5)
+            }
+            return
+        }
+        // the map's pick is exact; the hit tester adds the touch radius for small lines and points it missed
+        guard let featureId = features.first?.featureId ?? hits.first(where: { $0.featureId != nil })?.featureId else {return}
+        print("Selecting object with ID \(featureId)")
         
         // tell the map to select the object that has been touched
-        self.mapView.selectFeature(withId: feature.featureId)
+        // through the updater, so its state buffer and the scene's isSelected() agree with the map
+        if let styleUpdater = self.styleUpdater {
+            for selected in styleUpdater.selectedFeatures where selected != featureId {
+                styleUpdater.deselectFeature(selected)
+            }
+            styleUpdater.selectFeature(featureId)
+        } else {
+            self.mapView.selectFeature(withId: featureId)
+        }
         
         //remove all previously added annotations
-        self.mapView.remove(self.mapView.annotations)
+        self.mapView.remove(self.mapView.annotations.filter { !(self.annotationLayer?.owns($0) ?? false) })
         
         //create a new annotation and add it to the map
         let annotation = HDMAnnotation(coordinate: coordinate)
-        annotation.title = "ObjectID \(feature.featureId)"
+        annotation.title = "ObjectID \(featureId)"
         annotation.subtitle = "This is subtitle"
         annotation.leftCalloutAccessoryView = Food
         annotation.rightCalloutAccessoryView = test
         self.mapView.add(annotation)
+        self.frameScheduler?.requestFrame(.annotation)
 
         
         
@@ -51,6 +235,7 @@ class ViewController: HDMMapViewController, HDMMapViewControllerDelegate {
         
         guard let route = routing.calculateRoute(from: startPoint, destinationPoint: coordinate) else {return}
         self.mapView.navigate(withPath: route, using: HDMUserTrackingModeNone)
+        self.frameScheduler?.animate(for: 1.0)
         // HDMUserTrackingMode
         // older sdk
         //self.mapView.navigate(withPath: route, using: HDMUserTrackingModeNone)
@@ -95,22 +280,28 @@ class ViewController: HDMMapViewController, HDMMapViewControllerDelegate {
         {
             self.mapView.set3DMode(false, animated: true)
         }
+        self.is3DMode = !sender.isOn
+        self.extrusionLayer?.isEnabled = self.is3DMode
+        self.updateExtrusions()
+        self.frameScheduler?.animate(for: 0.5)
 
     }
     
     func flip(sender: UISwitch!){
         
+        guard let styleUpdater = self.styleUpdater else {return}
+        // unchanged properties are skipped and the scene refreshes once
         if(sender.isOn == true)
         {
-            self.mapView.setFeatureStyle("building", propertyName: "fill-color", value: "#0000ff", update: false);
-            self.mapView.setFeatureStyle("stand_tables", propertyName: "visibility", value: "visible", update: false);
-            self.mapView.setFeatureStyle("stand_tables", propertyName: "text-visibility", value: "visible", update: true);
+            styleUpdater.setFeatureStyle("building", property: "fill-color", value: "#0000ff")
+            styleUpdater.setFeatureStyle("stand_tables", property: "visibility", value: "visible")
+            styleUpdater.setFeatureStyle("stand_tables", property: "text-visibility", value: "visible")
         }
         else
         {
-            self.mapView.setFeatureStyle("building", propertyName: "fill-color", value: "#ff0000", update: false);
-            self.mapView.setFeatureStyle("stand_tables", propertyName: "visibility", value: "none", update: false);
-            self.mapView.setFeatureStyle("stand_tables", propertyName: "text-visibility", value: "none", update: true);
+            styleUpdater.setFeatureStyle("building", property: "fill-color", value: "#ff0000")
+            styleUpdater.setFeatureStyle("stand_tables", property: "visibility", value: "none")
+            styleUpdater.setFeatureStyle("stand_tables", property: "text-visibility", value: "none")
         }
     }
 
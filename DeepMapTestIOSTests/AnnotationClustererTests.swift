@@ -0,0 +1,106 @@
+//
+//  AnnotationClustererTests.swift
+//  DeepMapTestIOSTests
+//
+//  Created by agent on 18.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+import XCTest
+import HDMMapCore
+@testable import DeepMapTestIOS
+
+class AnnotationClustererTests: XCTestCase {
+
+    /// A corner of a 32 m cell in Heidelberg.
+    let origin = RenderPoint(x: 477024, y: 5474016)
+
+    func pin(_ id: Int, x: Double, y: Double, level: Float = AnnotationClusterer.allLevels) -> MapPin {
+        let (longitude, latitude) = UTMProjection.zone32N.unproject(RenderPoint(x: origin.x + x, y: origin.y + y))
+        return MapPin(id: id, coordinate: HDMMapCoordinateMake(longitude, latitude, 0), level: level)
+    }
+
+    /// A top-down camera over (x, y) from the origin at `metersPerPixel`.
+    func camera(x: Double, y: Double, metersPerPixel: Double) -> RenderCamera {
+        let focalLength = 500 / tan(22.5 * .pi / 180)
+        return RenderCamera(center: RenderPoint(x: origin.x + x, y: origin.y + y), distance: focalLength * metersPerPixel,
+                            width: 1000, height: 1000)
+    }
+
+    func makeGrid(_ clusterer: AnnotationClusterer) {
+        clusterer.add((0..<100).map { pin($0, x: Double($0 % 10) + 0.5, y: Double($0 / 10) + 0.5) })
+    }
+
+    func testClustersByZoom() {
+        let clusterer = AnnotationClusterer()
+        makeGrid(clusterer)
+
+        let far = clusterer.markers(camera: camera(x: 5, y: 5, metersPerPixel: 1), level: 0)
+        XCTAssertEqual(far.map { $0.count }, [100])
+        XCTAssertNil(far[0].pin)
+        XCTAssertEqual(far[0].x, 500, accuracy: 1)
+        XCTAssertEqual(far[0].y, 500, accuracy: 1)
+
+        let near = clusterer.markers(camera: camera(x: 5, y: 5, metersPerPixel: 0.01), level: 0)
+        XCTAssertEqual(near.count, 100)
+        XCTAssertEqual(Set(near.flatMap { $0.pin }), Set(0..<100))
+    }
+
+    func testVisitsVisibleCellsOnly() {
+        let clusterer = AnnotationClusterer()
+        makeGrid(clusterer)
+        clusterer.add((0..<50_000).map { pin(1000 + $0, x: 10_000 + Double($0 % 250) * 4, y: Double($0 / 250) * 4) })
+        XCTAssertEqual(clusterer.count, 50_100)
+
+        let near = clusterer.markers(camera: camera(x: 5, y: 5, metersPerPixel: 0.01), level: 0)
+        XCTAssertEqual(near.count, 100)
+        XCTAssertEqual(clusterer.visitedCells, 100)
+
+        let overview = clusterer.markers(camera: camera(x: 5000, y: 400, metersPerPixel: 20), level: 0)
+        XCTAssertEqual(overview.reduce(0) { $0 + $1.count }, 50_100)
+        XCTAssertLessThan(overview.count, 1000)
+    }
+
+    func testRemovesAndReplacesPins() {
+        let clusterer = AnnotationClusterer()
+        makeGrid(clusterer)
+        clusterer.remove(ids: Array(0..<50))
+        clusterer.add([pin(99, x: 40.5, y: 40.5)])
+        XCTAssertEqual(clusterer.count, 50)
+
+        let far = clusterer.markers(camera: camera(x: 20, y: 20, metersPerPixel: 1), level: 0)
+        XCTAssertEqual(far.map { $0.count }.sorted(), [1, 49])
+        XCTAssertEqual(far.first { $0.count == 1 }?.pin, 99)
+
+        clusterer.removeAll()
+        XCTAssertTrue(clusterer.markers(camera: camera(x: 20, y: 20, metersPerPixel: 1), level: 0).isEmpty)
+    }
+
+    func testSeparatesFloors() {
+        let clusterer = AnnotationClusterer()
+        clusterer.add([pin(1, x: 1.5, y: 1.5, level: 0), pin(2, x: 3.5, y: 3.5, level: 1), pin(3, x: 5.5, y: 5.5)])
+        let view = camera(x: 4, y: 4, metersPerPixel: 0.01)
+
+        XCTAssertEqual(Set(clusterer.markers(camera: view, level: 0).flatMap { $0.pin }), [1, 3])
+        XCTAssertEqual(Set(clusterer.markers(camera: view, level: 1).flatMap { $0.pin }), [2, 3])
+    }
+
+    func testPlacesPinsForTheAssumedFieldOfView() {
+        let clusterer = AnnotationClusterer()
+        clusterer.add([pin(1, x: 5, y: 10), pin(2, x: 7, y: 5)])
+        var view = camera(x: 5, y: 5, metersPerPixel: 0.05)
+
+        // 20 pixels per meter at the 45° the overlay assumes
+        let markers = clusterer.markers(camera: view, level: 0).sorted { $0.pin! < $1.pin! }
+        XCTAssertEqual(markers.map { $0.pin! }, [1, 2])
+        XCTAssertEqual(markers[0].x, 500, accuracy: 0.5)
+        XCTAssertEqual(markers[0].y, 400, accuracy: 0.5)
+        XCTAssertEqual(markers[1].x, 540, accuracy: 0.5)
+        XCTAssertEqual(markers[1].y, 500, accuracy: 0.5)
+
+        // a wider engine field of view moves pins toward the center
+        view.fieldOfView = 60
+        let wide = clusterer.markers(camera: view, level: 0).first { $0.pin == 1 }!
+        XCTAssertEqual(wide.y, 500 - 5 * 500 / tan(30 * .pi / 180) / view.distance, accuracy: 0.5)
+    }
+}
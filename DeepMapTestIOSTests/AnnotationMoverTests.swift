@@ -0,0 +1,88 @@
+//
+//  AnnotationMoverTests.swift
+//  DeepMapTestIOSTests
+//
+//  Created by agent on 18.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+import XCTest
+import HDMMapCore
+@testable import DeepMapTestIOS
+
+class AnnotationMoverTests: XCTestCase {
+
+    let origin = RenderPoint(x: 477000, y: 5474000)
+
+    func coordinate(_ x: Double, _ y: Double) -> HDMMapCoordinate {
+        let (longitude, latitude) = UTMProjection.zone32N.unproject(RenderPoint(x: origin.x + x, y: origin.y + y))
+        return HDMMapCoordinateMake(longitude, latitude, 0)
+    }
+
+    func makeMover(pins: Int) -> AnnotationMover {
+        let clusterer = AnnotationClusterer()
+        clusterer.add((0..<pins).map { MapPin(id: $0, coordinate: coordinate(Double($0), 0)) })
+        return AnnotationMover(clusterer: clusterer)
+    }
+
+    func testGlidesToNewPosition() {
+        let mover = makeMover(pins: 1)
+        var moves = 0
+        mover.didMove = { moves += 1 }
+
+        mover.update(pins: [(id: 0, coordinate: coordinate(10, 0))])
+        mover.step(at: 0)
+        XCTAssertEqual(mover.clusterer.position(ofPin: 0)!.x - origin.x, 0, accuracy: 1e-3)
+        XCTAssertEqual(mover.clusterer.pin(withId: 0)!.coordinate.x, coordinate(10, 0).x)
+
+        mover.step(at: 0.125)
+        XCTAssertEqual(mover.clusterer.position(ofPin: 0)!.x - origin.x, 5, accuracy: 1e-3)
+        mover.step(at: 0.25)
+        XCTAssertEqual(mover.clusterer.position(ofPin: 0)!.x - origin.x, 10, accuracy: 1e-3)
+        XCTAssertFalse(mover.isAnimating)
+        XCTAssertEqual(moves, 3)
+
+        // the next update arrives 0.5 s later, so the pin takes 0.5 s to get there
+        mover.update(pins: [(id: 0, coordinate: coordinate(20, 0))])
+        mover.step(at: 0.5)
+        mover.step(at: 0.75)
+        XCTAssertEqual(mover.clusterer.position(ofPin: 0)!.x - origin.x, 15, accuracy: 1e-3)
+    }
+
+    func testCoalescesAndBoundsWork() {
+        let mover = makeMover(pins: 10)
+        mover.maximumMovesPerFrame = 4
+
+        mover.update(pins: [(id: 0, coordinate: coordinate(5, 5)), (id: 0, coordinate: coordinate(6, 6))])
+        mover.update(pins: (1..<10).map { (id: $0, coordinate: coordinate(Double($0), 10)) })
+        mover.step(at: 0)
+        XCTAssertEqual(mover.statistics.updates, 11)
+        XCTAssertEqual(mover.statistics.coalesced, 1)
+        XCTAssertEqual(mover.statistics.pinMoves, 4)
+
+        for frame in 1...3 {
+            mover.step(at: Double(frame))
+        }
+        XCTAssertFalse(mover.isAnimating)
+        XCTAssertEqual(mover.clusterer.position(ofPin: 0)!.y - origin.y, 6, accuracy: 1e-3)
+        XCTAssertEqual(mover.clusterer.position(ofPin: 9)!.y - origin.y, 10, accuracy: 1e-3)
+    }
+
+    func testDropsTracksOfRemovedPins() {
+        let mover = makeMover(pins: 3)
+        mover.update(pins: (0..<3).map { (id: $0, coordinate: coordinate(Double($0), 10)) })
+        mover.step(at: 0)
+        XCTAssertEqual(mover.trackCount, 3)
+
+        mover.clusterer.remove(ids: [0])
+        mover.step(at: 0.125)
+        XCTAssertEqual(mover.trackCount, 2)
+        mover.step(at: 1)
+        XCTAssertFalse(mover.isAnimating)
+        XCTAssertEqual(mover.clusterer.position(ofPin: 2)!.y - origin.y, 10, accuracy: 1e-3)
+
+        mover.clusterer.removeAll()
+        mover.step(at: 2)
+        XCTAssertEqual(mover.trackCount, 0)
+    }
+}
@@ -0,0 +1,111 @@
+//
+//  ExtrusionBuilderTests.swift
+//  DeepMapTestIOSTests
+//
+//  Created by agent on 18.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+import XCTest
+@testable import DeepMapTestIOS
+
+class ExtrusionBuilderTests: XCTestCase {
+
+    func ring(_ coordinates: [(Double, Double)]) -> [RenderPoint] {
+        return coordinates.map { RenderPoint(x: $0.0, y: $0.1) }
+    }
+
+    func area(_ points: [RenderPoint], _ triangles: [Int]) -> Double {
+        return stride(from: 0, to: triangles.count, by: 3).reduce(0) { total, index in
+            total + ExtrusionBuilder.signedArea([points[triangles[index]], points[triangles[index + 1]], points[triangles[index + 2]]]) / 2
+        }
+    }
+
+    func testTriangulatesConcaveFootprintsWithHoles() {
+        let shape = ring([(0, 0), (20, 0), (20, 10), (10, 10), (10, 20), (0, 20)])
+        let concave = ExtrusionBuilder.triangulate([shape])
+        XCTAssertEqual(concave.triangles.count, 4 * 3)
+        XCTAssertEqual(area(concave.points, concave.triangles), 300, accuracy: 1e-9)
+
+        let outer = ring([(0, 0), (30, 0), (30, 30), (0, 30)])
+        let courtyard = ring([(10, 10), (10, 20), (20, 20), (20, 10)])
+        let holed = ExtrusionBuilder.triangulate([outer, courtyard])
+        XCTAssertEqual(holed.triangles.count, 8 * 3)
+        XCTAssertEqual(area(holed.points, holed.triangles), 800, accuracy: 1e-9)
+        for index in stride(from: 0, to: holed.triangles.count, by: 3) {
+            XCTAssertGreaterThan(area(holed.points, Array(holed.triangles[index..<index + 3])), 0)
+        }
+    }
+
+    func testFindsEnclosingRectangle() {
+        let angle = 0.3, (c, s) = (cos(angle), sin(angle))
+        let rotated = ring([(0, 0), (40, 0), (40, 10), (0, 10)]).map { RenderPoint(x: $0.x * c - $0.y * s, y: $0.x * s + $0.y * c) }
+        let rectangle = ExtrusionBuilder.enclosingRectangle(rotated)
+        XCTAssertEqual(rectangle.count, 4)
+        XCTAssertEqual(ExtrusionBuilder.signedArea(rectangle) / 2, 400, accuracy: 1e-6)
+
+        let triangle = ring([(0, 0), (10, 0), (0, 10)])
+        XCTAssertEqual(ExtrusionBuilder.signedArea(ExtrusionBuilder.enclosingRectangle(triangle)) / 2, 100, accuracy: 1e-6)
+    }
+
+    func testBuildsBatchesAtTwoDetails() {
+        let primitives = [
+            RenderPrimitive(featureId: 1, type: "building", level: 0,
+                            geometry: .polygon([ring([(0, 0), (20, 0), (20, 10), (10, 10), (10, 20), (0, 20), (0, 0)])])),
+            RenderPrimitive(featureId: 2, type: "building", level: 0, geometry: .polygon([ring([(30, 0), (40, 0), (40, 10), (30, 10)])])),
+            RenderPrimitive(featureId: 3, type: "room", level: 1, geometry: .polygon([ring([(0, 0), (5, 0), (5, 5), (0, 5)])])),
+            RenderPrimitive(featureId: 4, type: "building", level: 0, geometry: .polygon([ring([(500, 500), (510, 500), (510, 510)])])),
+            RenderPrimitive(featureId: 5, type: "atm", level: 0, geometry: .point(RenderPoint(x: 1, y: 1))),
+        ]
+        let heights: [UInt64: (minimum: Double, maximum: Double)] = [1: (0, 12), 2: (0, 8), 3: (5, 7), 5: (0, 2)]
+        let footprints = ExtrusionBuilder.footprints(in: primitives) { heights[$0] }
+        XCTAssertEqual(footprints.map { $0.featureId }, [1, 2, 3])
+        XCTAssertEqual(footprints[2].base, 5)
+        XCTAssertEqual(footprints[2].top, 7)
+
+        let batches = ExtrusionBuilder.batches(footprints)
+        XCTAssertEqual(batches.count, 2)
+        let ground = batches.first { $0.level == 0 }!
+        XCTAssertEqual(ground.featureIds, [1, 2])
+        XCTAssertEqual(ground.origin.x, 20)
+        // full: 6 + 4 walls and two roofs, block: two boxes
+        XCTAssertEqual(ground.meshes[ExtrusionDetail.full.rawValue].indices.count / 3, 10 * 2 + 4 + 2)
+        XCTAssertEqual(ground.meshes[ExtrusionDetail.full.rawValue].vertexCount, 10 * 4 + 6 + 4)
+        XCTAssertEqual(ground.meshes[ExtrusionDetail.block.rawValue].indices.count / 3, 2 * (4 * 2 + 2))
+        XCTAssertEqual(ground.meshes[ExtrusionDetail.block.rawValue].positions.enumerated()
+            .filter { $0.offset % 3 == 1 }.map { $0.element }.max(), 12)
+
+        let parsed = try? OBJMesh.parse(ground.meshes[0].objData())
+        XCTAssertEqual(parsed?.indices.count, ground.meshes[0].indices.count)
+    }
+
+    func testPicksDetailWithHysteresis() {
+        func detail(_ size: Double, _ current: ExtrusionDetail?) -> ExtrusionDetail {
+            return ExtrusionLayer.detail(forSize: size, current: current, full: 160, minimum: 12)
+        }
+        XCTAssertEqual(detail(200, nil), .full)
+        XCTAssertEqual(detail(170, nil), .block)
+        XCTAssertEqual(detail(13, nil), .hidden)
+        XCTAssertEqual(detail(140, .full), .full)
+        XCTAssertEqual(detail(100, .full), .block)
+        XCTAssertEqual(detail(180, .block), .block)
+        XCTAssertEqual(detail(11, .block), .block)
+        XCTAssertEqual(detail(9, .block), .hidden)
+    }
+
+    func testExtrudesPackageObjects() throws {
+        let cellPath = URL(fileURLWithPath: #file).deletingLastPathComponent().deletingLastPathComponent()
+            .appendingPathComponent("DeepMapTestIOS/DeepMap/mapdata/tiles").path
+        let cells = try MapCellSource(cellPath: cellPath)
+        let footprints = ExtrusionBuilder.footprints(in: cells.primitives(level: nil), heights: ExtrusionBuilder.heights(in: cells))
+
+        // an OSM building around the venue, 10 m high
+        XCTAssertEqual(footprints.first { $0.featureId == 15938 }?.base, 0)
+        XCTAssertEqual(footprints.first { $0.featureId == 15938 }?.top, 10)
+        // stands on the first floor start at its elevation, 10 m up
+        XCTAssertEqual(footprints.first { $0.featureId == 19402 }?.base, 10)
+        XCTAssertEqual(footprints.first { $0.featureId == 19402 }?.top, 12)
+        XCTAssertFalse(footprints.contains { $0.top <= $0.base })
+        XCTAssertFalse(ExtrusionBuilder.batches(footprints).isEmpty)
+    }
+}
@@ -0,0 +1,65 @@
+//
+//  FeatureStateBufferTests.swift
+//  DeepMapTestIOSTests
+//
+//  Created by agent on 18.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+import XCTest
+@testable import DeepMapTestIOS
+
+class FeatureStateBufferTests: XCTestCase {
+
+    let store = FeatureTagStore(tags: (1...8).map { (UInt64($0), "level", "0") })
+
+    func testAppliesOnlyNetChanges() {
+        let buffer = FeatureStateBuffer(store: store)
+        let target = RecordingStyleTarget()
+
+        XCTAssertTrue(buffer.insert(.highlighted, featureId: 3))
+        XCTAssertFalse(buffer.insert(.highlighted, featureId: 3))
+        XCTAssertTrue(buffer.remove(.highlighted, featureId: 3))
+        XCTAssertTrue(buffer.insert(.selected, featureId: 5))
+        // not in the store
+        XCTAssertTrue(buffer.insert([.selected, .highlighted], featureId: 42))
+        XCTAssertEqual(buffer.version, 4)
+
+        XCTAssertEqual(buffer.apply(to: target), 3)
+        XCTAssertEqual(target.calls, ["select 5", "select 42", "highlight 42"])
+        XCTAssertFalse(buffer.hasPendingChanges)
+        XCTAssertEqual(buffer.apply(to: target), 0)
+
+        buffer.remove(.selected, featureId: 5)
+        buffer.remove(.highlighted, featureId: 42)
+        XCTAssertEqual(buffer.apply(to: target), 2)
+        XCTAssertEqual(Array(target.calls.suffix(2)), ["deselect 5", "unhighlight 42"])
+    }
+
+    func testReportsStatesPerRow() {
+        let buffer = FeatureStateBuffer(store: store)
+        buffer.insert(.selected, featureId: 2)
+        buffer.insert(.selected, featureId: 7)
+        buffer.insert(.highlighted, featureId: 7)
+
+        XCTAssertEqual(buffer.featureIds(with: .selected), [2, 7])
+        XCTAssertEqual(buffer.featureIds(with: [.selected, .highlighted]), [7])
+        XCTAssertEqual(buffer.state(of: 7), [.selected, .highlighted])
+        let rows = buffer.withStates { Array($0) }
+        XCTAssertEqual(rows.count, 8)
+        XCTAssertEqual(rows[store.row(ofFeature: 2)!], FeatureState.selected.rawValue)
+    }
+
+    func testReplacingStatesClearsTheMap() {
+        let target = RecordingStyleTarget()
+        let updater = StyleUpdater(mapView: target)
+        updater.selectFeature(2)
+        updater.flush()
+        updater.highlightFeature(4)
+
+        updater.replaceStates(with: FeatureStateBuffer(store: store))
+        // the pending highlight never reached the map, so it costs no call
+        XCTAssertEqual(target.calls, ["select 2", "deselect 2"])
+        XCTAssertEqual(updater.selectedFeatures, [])
+    }
+}
@@ -0,0 +1,43 @@
+//
+//  FeatureTagStoreTests.swift
+//  DeepMapTestIOSTests
+//
+//  Created by agent on 18.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+import XCTest
+@testable import DeepMapTestIOS
+
+class FeatureTagStoreTests: XCTestCase {
+
+    func makeStore() -> FeatureTagStore {
+        var tags: [(UInt64, String, String)] = []
+        for id in UInt64(1)...UInt64(40) {
+            tags.append((id, "level", String(id % 3)))
+            tags.append((id, "name:en", "Room \(id)"))
+        }
+        tags.append((7, "name:de", "Raum 7"))
+        tags.append((7, "name", "R7"))
+        return FeatureTagStore(tags: tags)
+    }
+
+    func testLocalizedLookupFallsBack() {
+        let store = makeStore()
+        let key = store.localizedKey("name", locale: "de")
+
+        XCTAssertEqual(store.view(forFeature: 7)?.value(for: key), "Raum 7")
+        XCTAssertNil(store.view(forFeature: 8)?.value(for: key))
+        XCTAssertEqual(store.view(forFeature: 8)?.value(forKey: "name", locale: "en"), "Room 8")
+    }
+
+    func testDenseAndSparseColumnsAgree() {
+        let store = makeStore()
+        let view = store.view(forFeature: 7)!
+
+        XCTAssertEqual(view.value(forKey: "level"), "1")
+        XCTAssertEqual(view.value(forKey: "name"), "R7")
+        XCTAssertEqual(view.attributes.count, 4)
+        XCTAssertNil(store.view(forFeature: 41))
+    }
+}
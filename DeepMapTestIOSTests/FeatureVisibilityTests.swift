@@ -0,0 +1,90 @@
+//
+//  FeatureVisibilityTests.swift
+//  DeepMapTestIOSTests
+//
+//  Created by agent on 18.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+import XCTest
+@testable import DeepMapTestIOS
+
+class FeatureVisibilityTests: XCTestCase {
+
+    func makeVisibility() -> FeatureVisibility {
+        let store = FeatureTagStore(tags: [
+            (1, "level", "0"), (1, "visibility_profile", "building"),
+            (2, "level", "1"), (2, "visibility_profile", "in_building"),
+            (3, "level", "1"),
+            (4, "name:en", "Campus"),
+        ])
+        return FeatureVisibility(store: store)
+    }
+
+    func testBitset() {
+        var bitset = FeatureBitset(count: 70)
+        bitset[3] = true
+        bitset[69] = true
+        var rows: [Int] = []
+        bitset.forEachRow { rows.append($0) }
+
+        XCTAssertEqual(rows, [3, 69])
+        XCTAssertEqual(bitset.complement().cardinality, 68)
+        XCTAssertEqual(FeatureBitset(count: 70, filled: true), bitset.complement().union(bitset))
+    }
+
+    func testSourcesCombine() {
+        let visibility = makeVisibility()
+        XCTAssertEqual(visibility.visible.cardinality, 4)
+
+        visibility.setProfileVisible(false, "in_building")
+        XCTAssertFalse(visibility.isVisible(2))
+        visibility.setVisibleLevels([0])
+        XCTAssertEqual([1, 2, 3, 4].filter { visibility.isVisible($0) }, [1, 4])
+
+        visibility.setFeatureType("stand", forFeature: 1)
+        visibility.setTypeVisible(false, "stand")
+        XCTAssertFalse(visibility.isVisible(1))
+        visibility.setTypeVisible(true, "stand")
+        visibility.setProfileVisible(true, "in_building")
+        visibility.setVisibleLevels(nil)
+        XCTAssertEqual(visibility.visible.cardinality, 4)
+    }
+
+    func testRowsOfSeveralTypesStayHiddenWhileOneIs() {
+        let store = FeatureTagStore(tags: [(1, "level", "0"), (2, "level", "0")])
+        let point = RenderPoint(x: 0, y: 0)
+        let visibility = FeatureVisibility(store: store, types: [
+            RenderPrimitive(featureId: 1, type: "building", level: 0, geometry: .point(point)),
+            RenderPrimitive(featureId: 1, type: "stand", level: 0, geometry: .point(point)),
+            RenderPrimitive(featureId: 2, type: "stand", level: 0, geometry: .point(point)),
+        ])
+
+        visibility.setTypeVisible(false, "building")
+        visibility.setTypeVisible(false, "stand")
+        visibility.setTypeVisible(true, "stand")
+        XCTAssertFalse(visibility.isVisible(1))
+        XCTAssertTrue(visibility.isVisible(2))
+        visibility.setTypeVisible(true, "building")
+        XCTAssertTrue(visibility.isVisible(1))
+    }
+
+    func testHidingTypesThroughTheStyleUpdater() {
+        let store = FeatureTagStore(tags: [(1, "level", "0"), (2, "level", "0"), (3, "level", "1")])
+        let point = RenderPoint(x: 0, y: 0)
+        let locations = [
+            RenderPrimitive(featureId: 1, type: "stand", level: 0, geometry: .point(point)),
+            RenderPrimitive(featureId: 2, type: "room", level: 0, geometry: .point(point)),
+            RenderPrimitive(featureId: 3, type: "stand", level: 1, geometry: .point(point)),
+        ]
+        let target = RecordingStyleTarget()
+        let updater = StyleUpdater(mapView: target)
+        updater.visibility = FeatureVisibility(store: store, types: locations)
+
+        updater.hideFeatures("stand")
+        XCTAssertEqual([1, 2, 3].filter { updater.visibility!.isVisible($0) }, [2])
+        XCTAssertEqual(target.calls, ["hide stand"])
+        updater.showFeatures("stand")
+        XCTAssertEqual(updater.visibility?.visible.cardinality, 3)
+    }
+}
@@ -0,0 +1,88 @@
+//
+//  FloorCullerTests.swift
+//  DeepMapTestIOSTests
+//
+//  Created by agent on 18.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+import XCTest
+@testable import DeepMapTestIOS
+
+class FloorCullerTests: XCTestCase {
+
+    func square(_ featureId: UInt64, _ type: Symbol, level: Float, x: Double, y: Double, size: Double) -> RenderPrimitive {
+        return RenderPrimitive(featureId: featureId, type: type, level: level, geometry: .polygon([[
+            RenderPoint(x: x, y: y), RenderPoint(x: x + size, y: y), RenderPoint(x: x + size, y: y + size), RenderPoint(x: x, y: y + size),
+        ]]))
+    }
+
+    /// Looks down on floor 1 (4 m up) from 400 m above, seeing about 330 m across.
+    func makeCamera() -> RenderCamera {
+        return RenderCamera(center: RenderPoint(x: 50, y: 50, z: 4), distance: 400, width: 256, height: 256)
+    }
+
+    func testFrustumAndFloorOcclusion() {
+        let culler = FloorCuller(primitives: [
+            square(1, "fg_polygons", level: 1, x: 0, y: 0, size: 100),
+            square(12, "room", level: 1, x: 1000, y: 0, size: 10),
+            square(10, "room", level: 0, x: 40, y: 40, size: 20),
+            square(11, "room", level: 0, x: 200, y: 40, size: 10),
+            square(20, "room", level: 2, x: 40, y: 40, size: 20),
+        ], floorHeight: 4)
+        culler.activeLevel = 1
+        var statistics = CullStatistics()
+        let visible = culler.visibleFeatures(camera: makeCamera(), statistics: &statistics)
+
+        XCTAssertEqual(visible[1] ?? [], [1])
+        XCTAssertEqual(visible[0] ?? [], [11])
+        XCTAssertNil(visible[2])
+        XCTAssertEqual(statistics.frustumCulled, 1)
+        XCTAssertEqual(statistics.occlusionCulled, 1)
+        XCTAssertEqual(statistics.floorsSkipped, 1)
+    }
+
+    func testInsertedPartsGrowFeatureBounds() {
+        let culler = FloorCuller(floorHeight: 4)
+        culler.insert(square(7, "room", level: 0, x: 0, y: 0, size: 10))
+        culler.insert(square(7, "room", level: 0, x: 90, y: 90, size: 10))
+        let bounds = culler.tree(forLevel: 0)?.bounds(ofFeature: 7)
+
+        XCTAssertEqual(bounds?.minX, 0)
+        XCTAssertEqual(bounds?.maxX, 100)
+        XCTAssertEqual(bounds?.maxY, 100)
+    }
+
+    func testRefitAfterChanges() {
+        let tree = BoundingVolumeHierarchy((0..<40).map { index in
+            (UInt64(index), RenderBounds(minX: Double(index * 10), minY: 0, minZ: 0, maxX: Double(index * 10 + 5), maxY: 5, maxZ: 0))
+        })
+        let frustum = RenderFrustum(camera: RenderCamera(center: RenderPoint(x: 50, y: 0), distance: 100, width: 64, height: 64))
+        func visible() -> Set<UInt64> {
+            var statistics = CullStatistics()
+            var ids = Set<UInt64>()
+            tree.forEachVisible(in: frustum, statistics: &statistics) { ids.insert($0) }
+            return ids
+        }
+        let before = visible()
+        XCTAssertTrue(before.contains(5))
+        XCTAssertFalse(before.contains(39))
+
+        tree.remove(5)
+        tree.insert(39, bounds: RenderBounds(minX: 50, minY: 0, minZ: 0, maxX: 52, maxY: 2, maxZ: 0))
+        tree.insert(100, bounds: RenderBounds(minX: 60, minY: 0, minZ: 0, maxX: 62, maxY: 2, maxZ: 0))
+        let after = visible()
+
+        XCTAssertEqual(after, before.subtracting([5]).union([39, 100]))
+        XCTAssertEqual(tree.count, 40)
+    }
+
+    func testSlabCoverage() {
+        let slab = FloorSlab(polygons: [[[
+            RenderPoint(x: 0, y: 0), RenderPoint(x: 10, y: 0), RenderPoint(x: 10, y: 10), RenderPoint(x: 0, y: 10),
+        ]]])!
+
+        XCTAssertTrue(slab.covers(minX: 2, minY: 2, maxX: 8, maxY: 8))
+        XCTAssertFalse(slab.covers(minX: 2, minY: 2, maxX: 12, maxY: 8))
+    }
+}
@@ -0,0 +1,143 @@
+//
+//  FloorTableTests.swift
+//  DeepMapTestIOSTests
+//
+//  Created by agent on 18.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+import XCTest
+import SQLite3
+import HDMMapCore
+@testable import DeepMapTestIOS
+
+class FloorTableTests: XCTestCase {
+
+    /// Answers from fixed data and counts the calls that would hit the database.
+    final class StubLocator: FloorLocator {
+        var featureLookups = 0
+        var nameLookups = 0
+
+        func floors() -> [HDMFeature] {
+            return [HDMFeature(id: 100, location: nil, attributes: ["level": "2"])]
+        }
+
+        func __getFeatures(byIds featureIds: [NSNumber]) -> [HDMFeature] {
+            featureLookups += 1
+            return featureIds.map { id in
+                let x = id.doubleValue
+                return HDMFeature(id: id.uint64Value, location: HDMLocation(coordinate: HDMMapCoordinateMake(x, -x, 0), crs: "EPSG:4326"),
+                                  attributes: [:])
+            }
+        }
+
+        func getLocalizedFloorName(_ floor: Float, withLocale localeStr: String, shortName: Bool) -> String {
+            nameLookups += 1
+            return "\(localeStr) \(floor)\(shortName ? "" : " floor")"
+        }
+
+        func getLocalizedNumericFloorName(_ floor: Float, withLocale localeStr: String) -> String {
+            nameLookups += 1
+            return "\(floor)"
+        }
+    }
+
+    var path = ""
+
+    override func setUp() {
+        super.setUp()
+        path = NSTemporaryDirectory() + "FloorTableTests-\(UUID().uuidString).sqlite"
+        var handle: OpaquePointer?
+        XCTAssertEqual(sqlite3_open(path, &handle), SQLITE_OK)
+        XCTAssertEqual(sqlite3_exec(handle, "CREATE TABLE tags (object_id INTEGER, key TEXT, value TEXT); " +
+            "INSERT INTO tags VALUES (1, 'level', '0'), (2, 'level', '0'), (3, 'level', '1'), (4, 'level', '-1'), " +
+            "(1, 'name:de', 'Halle'), (5, 'level', 'roof');", nil, nil, nil), SQLITE_OK)
+        sqlite3_close(handle)
+    }
+
+    override func tearDown() {
+        try? FileManager.default.removeItem(atPath: path)
+        super.tearDown()
+    }
+
+    func testReadsFloorsAndCachesNames() {
+        let locator = StubLocator()
+        let table = FloorTable(databasePath: path, locator: locator, locales: ["en"])
+
+        XCTAssertEqual(table.floors.map { $0.level }, [-1, 0, 1, 2])
+        XCTAssertEqual(table.floor(at: 0)?.featureIds ?? [], [1, 2])
+        XCTAssertEqual(table.floor(at: 2)?.floorFeatureId, 100)
+        XCTAssertNil(table.floor(at: 0.5))
+        XCTAssertEqual(table.minimumLevel, -1)
+        XCTAssertEqual(table.maximumLevel, 2)
+
+        // "en" was asked for, "de" found in the map's name keys: 2 locales × 4 floors × 3 styles
+        XCTAssertEqual(locator.nameLookups, 24)
+        XCTAssertEqual(table.localizedFloorName(1, locale: "de", shortName: false), "de 1.0 floor")
+        XCTAssertEqual(table.localizedNumericFloorName(-1, locale: "en"), "-1.0")
+        XCTAssertEqual(locator.nameLookups, 24)
+        XCTAssertEqual(table.localizedFloorName(1, locale: "fr", shortName: true), "fr 1.0")
+        XCTAssertEqual(locator.nameLookups, 25)
+    }
+
+    func testComputesBoundsOnDemand() {
+        let locator = StubLocator()
+        let table = FloorTable(databasePath: path, locator: locator)
+        XCTAssertEqual(locator.featureLookups, 0)
+
+        let bounds = table.bounds(at: 0)
+        XCTAssertEqual(bounds?.minX, 1)
+        XCTAssertEqual(bounds?.maxX, 2)
+        XCTAssertEqual(bounds?.minY, -2)
+        XCTAssertNil(table.bounds(at: 2))
+        XCTAssertNil(table.bounds(at: 7))
+        let lookups = locator.featureLookups
+        _ = table.bounds(at: 0)
+        _ = table.bounds(at: 2)
+        XCTAssertEqual(locator.featureLookups, lookups)
+    }
+
+    func testExecutorSharesOneTableAndHandsWaitersToNewDatabase() {
+        let projector = HDMProjector(apiCRS: "EPSG:4326", displayCRS: "EPSG:32632", elevationMode: HDMElevationModeLocal)
+        let executor = LocatorQueryExecutor(databasePath: path, projector: projector, readerCount: 1,
+                                            deliveryQueue: DispatchQueue(label: "FloorTableTests.delivery"))
+        let gate = DispatchSemaphore(value: 0)
+        let lock = NSLock()
+        var built: [String] = []
+        executor.makeFloorTable = { path in
+            lock.lock()
+            built.append(path)
+            let first = built.count == 1
+            lock.unlock()
+            if first {
+                gate.wait()
+            }
+            return FloorTable(databasePath: self.path, locator: StubLocator())
+        }
+
+        var tables: [FloorTable] = []
+        let delivered = expectation(description: "waiters get the new database's table")
+        delivered.expectedFulfillmentCount = 2
+        for _ in 0..<2 {
+            executor.floorTable { table in
+                tables.append(table)
+                delivered.fulfill()
+            }
+        }
+        // the table of the old database is still building
+        executor.setDB("/new.sqlite")
+        gate.signal()
+        wait(for: [delivered], timeout: 5)
+
+        XCTAssertEqual(Set(built), [path, "/new.sqlite"])
+        XCTAssertTrue(tables[0] === tables[1])
+
+        let cached = expectation(description: "later calls reuse the table")
+        executor.floorTable { table in
+            XCTAssertTrue(table === tables[0])
+            cached.fulfill()
+        }
+        wait(for: [cached], timeout: 5)
+        XCTAssertEqual(built.count, 2)
+    }
+}
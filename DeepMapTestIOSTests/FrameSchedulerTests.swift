@@ -0,0 +1,74 @@
+//
+//  FrameSchedulerTests.swift
+//  DeepMapTestIOSTests
+//
+//  Created by agent on 18.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+import XCTest
+import GLKit
+@testable import DeepMapTestIOS
+
+class FrameSchedulerTests: XCTestCase {
+
+    let renderLoop = GLKViewController()
+    var now: CFTimeInterval = 0
+    var changes: [Bool] = []
+
+    func makeScheduler() -> FrameScheduler {
+        let scheduler = FrameScheduler(renderLoop: renderLoop)
+        scheduler.clock = { self.now }
+        scheduler.idleDidChange = { self.changes.append($0) }
+        return scheduler
+    }
+
+    func testPausesAfterIdleDelayAndWakesOnRequest() {
+        let scheduler = makeScheduler()
+        scheduler.requestFrame(.annotation)
+
+        XCTAssertFalse(scheduler.step(at: 0.4))
+        XCTAssertFalse(scheduler.isIdle)
+        XCTAssertTrue(scheduler.step(at: 0.5))
+        XCTAssertTrue(scheduler.isIdle)
+        XCTAssertTrue(renderLoop.isPaused)
+        // further ticks do not count as new transitions
+        XCTAssertTrue(scheduler.step(at: 0.6))
+        XCTAssertEqual(scheduler.idleTransitions, 1)
+
+        now = 3
+        scheduler.requestFrame(.location)
+        XCTAssertFalse(scheduler.isIdle)
+        XCTAssertFalse(renderLoop.isPaused)
+        XCTAssertEqual(changes, [true, false])
+        XCTAssertEqual(scheduler.requests[FrameReason.annotation.rawValue], 1)
+        XCTAssertEqual(scheduler.requests[FrameReason.location.rawValue], 1)
+    }
+
+    func testEngineWorkKeepsRunningUntilSettled() {
+        let scheduler = makeScheduler()
+        for reason in [FrameReason.camera, .style, .request] {
+            scheduler.requestFrame(reason)
+            XCTAssertFalse(scheduler.step(at: now + scheduler.idleDelay))
+            XCTAssertTrue(scheduler.step(at: now + scheduler.settleDelay))
+            now += 10
+        }
+        XCTAssertEqual(scheduler.idleTransitions, 3)
+
+        scheduler.animate(for: 1)
+        XCTAssertFalse(scheduler.step(at: now + 1))
+        XCTAssertTrue(scheduler.step(at: now + 1 + scheduler.idleDelay))
+    }
+
+    func testInteractionKeepsRunningUntilItEnds() {
+        let scheduler = makeScheduler()
+        scheduler.beginInteraction()
+        XCTAssertFalse(scheduler.step(at: 100))
+
+        now = 100
+        scheduler.endInteraction()
+        XCTAssertFalse(scheduler.step(at: 100.4))
+        XCTAssertTrue(scheduler.step(at: 100.5))
+        XCTAssertEqual(changes, [true])
+    }
+}
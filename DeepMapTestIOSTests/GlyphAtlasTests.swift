@@ -0,0 +1,66 @@
+//
+//  GlyphAtlasTests.swift
+//  DeepMapTestIOSTests
+//
+//  Created by agent on 18.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+import XCTest
+import CoreText
+@testable import DeepMapTestIOS
+
+class GlyphAtlasTests: XCTestCase {
+
+    func testDistanceField() {
+        // 4x4 square in the middle of a 12x12 bitmap
+        var coverage = [UInt8](repeating: 0, count: 144)
+        for y in 4..<8 {
+            for x in 4..<8 {
+                coverage[y * 12 + x] = 255
+            }
+        }
+        let field = SignedDistanceField.make(coverage: coverage, width: 12, height: 12, spread: 4)
+
+        XCTAssertGreaterThan(field[5 * 12 + 5], 128)
+        XCTAssertGreaterThan(field[5 * 12 + 5], field[4 * 12 + 4])
+        XCTAssertLessThan(field[5 * 12 + 3], 128)
+        XCTAssertEqual(field[0], 0)
+        XCTAssertEqual(Int(field[5 * 12 + 3]) + Int(field[5 * 12 + 4]), 256)
+    }
+
+    func testShelfPacking() {
+        let packing = ShelfPacker.pack([(10, 5), (10, 8), (0, 0), (10, 8)], width: 24)
+
+        XCTAssertEqual(packing.positions.map { [$0.x, $0.y] }, [[0, 9], [0, 0], [0, 0], [11, 0]])
+        XCTAssertEqual(packing.height, 14)
+    }
+
+    func testBuildAndReload() throws {
+        let builder = GlyphAtlasBuilder(font: CTFontCreateWithName("Helvetica" as CFString, 32, nil))
+        builder.atlasWidth = 256
+        let atlas = builder.build(strings: ["Hall", "Hall A", "Foyer"])
+        XCTAssertEqual(atlas.glyphCount, 10)
+
+        let reloaded = try GlyphAtlas(data: atlas.data())
+        XCTAssertEqual(reloaded.pixels, atlas.pixels)
+        XCTAssertEqual(reloaded.fontName, atlas.fontName)
+        XCTAssertEqual(reloaded.glyphCount, atlas.glyphCount)
+
+        let text = ShapedTextCache.shape("Hall", font: builder.font)
+        let quads = reloaded.quads(for: text, size: 16)
+        XCTAssertEqual(quads.count, 4)
+        XCTAssertLessThan(quads[0].minX, quads[1].minX)
+        XCTAssertLessThan(quads[0].minY, 0)
+    }
+
+    func testCacheSkipsReshaping() {
+        let cache = ShapedTextCache(font: CTFontCreateWithName("Helvetica" as CFString, 32, nil))
+        let first = cache.measure("Exhibitor Hall", size: 12)
+        let second = cache.measure("Exhibitor Hall", size: 24)
+
+        XCTAssertEqual(cache.misses, 1)
+        XCTAssertEqual(cache.hits, 1)
+        XCTAssertEqual(second.width, first.width * 2, accuracy: 0.01)
+    }
+}
@@ -0,0 +1,123 @@
+//
+//  HitTesterTests.swift
+//  DeepMapTestIOSTests
+//
+//  Created by agent on 18.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+import XCTest
+import HDMMapCore
+@testable import DeepMapTestIOS
+
+class HitTesterTests: XCTestCase {
+
+    let origin = RenderPoint(x: 477000, y: 5474000)
+
+    func point(_ x: Double, _ y: Double) -> RenderPoint {
+        return RenderPoint(x: origin.x + x, y: origin.y + y)
+    }
+
+    func square(_ x: Double, _ y: Double, _ size: Double) -> RenderPrimitive.Geometry {
+        return .polygon([[point(x, y), point(x + size, y), point(x + size, y + size), point(x, y + size)]])
+    }
+
+    func makeTester() throws -> HitTester {
+        let sheet = try StyleSheet(source: """
+            feature polygon {
+                floor-selectable: true;
+            }
+            feature line {
+                line-width: 2.0m;
+                floor-selectable: true;
+            }
+            feature icon {
+                floor-selectable: true;
+            }
+            feature building:polygon {}
+            feature room:polygon {}
+            feature hidden:polygon {
+                visibility: none;
+            }
+            feature path:line {}
+            feature atm:icon {}
+            feature decoration {
+                fill-color: #FF0000;
+            }
+            """)
+        return HitTester(primitives: [
+            RenderPrimitive(featureId: 1, type: "building", level: 0, geometry: square(0, 0, 100)),
+            RenderPrimitive(featureId: 2, type: "room", level: 0, geometry: square(10, 10, 10)),
+            RenderPrimitive(featureId: 3, type: "atm", level: 0, geometry: .point(point(15, 15))),
+            RenderPrimitive(featureId: 4, type: "path", level: 0, geometry: .line([point(0, 50), point(100, 50)])),
+            RenderPrimitive(featureId: 5, type: "hidden", level: 0, geometry: square(10, 10, 10)),
+            RenderPrimitive(featureId: 6, type: "decoration", level: 0, geometry: square(10, 10, 10)),
+            RenderPrimitive(featureId: 7, type: "room", level: 1, geometry: square(10, 10, 10)),
+        ], sheet: sheet)
+    }
+
+    func testOrdersPointsLinesAndSmallerPolygons() throws {
+        let tester = try makeTester()
+
+        XCTAssertEqual(tester.hitTest(at: point(12, 12), level: 0, radius: 1).flatMap { $0.featureId }, [2, 1])
+        XCTAssertEqual(tester.hitTest(at: point(15.5, 15), level: 0, radius: 1).flatMap { $0.featureId }, [3, 2, 1])
+        XCTAssertEqual(tester.hitTest(at: point(12, 12), level: 1, radius: 1).flatMap { $0.featureId }, [7])
+        XCTAssertTrue(tester.hitTest(at: point(150, 150), level: 0, radius: 1).isEmpty)
+    }
+
+    func testLinesHitWithinTheirWidth() throws {
+        let tester = try makeTester()
+
+        XCTAssertEqual(tester.hitTest(at: point(40, 52.5), level: 0, radius: 2).first?.featureId, 4)
+        XCTAssertEqual(tester.hitTest(at: point(40, 53.5), level: 0, radius: 2).flatMap { $0.featureId }, [1])
+        XCTAssertEqual(tester.hitTest(at: point(105, 50), level: 0, radius: 5).first?.distance ?? 0, 5, accuracy: 1e-9)
+    }
+
+    func testFindsPinsFirst() throws {
+        let tester = try makeTester()
+        let pins = AnnotationClusterer()
+        let (longitude, latitude) = UTMProjection.zone32N.unproject(point(12, 12))
+        pins.add([MapPin(id: 42, coordinate: HDMMapCoordinateMake(longitude, latitude, 0), level: 0)])
+        tester.annotations = pins
+
+        let hits = tester.hitTest(at: point(12.5, 12), level: 0, radius: 1)
+        XCTAssertEqual(hits.first?.pin, 42)
+        XCTAssertEqual(hits.flatMap { $0.featureId }, [2, 1])
+        XCTAssertNil(tester.hitTest(at: point(12.5, 12), level: 1, radius: 1).first?.pin)
+    }
+
+    func testTestsFeaturesNearTheTouchOnly() {
+        var primitives: [RenderPrimitive] = []
+        for index in 0..<100_000 {
+            primitives.append(RenderPrimitive(featureId: UInt64(index), type: "atm", level: 0,
+                                              geometry: .point(point(Double(index % 316) * 3, Double(index / 316) * 3))))
+        }
+        let tester = HitTester(primitives: primitives)
+
+        XCTAssertEqual(tester.hitTest(at: point(30, 30), level: 0, radius: 1).flatMap { $0.featureId }, [3170])
+        XCTAssertLessThan(tester.statistics.candidates, 16)
+
+        tester.remove(3170, level: 0)
+        tester.insert(RenderPrimitive(featureId: 3170, type: "atm", level: 0, geometry: .point(point(31, 30))))
+        XCTAssertEqual(tester.hitTest(at: point(30, 30), level: 0, radius: 1.5).first?.distance ?? 0, 1, accuracy: 1e-9)
+        XCTAssertEqual(tester.statistics.queries, 2)
+    }
+
+    func testHitsPackageOutlines() throws {
+        let cellPath = URL(fileURLWithPath: #file).deletingLastPathComponent().deletingLastPathComponent()
+            .appendingPathComponent("DeepMapTestIOS/DeepMap/mapdata/tiles").path
+        let cells = try MapCellSource(cellPath: cellPath)
+        let sheet = try StyleSheet(source: """
+            feature polygon {
+                floor-selectable: true;
+            }
+            feature building:polygon {}
+            feature stand:polygon {}
+            """)
+        let tester = HitTester(primitives: cells.primitives(level: nil), sheet: sheet, projection: cells.metadata.projection!)
+        // inside stand 19408 of building 16298
+        let hits = tester.hitTest(at: RenderPoint(x: 476225.96, y: 5473980.89), level: 0, radius: 0.5).flatMap { $0.featureId }
+
+        XCTAssertEqual(hits, [19408, 16298])
+    }
+}
@@ -0,0 +1,170 @@
+//
+//  IconAtlasTests.swift
+//  DeepMapTestIOSTests
+//
+//  Created by agent on 18.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+import XCTest
+@testable import DeepMapTestIOS
+
+/// Writes FlatBuffers front to back; every offset points to something written after it.
+private struct FlatBufferWriter {
+    var bytes: [UInt8] = [0, 0, 0, 0]
+
+    /// Appends a table of 4-byte fields (nil for absent ones); returns the table's position
+    /// and the positions of its fields.
+    mutating func table(_ fields: [UInt32?]) -> (table: Int, fields: [Int]) {
+        let vtable = bytes.count
+        append16(UInt16(4 + fields.count * 2))
+        append16(UInt16(4 + fields.count * 4))
+        for (index, field) in fields.enumerated() {
+            append16(field == nil ? 0 : UInt16(4 + index * 4))
+        }
+        pad()
+        let table = bytes.count
+        append32(UInt32(table - vtable))
+        var positions: [Int] = []
+        for field in fields {
+            positions.append(bytes.count)
+            append32(field ?? 0)
+        }
+        return (table, positions)
+    }
+
+    /// Appends a vector of `count` offsets; returns the vector's position and its slots.
+    mutating func vector(count: Int) -> (vector: Int, slots: [Int]) {
+        let vector = bytes.count
+        append32(UInt32(count))
+        let slots = (0..<count).map { bytes.count + $0 * 4 }
+        bytes += [UInt8](repeating: 0, count: count * 4)
+        return (vector, slots)
+    }
+
+    mutating func data(_ data: [UInt8]) -> Int {
+        let position = bytes.count
+        append32(UInt32(data.count))
+        bytes += data
+        pad()
+        return position
+    }
+
+    /// Points the offset at `position` to `target`.
+    mutating func link(_ position: Int, to target: Int) {
+        let offset = UInt32(target - position)
+        for index in 0..<4 {
+            bytes[position + index] = UInt8(offset >> UInt32(index * 8) & 0xFF)
+        }
+    }
+
+    private mutating func append16(_ value: UInt16) {
+        bytes += [UInt8(value & 0xFF), UInt8(value >> 8)]
+    }
+
+    private mutating func append32(_ value: UInt32) {
+        bytes += [UInt8(value & 0xFF), UInt8(value >> 8 & 0xFF), UInt8(value >> 16 & 0xFF), UInt8(value >> 24)]
+    }
+
+    private mutating func pad() {
+        while bytes.count % 4 != 0 {
+            bytes.append(0)
+        }
+    }
+}
+
+class IconAtlasTests: XCTestCase {
+
+    /// An icons.bin with one icon, "cafe.png", in the red right half of a 4x4 texture; further
+    /// `names` are icons of the same rectangle.
+    func makeFile(names: [String] = ["cafe.png"]) throws -> IconAtlasFile {
+        var rgba: [UInt8] = []
+        for _ in 0..<4 {
+            rgba += [0, 0, 255, 255, 0, 0, 255, 255, 255, 0, 0, 255, 255, 0, 0, 255]
+        }
+        let png = PNGEncoder.encode(rgba: rgba, width: 4, height: 4)
+
+        var writer = FlatBufferWriter()
+        let root = writer.table([0, 0])
+        writer.link(0, to: root.table)
+        let icons = writer.vector(count: names.count)
+        writer.link(root.fields[0], to: icons.vector)
+        for (slot, name) in zip(icons.slots, names) {
+            let icon = writer.table([0, nil, Float(0.5).bitPattern, 0, Float(0.5).bitPattern, Float(1).bitPattern])
+            writer.link(slot, to: icon.table)
+            writer.link(icon.fields[0], to: writer.data(Array(name.utf8)))
+        }
+
+        let atlases = writer.vector(count: 1)
+        writer.link(root.fields[1], to: atlases.vector)
+        let atlas = writer.table([nil, nil, 0, nil])
+        writer.link(atlases.slots[0], to: atlas.table)
+        let textures = writer.vector(count: 1)
+        writer.link(atlas.fields[2], to: textures.vector)
+        let texture = writer.table([0])
+        writer.link(textures.slots[0], to: texture.table)
+        let levels = writer.vector(count: 1)
+        writer.link(texture.fields[0], to: levels.vector)
+        let level = writer.table([0])
+        writer.link(levels.slots[0], to: level.table)
+        writer.link(level.fields[0], to: writer.data([UInt8](png)))
+
+        return try IconAtlasFile(data: Data(writer.bytes))
+    }
+
+    func testReadsFlatBuffer() throws {
+        let file = try makeFile()
+
+        XCTAssertEqual(file.entries.map { $0.name }, ["cafe"])
+        XCTAssertEqual(file.entries[0].u, 0.5)
+        XCTAssertEqual(file.entries[0].height, 1)
+        XCTAssertEqual(file.pages.count, 1)
+        XCTAssertEqual(file.size(page: 0, level: 0)?.width, 4)
+        XCTAssertThrowsError(try IconAtlasFile(data: Data([12, 0, 0, 0])))
+    }
+
+    func testDecodesReferencedIconsOnly() throws {
+        let sheet = try StyleSheet(source: """
+            feature icon_cafe {
+                icon-size: 8.0;
+            }
+            feature icon_bus {
+                icon-size: 8.0;
+            }
+            """)
+        let atlas = IconAtlas(file: try makeFile(), sheet: sheet)
+        XCTAssertEqual(atlas.decodedLevels, 0)
+        XCTAssertNil(atlas.image(forType: "icon_bus", size: 8))
+
+        let image = atlas.image(forType: "icon_cafe", size: 8)
+        XCTAssertEqual(image?.width, 2)
+        XCTAssertEqual(image?.color(u: 0.5, v: 0.5), 0xFF0000FF)
+        XCTAssertNotNil(atlas.image(forType: "icon_cafe", size: 8))
+        XCTAssertEqual(atlas.decodedIcons, 1)
+
+        atlas.evict()
+        XCTAssertNotNil(atlas.image(forType: "icon_cafe", size: 8))
+        XCTAssertEqual(atlas.decodedLevels, 2)
+
+        let unreferenced = IconAtlas(file: try makeFile(), sheet: try StyleSheet(source: "feature room { fill-color: #FF0000; }"))
+        XCTAssertNil(unreferenced.image(for: 0, size: 8))
+        XCTAssertEqual(unreferenced.decodedLevels, 0)
+    }
+
+    func testFillsEveryPageBeforeAddingOne() throws {
+        let atlas = IconAtlas(file: try makeFile(names: ["a.png", "b.png", "c.png", "d.png"]))
+        // two 2x4 icons per page
+        atlas.pageSize = 4
+        let images = (0..<4).flatMap { atlas.image(for: Int32($0), size: 2) }
+
+        XCTAssertEqual(images.count, 4)
+        XCTAssertEqual(atlas.pages.count, 2)
+        XCTAssertTrue(images[0].page === images[1].page)
+        XCTAssertTrue(images[2].page === images[3].page)
+        XCTAssertEqual(images.map { $0.x }, [0, 2, 0, 2])
+        // icons written later into a page leave the earlier ones intact
+        for image in images {
+            XCTAssertEqual(image.color(u: 0.5, v: 0.5), 0xFF0000FF)
+        }
+    }
+}
@@ -0,0 +1,113 @@
+//
+//  LabelEngineTests.swift
+//  DeepMapTestIOSTests
+//
+//  Created by agent on 18.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+import XCTest
+@testable import DeepMapTestIOS
+
+class LabelEngineTests: XCTestCase {
+
+    func label(_ featureId: UInt64, x: Double, y: Double, priority: Int = 0) -> LabelCandidate {
+        return LabelCandidate(featureId: featureId, anchor: RenderPoint(x: x, y: y), text: "Label", size: 12, color: 0x000000FF,
+                              offset: (0, 0), priority: priority)
+    }
+
+    func makeCamera(x: Double = 0) -> RenderCamera {
+        return RenderCamera(center: RenderPoint(x: x, y: 0), distance: 200, width: 320, height: 320)
+    }
+
+    func place(_ engine: LabelEngine, camera: RenderCamera) {
+        let placed = expectation(description: "placed")
+        engine.didPlace = { placed.fulfill() }
+        engine.update(camera: camera)
+        wait(for: [placed], timeout: 5)
+        engine.didPlace = nil
+    }
+
+    func testCollisionGrid() {
+        var grid = LabelCollisionGrid(width: 256, height: 256, cellSize: 32)
+
+        XCTAssertTrue(grid.insertIfFree(LabelRect(minX: 10, minY: 10, maxX: 100, maxY: 20)))
+        XCTAssertFalse(grid.insertIfFree(LabelRect(minX: 90, minY: 15, maxX: 150, maxY: 25)))
+        XCTAssertTrue(grid.insertIfFree(LabelRect(minX: 100, minY: 10, maxX: 150, maxY: 20)))
+        XCTAssertTrue(grid.insertIfFree(LabelRect(minX: 10, minY: 20, maxX: 100, maxY: 30)))
+    }
+
+    func testPlacesByPriorityAndReusesOnPan() {
+        let engine = LabelEngine()
+        engine.fadeDuration = 0
+        // 1 and 2 overlap, 3 is far enough away
+        engine.setCandidates([label(1, x: 0, y: 0), label(2, x: 1, y: 0, priority: 5), label(3, x: 0, y: 50)])
+        place(engine, camera: makeCamera())
+
+        XCTAssertEqual(Set(engine.labels().map { $0.featureId }), [2, 3])
+        let before = engine.labels().first { $0.featureId == 3 }!.rect
+
+        engine.update(camera: makeCamera(x: 5))
+        XCTAssertEqual(engine.placements, 1)
+        XCTAssertEqual(engine.reusedPlacements, 1)
+        let after = engine.labels().first { $0.featureId == 3 }!.rect
+        XCTAssertLessThan(after.minX, before.minX)
+        XCTAssertEqual(after.minY, before.minY, accuracy: 0.01)
+
+        place(engine, camera: makeCamera(x: 100))
+        XCTAssertEqual(engine.placements, 2)
+    }
+
+    func testReuseDropsStalePlacement() {
+        let engine = LabelEngine()
+        engine.fadeDuration = 0
+        engine.setCandidates([label(1, x: 0, y: 0), label(3, x: 0, y: 50)])
+        place(engine, camera: makeCamera())
+
+        // the placement for the far camera is still running when the camera comes back
+        engine.update(camera: makeCamera(x: 100))
+        engine.update(camera: makeCamera(x: 5))
+        let drained = expectation(description: "drained")
+        DispatchQueue.main.asyncAfter(deadline: .now() + 0.5) { drained.fulfill() }
+        wait(for: [drained], timeout: 5)
+
+        XCTAssertEqual(engine.placements, 1)
+        XCTAssertEqual(engine.reusedPlacements, 1)
+    }
+
+    func testKeptCandidatesKeepTheirLabels() {
+        let engine = LabelEngine()
+        engine.setCandidates([label(1, x: 0, y: 0), label(3, x: 0, y: 50)])
+        place(engine, camera: makeCamera())
+
+        engine.setCandidates([label(3, x: 0, y: 50), label(4, x: 50, y: 0)])
+        XCTAssertEqual(engine.labels(at: CACurrentMediaTime() + 1).map { $0.featureId }, [3])
+    }
+
+    func testCandidatesFromTags() {
+        let store = FeatureTagStore(tags: [
+            (1, "maplabel:en", "Hall A"), (1, "name:en", "Hall"), (1, "label_offsety", "-10"),
+            (2, "name", "Booth"),
+            (3, "name", "Hidden"),
+        ])
+        let sheet = try! StyleSheet(source: """
+            feature booth {
+                text-size: 14.0;
+            }
+            feature door {
+                text-visibility: none;
+            }
+            """)
+        let points = [
+            RenderPrimitive(featureId: 1, type: "hall", level: 0, geometry: .point(RenderPoint(x: 0, y: 0))),
+            RenderPrimitive(featureId: 2, type: "booth", level: 0, geometry: .point(RenderPoint(x: 0, y: 0))),
+            RenderPrimitive(featureId: 3, type: "door", level: 0, geometry: .point(RenderPoint(x: 0, y: 0))),
+        ]
+        let candidates = LabelEngine.candidates(for: points, store: store, sheet: sheet, locale: "en")
+
+        XCTAssertEqual(candidates.map { $0.text }, ["Hall A", "Booth"])
+        XCTAssertEqual(candidates[0].offset.y, -10)
+        XCTAssertEqual(candidates[1].size, 14)
+        XCTAssertGreaterThan(candidates[0].priority, candidates[1].priority)
+    }
+}
@@ -0,0 +1,105 @@
+//
+//  LocatorQueryExecutorTests.swift
+//  DeepMapTestIOSTests
+//
+//  Created by agent on 18.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+import XCTest
+import SQLite3
+import HDMMapCore
+@testable import DeepMapTestIOS
+
+class LocatorQueryExecutorTests: XCTestCase {
+
+    /// Counts to `count` before returning a single row, to keep a reader busy.
+    func slowQuery(_ count: Int) -> String {
+        return "WITH RECURSIVE n(x) AS (SELECT 1 UNION ALL SELECT x + 1 FROM n WHERE x < \(count)) " +
+            "SELECT max(x) AS object_id FROM n"
+    }
+
+    var path = ""
+    let store = FeatureTagStore(tags: (1...20).map { (UInt64($0), "name", "Room \($0)") })
+    let delivery = DispatchQueue(label: "LocatorQueryExecutorTests.delivery")
+
+    override func setUp() {
+        super.setUp()
+        path = NSTemporaryDirectory() + "LocatorQueryExecutorTests-\(UUID().uuidString).sqlite"
+        var handle: OpaquePointer?
+        XCTAssertEqual(sqlite3_open(path, &handle), SQLITE_OK)
+        let rows = (1...20).map { "(\($0), 'name', 'Room \($0)')" }.joined(separator: ",")
+        XCTAssertEqual(sqlite3_exec(handle, "CREATE TABLE tags (object_id INTEGER, key TEXT, value TEXT); " +
+            "INSERT INTO tags VALUES \(rows);", nil, nil, nil), SQLITE_OK)
+        sqlite3_close(handle)
+    }
+
+    override func tearDown() {
+        try? FileManager.default.removeItem(atPath: path)
+        super.tearDown()
+    }
+
+    func makeExecutor(readers: Int) -> LocatorQueryExecutor {
+        let projector = HDMProjector(apiCRS: "EPSG:4326", displayCRS: "EPSG:32632", elevationMode: HDMElevationModeLocal)
+        return LocatorQueryExecutor(databasePath: path, projector: projector, readerCount: readers, deliveryQueue: delivery)
+    }
+
+    func testDeliversInSubmissionOrder() {
+        let executor = makeExecutor(readers: 3)
+        var order: [Int] = []
+        let done = expectation(description: "all delivered")
+        done.expectedFulfillmentCount = 3
+        let queries = [slowQuery(300000), "SELECT object_id FROM tags WHERE object_id < 4", "SELECT object_id FROM tags"]
+        for (index, sql) in queries.enumerated() {
+            executor.featureViews(withSQL: sql, in: store) { views, error in
+                XCTAssertNil(error)
+                order.append(index)
+                done.fulfill()
+            }
+        }
+        wait(for: [done], timeout: 10)
+        XCTAssertEqual(order, [0, 1, 2])
+    }
+
+    func testNewerQuerySupersedesItsGroup() {
+        let executor = makeExecutor(readers: 2)
+        let done = expectation(description: "latest delivered")
+        executor.featureViews(withSQL: slowQuery(300000), in: store, group: "search") { _, _ in
+            XCTFail("superseded query must not be delivered")
+        }
+        executor.featureViews(withSQL: "SELECT object_id FROM tags WHERE object_id = 7", in: store, group: "search") { views, error in
+            XCTAssertNil(error)
+            XCTAssertEqual(views.map { $0.featureId }, [7])
+            done.fulfill()
+        }
+        wait(for: [done], timeout: 10)
+    }
+
+    func testCancelWhileRunningLeavesNextQueryAlone() {
+        // one reader, so the next query runs right after the interrupted one on the same connection
+        let executor = makeExecutor(readers: 1)
+        let done = expectation(description: "next query delivered")
+        let running = executor.featureViews(withSQL: slowQuery(1000000000), in: store) { _, _ in
+            XCTFail("cancelled query must not be delivered")
+        }
+        executor.featureViews(withSQL: "SELECT object_id FROM tags", in: store) { views, error in
+            XCTAssertNil(error)
+            XCTAssertEqual(views.count, 20)
+            done.fulfill()
+        }
+        Thread.sleep(forTimeInterval: 0.1)
+        running.cancel()
+        wait(for: [done], timeout: 10)
+    }
+
+    func testReportsFailuresInsteadOfEmptyResults() {
+        let executor = makeExecutor(readers: 1)
+        let done = expectation(description: "failure delivered")
+        executor.featureViews(withSQL: "SELECT object_id FROM missing", in: store) { views, error in
+            XCTAssertTrue(views.isEmpty)
+            XCTAssertNotNil(error)
+            done.fulfill()
+        }
+        wait(for: [done], timeout: 10)
+    }
+}
@@ -0,0 +1,48 @@
+//
+//  MapCellSourceTests.swift
+//  DeepMapTestIOSTests
+//
+//  Created by agent on 18.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+import XCTest
+@testable import DeepMapTestIOS
+
+class MapCellSourceTests: XCTestCase {
+
+    /// Cells of the package shipped with the app, read from the source tree.
+    let cellPath = URL(fileURLWithPath: #file).deletingLastPathComponent().deletingLastPathComponent()
+        .appendingPathComponent("DeepMapTestIOS/DeepMap/mapdata/tiles").path
+
+    func testReadsMetadata() throws {
+        let metadata = try MapCellMetadata(contentsOfFile: cellPath + "/meta/metafile.hsm")
+
+        XCTAssertEqual(metadata.projection?.zone, 32)
+        XCTAssertEqual(metadata.layers[15], "background")
+        XCTAssertEqual(metadata.layers[23], "stand")
+        XCTAssertEqual(metadata.bounds.0, 475279, accuracy: 1)
+        XCTAssertEqual(metadata.bounds.3, 5474594, accuracy: 1)
+    }
+
+    func testReadsPartsOfAllObjects() throws {
+        let source = try MapCellSource(cellPath: cellPath)
+        let all = source.primitives(level: nil)
+
+        XCTAssertEqual(all.count, 2886)
+        XCTAssertEqual(source.levels, [0, 1, 2, 3, 4])
+        XCTAssertEqual(source.primitives(level: 2).count, 296)
+        // parents come before their children, in file order
+        XCTAssertEqual(all.first?.featureId, 15913)
+        XCTAssertEqual(all.first?.type, "osm.landuse.farmland")
+
+        let stairs = all.filter { $0.type == "stair" }
+        XCTAssertFalse(stairs.isEmpty)
+        for stair in stairs {
+            guard case .point(let point) = stair.geometry else { return XCTFail("stairs are points") }
+            XCTAssertTrue(point.x > source.metadata.bounds.0 && point.x < source.metadata.bounds.2)
+            XCTAssertTrue(point.y > source.metadata.bounds.1 && point.y < source.metadata.bounds.3)
+        }
+        XCTAssertEqual(source.heights[18705]?.minimum, 22)
+    }
+}
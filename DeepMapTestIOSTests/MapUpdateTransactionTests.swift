@@ -0,0 +1,68 @@
+//
+//  MapUpdateTransactionTests.swift
+//  DeepMapTestIOSTests
+//
+//  Created by agent on 18.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+import XCTest
+@testable import DeepMapTestIOS
+
+class MapUpdateTransactionTests: XCTestCase {
+
+    func commit(_ transaction: MapUpdateTransaction, to updater: StyleUpdater) -> Int {
+        var applied = 0
+        let done = expectation(description: "transaction applied")
+        updater.commit(transaction) { count in
+            applied = count
+            done.fulfill()
+        }
+        wait(for: [done], timeout: 5)
+        return applied
+    }
+
+    func testLastWriteWinsWithOneRefresh() throws {
+        let target = RecordingStyleTarget()
+        let updater = StyleUpdater(mapView: target, sheet: try StyleSheet(source: "feature room { fill-color: #d0d0d0; }"))
+        let transaction = MapUpdateTransaction()
+        transaction.setFeatureAttribute("status", value: "busy", featureId: 9)
+        transaction.setFeatureStyle("room", property: "fill-color", value: "#ff0000")
+        transaction.setFeatureAttribute("status", value: "free", featureId: 2)
+        transaction.setFeatureStyle("room", property: "fill-color", value: "#00ff00")
+        transaction.setFeatureAttribute("status", value: "open", featureId: 9)
+        transaction.hideFeatures("room")
+        transaction.showFeatures("room")
+        transaction.setGlobalAttribute("night", value: "yes")
+        transaction.removeGlobalAttribute("night")
+        XCTAssertEqual(transaction.count, 9)
+
+        XCTAssertEqual(commit(transaction, to: updater), 5)
+        // styles and globals first, then attributes grouped by feature
+        XCTAssertEqual(target.calls, ["style room.fill-color=#00ff00", "show room", "remove global night",
+                                      "attribute 2.status=free", "attribute 9.status=open", "reloadStyle"])
+    }
+
+    func testStateTogglesWithinABatchCostNoMapCalls() {
+        let target = RecordingStyleTarget()
+        let updater = StyleUpdater(mapView: target)
+        let first = MapUpdateTransaction()
+        first.highlightFeature(4)
+        first.selectFeature(5)
+        first.unhighlightFeature(4)
+        XCTAssertEqual(commit(first, to: updater), 2)
+        XCTAssertEqual(target.calls, ["select 5"])
+
+        // batches apply in commit order; the second one only deselects again
+        let second = MapUpdateTransaction()
+        second.selectFeature(5)
+        second.deselectFeature(5)
+        let third = MapUpdateTransaction()
+        third.selectFeature(6)
+        updater.commit(second)
+        XCTAssertEqual(commit(third, to: updater), 1)
+        XCTAssertEqual(target.calls, ["select 5", "deselect 5", "select 6"])
+        XCTAssertEqual(updater.selectedFeatures, [6])
+        XCTAssertEqual(target.reloads, 0)
+    }
+}
@@ -0,0 +1,122 @@
+//
+//  MeshCacheTests.swift
+//  DeepMapTestIOSTests
+//
+//  Created by agent on 18.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+import XCTest
+@testable import DeepMapTestIOS
+
+class MeshCacheTests: XCTestCase {
+
+    let cube = """
+        # unit cube
+        o cube
+        v 0 0 0
+        v 1 0 0
+        v 1 1 0
+        v 0 1 0
+        v 0 0 1
+        v 1 0 1
+        v 1 1 1
+        v 0 1 1
+        vn 0 0 -1
+        vn 0 0 1
+        f 1//1 4//1 3//1 2//1
+        f 5//2 6//2 7//2 8//2
+        f 1 2 6 5
+        f 2 3 7 6
+        f 3 4 8 7
+        f -8 -4 -1 -5
+        """
+
+    /// A flat grid of `size` × `size` quads as an .obj file.
+    func grid(_ size: Int) -> String {
+        var text = ""
+        for y in 0...size {
+            for x in 0...size {
+                text += "v \(Double(x) * 0.5) \(Double(y) * 0.5) 0.0\n"
+            }
+        }
+        for y in 0..<size {
+            for x in 0..<size {
+                let a = y * (size + 1) + x + 1
+                text += "f \(a) \(a + 1) \(a + size + 2) \(a + size + 1)\n"
+            }
+        }
+        return text
+    }
+
+    func testParsesOBJ() throws {
+        let mesh = try OBJMesh.parse(cube.data(using: .utf8)!)
+
+        XCTAssertEqual(mesh.indices.count, 36)
+        // corners with a normal are separate vertices from those without
+        XCTAssertEqual(mesh.vertexCount, 16)
+        XCTAssertEqual(mesh.normals.count, mesh.positions.count)
+        XCTAssertEqual(Array(mesh.positions[0..<3]), [0, 0, 0])
+        XCTAssertThrowsError(try OBJMesh.parse("v 0 0 0\nf 1 2 3\n".data(using: .utf8)!))
+        XCTAssertThrowsError(try OBJMesh.parse("v 0 x 0\n".data(using: .utf8)!))
+    }
+
+    func testCompilesQuantizedLevels() throws {
+        let source = try OBJMesh.parse(grid(50).data(using: .utf8)!)
+        let mesh = try CompiledMesh(data: MeshCompiler.compile(source))
+
+        XCTAssertEqual(mesh.vertexCount, 51 * 51)
+        XCTAssertFalse(mesh.hasNormals)
+        XCTAssertEqual(mesh.indices(level: 0), source.indices)
+        for vertex in [0, 100, 51 * 51 - 1] {
+            let position = mesh.position(at: vertex)
+            XCTAssertEqual(position.x, source.positions[vertex * 3], accuracy: 25.0 / 65535)
+            XCTAssertEqual(position.y, source.positions[vertex * 3 + 1], accuracy: 25.0 / 65535)
+        }
+
+        XCTAssertGreaterThan(mesh.levels.count, 1)
+        XCTAssertLessThan(mesh.indices(level: 1).count * 4, source.indices.count * 3)
+        XCTAssertEqual(mesh.levels[0].error, 0)
+        XCTAssertGreaterThan(mesh.levels[1].error, 0)
+
+        XCTAssertThrowsError(try CompiledMesh(data: Data([1, 2, 3])))
+    }
+
+    func testPicksLevelsByDistance() throws {
+        let mesh = try CompiledMesh(data: MeshCompiler.compile(try OBJMesh.parse(grid(50).data(using: .utf8)!)))
+        let last = mesh.levels.count - 1
+        func level(at distance: Double, current: Int? = nil) -> Int {
+            return MeshFeatureLoader.level(of: mesh, distance: distance, focalLength: 1000, tolerance: 1, current: current)
+        }
+        XCTAssertEqual(level(at: 1), 0)
+        XCTAssertEqual(level(at: 1_000_000), last)
+
+        // where level 1 is off by 1.1 points, it is kept but not switched to
+        let distance = Double(mesh.levels[1].error) * 1000 / 1.1
+        XCTAssertEqual(level(at: distance, current: 1), 1)
+        XCTAssertEqual(level(at: distance, current: 0), 0)
+        XCTAssertEqual(level(at: distance * 2, current: 0), 1)
+    }
+
+    func testCachesAndSharesMeshes() throws {
+        let directory = URL(fileURLWithPath: NSTemporaryDirectory()).appendingPathComponent(UUID().uuidString)
+        try FileManager.default.createDirectory(at: directory, withIntermediateDirectories: true, attributes: nil)
+        defer { try? FileManager.default.removeItem(at: directory) }
+        let first = directory.appendingPathComponent("cart.obj"), second = directory.appendingPathComponent("copy.obj")
+        try cube.write(to: first, atomically: true, encoding: .utf8)
+        try cube.write(to: second, atomically: true, encoding: .utf8)
+
+        let cache = MeshCache(directory: directory.appendingPathComponent("cache"))
+        let mesh = try cache.mesh(forFile: first.path)
+        XCTAssertTrue(try cache.mesh(forFile: first.path) === mesh)
+        cache.removeAll()
+        // mapped from the cache file this time
+        XCTAssertEqual(try cache.mesh(forFile: first.path).contentHash, mesh.contentHash)
+
+        let objFile = try cache.objFile(for: mesh)
+        XCTAssertEqual(try cache.objFile(for: try cache.mesh(forFile: second.path)), objFile)
+        let compact = try OBJMesh.parse(try Data(contentsOf: URL(fileURLWithPath: objFile)))
+        XCTAssertEqual(compact.indices.count, 36)
+        XCTAssertEqual(compact.vertexCount, 16)
+    }
+}
@@ -0,0 +1,99 @@
+//
+//  SnapshotBufferTests.swift
+//  DeepMapTestIOSTests
+//
+//  Created by agent on 18.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+import XCTest
+@testable import DeepMapTestIOS
+
+class SnapshotBufferTests: XCTestCase {
+
+    final class Scene {
+        let version: Int
+        init(_ version: Int) { self.version = version }
+    }
+
+    func testKeepsServingOldSnapshotWhileBuilding() {
+        let buffer = SnapshotBuffer<Scene>(Scene(0))
+        let held = buffer.current
+        let gate = DispatchSemaphore(value: 0)
+        buffer.rebuild { _ in
+            gate.wait()
+            return Scene(1)
+        }
+        XCTAssertEqual(buffer.current?.version, 0)
+        gate.signal()
+        buffer.waitForBuilds()
+
+        XCTAssertEqual(held?.version, 0)
+        XCTAssertEqual(buffer.current?.version, 1)
+        XCTAssertEqual(buffer.statistics.published, 1)
+    }
+
+    func testDropsSupersededBuilds() {
+        let buffer = SnapshotBuffer<Scene>()
+        let gate = DispatchSemaphore(value: 0)
+        var sawSuperseded = false
+        buffer.rebuild { isSuperseded in
+            gate.wait()
+            sawSuperseded = isSuperseded()
+            // finishes last, but must not replace the newer snapshot
+            return Scene(1)
+        }
+        let published = expectation(description: "newer snapshot swapped in")
+        buffer.didSwap = { scene in
+            XCTAssertEqual(scene.version, 2)
+            published.fulfill()
+        }
+        buffer.rebuild { _ in Scene(2) }
+        wait(for: [published], timeout: 5)
+
+        gate.signal()
+        buffer.waitForBuilds()
+        XCTAssertTrue(sawSuperseded)
+        XCTAssertEqual(buffer.current?.version, 2)
+        let statistics = buffer.statistics
+        XCTAssertEqual(statistics.requested, 2)
+        XCTAssertEqual(statistics.published, 1)
+        XCTAssertEqual(statistics.dropped, 1)
+
+        buffer.rebuild { _ in nil }
+        buffer.waitForBuilds()
+        XCTAssertEqual(buffer.current?.version, 2)
+        XCTAssertEqual(buffer.statistics.dropped, 2)
+    }
+
+    func testRestyleAfterMapSwitchDerivesFromPendingBuild() {
+        let buffer = SnapshotBuffer<Scene>(Scene(0))
+        let gate = DispatchSemaphore(value: 0)
+        let counting = NSLock()
+        var baseBuilds = 0
+        // a map switch still building when the style changes
+        buffer.rebuild { _ in
+            gate.wait()
+            counting.lock()
+            baseBuilds += 1
+            counting.unlock()
+            return Scene(1)
+        }
+        XCTAssertTrue(buffer.rebuild(derivingFrom: { scene, _ in Scene(scene.version + 10) }))
+        gate.signal()
+        gate.signal()
+        buffer.waitForBuilds()
+
+        // the style applies to the new map, not to the one shown before the switch
+        XCTAssertEqual(buffer.current?.version, 11)
+        XCTAssertEqual(baseBuilds, 2)
+
+        // with nothing pending, the front snapshot is restyled
+        buffer.rebuild(derivingFrom: { scene, _ in Scene(scene.version + 10) })
+        buffer.waitForBuilds()
+        XCTAssertEqual(buffer.current?.version, 21)
+        XCTAssertEqual(baseBuilds, 2)
+
+        XCTAssertFalse(SnapshotBuffer<Scene>().rebuild(derivingFrom: { scene, _ in scene }))
+    }
+}
@@ -0,0 +1,140 @@
+//
+//  SoftwareRendererTests.swift
+//  DeepMapTestIOSTests
+//
+//  Created by agent on 18.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+import XCTest
+@testable import DeepMapTestIOS
+
+class SoftwareRendererTests: XCTestCase {
+
+    let sheet = try! StyleSheet(source: """
+        feature room {
+            fill-color: #FF0000;
+        }
+        feature corridor {
+            line-color: #0000FF;
+            line-width: 4.0;
+        }
+        feature office {
+            fill-color: #FF0000;
+        }
+        feature icon_cafe {
+            text-color: #202020;
+            icon-size: 8.0;
+        }
+        rule roomSelectRule(room) ["isSelected()"] {
+            fill-color: #00FF00;
+        }
+        """)
+
+    /// 100 m square around the origin.
+    let room = RenderPrimitive(featureId: 1, type: "room", level: 0, geometry: .polygon([[
+        RenderPoint(x: -50, y: -50), RenderPoint(x: 50, y: -50), RenderPoint(x: 50, y: 50), RenderPoint(x: -50, y: 50),
+    ]]))
+
+    func makeCamera() -> RenderCamera {
+        return RenderCamera.fitting((-100, -100, 100, 100), width: 64, height: 64, margin: 0)
+    }
+
+    func testFillsPolygonFromTop() {
+        let renderer = SoftwareRenderer(sheet: sheet)
+        renderer.background = StyleColor(rgba: 0xFFFFFFFF)
+        renderer.tileSize = 16
+        let image = renderer.render([room], camera: makeCamera())
+
+        XCTAssertEqual(image.color(x: 32, y: 32), StyleColor(rgba: 0xFF0000FF))
+        XCTAssertEqual(image.color(x: 17, y: 17), StyleColor(rgba: 0xFF0000FF))
+        XCTAssertEqual(image.color(x: 2, y: 2), StyleColor(rgba: 0xFFFFFFFF))
+        XCTAssertEqual(image.color(x: 60, y: 32), StyleColor(rgba: 0xFFFFFFFF))
+        XCTAssertEqual(renderer.statistics.shapes, 1)
+        XCTAssertLessThan(renderer.statistics.occupiedTiles, renderer.statistics.tiles)
+    }
+
+    func testNorthIsUp() {
+        let line = RenderPrimitive(featureId: 2, type: "corridor", level: 0, geometry: .line([
+            RenderPoint(x: -90, y: 80), RenderPoint(x: 90, y: 80),
+        ]))
+        let image = SoftwareRenderer(sheet: sheet).render([line], camera: makeCamera())
+
+        XCTAssertEqual(image.color(x: 32, y: 6), StyleColor(rgba: 0x0000FFFF))
+        XCTAssertNotEqual(image.color(x: 32, y: 57), StyleColor(rgba: 0x0000FFFF))
+    }
+
+    func testSelectionAndVisibility() {
+        let renderer = SoftwareRenderer(sheet: sheet)
+        renderer.states = FeatureStateBuffer(store: nil)
+        renderer.states?.insert(.selected, featureId: 1)
+        XCTAssertEqual(renderer.render([room], camera: makeCamera()).color(x: 32, y: 32), StyleColor(rgba: 0x00FF00FF))
+
+        let visibility = FeatureVisibility(store: FeatureTagStore(tags: [(1, "level", "0")]))
+        visibility.setFeaturesVisible(false, [1])
+        renderer.visibility = visibility
+        XCTAssertEqual(renderer.render([room], camera: makeCamera()).color(x: 32, y: 32), renderer.background)
+        XCTAssertEqual(renderer.statistics.culled, 1)
+    }
+
+    func testBatchesByResolvedStyle() {
+        let office = RenderPrimitive(featureId: 3, type: "office", level: 0, geometry: .polygon([[
+            RenderPoint(x: 60, y: 60), RenderPoint(x: 90, y: 60), RenderPoint(x: 90, y: 90),
+        ]]))
+        let cafes = (10..<110).map { index in
+            RenderPrimitive(featureId: UInt64(index), type: "icon_cafe", level: 0,
+                            geometry: .point(RenderPoint(x: Double(index) - 60, y: -80)))
+        }
+        let states = FeatureStateBuffer(store: nil)
+        states.insert(.selected, featureId: 1)
+        let scene = RenderScene(primitives: [room, office] + cafes, sheet: sheet, states: states)
+
+        // the selected room is green, the office red; all cafes are one instanced batch
+        XCTAssertEqual(scene.batches.map { $0.kind }, [.area, .area, .icon])
+        XCTAssertEqual(scene.batches[2].instances.count, 100)
+        XCTAssertEqual(scene.icons, ["icon_cafe"])
+
+        let unselected = RenderScene(primitives: [room, office] + cafes, sheet: sheet)
+        XCTAssertEqual(unselected.batches.count, 2)
+        XCTAssertEqual(unselected.batches[0].parts.map { $0.featureId }, [1, 3])
+
+        let renderer = SoftwareRenderer(sheet: sheet)
+        _ = renderer.render(unselected, camera: makeCamera())
+        XCTAssertEqual(renderer.statistics.drawCalls, 2)
+        XCTAssertEqual(renderer.statistics.instances, 100)
+    }
+
+    func testImageDifference() {
+        let renderer = SoftwareRenderer(sheet: sheet)
+        let reference = renderer.render([room], camera: makeCamera())
+        var changed = reference
+        changed.pixels[0] = changed.pixels[0] &+ 3
+
+        XCTAssertEqual(reference.difference(from: reference).differingPixels, 0)
+        XCTAssertEqual(changed.difference(from: reference).differingPixels, 1)
+        XCTAssertEqual(changed.difference(from: reference, tolerance: 3).differingPixels, 0)
+    }
+
+    func testPNGEncoding() {
+        let png = RenderImage(width: 3, height: 2, fill: StyleColor(rgba: 0x336699FF)).pngData()
+
+        XCTAssertEqual(Array(png.prefix(8)), [0x89, 0x50, 0x4E, 0x47, 0x0D, 0x0A, 0x1A, 0x0A])
+        XCTAssertEqual(PNGEncoder.crc32(Array("IEND".utf8)), 0xAE426082)
+        XCTAssertEqual(PNGEncoder.adler32(Array("Wikipedia".utf8)), 0x11E60398)
+        // signature, IHDR, IDAT with 2 + 5 + 2 * 13 + 4 bytes, IEND
+        XCTAssertEqual(png.count, 8 + 25 + 12 + 37 + 12)
+    }
+
+    func testPNGRoundTrip() {
+        let renderer = SoftwareRenderer(sheet: sheet)
+        let image = renderer.render([room], camera: makeCamera())
+
+        for compressed in [false, true] {
+            let decoded = PNGDecoder.decode(image.pngData(compressed: compressed))
+            XCTAssertEqual(decoded?.width, image.width)
+            XCTAssertEqual(decoded?.pixels ?? [], image.pixels)
+        }
+        XCTAssertLessThan(image.pngData(compressed: true).count, image.pngData().count)
+        XCTAssertNil(PNGDecoder.decode(Data([0x89, 0x50, 0x4E, 0x47])))
+    }
+}
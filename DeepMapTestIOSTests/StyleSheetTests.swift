@@ -0,0 +1,102 @@
+//
+//  StyleSheetTests.swift
+//  DeepMapTestIOSTests
+//
+//  Created by agent on 18.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+import XCTest
+@testable import DeepMapTestIOS
+
+class StyleSheetTests: XCTestCase {
+
+    let source = """
+        /* base types */
+        feature polygon {
+            fill-color: #d0d0d0;
+            visibility: visible;
+        }
+        feature icon {
+            icon-size: 8.0;
+        }
+        feature visibility_building_polygon:polygon{}
+        feature visibility_in_building_icon:icon{
+                visibility: none;
+        }
+        feature building:visibility_building_polygon {
+            fill-color: #D7DEE3FF;
+            line-width: 2.0m;
+        }
+        feature stair:visibility_in_building_icon {
+            icon-size: 3.0;
+        }
+        rule building_SelectRule(building) ["isSelected()"] {
+            fill-color: #FFF200;
+        }
+        rule buildingRule(visibility_building_polygon) ["distance() < 200 "] {
+            rule iconsRule(visibility_in_building_icon){
+                visibility: visible;
+            }
+            text-visibility: none;
+        }
+        """
+
+    func testInheritance() throws {
+        let sheet = try StyleSheet(source: source)
+        let building = sheet.style(for: "building")
+
+        XCTAssertEqual(building?.string("fill-color"), "#D7DEE3FF")
+        XCTAssertEqual(building?.string("visibility"), "visible")
+        XCTAssertEqual(sheet.property("line-width").flatMap { building?.number($0) }, 2.0)
+        XCTAssertEqual(sheet.style(for: "stair")?.string("icon-size"), "3.0")
+        XCTAssertEqual(sheet.style(for: "stair")?.string("visibility"), "none")
+    }
+
+    func testRules() throws {
+        let sheet = try StyleSheet(source: source)
+        var context = StyleContext()
+        context.distance = 100
+
+        XCTAssertEqual(sheet.style(for: "stair", context: context)?.string("visibility"), "visible")
+        XCTAssertEqual(sheet.style(for: "building", context: context)?.string("text-visibility"), "none")
+        context.isSelected = true
+        let selected = sheet.style(for: "building", context: context)
+        XCTAssertEqual(sheet.property("fill-color").flatMap { selected?.color($0) }, StyleColor(rgba: 0xFFF200FF))
+
+        context.distance = 300
+        XCTAssertEqual(sheet.style(for: "stair", context: context)?.string("visibility"), "none")
+    }
+
+    func testConditions() throws {
+        let condition = try StyleCondition("attribute(\"status\") == 'open' && !(distance() >= 50)")
+        var context = StyleContext()
+        context.featureAttributes[Symbol("status")] = "open"
+        context.distance = 10
+
+        XCTAssertTrue(condition.evaluate(context))
+        context.distance = 50
+        XCTAssertFalse(condition.evaluate(context))
+        XCTAssertThrowsError(try StyleCondition("unknown() < 1"))
+    }
+
+    func testStyleCacheTakesTypesFromPrimitives() throws {
+        let sheet = try StyleSheet(source: source)
+        let store = FeatureTagStore(tags: [(1, "level", "0"), (2, "level", "0"), (3, "level", "1")])
+        let point = RenderPoint(x: 0, y: 0)
+        let cache = FeatureStyleCache(sheet: sheet, store: store, types: [
+            RenderPrimitive(featureId: 1, type: "building", level: 0, geometry: .point(point)),
+            RenderPrimitive(featureId: 2, type: "stair", level: 0, geometry: .point(point)),
+            RenderPrimitive(featureId: 3, type: "unstyled", level: 1, geometry: .point(point)),
+        ])
+
+        XCTAssertEqual(cache.typeIndex(ofFeature: 1), sheet.typeIndex(of: "building"))
+        XCTAssertEqual(cache.typeIndex(ofFeature: 3), -1)
+        XCTAssertEqual(cache.invalidate(types: [sheet.typeIndex(of: "stair")]), [2])
+        XCTAssertEqual(cache.style(forFeature: 1, context: StyleContext())?.string("fill-color"), "#D7DEE3FF")
+    }
+
+    func testUnknownParentFails() {
+        XCTAssertThrowsError(try StyleSheet(source: "feature stand:missing { fill-color: #fff; }"))
+    }
+}
@@ -0,0 +1,192 @@
+//
+//  StyleUpdaterTests.swift
+//  DeepMapTestIOSTests
+//
+//  Created by agent on 18.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+import XCTest
+@testable import DeepMapTestIOS
+
+/// Records the map calls of a `StyleUpdater` instead of making them.
+final class RecordingStyleTarget: StyleTarget {
+    var calls: [String] = []
+
+    var reloads: Int {
+        return calls.filter { $0 == "reloadStyle" }.count
+    }
+
+    func setFeatureStyle(_ featureName: String, propertyName: String, value: String, update: Bool) -> Bool {
+        calls.append("style \(featureName).\(propertyName)=\(value)")
+        return true
+    }
+
+    func showFeatures(_ featureName: String, update: Bool) {
+        calls.append("show \(featureName)")
+    }
+
+    func hideFeatures(_ featureName: String, update: Bool) {
+        calls.append("hide \(featureName)")
+    }
+
+    func reloadStyle() {
+        calls.append("reloadStyle")
+    }
+
+    func setFeatureAttribute(_ key: String, value: String, withFeatureId featureId: UInt64) {
+        calls.append("attribute \(featureId).\(key)=\(value)")
+    }
+
+    func removeFeatureAttribute(_ key: String, withFeatureId featureId: UInt64) {
+        calls.append("remove \(featureId).\(key)")
+    }
+
+    func setGlobalAttribute(_ key: String, value: String) {
+        calls.append("global \(key)=\(value)")
+    }
+
+    func removeGlobalAtribute(_ key: String) {
+        calls.append("remove global \(key)")
+    }
+
+    func selectFeature(withId featureId: UInt64) {
+        calls.append("select \(featureId)")
+    }
+
+    func deselectFeature(withId featureId: UInt64) {
+        calls.append("deselect \(featureId)")
+    }
+
+    func highlightFeature(withId featureId: UInt64) {
+        calls.append("highlight \(featureId)")
+    }
+
+    func unhighlightFeature(withId featureId: UInt64) {
+        calls.append("unhighlight \(featureId)")
+    }
+}
+
+class StyleUpdaterTests: XCTestCase {
+
+    let source = """
+        feature room {
+            fill-color: #d0d0d0;
+        }
+        rule occupiedRule(room) ["attribute('occupied') == 'yes'"] {
+            fill-color: #ff0000;
+        }
+        rule nightRule(room) ["globalAttribute('night') == 'yes'"] {
+            fill-color: #202020;
+        }
+        """
+
+    func testSkipsCallsThatChangeNothing() throws {
+        let target = RecordingStyleTarget()
+        let updater = StyleUpdater(mapView: target, sheet: try StyleSheet(source: source))
+
+        // the compiled sheet already has this value
+        updater.setFeatureStyle("room", property: "fill-color", value: "#d0d0d0")
+        updater.flush()
+        XCTAssertEqual(target.calls, [])
+
+        updater.setFeatureStyle("room", property: "fill-color", value: "#00ff00")
+        updater.setFeatureStyle("room", property: "fill-color", value: "#00ff00")
+        updater.hideFeatures("room")
+        updater.hideFeatures("room")
+        updater.setGlobalAttribute("night", value: "yes")
+        updater.setGlobalAttribute("night", value: "yes")
+        updater.flush()
+        XCTAssertEqual(target.calls, ["style room.fill-color=#00ff00", "hide room", "global night=yes", "reloadStyle"])
+        XCTAssertEqual(updater.skippedCalls, 4)
+        XCTAssertEqual(updater.updates, 1)
+
+        // nothing left to refresh
+        updater.flush()
+        XCTAssertEqual(target.reloads, 1)
+    }
+
+    func testRefreshesOnlyForAttributesRulesRead() throws {
+        let target = RecordingStyleTarget()
+        let updater = StyleUpdater(mapView: target, sheet: try StyleSheet(source: source))
+        var invalidated: [UInt64] = []
+        updater.didInvalidate = { invalidation in
+            if case .features(let featureIds) = invalidation {
+                invalidated += featureIds
+            }
+        }
+
+        // no rule reads these: the map gets the values, the scene is not refreshed
+        updater.setFeatureAttribute("note", value: "hello", featureId: 1)
+        updater.setGlobalAttribute("weather", value: "rain")
+        updater.flush()
+        XCTAssertEqual(target.reloads, 0)
+        XCTAssertEqual(invalidated, [])
+
+        updater.setFeatureAttribute("occupied", value: "yes", featureId: 1)
+        updater.setFeatureAttribute("occupied", value: "yes", featureId: 2)
+        updater.setFeatureAttribute("occupied", value: "yes", featureId: 1)
+        updater.flush()
+        XCTAssertEqual(target.reloads, 1)
+        XCTAssertEqual(invalidated, [1, 2])
+        XCTAssertEqual(updater.featureAttributes(of: 1), ["note": "hello", "occupied": "yes"])
+
+        updater.removeFeatureAttribute("occupied", featureId: 2)
+        updater.removeFeatureAttribute("occupied", featureId: 2)
+        updater.flush()
+        XCTAssertEqual(target.reloads, 2)
+        XCTAssertEqual(target.calls.filter { $0.hasPrefix("remove") }, ["remove 2.occupied"])
+    }
+
+    func testTypedFeaturesRestyleWithoutRefresh() throws {
+        let target = RecordingStyleTarget()
+        let sheet = try StyleSheet(source: source)
+        let store = FeatureTagStore(tags: [(1, "level", "0"), (2, "level", "0")])
+        let updater = StyleUpdater(mapView: target, sheet: sheet)
+        updater.styleCache = FeatureStyleCache(sheet: sheet, store: store, types: [
+            RenderPrimitive(featureId: 1, type: "room", level: 0, geometry: .point(RenderPoint(x: 0, y: 0))),
+        ])
+        var invalidated: [UInt64] = []
+        updater.didInvalidate = { invalidation in
+            if case .features(let featureIds) = invalidation {
+                invalidated += featureIds
+            }
+        }
+
+        updater.setFeatureAttribute("occupied", value: "yes", featureId: 1)
+        updater.flush()
+        XCTAssertEqual(target.calls, ["attribute 1.occupied=yes"])
+        XCTAssertEqual(invalidated, [1])
+
+        // the type of feature 2 is unknown, so rules may apply to it
+        updater.setFeatureAttribute("occupied", value: "yes", featureId: 2)
+        updater.flush()
+        XCTAssertEqual(target.reloads, 1)
+        XCTAssertEqual(invalidated, [1, 2])
+    }
+
+    func testResetSendsValuesAgain() throws {
+        let target = RecordingStyleTarget()
+        let updater = StyleUpdater(mapView: target, sheet: try StyleSheet(source: source))
+        updater.hideFeatures("room")
+        updater.setGlobalAttribute("night", value: "yes")
+        updater.flush()
+
+        // a new map or style does not have the values sent to the old one
+        updater.reset()
+        updater.hideFeatures("room")
+        updater.setGlobalAttribute("night", value: "yes")
+        updater.flush()
+        XCTAssertEqual(target.calls.filter { $0 == "hide room" }.count, 2)
+        XCTAssertEqual(target.calls.filter { $0 == "global night=yes" }.count, 2)
+        XCTAssertEqual(updater.skippedCalls, 0)
+    }
+
+    func testWithoutSheetEveryAttributeRefreshes() {
+        let target = RecordingStyleTarget()
+        let updater = StyleUpdater(mapView: target)
+        updater.setFeatureAttribute("note", value: "hello", featureId: 1)
+        updater.flush()
+        XCTAssertEqual(target.reloads, 1)
+    }
+}
@@ -0,0 +1,47 @@
+//
+//  SymbolTableTests.swift
+//  DeepMapTestIOSTests
+//
+//  Created by agent on 18.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+import XCTest
+@testable import DeepMapTestIOS
+
+class SymbolTableTests: XCTestCase {
+
+    func testInterningReturnsSameSymbol() {
+        let building = Symbol("building")
+        let literal: Symbol = "building"
+
+        XCTAssertEqual(building, literal)
+        XCTAssertNotEqual(building, Symbol("stand_tables"))
+        XCTAssertEqual(building.string, "building")
+        XCTAssertEqual(SymbolTable.shared.lookup("building"), building)
+    }
+
+    func testLookupDoesNotIntern() {
+        let count = SymbolTable.shared.count
+
+        XCTAssertNil(SymbolTable.shared.lookup("symbol-table-test-unknown"))
+        XCTAssertEqual(SymbolTable.shared.count, count)
+    }
+
+    #if DEBUG
+    func testCountsComparisons() {
+        let before = SymbolTable.shared.statistics.comparisons
+        _ = Symbol("building") == Symbol("stand_tables")
+        XCTAssertGreaterThanOrEqual(SymbolTable.shared.statistics.comparisons, before + 1)
+    }
+    #endif
+
+    func testTagStoreKeysAreSymbols() {
+        let store = FeatureTagStore(tags: [(1, "name:en", "Mathematikon"), (1, "level", "0")])
+
+        let key = store.key(Symbol("level"))
+        XCTAssertNotNil(key)
+        XCTAssertEqual(key, store.key("level"))
+        XCTAssertEqual(key.map { store.name(of: $0) }, "level")
+    }
+}
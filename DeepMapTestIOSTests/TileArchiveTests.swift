@@ -0,0 +1,99 @@
+//
+//  TileArchiveTests.swift
+//  DeepMapTestIOSTests
+//
+//  Created by agent on 18.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+import XCTest
+@testable import DeepMapTestIOS
+
+class TileArchiveTests: XCTestCase {
+
+    /// A 400 m square of one room type in Heidelberg, on level 0.
+    struct SquareSource: RenderGeometrySource {
+        func primitives(level: Float?) -> [RenderPrimitive] {
+            guard level == nil || level == 0 else { return [] }
+            let ring = [RenderPoint(x: 476000, y: 5473000), RenderPoint(x: 476400, y: 5473000),
+                        RenderPoint(x: 476400, y: 5473400), RenderPoint(x: 476000, y: 5473400)]
+            return [RenderPrimitive(featureId: 1, type: "room", level: 0, geometry: .polygon([ring]))]
+        }
+    }
+
+    func testTileCoordinates() {
+        let tile = TileCoordinate(zoom: 16, longitude: 8.6724, latitude: 49.4093)
+        let bounds = tile.bounds
+
+        XCTAssertEqual(tile, TileCoordinate(zoom: 16, x: 34346, y: 22392))
+        XCTAssertLessThanOrEqual(bounds.west, 8.6724)
+        XCTAssertGreaterThan(bounds.east, 8.6724)
+        XCTAssertLessThanOrEqual(bounds.south, 49.4093)
+        XCTAssertGreaterThan(bounds.north, 49.4093)
+        XCTAssertEqual(TileCoordinate(zoom: 1, x: 0, y: 0).tmsY, 1)
+    }
+
+    func testUTMRoundTrip() {
+        let point = UTMProjection.zone32N.project(longitude: 8.6724, latitude: 49.4093)
+        let position = UTMProjection.zone32N.unproject(point)
+
+        XCTAssertEqual(point.x, 476235.49, accuracy: 0.01)
+        XCTAssertEqual(point.y, 5473008.93, accuracy: 0.01)
+        XCTAssertEqual(position.longitude, 8.6724, accuracy: 1e-8)
+        XCTAssertEqual(position.latitude, 49.4093, accuracy: 1e-8)
+    }
+
+    func testProjectionFromProj4() {
+        let projection = UTMProjection(proj4: "+proj=utm +zone=32 +datum=WGS84 +units=m +no_defs ")
+
+        XCTAssertEqual(projection?.zone, 32)
+        XCTAssertEqual(projection?.northernHemisphere, true)
+        XCTAssertEqual(UTMProjection(proj4: "+proj=utm +zone=56 +south +ellps=WGS84")?.northernHemisphere, false)
+        XCTAssertNil(UTMProjection(proj4: "+proj=longlat +datum=WGS84"))
+        XCTAssertNil(UTMProjection(proj4: "+proj=utm +zone=32 +ellps=intl"))
+    }
+
+    func testPyramidSkipsEmptyAndSharesDuplicates() throws {
+        let path = NSTemporaryDirectory() + "TileArchiveTests.mbtiles"
+        defer { try? FileManager.default.removeItem(atPath: path) }
+        let sheet = try StyleSheet(source: "feature room { fill-color: #FF0000; }")
+        let renderer = TilePyramidRenderer(sources: [SquareSource()], sheet: sheet, projection: UTMProjection(zone: 32))
+        renderer.tileSize = 32
+
+        let report = try renderer.render(levels: [0, 1], zoomLevels: 17...19, into: TileArchiveWriter(path: path))
+
+        var stored = 0, images = 0
+        let reader = try SQLiteReader(path: path)
+        try reader.query("SELECT count(*) FROM tiles") { row, _ in
+            stored = Int(row.int64(at: 0))
+            return false
+        }
+        try reader.query("SELECT count(*) FROM images") { row, _ in
+            images = Int(row.int64(at: 0))
+            return false
+        }
+        XCTAssertGreaterThan(report.rendered, 0)
+        XCTAssertEqual(stored, report.rendered)
+        // every interior tile is plain red
+        XCTAssertGreaterThan(report.duplicates, 0)
+        XCTAssertEqual(images, report.rendered - report.duplicates)
+    }
+
+    func testMetadataIsStoredVerbatim() throws {
+        let path = NSTemporaryDirectory() + "TileArchiveMetadata.mbtiles"
+        defer { try? FileManager.default.removeItem(atPath: path) }
+        let archive = try TileArchiveWriter(path: path)
+        try archive.setMetadata("name", "Mensa' ); DROP TABLE images; --")
+        try archive.setMetadata("name", "Bergheimer Str. 'Altbau'")
+        try archive.finish()
+
+        var names: [String] = []
+        let reader = try SQLiteReader(path: path)
+        try reader.query("SELECT value FROM metadata WHERE name = 'name'") { row, _ in
+            names.append(row.string(at: 0) ?? "")
+            return true
+        }
+        try reader.query("SELECT count(*) FROM images") { _, _ in false }
+        XCTAssertEqual(names, ["Bergheimer Str. 'Altbau'"])
+    }
+}
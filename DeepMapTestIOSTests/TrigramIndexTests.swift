@@ -0,0 +1,47 @@
+//
+//  TrigramIndexTests.swift
+//  DeepMapTestIOSTests
+//
+//  Created by agent on 18.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+import XCTest
+@testable import DeepMapTestIOS
+
+class TrigramIndexTests: XCTestCase {
+
+    func makeIndex() -> TrigramIndex {
+        let store = FeatureTagStore(tags: [
+            (1, "name:en", "Mathematikon"), (1, "level", "0"),
+            (2, "name:en", "Heidelberger Druckmaschinen"), (2, "level", "1"),
+            (3, "name:en", "Café Botanik"), (3, "level", "1"),
+            (3, "name:de", "Café Botanik"),
+        ])
+        return TrigramIndex(store: store)
+    }
+
+    func testFindsMisspelledNames() {
+        let index = makeIndex()
+
+        XCTAssertEqual(index.fuzzySearch("Mathematicon", locale: "en").first?.featureId, 1)
+        XCTAssertEqual(index.fuzzySearch("cafe botnik", locale: "en").first?.featureId, 3)
+        XCTAssertTrue(index.fuzzySearch("Mathematicon", locale: "de").isEmpty)
+    }
+
+    func testLevelFilter() {
+        let index = makeIndex()
+
+        XCTAssertEqual(index.fuzzySearch("botanik", locale: "en", level: 1).count, 1)
+        XCTAssertTrue(index.fuzzySearch("botanik", locale: "en", level: 0).isEmpty)
+    }
+
+    func testUpdateReplacesIndexedName() {
+        let index = makeIndex()
+        index.update(featureId: 2, key: "name:en", value: "Printing Hall")
+
+        XCTAssertEqual(index.fuzzySearch("printng hall", locale: "en").first?.featureId, 2)
+        XCTAssertTrue(index.fuzzySearch("Druckmaschinen", locale: "en").isEmpty)
+        XCTAssertEqual(index.count, 4)
+    }
+}
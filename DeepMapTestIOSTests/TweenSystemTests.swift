@@ -0,0 +1,97 @@
+//
+//  TweenSystemTests.swift
+//  DeepMapTestIOSTests
+//
+//  Created by agent on 18.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+import XCTest
+import HDMMapCore
+@testable import DeepMapTestIOS
+
+class TweenSystemTests: XCTestCase {
+
+    func testEvaluatesBuiltInCurves() {
+        let tweens = TweenSystem()
+        var updates: [[Float]] = []
+        var completed: Bool?
+        let linear = tweens.add(from: [0, 10], to: [1, 20], duration: 1, easing: .linear, at: 0,
+                                update: { updates.append(Array($0)) }, completion: { completed = $0 })
+        let cubic = tweens.add(from: [0], to: [1], duration: 1, easing: .cubicInOut, at: 0, update: nil)
+        let quadratic = tweens.add(from: [0], to: [1], duration: 1, easing: TweenEasing(HDMEasingQuadraticOut), at: 0, update: nil)
+        let delayed = tweens.add(from: [5], to: [6], duration: 1, delay: 0.5, easing: .linear, at: 0, update: nil)
+
+        tweens.step(at: 0.25)
+        XCTAssertEqual(updates.last!, [0.25, 12.5])
+        XCTAssertEqual(tweens.values(of: cubic)![0], 4 * 0.25 * 0.25 * 0.25, accuracy: 1e-6)
+        XCTAssertEqual(tweens.values(of: quadratic)![0], 0.25 * 1.75, accuracy: 1e-6)
+        XCTAssertEqual(tweens.values(of: delayed)!, [5])
+        tweens.step(at: 0.75)
+        XCTAssertEqual(tweens.values(of: cubic)![0], 1 - 4 * 0.25 * 0.25 * 0.25, accuracy: 1e-6)
+        XCTAssertEqual(tweens.values(of: delayed)![0], 5.25, accuracy: 1e-6)
+        XCTAssertNil(completed)
+
+        tweens.step(at: 1)
+        XCTAssertEqual(updates.last!, [1, 20])
+        XCTAssertEqual(completed, true)
+        XCTAssertNil(tweens.values(of: linear))
+        XCTAssertEqual(tweens.count, 1)
+        XCTAssertEqual(tweens.values(of: delayed)![0], 5.5, accuracy: 1e-6)
+        tweens.step(at: 1.5)
+        XCTAssertFalse(tweens.isAnimating)
+        XCTAssertEqual(tweens.statistics.completed, 4)
+    }
+
+    func testRunsCustomCurvesInBatches() {
+        let tweens = TweenSystem()
+        var batches: [Int] = []
+        let steps = tweens.register { progress in
+            batches.append(progress.count)
+            for index in progress.indices {
+                progress[index] = (progress[index] * 4).rounded(.down) / 4
+            }
+        }
+        let square: HDMMapEasingFunction1f = { time, source, change, duration, _ in
+            return source + change * Float(time / duration) * Float(time / duration)
+        }
+        let squared = tweens.register(square)
+
+        let first = tweens.add(from: [0], to: [8], duration: 1, easing: steps, at: 0, update: nil)
+        let second = tweens.add(from: [0, 0], to: [1, -1], duration: 1, easing: steps, at: 0, update: nil)
+        let third = tweens.add(from: [2], to: [4], duration: 1, easing: squared, at: 0, update: nil)
+        tweens.step(at: 0.6)
+        XCTAssertEqual(batches, [3])
+        XCTAssertEqual(tweens.values(of: first)!, [4])
+        XCTAssertEqual(tweens.values(of: second)!, [0.5, -0.5])
+        XCTAssertEqual(tweens.values(of: third)![0], 2 + 2 * 0.36, accuracy: 1e-5)
+    }
+
+    func testCancelsAndCompactsManyTweens() {
+        let tweens = TweenSystem()
+        var cancelled = 0
+        let ids = (0..<1000).map { index in
+            tweens.add(from: [Float(index)], to: [Float(index) + 1], duration: 1 + Double(index % 3),
+                       easing: index % 2 == 0 ? .linear : .quadraticIn, at: 0, update: nil,
+                       completion: { if !$0 { cancelled += 1 } })
+        }
+        for id in ids where id % 5 == 0 {
+            tweens.cancel(id)
+        }
+        XCTAssertEqual(cancelled, 200)
+
+        tweens.step(at: 0.5)
+        XCTAssertEqual(tweens.statistics.lanes, 800)
+        for (index, id) in ids.enumerated() where id % 5 != 0 {
+            let t = 0.5 / Float(1 + index % 3)
+            XCTAssertEqual(tweens.values(of: id)![0], Float(index) + (index % 2 == 0 ? t : t * t), accuracy: 1e-3)
+        }
+
+        tweens.step(at: 1)
+        XCTAssertEqual(tweens.count, 800 - 267)
+        let survivor = ids[998]
+        XCTAssertEqual(tweens.values(of: survivor)![0], 998 + 1.0 / 3, accuracy: 1e-3)
+        XCTAssertEqual(tweens.statistics.frames, 2)
+        XCTAssertEqual(tweens.statistics.cancelled, 200)
+    }
+}